@@ -1954,6 +1954,27 @@ gf_dirent_to_dirent (gf_dirent_t *gf_dirent, struct dirent *dirent)
 }
 
 
+/*
+ * readdirp may return entries without attributes, readdir-ahead does when it
+ * serves a cached listing. Look them up.
+ */
+static void
+glfd_entries_lookup (struct glfs *fs, xlator_t *subvol, inode_t *parent,
+		     gf_dirent_t *entries)
+{
+	gf_dirent_t *entry = NULL;
+
+	list_for_each_entry (entry, &entries->list, list) {
+		if (entry->inode)
+			continue;
+
+		entry->inode = glfs_resolve_component (fs, subvol, parent,
+						       entry->d_name,
+						       &entry->d_stat, 1);
+	}
+}
+
+
 int
 glfd_entry_refresh (struct glfs_fd *glfd, int plus)
 {
@@ -1994,8 +2015,11 @@ glfd_entry_refresh (struct glfs_fd *glfd, int plus)
 				      &entries);
         DECODE_SYNCOP_ERR (ret);
 	if (ret >= 0) {
-		if (plus)
+		if (plus) {
 			gf_link_inodes_from_dirent (THIS, fd->inode, &entries);
+			glfd_entries_lookup (glfd->fs, subvol, fd->inode,
+					     &entries);
+		}
 
 		list_splice_init (&glfd->entries, &old.list);
 		list_splice_init (&entries.list, &glfd->entries);
@@ -212,6 +212,9 @@ int glfs_resolve_base (struct glfs *fs, xlator_t *subvol, inode_t *inode,
 int glfs_resolve_at (struct glfs *fs, xlator_t *subvol, inode_t *at,
                      const char *origpath, loc_t *loc, struct iatt *iatt,
                      int follow, int reval);
+inode_t *glfs_resolve_component (struct glfs *fs, xlator_t *subvol,
+				 inode_t *parent, const char *component,
+				 struct iatt *iatt, int force_lookup);
 int glfs_loc_touchup (loc_t *loc);
 void glfs_iatt_to_stat (struct glfs *fs, struct iatt *iatt, struct stat *stat);
 int glfs_loc_link (loc_t *loc, struct iatt *iatt);
@@ -5761,6 +5761,9 @@ cli_print_volume_status_itables (dict_t *dict, char *prefix)
         uint32_t        active_size = 0;
         uint32_t        lru_size = 0;
         uint32_t        purge_size = 0;
+        uint64_t        lru_hits = 0;
+        uint64_t        lru_misses = 0;
+        uint64_t        lru_evictions = 0;
         int             i =0;
 
         GF_ASSERT (dict);
@@ -5822,6 +5825,28 @@ cli_print_volume_status_itables (dict_t *dict, char *prefix)
                 cli_print_volume_status_inode_entry (dict, key);
         }
 
+        /* Older bricks do not send the lru statistics */
+        memset (key, 0, sizeof (key));
+        snprintf (key, sizeof (key), "%s.lru_hits", prefix);
+        ret = dict_get_uint64 (dict, key, &lru_hits);
+        if (ret)
+                goto out;
+        memset (key, 0, sizeof (key));
+        snprintf (key, sizeof (key), "%s.lru_misses", prefix);
+        ret = dict_get_uint64 (dict, key, &lru_misses);
+        if (ret)
+                goto out;
+        memset (key, 0, sizeof (key));
+        snprintf (key, sizeof (key), "%s.lru_evictions", prefix);
+        ret = dict_get_uint64 (dict, key, &lru_evictions);
+        if (ret)
+                goto out;
+
+        cli_out (" ");
+        cli_out ("%-20s : %"PRIu64, "LRU hits", lru_hits);
+        cli_out ("%-20s : %"PRIu64, "LRU misses", lru_misses);
+        cli_out ("%-20s : %"PRIu64, "LRU evictions", lru_evictions);
+
 out:
         return;
 }
@@ -0,0 +1,125 @@
+/*
+   Copyright (c) 2014 Red Hat, Inc. <http://www.redhat.com>
+   This file is part of GlusterFS.
+
+   This file is licensed to you under your choice of the GNU Lesser
+   General Public License, version 3 or any later version (LGPLv3 or
+   later), or the GNU General Public License, version 2 (GPLv2), in all
+   cases as published by the Free Software Foundation.
+*/
+
+/*
+ * dict-bm: measure the cost of dict_set/dict_get and of the interned key
+ * variants dict_setk/dict_getk as the number of keys in a dict grows.
+ *
+ * Keys look like the xattrs carried in lookup/readdirp xdata, e.g.
+ * "trusted.afr.patchy-client-3".
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include "glusterfs.h"
+#include "globals.h"
+#include "dict.h"
+
+#define BM_MAX_KEYS 128
+
+static double
+bm_now (void)
+{
+        struct timeval tv = {0, };
+
+        gettimeofday (&tv, NULL);
+
+        return tv.tv_sec * 1e9 + tv.tv_usec * 1e3;
+}
+
+static void
+bm_run (int nkeys, long rounds)
+{
+        char        keys[BM_MAX_KEYS][64];
+        dict_key_t *ikeys[BM_MAX_KEYS];
+        dict_t     *dict = NULL;
+        data_t     *value = NULL;
+        double      start = 0;
+        double      set_ns = 0;
+        double      get_ns = 0;
+        double      setk_ns = 0;
+        double      getk_ns = 0;
+        double      ops = 0;
+        long        r = 0;
+        int         i = 0;
+
+        for (i = 0; i < nkeys; i++) {
+                snprintf (keys[i], sizeof (keys[i]),
+                          "trusted.afr.patchy-client-%d", i);
+                ikeys[i] = dict_key_intern (keys[i]);
+        }
+
+        dict = dict_new ();
+        value = data_ref (data_from_uint64 (0));
+
+        start = bm_now ();
+        for (r = 0; r < rounds; r++)
+                for (i = 0; i < nkeys; i++)
+                        dict_set (dict, keys[i], value);
+        set_ns = bm_now () - start;
+
+        start = bm_now ();
+        for (r = 0; r < rounds; r++)
+                for (i = 0; i < nkeys; i++)
+                        dict_get (dict, keys[i]);
+        get_ns = bm_now () - start;
+
+        dict_unref (dict);
+        dict = dict_new ();
+
+        start = bm_now ();
+        for (r = 0; r < rounds; r++)
+                for (i = 0; i < nkeys; i++)
+                        dict_setk (dict, ikeys[i], value);
+        setk_ns = bm_now () - start;
+
+        start = bm_now ();
+        for (r = 0; r < rounds; r++)
+                for (i = 0; i < nkeys; i++)
+                        dict_getk (dict, ikeys[i]);
+        getk_ns = bm_now () - start;
+
+        dict_unref (dict);
+        data_unref (value);
+
+        ops = (double) rounds * nkeys;
+        printf ("%6d %10.1f %10.1f %10.1f %10.1f\n", nkeys, set_ns / ops,
+                get_ns / ops, setk_ns / ops, getk_ns / ops);
+}
+
+int
+main (int argc, char *argv[])
+{
+        glusterfs_ctx_t *ctx = NULL;
+        long             rounds = 0;
+        int              nkeys = 0;
+
+        rounds = (argc > 1) ? atol (argv[1]) : 100000;
+
+        ctx = glusterfs_ctx_new ();
+        if (!ctx || glusterfs_globals_init (ctx))
+                return 1;
+        THIS->ctx = ctx;
+
+        ctx->dict_pool = mem_pool_new (dict_t, 1024);
+        ctx->dict_pair_pool = mem_pool_new (data_pair_t, 4096);
+        ctx->dict_data_pool = mem_pool_new (data_t, 4096);
+        if (!ctx->dict_pool || !ctx->dict_pair_pool || !ctx->dict_data_pool)
+                return 1;
+
+        printf ("%6s %10s %10s %10s %10s   (ns per call)\n", "keys", "set",
+                "get", "setk", "getk");
+        for (nkeys = 1; nkeys <= BM_MAX_KEYS; nkeys *= 2)
+                bm_run (nkeys, rounds / nkeys + 1);
+
+        return 0;
+}
@@ -0,0 +1,213 @@
+/*
+   Copyright (c) 2014 Red Hat, Inc. <http://www.redhat.com>
+   This file is part of GlusterFS.
+
+   This file is licensed to you under your choice of the GNU Lesser
+   General Public License, version 3 or any later version (LGPLv3 or
+   later), or the GNU General Public License, version 2 (GPLv2), in all
+   cases as published by the Free Software Foundation.
+*/
+
+/*
+ * inode-bm: stress an inode table with 1, 2, 4 ... N threads resolving,
+ * linking and forgetting entries the way a brick or a fuse mount does.
+ *
+ * Every operation resolves "/dirN/fileM" component by component with
+ * inode_grep(). On a miss the entry is created with inode_new() and
+ * inode_link(), as on a lookup reply. One operation in 'forget-ratio'
+ * forgets the file again, so that inodes keep being retired and purged
+ * while other threads look them up.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+#include "glusterfs.h"
+#include "globals.h"
+#include "inode.h"
+
+#define BM_DIRS 64
+
+struct bm_state {
+        inode_table_t    *table;
+        inode_t          *dirs[BM_DIRS];
+        long              iterations;
+        int               files;
+        int               forget_ratio;
+        glusterfs_ctx_t  *ctx;
+        xlator_t         *xl;
+        pthread_barrier_t barrier;
+};
+
+static void
+bm_gfid (struct iatt *iatt, int dir, int file)
+{
+        memset (iatt, 0, sizeof (*iatt));
+        /* unique and spread over the gfid hash */
+        *(int *) &iatt->ia_gfid[0] = dir + 1;
+        *(int *) &iatt->ia_gfid[4] = file + 1;
+        iatt->ia_gfid[14] = file >> 8;
+        iatt->ia_gfid[15] = file ^ dir;
+        if (!iatt->ia_gfid[15])
+                iatt->ia_gfid[15] = 0xff;
+}
+
+static inode_t *
+bm_link (inode_table_t *table, inode_t *parent, const char *name,
+         struct iatt *iatt)
+{
+        inode_t *new = NULL;
+        inode_t *linked = NULL;
+
+        new = inode_new (table);
+        linked = inode_link (new, parent, name, iatt);
+        if (linked)
+                inode_lookup (linked);
+        inode_unref (new);
+
+        return linked;
+}
+
+static void *
+bm_worker (void *data)
+{
+        struct bm_state *state = data;
+        struct iatt      iatt = {0, };
+        char             name[32];
+        inode_t         *dir = NULL;
+        inode_t         *inode = NULL;
+        unsigned int     seed = 0;
+        long             i = 0;
+        int              d = 0;
+        int              f = 0;
+
+        THIS = state->xl;
+        seed = (unsigned long) pthread_self ();
+
+        pthread_barrier_wait (&state->barrier);
+
+        for (i = 0; i < state->iterations; i++) {
+                d = rand_r (&seed) % BM_DIRS;
+                f = rand_r (&seed) % state->files;
+
+                snprintf (name, sizeof (name), "dir%d", d);
+                dir = inode_grep (state->table, state->table->root, name);
+                if (!dir)
+                        continue;
+
+                snprintf (name, sizeof (name), "file%d", f);
+                inode = inode_grep (state->table, dir, name);
+                if (!inode) {
+                        bm_gfid (&iatt, d, f);
+                        inode = bm_link (state->table, dir, name, &iatt);
+                }
+
+                if (inode && (rand_r (&seed) % state->forget_ratio) == 0)
+                        inode_forget (inode, 0);
+
+                inode_unref (inode);
+                inode_unref (dir);
+        }
+
+        return NULL;
+}
+
+static double
+bm_run (struct bm_state *state, int nthreads)
+{
+        pthread_t      *threads = NULL;
+        struct timeval  start = {0, };
+        struct timeval  end = {0, };
+        int             i = 0;
+
+        threads = calloc (nthreads, sizeof (*threads));
+        if (!threads)
+                return 0;
+
+        pthread_barrier_init (&state->barrier, NULL, nthreads + 1);
+
+        for (i = 0; i < nthreads; i++)
+                pthread_create (&threads[i], NULL, bm_worker, state);
+
+        gettimeofday (&start, NULL);
+        pthread_barrier_wait (&state->barrier);
+
+        for (i = 0; i < nthreads; i++)
+                pthread_join (threads[i], NULL);
+        gettimeofday (&end, NULL);
+
+        pthread_barrier_destroy (&state->barrier);
+        free (threads);
+
+        return (end.tv_sec - start.tv_sec) +
+                (end.tv_usec - start.tv_usec) / 1000000.0;
+}
+
+int
+main (int argc, char *argv[])
+{
+        struct bm_state  state = {0, };
+        glusterfs_graph_t graph = {{0, }, };
+        xlator_t         xl = {0, };
+        struct iatt      iatt = {0, };
+        char             name[32];
+        int              max_threads = 32;
+        int              lru_limit = 16384;
+        int              nthreads = 0;
+        int              i = 0;
+        double           secs = 0;
+
+        if (argc > 1)
+                max_threads = atoi (argv[1]);
+        state.iterations = (argc > 2) ? atol (argv[2]) : 200000;
+        state.files = (argc > 3) ? atoi (argv[3]) : 1024;
+        state.forget_ratio = (argc > 4) ? atoi (argv[4]) : 16;
+        if (argc > 5)
+                lru_limit = atoi (argv[5]);
+        if (state.forget_ratio < 1)
+                state.forget_ratio = 1;
+
+        state.ctx = glusterfs_ctx_new ();
+        if (!state.ctx || glusterfs_globals_init (state.ctx))
+                return 1;
+        THIS->ctx = state.ctx;
+
+        graph.xl_count = 1;
+        xl.name = "inode-bm";
+        xl.ctx = state.ctx;
+        xl.graph = &graph;
+        state.xl = &xl;
+        THIS = &xl;
+
+        state.table = inode_table_new (lru_limit, &xl);
+        if (!state.table)
+                return 1;
+
+        for (i = 0; i < BM_DIRS; i++) {
+                snprintf (name, sizeof (name), "dir%d", i);
+                bm_gfid (&iatt, i, -1);
+                iatt.ia_type = IA_IFDIR;
+                state.dirs[i] = bm_link (state.table, state.table->root,
+                                         name, &iatt);
+        }
+
+        printf ("%8s %14s %14s %10s %10s\n", "threads", "ops/sec",
+                "ops/sec/thread", "active", "lru");
+        for (nthreads = 1; nthreads <= max_threads; nthreads *= 2) {
+                secs = bm_run (&state, nthreads);
+                printf ("%8d %14.0f %14.0f %10u %10u\n", nthreads,
+                        state.iterations * nthreads / secs,
+                        state.iterations / secs,
+                        state.table->active_size, state.table->lru_size);
+        }
+
+        printf ("lru: cap=%u hot=%u/%u hits=%"PRIu64" misses=%"PRIu64" "
+                "evictions=%"PRIu64"\n", state.table->lru_cap,
+                state.table->lru_hot_size, state.table->lru_hot_target,
+                state.table->lru_hits, state.table->lru_misses,
+                state.table->lru_evictions);
+
+        return 0;
+}
@@ -0,0 +1,134 @@
+/*
+   Copyright (c) 2014 Red Hat, Inc. <http://www.redhat.com>
+   This file is part of GlusterFS.
+
+   This file is licensed to you under your choice of the GNU Lesser
+   General Public License, version 3 or any later version (LGPLv3 or
+   later), or the GNU General Public License, version 2 (GPLv2), in all
+   cases as published by the Free Software Foundation.
+*/
+
+/*
+ * mem-pool-bm: measure mem_get/mem_put throughput of a single mem_pool
+ * shared by an increasing number of threads.
+ *
+ * Every thread repeatedly takes a burst of objects from the pool and puts
+ * them back, which is how call frames and dicts are used by a fop. With
+ * per-thread magazines the aggregate rate should grow with the number of
+ * threads instead of collapsing on the pool lock.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+#include "glusterfs.h"
+#include "globals.h"
+#include "mem-pool.h"
+
+#define BM_BURST 16
+
+struct bm_object {
+        char data[128];
+};
+
+struct bm_state {
+        struct mem_pool  *pool;
+        long              iterations;
+        glusterfs_ctx_t  *ctx;
+        pthread_barrier_t barrier;
+};
+
+static void *
+bm_worker (void *data)
+{
+        struct bm_state  *state = data;
+        struct bm_object *objs[BM_BURST];
+        long              i = 0;
+        int               j = 0;
+
+        THIS->ctx = state->ctx;
+
+        pthread_barrier_wait (&state->barrier);
+
+        for (i = 0; i < state->iterations; i++) {
+                for (j = 0; j < BM_BURST; j++)
+                        objs[j] = mem_get (state->pool);
+                for (j = 0; j < BM_BURST; j++)
+                        mem_put (objs[j]);
+        }
+
+        return NULL;
+}
+
+static double
+bm_run (struct bm_state *state, int nthreads)
+{
+        pthread_t      *threads = NULL;
+        struct timeval  start = {0, };
+        struct timeval  end = {0, };
+        int             i = 0;
+
+        threads = calloc (nthreads, sizeof (*threads));
+        if (!threads)
+                return 0;
+
+        pthread_barrier_init (&state->barrier, NULL, nthreads + 1);
+
+        for (i = 0; i < nthreads; i++)
+                pthread_create (&threads[i], NULL, bm_worker, state);
+
+        gettimeofday (&start, NULL);
+        pthread_barrier_wait (&state->barrier);
+
+        for (i = 0; i < nthreads; i++)
+                pthread_join (threads[i], NULL);
+        gettimeofday (&end, NULL);
+
+        pthread_barrier_destroy (&state->barrier);
+        free (threads);
+
+        return (end.tv_sec - start.tv_sec) +
+                (end.tv_usec - start.tv_usec) / 1000000.0;
+}
+
+int
+main (int argc, char *argv[])
+{
+        struct bm_state  state = {0, };
+        int              max_threads = 32;
+        int              nthreads = 0;
+        double           secs = 0;
+        double           ops = 0;
+
+        if (argc > 1)
+                max_threads = atoi (argv[1]);
+        state.iterations = (argc > 2) ? atol (argv[2]) : 100000;
+
+        state.ctx = glusterfs_ctx_new ();
+        if (!state.ctx || glusterfs_globals_init (state.ctx))
+                return 1;
+        THIS->ctx = state.ctx;
+
+        state.pool = mem_pool_new (struct bm_object, 1024);
+        if (!state.pool)
+                return 1;
+
+        printf ("%8s %14s %14s\n", "threads", "ops/sec", "ops/sec/thread");
+        for (nthreads = 1; nthreads <= max_threads; nthreads *= 2) {
+                secs = bm_run (&state, nthreads);
+                ops = 2.0 * BM_BURST * state.iterations * nthreads;
+                printf ("%8d %14.0f %14.0f\n", nthreads, ops / secs,
+                        ops / secs / nthreads);
+        }
+
+        printf ("slabs=%d hot=%d cold=%d misses=%"PRIu64" released=%"PRIu64
+                "\n", state.pool->nr_slabs, state.pool->hot_count,
+                state.pool->cold_count, state.pool->pool_misses,
+                state.pool->slabs_released);
+
+        mem_pool_destroy (state.pool);
+
+        return 0;
+}
@@ -0,0 +1,247 @@
+/*
+   Copyright (c) 2014 Red Hat, Inc. <http://www.redhat.com>
+   This file is part of GlusterFS.
+
+   This file is licensed to you under your choice of the GNU Lesser
+   General Public License, version 3 or any later version (LGPLv3 or
+   later), or the GNU General Public License, version 2 (GPLv2), in all
+   cases as published by the Free Software Foundation.
+*/
+
+/*
+ * readdirp-bm: measure the cost of encoding the readdirp replies of a large
+ * directory, for 16 to 4096 entries per reply.
+ *
+ * "list" is the encoder protocol/server used to have: a gfs3_dirplist node
+ * and a serialized dict buffer per entry, then xdr_sizeof and encoding of
+ * the list. "stream" is gfs3_encode_readdirp_rsp, which encodes the
+ * gf_dirent_t list straight into the reply buffer. Both must produce the
+ * same bytes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include "glusterfs.h"
+#include "globals.h"
+#include "dict.h"
+#include "gf-dirent.h"
+#include "glusterfs3.h"
+
+#define BM_MAX_BATCH 4096
+
+/* afr changelog, the value of the pending xattrs */
+static char pending[12];
+
+static double
+bm_now (void)
+{
+        struct timeval tv = {0, };
+
+        gettimeofday (&tv, NULL);
+
+        return tv.tv_sec * 1e9 + tv.tv_usec * 1e3;
+}
+
+/* entries the way posix returns them for afr on a replica 2 volume */
+static gf_dirent_t *
+bm_entries (int count)
+{
+        gf_dirent_t *entries = NULL;
+        gf_dirent_t *entry = NULL;
+        char         name[64] = {0, };
+        int          i = 0;
+
+        entries = calloc (1, sizeof (*entries));
+        if (!entries)
+                return NULL;
+        INIT_LIST_HEAD (&entries->list);
+
+        for (i = 0; i < count; i++) {
+                snprintf (name, sizeof (name), "file-%08d.dat", i);
+                entry = gf_dirent_for_name (name);
+                if (!entry)
+                        return NULL;
+
+                entry->d_ino = i + 1;
+                entry->d_off = i + 1;
+                entry->d_type = DT_REG;
+                entry->d_stat.ia_ino = i + 1;
+                entry->d_stat.ia_type = IA_IFREG;
+                entry->d_stat.ia_size = 4096 * i;
+                entry->d_stat.ia_gfid[15] = i & 0xff;
+
+                entry->dict = dict_new ();
+                if (!entry->dict ||
+                    dict_set_static_bin (entry->dict,
+                                         "trusted.afr.patchy-client-0",
+                                         pending, sizeof (pending)) ||
+                    dict_set_static_bin (entry->dict,
+                                         "trusted.afr.patchy-client-1",
+                                         pending, sizeof (pending)) ||
+                    dict_set_static_bin (entry->dict, "trusted.gfid",
+                                         entry->d_stat.ia_gfid, 16))
+                        return NULL;
+
+                list_add_tail (&entry->list, &entries->list);
+        }
+
+        return entries;
+}
+
+static ssize_t
+bm_encode_list (gfs3_readdirp_rsp *rsp, gf_dirent_t *entries, uint32_t keys,
+                char **buf)
+{
+        gf_dirent_t   *entry = NULL;
+        gfs3_dirplist *trav = NULL;
+        gfs3_dirplist *prev = NULL;
+        struct iovec   iov = {0, };
+        ssize_t        len = -1;
+
+        list_for_each_entry (entry, &entries->list, list) {
+                trav = GF_CALLOC (1, sizeof (*trav), gf_common_mt_char);
+                if (!trav)
+                        goto out;
+
+                trav->d_ino  = entry->d_ino;
+                trav->d_off  = entry->d_off;
+                trav->d_len  = entry->d_len;
+                trav->d_type = entry->d_type;
+                trav->name   = entry->d_name;
+                gf_stat_from_iatt (&trav->stat, &entry->d_stat);
+                dict_allocate_and_serialize_compact (entry->dict, keys,
+                                                     &trav->dict.dict_val,
+                                                     &trav->dict.dict_len);
+
+                if (prev)
+                        prev->nextentry = trav;
+                else
+                        rsp->reply = trav;
+                prev = trav;
+        }
+
+        iov.iov_len = xdr_sizeof ((xdrproc_t) xdr_gfs3_readdirp_rsp, rsp);
+        iov.iov_base = *buf = malloc (iov.iov_len);
+        if (*buf)
+                len = xdr_serialize_generic (iov, rsp,
+                                             (xdrproc_t) xdr_gfs3_readdirp_rsp);
+out:
+        trav = rsp->reply;
+        while (trav) {
+                prev = trav;
+                trav = trav->nextentry;
+                GF_FREE (prev->dict.dict_val);
+                GF_FREE (prev);
+        }
+        rsp->reply = NULL;
+
+        return len;
+}
+
+static ssize_t
+bm_encode_stream (gfs3_readdirp_rsp *rsp, gf_dirent_t *entries, uint32_t keys,
+                  char **buf)
+{
+        struct iovec iov = {0, };
+
+        iov.iov_len = gfs3_readdirp_rsp_length (rsp, entries, keys);
+        iov.iov_base = *buf = malloc (iov.iov_len);
+        if (!*buf)
+                return -1;
+
+        return gfs3_encode_readdirp_rsp (iov, rsp, entries, keys);
+}
+
+static void
+bm_run (int batch, int total, uint32_t keys)
+{
+        gfs3_readdirp_rsp  rsp = {0, };
+        gf_dirent_t       *entries = NULL;
+        char              *list_buf = NULL;
+        char              *stream_buf = NULL;
+        ssize_t            list_len = 0;
+        ssize_t            stream_len = 0;
+        double             start = 0;
+        double             list_ns = 0;
+        double             stream_ns = 0;
+        int                replies = 0;
+        int                r = 0;
+
+        entries = bm_entries (batch);
+        if (!entries)
+                return;
+
+        rsp.op_ret = batch;
+        replies = (total + batch - 1) / batch;
+
+        list_len = bm_encode_list (&rsp, entries, keys, &list_buf);
+        stream_len = bm_encode_stream (&rsp, entries, keys, &stream_buf);
+        if (list_len < 0 || list_len != stream_len ||
+            memcmp (list_buf, stream_buf, list_len)) {
+                printf ("%8d  encoders disagree (%zd and %zd bytes)\n", batch,
+                        list_len, stream_len);
+                goto out;
+        }
+        free (list_buf);
+        free (stream_buf);
+
+        start = bm_now ();
+        for (r = 0; r < replies; r++) {
+                bm_encode_list (&rsp, entries, keys, &list_buf);
+                free (list_buf);
+        }
+        list_ns = bm_now () - start;
+
+        start = bm_now ();
+        for (r = 0; r < replies; r++) {
+                bm_encode_stream (&rsp, entries, keys, &stream_buf);
+                free (stream_buf);
+        }
+        stream_ns = bm_now () - start;
+
+        printf ("%8d %10zd %15.1f %15.1f %7.2fx\n", batch, stream_len,
+                list_ns / (replies * batch), stream_ns / (replies * batch),
+                list_ns / stream_ns);
+        list_buf = stream_buf = NULL;
+out:
+        free (list_buf);
+        free (stream_buf);
+        gf_dirent_free (entries);
+        free (entries);
+}
+
+int
+main (int argc, char *argv[])
+{
+        glusterfs_ctx_t *ctx = NULL;
+        uint32_t         keys = 0;
+        int              total = 0;
+        int              batch = 0;
+
+        total = (argc > 1) ? atoi (argv[1]) : 100000;
+        /* the compact dict format is what current clients negotiate */
+        keys = (argc > 2 && strcmp (argv[2], "regular") == 0) ?
+                0 : dict_compact_key_count ();
+
+        ctx = glusterfs_ctx_new ();
+        if (!ctx || glusterfs_globals_init (ctx))
+                return 1;
+        THIS->ctx = ctx;
+
+        ctx->dict_pool = mem_pool_new (dict_t, 1024);
+        ctx->dict_pair_pool = mem_pool_new (data_pair_t, 4096);
+        ctx->dict_data_pool = mem_pool_new (data_t, 4096);
+        if (!ctx->dict_pool || !ctx->dict_pair_pool || !ctx->dict_data_pool)
+                return 1;
+
+        printf ("%d entries, %s dict format\n", total,
+                keys ? "compact" : "regular");
+        printf ("%8s %10s %15s %15s %8s\n", "entries", "bytes",
+                "list ns/entry", "stream ns/entry", "speedup");
+        for (batch = 16; batch <= BM_MAX_BATCH; batch *= 4)
+                bm_run (batch, total, keys);
+
+        return 0;
+}
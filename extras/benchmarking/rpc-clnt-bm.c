@@ -0,0 +1,128 @@
+/*
+   Copyright (c) 2014 Red Hat, Inc. <http://www.redhat.com>
+   This file is part of GlusterFS.
+
+   This file is licensed to you under your choice of the GNU Lesser
+   General Public License, version 3 or any later version (LGPLv3 or
+   later), or the GNU General Public License, version 2 (GPLv2), in all
+   cases as published by the Free Software Foundation.
+*/
+
+/*
+ * rpc-clnt-bm: measure how long rpc-clnt takes to match a reply to its
+ * saved frame as the number of calls in flight grows from 16 to 64K.
+ *
+ * The table is kept at a constant depth. Every round takes the reply for
+ * a random outstanding xid, the way a brick answers out of order, and
+ * saves a new call with the next xid in its place.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include "glusterfs.h"
+#include "globals.h"
+#include "rpc-clnt.h"
+
+#define BM_MAX_DEPTH (64 * 1024)
+
+struct saved_frames *saved_frames_new (void);
+void saved_frames_destroy (struct saved_frames *frames);
+struct saved_frame *__saved_frames_put (struct saved_frames *frames,
+                                        void *frame, struct rpc_req *rpcreq);
+struct saved_frame *__saved_frame_get (struct saved_frames *frames,
+                                       int64_t callid);
+
+static double
+bm_now (void)
+{
+        struct timeval tv = {0, };
+
+        gettimeofday (&tv, NULL);
+
+        return tv.tv_sec * 1e9 + tv.tv_usec * 1e3;
+}
+
+static void
+bm_run (struct rpc_clnt *clnt, rpc_clnt_prog_t *prog, struct rpc_req *reqs,
+        int depth, long rounds)
+{
+        struct saved_frames *frames = NULL;
+        struct saved_frame  *sframe = NULL;
+        unsigned int         seed = depth;
+        uint32_t             xid = 0;
+        double               start = 0;
+        double               ns = 0;
+        long                 misses = 0;
+        long                 r = 0;
+        int                  slot = 0;
+
+        frames = saved_frames_new ();
+        if (!frames)
+                return;
+
+        for (slot = 0; slot < depth; slot++) {
+                reqs[slot].conn = &clnt->conn;
+                reqs[slot].prog = prog;
+                reqs[slot].xid = ++xid;
+                __saved_frames_put (frames, NULL, &reqs[slot]);
+        }
+
+        start = bm_now ();
+        for (r = 0; r < rounds; r++) {
+                slot = rand_r (&seed) % depth;
+
+                sframe = __saved_frame_get (frames, reqs[slot].xid);
+                if (!sframe) {
+                        misses++;
+                        continue;
+                }
+                mem_put (sframe);
+
+                reqs[slot].xid = ++xid;
+                __saved_frames_put (frames, NULL, &reqs[slot]);
+        }
+        ns = bm_now () - start;
+
+        printf ("%8d %12.1f %10u%s\n", depth, ns / rounds, frames->hash_size,
+                misses ? "  (lost replies!)" : "");
+
+        /* nothing is left to be unwound */
+        for (slot = 0; slot < depth; slot++)
+                mem_put (__saved_frame_get (frames, reqs[slot].xid));
+        saved_frames_destroy (frames);
+}
+
+int
+main (int argc, char *argv[])
+{
+        glusterfs_ctx_t *ctx = NULL;
+        struct rpc_clnt  clnt = {{{0, }, }, };
+        rpc_clnt_prog_t  prog = {0, };
+        struct rpc_req  *reqs = NULL;
+        long             rounds = 0;
+        int              depth = 0;
+
+        rounds = (argc > 1) ? atol (argv[1]) : 200000;
+
+        ctx = glusterfs_ctx_new ();
+        if (!ctx || glusterfs_globals_init (ctx))
+                return 1;
+        THIS->ctx = ctx;
+
+        prog.progname = "rpc-clnt-bm";
+        clnt.conn.rpc_clnt = &clnt;
+        clnt.saved_frames_pool = mem_pool_new (struct saved_frame, 1024);
+        reqs = calloc (BM_MAX_DEPTH, sizeof (*reqs));
+        if (!clnt.saved_frames_pool || !reqs)
+                return 1;
+
+        printf ("%8s %12s %10s\n", "depth", "ns/reply", "buckets");
+        for (depth = 16; depth <= BM_MAX_DEPTH; depth *= 4)
+                bm_run (&clnt, &prog, reqs, depth, rounds);
+
+        free (reqs);
+
+        return 0;
+}
@@ -215,6 +215,8 @@ static struct argp_option gf_options[] = {
          "Use readdirp mode in fuse kernel module"
          " [default: \"off\"]"},
         {0, 0, 0, 0, "Miscellaneous Options:"},
+        {"synctask-stack-size", ARGP_SYNCTASK_STACK_SIZE_KEY, "SIZE", 0,
+         "Set the stack size of synctasks to SIZE [default: 512KB]"},
         {0, }
 };
 
@@ -1110,6 +1112,14 @@ parse_opts (int key, char *arg, struct argp_state *state)
 
                 break;
 
+        case ARGP_SYNCTASK_STACK_SIZE_KEY:
+                if (gf_string2bytesize (arg, &cmd_args->synctask_stack_size)
+                    || cmd_args->synctask_stack_size < 64 * GF_UNIT_KB)
+                        argp_failure (state, -1, 0,
+                                      "invalid synctask stack size %s", arg);
+
+                break;
+
 	}
 
         return 0;
@@ -1157,6 +1167,9 @@ cleanup_and_exit (int signum)
 
         glusterfs_pidfile_cleanup (ctx);
 
+        /* messages still queued to the log writer thread */
+        gf_log_flush ();
+
         exit (0);
 #if 0
         /* TODO: Properly do cleanup_and_exit(), with synchronization */
@@ -1325,6 +1338,7 @@ glusterfs_ctx_defaults_init (glusterfs_ctx_t *ctx)
         cmd_args->log_level = DEFAULT_LOG_LEVEL;
         cmd_args->logger    = gf_logger_glusterlog;
         cmd_args->log_format = gf_logformat_withmsgid;
+        cmd_args->synctask_stack_size = DEFAULT_SYNCTASK_STACK_SIZE;
 
         cmd_args->mac_compat = GF_OPTION_DISABLE;
 #ifdef GF_DARWIN_HOST_OS
@@ -1952,7 +1966,7 @@ main (int argc, char *argv[])
         if (ret)
                 goto out;
 
-	ctx->env = syncenv_new (0, 0, 0);
+	ctx->env = syncenv_new (ctx->cmd_args.synctask_stack_size, 0, 0);
         if (!ctx->env) {
                 gf_msg ("", GF_LOG_ERROR, 0, glusterfsd_msg_31);
                 goto out;
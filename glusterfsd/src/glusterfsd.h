@@ -23,6 +23,9 @@
 
 #define DEFAULT_EVENT_POOL_SIZE            16384
 
+/* of the synctasks of ctx->env, unless --synctask-stack-size is given */
+#define DEFAULT_SYNCTASK_STACK_SIZE        (512 * GF_UNIT_KB)
+
 #define ARGP_LOG_LEVEL_NONE_OPTION        "NONE"
 #define ARGP_LOG_LEVEL_TRACE_OPTION       "TRACE"
 #define ARGP_LOG_LEVEL_CRITICAL_OPTION    "CRITICAL"
@@ -87,6 +90,7 @@ enum argp_option_keys {
         ARGP_FUSE_NO_ROOT_SQUASH_KEY      = 167,
         ARGP_LOGGER                       = 168,
         ARGP_LOG_FORMAT                   = 169,
+        ARGP_SYNCTASK_STACK_SIZE_KEY      = 170,
 };
 
 struct _gfd_vol_top_priv_t {
@@ -18,6 +18,7 @@
 
 #include "call-stub.h"
 #include "mem-types.h"
+#include "compound-fop.h"
 
 
 static call_stub_t *
@@ -2296,6 +2297,70 @@ out:
 
 }
 
+call_stub_t *
+fop_compound_cbk_stub (call_frame_t *frame, fop_compound_cbk_t fn,
+                       int32_t op_ret, int32_t op_errno, compound_rsp_t *rsp,
+                       int32_t count, dict_t *xdata)
+{
+        call_stub_t *stub = NULL;
+        int32_t      i = 0;
+
+        GF_VALIDATE_OR_GOTO ("call-stub", frame, out);
+
+        stub = stub_new (frame, 0, GF_FOP_COMPOUND);
+        GF_VALIDATE_OR_GOTO ("call-stub", stub, out);
+
+        stub->fn_cbk.compound = fn;
+
+        stub->args_cbk.op_ret = op_ret;
+        stub->args_cbk.op_errno = op_errno;
+
+        if (rsp && count > 0) {
+                stub->args_cbk.compound = compound_rsp_new (count);
+                if (!stub->args_cbk.compound) {
+                        mem_put (stub);
+                        stub = NULL;
+                        goto out;
+                }
+                stub->args_cbk.count = count;
+                for (i = 0; i < count; i++) {
+                        stub->args_cbk.compound[i] = rsp[i];
+                        if (rsp[i].xattr)
+                                dict_ref (rsp[i].xattr);
+                        if (rsp[i].xdata)
+                                dict_ref (rsp[i].xdata);
+                }
+        }
+        if (xdata)
+                stub->args_cbk.xdata = dict_ref (xdata);
+out:
+        return stub;
+}
+
+call_stub_t *
+fop_compound_stub (call_frame_t *frame, fop_compound_t fn,
+                   compound_args_t *args, int32_t count, dict_t *xdata)
+{
+        call_stub_t *stub = NULL;
+
+        GF_VALIDATE_OR_GOTO ("call-stub", frame, out);
+        GF_VALIDATE_OR_GOTO ("call-stub", fn, out);
+
+        stub = stub_new (frame, 1, GF_FOP_COMPOUND);
+        GF_VALIDATE_OR_GOTO ("call-stub", stub, out);
+
+        stub->fn.compound = fn;
+
+        /* the links belong to the caller until the fop unwinds */
+        stub->args.compound = args;
+        stub->args.count = count;
+
+        if (xdata)
+                stub->args.xdata = dict_ref (xdata);
+out:
+        return stub;
+}
+
 
 static void
 call_resume_wind (call_stub_t *stub)
@@ -2529,6 +2594,11 @@ call_resume_wind (call_stub_t *stub)
                                  stub->args.fd, stub->args.offset,
                                  stub->args.size, stub->args.xdata);
                 break;
+        case GF_FOP_COMPOUND:
+                stub->fn.compound (stub->frame, stub->frame->this,
+                                   stub->args.compound, stub->args.count,
+                                   stub->args.xdata);
+                break;
 
         default:
                 gf_log_callingfn ("call-stub", GF_LOG_ERROR,
@@ -2736,6 +2806,10 @@ call_resume_unwind (call_stub_t *stub)
                 STUB_UNWIND(stub, zerofill, &stub->args_cbk.prestat,
                             &stub->args_cbk.poststat, stub->args_cbk.xdata);
                 break;
+        case GF_FOP_COMPOUND:
+                STUB_UNWIND (stub, compound, stub->args_cbk.compound,
+                             stub->args_cbk.count, stub->args_cbk.xdata);
+                break;
 
         default:
                 gf_log_callingfn ("call-stub", GF_LOG_ERROR,
@@ -2798,6 +2872,8 @@ call_stub_wipe_args_cbk (call_stub_t *stub)
 
 	GF_FREE (stub->args_cbk.strong_checksum);
 
+        compound_rsp_destroy (stub->args_cbk.compound, stub->args_cbk.count);
+
 	if (stub->args_cbk.xdata)
 		dict_unref (stub->args_cbk.xdata);
 
@@ -150,23 +150,6 @@ gf_client_clienttable_destroy (clienttable_t *clienttable)
 }
 
 
-/*
- * a more comprehensive feature test is shown at
- * http://lists.iptel.org/pipermail/semsdev/2010-October/005075.html
- * this is sufficient for RHEL5 i386 builds
- */
-#if (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 1)) && !defined(__i386__)
-# define INCREMENT_ATOMIC(lk,op) __sync_add_and_fetch(&op, 1)
-# define DECREMENT_ATOMIC(lk,op) __sync_sub_and_fetch(&op, 1)
-#else
-/* These are only here for old gcc, e.g. on RHEL5 i386.
- * We're not ever going to use this in an if stmt,
- * but let's be pedantically correct for style points */
-# define INCREMENT_ATOMIC(lk,op) do { LOCK (&lk); ++op; UNLOCK (&lk); } while (0)
-/* this is a gcc 'statement expression', it works with llvm/clang too */
-# define DECREMENT_ATOMIC(lk,op) ({ LOCK (&lk); --op; UNLOCK (&lk); op; })
-#endif
-
 client_t *
 gf_client_get (xlator_t *this, struct rpcsvc_auth_data *cred, char *client_uid)
 {
@@ -202,8 +185,8 @@ gf_client_get (xlator_t *this, struct rpcsvc_auth_data *cred, char *client_uid)
                                         memcmp (cred->authdata,
                                                 client->auth.data,
                                                 client->auth.len) == 0))) {
-                                INCREMENT_ATOMIC (client->ref.lock,
-                                                  client->ref.bind);
+                                GF_ATOMIC_ADD (client->ref.lock,
+                                               client->ref.bind, 1);
                                 break;
                         }
                 }
@@ -285,7 +268,7 @@ gf_client_put (client_t *client, gf_boolean_t *detached)
         if (detached)
                 *detached = _gf_false;
 
-        bind_ref = DECREMENT_ATOMIC (client->ref.lock, client->ref.bind);
+        bind_ref = GF_ATOMIC_SUB (client->ref.lock, client->ref.bind, 1);
         if (bind_ref == 0)
                 unref = _gf_true;
 
@@ -306,7 +289,7 @@ gf_client_ref (client_t *client)
                 return NULL;
         }
 
-        INCREMENT_ATOMIC (client->ref.lock, client->ref.count);
+        GF_ATOMIC_ADD (client->ref.lock, client->ref.count, 1);
         return client;
 }
 
@@ -385,7 +368,7 @@ gf_client_unref (client_t *client)
                 return;
         }
 
-        refcount = DECREMENT_ATOMIC (client->ref.lock, client->ref.count);
+        refcount = GF_ATOMIC_SUB (client->ref.lock, client->ref.count, 1);
         if (refcount == 0) {
                 client_destroy (client);
         }
@@ -2342,6 +2342,29 @@ get_mem_size ()
 	return memsize;
 }
 
+/* Resident set size of this process, or 0 where it cannot be determined */
+uint64_t
+get_mem_rss ()
+{
+        uint64_t rss = 0;
+
+#ifdef GF_LINUX_HOST_OS
+        FILE          *fp = NULL;
+        unsigned long  size = 0;
+        unsigned long  resident = 0;
+
+        fp = fopen ("/proc/self/statm", "r");
+        if (!fp)
+                return 0;
+
+        if (fscanf (fp, "%lu %lu", &size, &resident) == 2)
+                rss = (uint64_t) resident * sysconf (_SC_PAGESIZE);
+
+        fclose (fp);
+#endif
+        return rss;
+}
+
 /* Strips all whitespace characters in a string and returns length of new string
  * on success
  */
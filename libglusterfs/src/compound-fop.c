@@ -0,0 +1,412 @@
+/*
+  Copyright (c) 2014 Red Hat, Inc. <http://www.redhat.com>
+  This file is part of GlusterFS.
+
+  This file is licensed to you under your choice of the GNU Lesser
+  General Public License, version 3 or any later version (LGPLv3 or
+  later), or the GNU General Public License, version 2 (GPLv2), in all
+  cases as published by the Free Software Foundation.
+*/
+
+#include "compound-fop.h"
+#include "common-utils.h"
+#include "mem-types.h"
+
+
+compound_args_t *
+compound_args_new (int32_t count)
+{
+        return GF_CALLOC (count, sizeof (compound_args_t),
+                          gf_common_mt_compound_args_t);
+}
+
+void
+compound_args_destroy (compound_args_t *args, int32_t count)
+{
+        int32_t i = 0;
+
+        if (!args)
+                return;
+
+        for (i = 0; i < count; i++) {
+                loc_wipe (&args[i].loc);
+                if (args[i].fd)
+                        fd_unref (args[i].fd);
+                GF_FREE (args[i].volume);
+                GF_FREE (args[i].name);
+                if (args[i].xattr)
+                        dict_unref (args[i].xattr);
+                GF_FREE (args[i].vector);
+                if (args[i].iobref)
+                        iobref_unref (args[i].iobref);
+                if (args[i].xdata)
+                        dict_unref (args[i].xdata);
+        }
+
+        GF_FREE (args);
+}
+
+compound_rsp_t *
+compound_rsp_new (int32_t count)
+{
+        return GF_CALLOC (count, sizeof (compound_rsp_t),
+                          gf_common_mt_compound_rsp_t);
+}
+
+void
+compound_rsp_destroy (compound_rsp_t *rsp, int32_t count)
+{
+        int32_t i = 0;
+
+        if (!rsp)
+                return;
+
+        for (i = 0; i < count; i++) {
+                if (rsp[i].xattr)
+                        dict_unref (rsp[i].xattr);
+                if (rsp[i].xdata)
+                        dict_unref (rsp[i].xdata);
+        }
+
+        GF_FREE (rsp);
+}
+
+static int
+compound_args_common (compound_args_t *args, glusterfs_fop_t fop,
+                      const char *volume, loc_t *loc, fd_t *fd, dict_t *xdata)
+{
+        args->fop = fop;
+
+        if (volume) {
+                args->volume = gf_strdup (volume);
+                if (!args->volume)
+                        return -1;
+        }
+
+        if (loc && loc_copy (&args->loc, loc))
+                return -1;
+
+        if (fd)
+                args->fd = fd_ref (fd);
+
+        if (xdata)
+                args->xdata = dict_ref (xdata);
+
+        return 0;
+}
+
+int
+compound_args_inodelk (compound_args_t *args, const char *volume, loc_t *loc,
+                       int32_t cmd, struct gf_flock *flock, dict_t *xdata)
+{
+        args->cmd = cmd;
+        args->flock = *flock;
+
+        return compound_args_common (args, GF_FOP_INODELK, volume, loc, NULL,
+                                     xdata);
+}
+
+int
+compound_args_finodelk (compound_args_t *args, const char *volume, fd_t *fd,
+                        int32_t cmd, struct gf_flock *flock, dict_t *xdata)
+{
+        args->cmd = cmd;
+        args->flock = *flock;
+
+        return compound_args_common (args, GF_FOP_FINODELK, volume, NULL, fd,
+                                     xdata);
+}
+
+int
+compound_args_entrylk (compound_args_t *args, const char *volume, loc_t *loc,
+                       const char *basename, entrylk_cmd cmd,
+                       entrylk_type type, dict_t *xdata)
+{
+        args->entrylk_cmd = cmd;
+        args->entrylk_type = type;
+
+        if (basename) {
+                args->name = gf_strdup (basename);
+                if (!args->name)
+                        return -1;
+        }
+
+        return compound_args_common (args, GF_FOP_ENTRYLK, volume, loc, NULL,
+                                     xdata);
+}
+
+int
+compound_args_fentrylk (compound_args_t *args, const char *volume, fd_t *fd,
+                        const char *basename, entrylk_cmd cmd,
+                        entrylk_type type, dict_t *xdata)
+{
+        args->entrylk_cmd = cmd;
+        args->entrylk_type = type;
+
+        if (basename) {
+                args->name = gf_strdup (basename);
+                if (!args->name)
+                        return -1;
+        }
+
+        return compound_args_common (args, GF_FOP_FENTRYLK, volume, NULL, fd,
+                                     xdata);
+}
+
+int
+compound_args_xattrop (compound_args_t *args, loc_t *loc,
+                       gf_xattrop_flags_t optype, dict_t *xattr, dict_t *xdata)
+{
+        args->optype = optype;
+        if (xattr)
+                args->xattr = dict_ref (xattr);
+
+        return compound_args_common (args, GF_FOP_XATTROP, NULL, loc, NULL,
+                                     xdata);
+}
+
+int
+compound_args_fxattrop (compound_args_t *args, fd_t *fd,
+                        gf_xattrop_flags_t optype, dict_t *xattr,
+                        dict_t *xdata)
+{
+        args->optype = optype;
+        if (xattr)
+                args->xattr = dict_ref (xattr);
+
+        return compound_args_common (args, GF_FOP_FXATTROP, NULL, NULL, fd,
+                                     xdata);
+}
+
+int
+compound_args_setxattr (compound_args_t *args, loc_t *loc, dict_t *xattr,
+                        int32_t flags, dict_t *xdata)
+{
+        args->flags = flags;
+        if (xattr)
+                args->xattr = dict_ref (xattr);
+
+        return compound_args_common (args, GF_FOP_SETXATTR, NULL, loc, NULL,
+                                     xdata);
+}
+
+int
+compound_args_fsetxattr (compound_args_t *args, fd_t *fd, dict_t *xattr,
+                         int32_t flags, dict_t *xdata)
+{
+        args->flags = flags;
+        if (xattr)
+                args->xattr = dict_ref (xattr);
+
+        return compound_args_common (args, GF_FOP_FSETXATTR, NULL, NULL, fd,
+                                     xdata);
+}
+
+int
+compound_args_writev (compound_args_t *args, fd_t *fd, struct iovec *vector,
+                      int32_t count, off_t offset, uint32_t flags,
+                      struct iobref *iobref, dict_t *xdata)
+{
+        args->vector = iov_dup (vector, count);
+        if (!args->vector)
+                return -1;
+        args->count = count;
+        args->offset = offset;
+        args->flags = flags;
+        if (iobref)
+                args->iobref = iobref_ref (iobref);
+
+        return compound_args_common (args, GF_FOP_WRITE, NULL, NULL, fd,
+                                     xdata);
+}
+
+
+/* Serial execution */
+
+typedef struct {
+        call_frame_t    *frame;
+        xlator_t        *subvol;
+        compound_args_t *args;
+        compound_rsp_t  *rsp;
+        int32_t          count;
+        int32_t          done;
+} compound_serial_t;
+
+static void compound_serial_next (compound_serial_t *cs);
+
+static void
+compound_serial_finish (compound_serial_t *cs, int32_t op_ret,
+                        int32_t op_errno)
+{
+        call_frame_t   *frame = cs->frame;
+        compound_rsp_t *rsp   = cs->rsp;
+        int32_t         done  = cs->done;
+
+        GF_FREE (cs);
+
+        STACK_UNWIND_STRICT (compound, frame, op_ret, op_errno, rsp, done,
+                             NULL);
+
+        compound_rsp_destroy (rsp, done);
+}
+
+static int
+compound_serial_done (compound_serial_t *cs, int32_t op_ret, int32_t op_errno,
+                      struct iatt *prebuf, struct iatt *postbuf,
+                      dict_t *xattr, dict_t *xdata)
+{
+        compound_rsp_t *rsp = &cs->rsp[cs->done++];
+
+        rsp->op_ret = op_ret;
+        rsp->op_errno = op_errno;
+        if (prebuf)
+                rsp->prebuf = *prebuf;
+        if (postbuf)
+                rsp->postbuf = *postbuf;
+        if (xattr)
+                rsp->xattr = dict_ref (xattr);
+        if (xdata)
+                rsp->xdata = dict_ref (xdata);
+
+        if (op_ret < 0)
+                compound_serial_finish (cs, -1, op_errno);
+        else if (cs->done == cs->count)
+                compound_serial_finish (cs, 0, 0);
+        else
+                compound_serial_next (cs);
+
+        return 0;
+}
+
+static int
+compound_serial_common_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                            int32_t op_ret, int32_t op_errno, dict_t *xdata)
+{
+        return compound_serial_done (cookie, op_ret, op_errno, NULL, NULL,
+                                     NULL, xdata);
+}
+
+static int
+compound_serial_xattrop_cbk (call_frame_t *frame, void *cookie,
+                             xlator_t *this, int32_t op_ret, int32_t op_errno,
+                             dict_t *xattr, dict_t *xdata)
+{
+        return compound_serial_done (cookie, op_ret, op_errno, NULL, NULL,
+                                     xattr, xdata);
+}
+
+static int
+compound_serial_writev_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                            int32_t op_ret, int32_t op_errno,
+                            struct iatt *prebuf, struct iatt *postbuf,
+                            dict_t *xdata)
+{
+        return compound_serial_done (cookie, op_ret, op_errno, prebuf, postbuf,
+                                     NULL, xdata);
+}
+
+static void
+compound_serial_next (compound_serial_t *cs)
+{
+        compound_args_t *args   = &cs->args[cs->done];
+        xlator_t        *subvol = cs->subvol;
+        call_frame_t    *frame  = cs->frame;
+
+        switch (args->fop) {
+        case GF_FOP_INODELK:
+                STACK_WIND_COOKIE (frame, compound_serial_common_cbk, cs,
+                                   subvol, subvol->fops->inodelk,
+                                   args->volume, &args->loc, args->cmd,
+                                   &args->flock, args->xdata);
+                break;
+        case GF_FOP_FINODELK:
+                STACK_WIND_COOKIE (frame, compound_serial_common_cbk, cs,
+                                   subvol, subvol->fops->finodelk,
+                                   args->volume, args->fd, args->cmd,
+                                   &args->flock, args->xdata);
+                break;
+        case GF_FOP_ENTRYLK:
+                STACK_WIND_COOKIE (frame, compound_serial_common_cbk, cs,
+                                   subvol, subvol->fops->entrylk,
+                                   args->volume, &args->loc, args->name,
+                                   args->entrylk_cmd, args->entrylk_type,
+                                   args->xdata);
+                break;
+        case GF_FOP_FENTRYLK:
+                STACK_WIND_COOKIE (frame, compound_serial_common_cbk, cs,
+                                   subvol, subvol->fops->fentrylk,
+                                   args->volume, args->fd, args->name,
+                                   args->entrylk_cmd, args->entrylk_type,
+                                   args->xdata);
+                break;
+        case GF_FOP_XATTROP:
+                STACK_WIND_COOKIE (frame, compound_serial_xattrop_cbk, cs,
+                                   subvol, subvol->fops->xattrop,
+                                   &args->loc, args->optype, args->xattr,
+                                   args->xdata);
+                break;
+        case GF_FOP_FXATTROP:
+                STACK_WIND_COOKIE (frame, compound_serial_xattrop_cbk, cs,
+                                   subvol, subvol->fops->fxattrop,
+                                   args->fd, args->optype, args->xattr,
+                                   args->xdata);
+                break;
+        case GF_FOP_SETXATTR:
+                STACK_WIND_COOKIE (frame, compound_serial_common_cbk, cs,
+                                   subvol, subvol->fops->setxattr,
+                                   &args->loc, args->xattr, args->flags,
+                                   args->xdata);
+                break;
+        case GF_FOP_FSETXATTR:
+                STACK_WIND_COOKIE (frame, compound_serial_common_cbk, cs,
+                                   subvol, subvol->fops->fsetxattr,
+                                   args->fd, args->xattr, args->flags,
+                                   args->xdata);
+                break;
+        case GF_FOP_WRITE:
+                STACK_WIND_COOKIE (frame, compound_serial_writev_cbk, cs,
+                                   subvol, subvol->fops->writev,
+                                   args->fd, args->vector, args->count,
+                                   args->offset, args->flags, args->iobref,
+                                   args->xdata);
+                break;
+        default:
+                gf_log (subvol->name, GF_LOG_ERROR,
+                        "%s is not supported in compound fops",
+                        gf_fop_list[args->fop]);
+                compound_serial_done (cs, -1, ENOTSUP, NULL, NULL, NULL,
+                                      NULL);
+                break;
+        }
+}
+
+int
+compound_fop_serial (call_frame_t *frame, xlator_t *subvol,
+                     compound_args_t *args, int32_t count, dict_t *xdata)
+{
+        compound_serial_t *cs = NULL;
+
+        if (count <= 0) {
+                STACK_UNWIND_STRICT (compound, frame, 0, 0, NULL, 0, NULL);
+                return 0;
+        }
+
+        cs = GF_CALLOC (1, sizeof (*cs), gf_common_mt_compound_serial_t);
+        if (cs)
+                cs->rsp = compound_rsp_new (count);
+        if (!cs || !cs->rsp) {
+                GF_FREE (cs);
+                STACK_UNWIND_STRICT (compound, frame, -1, ENOMEM, NULL, 0,
+                                     NULL);
+                return 0;
+        }
+
+        cs->frame = frame;
+        cs->subvol = subvol;
+        cs->args = args;
+        cs->count = count;
+
+        compound_serial_next (cs);
+
+        return 0;
+}
@@ -0,0 +1,65 @@
+/*
+  Copyright (c) 2014 Red Hat, Inc. <http://www.redhat.com>
+  This file is part of GlusterFS.
+
+  This file is licensed to you under your choice of the GNU Lesser
+  General Public License, version 3 or any later version (LGPLv3 or
+  later), or the GNU General Public License, version 2 (GPLv2), in all
+  cases as published by the Free Software Foundation.
+*/
+
+#ifndef _COMPOUND_FOP_H
+#define _COMPOUND_FOP_H
+
+#include "xlator.h"
+
+/*
+ * A compound fop carries an ordered list of fops (links) which is executed
+ * one after the other, stopping at the first failure. protocol/client sends
+ * the whole list to the brick in one round trip, which is what makes a
+ * lock, pre-op, write, post-op, unlock transaction cheap.
+ *
+ * The compound_args_*() helpers fill in a link, taking their own refs and
+ * copies of the arguments. compound_args_destroy() releases them.
+ */
+
+compound_args_t *compound_args_new (int32_t count);
+void compound_args_destroy (compound_args_t *args, int32_t count);
+
+compound_rsp_t *compound_rsp_new (int32_t count);
+void compound_rsp_destroy (compound_rsp_t *rsp, int32_t count);
+
+int compound_args_inodelk (compound_args_t *args, const char *volume,
+                           loc_t *loc, int32_t cmd, struct gf_flock *flock,
+                           dict_t *xdata);
+int compound_args_finodelk (compound_args_t *args, const char *volume,
+                            fd_t *fd, int32_t cmd, struct gf_flock *flock,
+                            dict_t *xdata);
+int compound_args_entrylk (compound_args_t *args, const char *volume,
+                           loc_t *loc, const char *basename, entrylk_cmd cmd,
+                           entrylk_type type, dict_t *xdata);
+int compound_args_fentrylk (compound_args_t *args, const char *volume,
+                            fd_t *fd, const char *basename, entrylk_cmd cmd,
+                            entrylk_type type, dict_t *xdata);
+int compound_args_xattrop (compound_args_t *args, loc_t *loc,
+                           gf_xattrop_flags_t optype, dict_t *xattr,
+                           dict_t *xdata);
+int compound_args_fxattrop (compound_args_t *args, fd_t *fd,
+                            gf_xattrop_flags_t optype, dict_t *xattr,
+                            dict_t *xdata);
+int compound_args_setxattr (compound_args_t *args, loc_t *loc, dict_t *xattr,
+                            int32_t flags, dict_t *xdata);
+int compound_args_fsetxattr (compound_args_t *args, fd_t *fd, dict_t *xattr,
+                             int32_t flags, dict_t *xdata);
+int compound_args_writev (compound_args_t *args, fd_t *fd,
+                          struct iovec *vector, int32_t count, off_t offset,
+                          uint32_t flags, struct iobref *iobref,
+                          dict_t *xdata);
+
+/* Executes the links by winding them one by one to subvol, then unwinds the
+ * compound fop on frame. Used where a compound fop can not be sent as such.
+ */
+int compound_fop_serial (call_frame_t *frame, xlator_t *subvol,
+                         compound_args_t *args, int32_t count, dict_t *xdata);
+
+#endif /* _COMPOUND_FOP_H */
@@ -365,6 +365,13 @@ default_zerofill_failure_cbk (call_frame_t *frame, int32_t op_errno)
         return 0;
 }
 
+int32_t
+default_compound_failure_cbk (call_frame_t *frame, int32_t op_errno)
+{
+        STACK_UNWIND_STRICT (compound, frame, -1, op_errno, NULL, 0, NULL);
+        return 0;
+}
+
 
 int32_t
 default_getspec_failure_cbk (call_frame_t *frame, int32_t op_errno)
@@ -1286,6 +1293,16 @@ default_zerofill_cbk(call_frame_t *frame, void *cookie, xlator_t *this,
         return 0;
 }
 
+int32_t
+default_compound_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                      int32_t op_ret, int32_t op_errno, compound_rsp_t *rsp,
+                      int32_t count, dict_t *xdata)
+{
+        STACK_UNWIND_STRICT (compound, frame, op_ret, op_errno, rsp, count,
+                             xdata);
+        return 0;
+}
+
 
 int32_t
 default_getspec_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
@@ -1725,6 +1742,15 @@ default_zerofill_resume(call_frame_t *frame, xlator_t *this, fd_t *fd,
         return 0;
 }
 
+int32_t
+default_compound_resume (call_frame_t *frame, xlator_t *this,
+                         compound_args_t *args, int32_t count, dict_t *xdata)
+{
+        STACK_WIND (frame, default_compound_cbk, FIRST_CHILD(this),
+                    FIRST_CHILD(this)->fops->compound, args, count, xdata);
+        return 0;
+}
+
 
 /* FOPS */
 
@@ -2160,6 +2186,16 @@ default_zerofill(call_frame_t *frame, xlator_t *this, fd_t *fd,
         return 0;
 }
 
+int32_t
+default_compound (call_frame_t *frame, xlator_t *this, compound_args_t *args,
+                  int32_t count, dict_t *xdata)
+{
+        STACK_WIND_TAIL (frame, FIRST_CHILD(this),
+                         FIRST_CHILD(this)->fops->compound, args, count,
+                         xdata);
+        return 0;
+}
+
 
 int32_t
 default_forget (xlator_t *this, inode_t *inode)
@@ -2246,6 +2282,7 @@ struct xlator_fops _default_fops = {
 	.fallocate = default_fallocate,
 	.discard = default_discard,
         .zerofill = default_zerofill,
+        .compound = default_compound,
 
         .getspec = default_getspec,
 };
@@ -263,6 +263,11 @@ int32_t default_zerofill(call_frame_t *frame,
                         off_t offset,
                         off_t len, dict_t *xdata);
 
+int32_t default_compound (call_frame_t *frame,
+                          xlator_t *this,
+                          compound_args_t *args,
+                          int32_t count, dict_t *xdata);
+
 
 /* Resume */
 int32_t default_getspec_resume (call_frame_t *frame,
@@ -492,6 +497,11 @@ int32_t default_zerofill_resume(call_frame_t *frame,
                                off_t offset,
                                off_t len, dict_t *xdata);
 
+int32_t default_compound_resume (call_frame_t *frame,
+                                 xlator_t *this,
+                                 compound_args_t *args,
+                                 int32_t count, dict_t *xdata);
+
 
 /* _cbk_resume */
 
@@ -985,6 +995,11 @@ int32_t default_zerofill_cbk(call_frame_t *frame, void *cookie, xlator_t *this,
                             int32_t op_ret, int32_t op_errno, struct iatt *pre,
                             struct iatt *post, dict_t *xdata);
 
+int32_t default_compound_cbk (call_frame_t *frame, void *cookie,
+                              xlator_t *this, int32_t op_ret, int32_t op_errno,
+                              compound_rsp_t *rsp, int32_t count,
+                              dict_t *xdata);
+
 int32_t
 default_getspec_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                      int32_t op_ret, int32_t op_errno, char *spec_data);
@@ -1123,6 +1138,9 @@ default_discard_failure_cbk (call_frame_t *frame, int32_t op_errno);
 int32_t
 default_zerofill_failure_cbk (call_frame_t *frame, int32_t op_errno);
 
+int32_t
+default_compound_failure_cbk (call_frame_t *frame, int32_t op_errno);
+
 int32_t
 default_getspec_failure_cbk (call_frame_t *frame, int32_t op_errno);
 
@@ -29,6 +29,7 @@
 #include "compat.h"
 #include "byte-order.h"
 #include "globals.h"
+#include "glusterfs-acl.h"
 
 data_t *
 get_new_data ()
@@ -44,38 +45,35 @@ get_new_data ()
         return data;
 }
 
+/*
+ * Dicts start with a single inline bucket, which is all the typical dict of
+ * a handful of keys needs. Once a dict holds more than GF_DICT_LINEAR_MAX
+ * pairs the bucket array is allocated and then doubled whenever the number
+ * of pairs exceeds the number of buckets. hash_size is always a power of 2.
+ */
+#define GF_DICT_LINEAR_MAX   8
+#define GF_DICT_MIN_BUCKETS  16
+
 dict_t *
 get_new_dict_full (int size_hint)
 {
         dict_t *dict = mem_get0 (THIS->ctx->dict_pool);
+        int32_t hash_size = 1;
 
         if (!dict) {
                 return NULL;
         }
 
-        dict->hash_size = size_hint;
-        if (size_hint == 1) {
-                /*
-                 * This is the only case we ever see currently.  If we ever
-                 * need to support resizing the hash table, the resize function
-                 * will have to take into account the possibility that
-                 * "members" is not separately allocated (i.e. don't just call
-                 * realloc() blindly.
-                 */
+        while (hash_size < size_hint)
+                hash_size <<= 1;
+
+        dict->hash_size = hash_size;
+        if (hash_size == 1) {
                 dict->members = &dict->members_internal;
         }
         else {
-                /*
-                 * We actually need to allocate space for size_hint *pointers*
-                 * but we actually allocate space for one *structure*.  Since
-                 * a data_pair_t consists of five pointers, we're wasting four
-                 * pointers' worth for N=1, and will overrun what we allocated
-                 * for N>5.  If anybody ever starts using size_hint, we'll need
-                 * to fix this.
-                 */
-                GF_ASSERT (size_hint <=
-                           (sizeof(data_pair_t) / sizeof(data_pair_t *)));
-                dict->members = mem_get0 (THIS->ctx->dict_pair_pool);
+                dict->members = GF_CALLOC (hash_size, sizeof (data_pair_t *),
+                                           gf_common_mt_dict_buckets_t);
                 if (!dict->members) {
                         mem_put (dict);
                         return NULL;
@@ -188,24 +186,36 @@ err_out:
         return NULL;
 }
 
+static data_pair_t *
+_dict_lookup_hashed (dict_t *this, char *key, int32_t keylen, uint32_t hash)
+{
+        data_pair_t *pair = NULL;
+
+        for (pair = this->members[hash & (this->hash_size - 1)]; pair != NULL;
+             pair = pair->hash_next) {
+                if (pair->key_hash == hash && pair->key_len == keylen &&
+                    !memcmp (pair->key, key, keylen))
+                        return pair;
+        }
+
+        return NULL;
+}
+
 static data_pair_t *
 _dict_lookup (dict_t *this, char *key)
 {
+        int32_t keylen = 0;
+
         if (!this || !key) {
                 gf_log_callingfn ("dict", GF_LOG_WARNING,
                                   "!this || !key (%s)", key);
                 return NULL;
         }
 
-        int hashval = SuperFastHash (key, strlen (key)) % this->hash_size;
-        data_pair_t *pair;
-
-        for (pair = this->members[hashval]; pair != NULL; pair = pair->hash_next) {
-                if (pair->key && !strcmp (pair->key, key))
-                        return pair;
-        }
+        keylen = strlen (key);
 
-        return NULL;
+        return _dict_lookup_hashed (this, key, keylen,
+                                    SuperFastHash (key, keylen));
 }
 
 int32_t
@@ -231,36 +241,70 @@ dict_lookup (dict_t *this, char *key, data_t **data)
         return 0;
 }
 
-static int32_t
-_dict_set (dict_t *this, char *key, data_t *value, gf_boolean_t replace)
+/* Rebuild the buckets with @hash_size entries. The bucket chains are rebuilt
+ * from the oldest pair to the newest, so that the newest of duplicate keys
+ * added with dict_add() keeps shadowing the older ones.
+ */
+static void
+_dict_rehash (dict_t *this, int32_t hash_size)
 {
-        int hashval;
-        data_pair_t *pair;
-        char key_free = 0;
-        int tmp = 0;
-        int ret = 0;
+        data_pair_t **members = NULL;
+        data_pair_t  *pair = NULL;
+        uint32_t      idx = 0;
 
-        if (!key) {
-                ret = gf_asprintf (&key, "ref:%p", value);
-                if (-1 == ret) {
-                        gf_log ("dict", GF_LOG_WARNING, "asprintf failed %s", key);
-                        return -1;
-                }
-                key_free = 1;
+        members = GF_CALLOC (hash_size, sizeof (data_pair_t *),
+                             gf_common_mt_dict_buckets_t);
+        if (!members)
+                /* keep using the smaller table, lookups remain correct */
+                return;
+
+        pair = this->members_list;
+        while (pair && pair->next)
+                pair = pair->next;
+
+        for (; pair; pair = pair->prev) {
+                idx = pair->key_hash & (hash_size - 1);
+                pair->hash_next = members[idx];
+                members[idx] = pair;
         }
 
-        tmp = SuperFastHash (key, strlen (key));
-        hashval = (tmp % this->hash_size);
+        if (this->members != &this->members_internal)
+                GF_FREE (this->members);
+
+        this->members = members;
+        this->hash_size = hash_size;
+}
+
+static void
+_dict_pair_free_key (data_pair_t *pair)
+{
+        if (!pair->key_static)
+                GF_FREE (pair->key);
+        pair->key = NULL;
+}
+
+enum {
+        DICT_KEY_COPY,     /* caller owns the key, make a copy */
+        DICT_KEY_OWNED,    /* key was allocated for the dict, take it */
+        DICT_KEY_STATIC,   /* interned key, share it */
+};
+
+static int32_t
+_dict_set_hashed (dict_t *this, char *key, int32_t keylen, uint32_t hash,
+                  int key_mode, data_t *value, gf_boolean_t replace)
+{
+        int hashval;
+        data_pair_t *pair;
 
         /* Search for a existing key if 'replace' is asked for */
         if (replace) {
-                pair = _dict_lookup (this, key);
+                pair = _dict_lookup_hashed (this, key, keylen, hash);
 
                 if (pair) {
                         data_t *unref_data = pair->value;
                         pair->value = data_ref (value);
                         data_unref (unref_data);
-                        if (key_free)
+                        if (key_mode == DICT_KEY_OWNED)
                                 GF_FREE (key);
                         /* Indicates duplicate key */
                         return 0;
@@ -270,7 +314,7 @@ _dict_set (dict_t *this, char *key, data_t *value, gf_boolean_t replace)
         if (this->free_pair_in_use) {
                 pair = mem_get0 (THIS->ctx->dict_pair_pool);
                 if (!pair) {
-                        if (key_free)
+                        if (key_mode == DICT_KEY_OWNED)
                                 GF_FREE (key);
                         return -1;
                 }
@@ -280,13 +324,17 @@ _dict_set (dict_t *this, char *key, data_t *value, gf_boolean_t replace)
                 this->free_pair_in_use = _gf_true;
         }
 
-        if (key_free) {
+        pair->key_static = _gf_false;
+        if (key_mode == DICT_KEY_STATIC) {
+                pair->key = key;
+                pair->key_static = _gf_true;
+        }
+        else if (key_mode == DICT_KEY_OWNED) {
                 /* It's ours.  Use it. */
                 pair->key = key;
-                key_free = 0;
         }
         else {
-                pair->key = (char *) GF_CALLOC (1, strlen (key) + 1,
+                pair->key = (char *) GF_MALLOC (keylen + 1,
                                                 gf_common_mt_char);
                 if (!pair->key) {
                         if (pair == &this->free_pair) {
@@ -297,10 +345,14 @@ _dict_set (dict_t *this, char *key, data_t *value, gf_boolean_t replace)
                         }
                         return -1;
                 }
-                strcpy (pair->key, key);
+                memcpy (pair->key, key, keylen);
+                pair->key[keylen] = '\0';
         }
+        pair->key_hash = hash;
+        pair->key_len = keylen;
         pair->value = data_ref (value);
 
+        hashval = hash & (this->hash_size - 1);
         pair->hash_next = this->members[hashval];
         this->members[hashval] = pair;
 
@@ -311,11 +363,35 @@ _dict_set (dict_t *this, char *key, data_t *value, gf_boolean_t replace)
         this->members_list = pair;
         this->count++;
 
-        if (key_free)
-                GF_FREE (key);
+        if (this->count > max (this->hash_size, GF_DICT_LINEAR_MAX))
+                _dict_rehash (this, max (this->hash_size * 2,
+                                         GF_DICT_MIN_BUCKETS));
+
         return 0;
 }
 
+static int32_t
+_dict_set (dict_t *this, char *key, data_t *value, gf_boolean_t replace)
+{
+        int key_mode = DICT_KEY_COPY;
+        int32_t keylen = 0;
+        int ret = 0;
+
+        if (!key) {
+                ret = gf_asprintf (&key, "ref:%p", value);
+                if (-1 == ret) {
+                        gf_log ("dict", GF_LOG_WARNING, "asprintf failed %s", key);
+                        return -1;
+                }
+                key_mode = DICT_KEY_OWNED;
+        }
+
+        keylen = strlen (key);
+
+        return _dict_set_hashed (this, key, keylen, SuperFastHash (key, keylen),
+                                 key_mode, value, replace);
+}
+
 int32_t
 dict_set (dict_t *this,
           char *key,
@@ -383,23 +459,16 @@ dict_get (dict_t *this, char *key)
         return NULL;
 }
 
-void
-dict_del (dict_t *this, char *key)
+static void
+_dict_del_hashed (dict_t *this, char *key, int32_t keylen, uint32_t hash)
 {
-        if (!this || !key) {
-                gf_log_callingfn ("dict", GF_LOG_WARNING,
-                                  "!this || key=%s", key);
-                return;
-        }
-
-        LOCK (&this->lock);
-
-        int hashval = SuperFastHash (key, strlen (key)) % this->hash_size;
+        int hashval = hash & (this->hash_size - 1);
         data_pair_t *pair = this->members[hashval];
         data_pair_t *prev = NULL;
 
         while (pair) {
-                if (strcmp (pair->key, key) == 0) {
+                if (pair->key_hash == hash && pair->key_len == keylen &&
+                    memcmp (pair->key, key, keylen) == 0) {
                         if (prev)
                                 prev->hash_next = pair->hash_next;
                         else
@@ -415,7 +484,7 @@ dict_del (dict_t *this, char *key)
                         if (pair->next)
                                 pair->next->prev = pair->prev;
 
-                        GF_FREE (pair->key);
+                        _dict_pair_free_key (pair);
                         if (pair == &this->free_pair) {
                                 this->free_pair_in_use = _gf_false;
                         }
@@ -429,12 +498,142 @@ dict_del (dict_t *this, char *key)
                 prev = pair;
                 pair = pair->hash_next;
         }
+}
+
+void
+dict_del (dict_t *this, char *key)
+{
+        int32_t keylen = 0;
+
+        if (!this || !key) {
+                gf_log_callingfn ("dict", GF_LOG_WARNING,
+                                  "!this || key=%s", key);
+                return;
+        }
+
+        keylen = strlen (key);
+
+        LOCK (&this->lock);
+
+        _dict_del_hashed (this, key, keylen, SuperFastHash (key, keylen));
 
         UNLOCK (&this->lock);
 
         return;
 }
 
+/* Interned keys */
+
+#define GF_DICT_KEY_TABLE_SIZE 256
+
+static dict_key_t      *dict_key_table[GF_DICT_KEY_TABLE_SIZE];
+static pthread_mutex_t  dict_key_table_lock = PTHREAD_MUTEX_INITIALIZER;
+
+dict_key_t *
+dict_key_intern (const char *key)
+{
+        dict_key_t *dkey = NULL;
+        int32_t     keylen = 0;
+        uint32_t    hash = 0;
+        uint32_t    idx = 0;
+
+        if (!key) {
+                gf_log_callingfn ("dict", GF_LOG_WARNING, "key is NULL");
+                return NULL;
+        }
+
+        keylen = strlen (key);
+        hash = SuperFastHash (key, keylen);
+        idx = hash % GF_DICT_KEY_TABLE_SIZE;
+
+        pthread_mutex_lock (&dict_key_table_lock);
+        {
+                for (dkey = dict_key_table[idx]; dkey; dkey = dkey->next) {
+                        if (dkey->hash == hash && dkey->len == keylen &&
+                            !memcmp (dkey->key, key, keylen))
+                                goto unlock;
+                }
+
+                /* Interned keys outlive any xlator, keep them out of
+                 * memory accounting.
+                 */
+                dkey = CALLOC (1, sizeof (*dkey) + keylen + 1);
+                if (!dkey)
+                        goto unlock;
+
+                dkey->key = (char *)(dkey + 1);
+                memcpy (dkey->key, key, keylen + 1);
+                dkey->len = keylen;
+                dkey->hash = hash;
+
+                dkey->next = dict_key_table[idx];
+                dict_key_table[idx] = dkey;
+        }
+unlock:
+        pthread_mutex_unlock (&dict_key_table_lock);
+
+        return dkey;
+}
+
+data_t *
+dict_getk (dict_t *this, dict_key_t *key)
+{
+        data_pair_t *pair = NULL;
+
+        if (!this || !key) {
+                gf_log_callingfn ("dict", GF_LOG_INFO,
+                                  "!this || key=%s", (key) ? key->key : "()");
+                return NULL;
+        }
+
+        LOCK (&this->lock);
+
+        pair = _dict_lookup_hashed (this, key->key, key->len, key->hash);
+
+        UNLOCK (&this->lock);
+
+        if (pair)
+                return pair->value;
+
+        return NULL;
+}
+
+int32_t
+dict_setk (dict_t *this, dict_key_t *key, data_t *value)
+{
+        int32_t ret;
+
+        if (!this || !key || !value) {
+                gf_log_callingfn ("dict", GF_LOG_WARNING,
+                                  "!this || !key || !value");
+                return -1;
+        }
+
+        LOCK (&this->lock);
+
+        ret = _dict_set_hashed (this, key->key, key->len, key->hash,
+                                DICT_KEY_STATIC, value, 1);
+
+        UNLOCK (&this->lock);
+
+        return ret;
+}
+
+void
+dict_delk (dict_t *this, dict_key_t *key)
+{
+        if (!this || !key) {
+                gf_log_callingfn ("dict", GF_LOG_WARNING, "!this || !key");
+                return;
+        }
+
+        LOCK (&this->lock);
+
+        _dict_del_hashed (this, key->key, key->len, key->hash);
+
+        UNLOCK (&this->lock);
+}
+
 void
 dict_destroy (dict_t *this)
 {
@@ -451,7 +650,7 @@ dict_destroy (dict_t *this)
         while (prev) {
                 pair = pair->next;
                 data_unref (prev->value);
-                GF_FREE (prev->key);
+                _dict_pair_free_key (prev);
                 if (prev != &this->free_pair) {
                         mem_put (prev);
                 }
@@ -459,7 +658,7 @@ dict_destroy (dict_t *this)
         }
 
         if (this->members != &this->members_internal) {
-                mem_put (this->members);
+                GF_FREE (this->members);
         }
 
         GF_FREE (this->extra_free);
@@ -1206,7 +1405,7 @@ dict_keys_join (void *value, int size, dict_t *dict,
 		if (value && (size > len))
 			strncpy (value + len, pairs->key, size - len);
 
-                len += (strlen (pairs->key) + 1);
+                len += (pairs->key_len + 1);
 
                 pairs = next;
         }
@@ -2320,7 +2519,7 @@ _dict_serialized_length (dict_t *this)
                         goto out;
                 }
 
-                len += strlen (pair->key) + 1  /* for '\0' */;
+                len += pair->key_len + 1  /* for '\0' */;
 
                 if (!pair->value) {
                         gf_log ("dict", GF_LOG_ERROR,
@@ -2400,7 +2599,7 @@ _dict_serialize (dict_t *this, char *buf)
                         goto out;
                 }
 
-                keylen  = strlen (pair->key);
+                keylen  = pair->key_len;
                 netword = hton32 (keylen);
                 memcpy (buf, &netword, sizeof(netword));
                 buf += DICT_DATA_HDR_KEY_LEN;
@@ -2497,6 +2696,491 @@ out:
 }
 
 
+/**
+ * Compact serialization format, used for xdata sent to peers which announced
+ * support for it at handshake:
+ *
+ *  ------- -------  -----  --------  ------- ------  ----------
+ * | magic | count || key | [suffix] | type | [len] | value     || ...
+ *  ------- -------  -----  --------  ------- ------  ----------
+ *     1    varint     1               1     varint
+ *
+ * The magic byte is never a valid first byte of the regular format, whose
+ * count is a non-negative 32 bit integer, so dict_unserialize() tells the two
+ * apart by looking at it.
+ *
+ * key is an index into dict_compact_keys[]. 0 is followed by a literal key
+ * (varint length and the bytes, no '\0'). A prefix entry is followed by the
+ * rest of the key in the same way.
+ *
+ * type 0x00-0x7f is the length of a short value, which follows. A canonical
+ * decimal string with its '\0', as set by dict_set_int*() and friends, is
+ * sent as a zigzag varint. Anything else is a varint length and the bytes.
+ */
+
+#define DICT_COMPACT_MAGIC         0xd1
+#define DICT_COMPACT_SHORT_MAX     0x7f
+#define DICT_COMPACT_RAW           0x80
+#define DICT_COMPACT_INT           0x81
+#define DICT_COMPACT_VARINT_MAX    10
+
+/* Append only: peers agree on a table size at handshake, and ids below it
+ * have to mean the same on both sides. Entry 0 stands for a literal key, and
+ * ids are sent as a single byte, so there is room for 255 keys.
+ */
+static struct dict_compact_key {
+        const char      *key;
+        gf_boolean_t     prefix;
+        int32_t          len;
+        uint32_t         hash;
+        dict_key_t      *dkey;
+} dict_compact_keys[] = {
+        { NULL,                           _gf_false },
+        { GFID_XATTR_KEY,                 _gf_false },
+        { "trusted.glusterfs.dht",        _gf_false },
+        { "trusted.glusterfs.dht.linkto", _gf_false },
+        { GF_CONTENT_KEY,                 _gf_false },
+        { GLUSTERFS_OPEN_FD_COUNT,        _gf_false },
+        { GLUSTERFS_INODELK_COUNT,        _gf_false },
+        { GLUSTERFS_ENTRYLK_COUNT,        _gf_false },
+        { GLUSTERFS_POSIXLK_COUNT,        _gf_false },
+        { GLUSTERFS_PARENT_ENTRYLK,       _gf_false },
+        { GLUSTERFS_INODELK_DOM_COUNT,    _gf_false },
+        { QUOTA_SIZE_KEY,                 _gf_false },
+        { QUOTA_LIMIT_KEY,                _gf_false },
+        { GF_SELINUX_XATTR_KEY,           _gf_false },
+        { POSIX_ACL_ACCESS_XATTR,         _gf_false },
+        { POSIX_ACL_DEFAULT_XATTR,        _gf_false },
+        { GF_XATTR_VOL_ID_KEY,            _gf_false },
+        { GF_XATTR_NODE_UUID_KEY,         _gf_false },
+        { GF_XATTR_PATHINFO_KEY,          _gf_false },
+        { GLUSTERFS_WRITE_IS_APPEND,      _gf_false },
+        { GLUSTERFS_INTERNAL_FOP_KEY,     _gf_false },
+        { "trusted.afr.",                 _gf_true  },
+        { PGFID_XATTR_KEY_PREFIX,         _gf_true  },
+        { "trusted.glusterfs.quota.",     _gf_true  },
+        { "trusted.glusterfs.",           _gf_true  },
+        { "trusted.",                     _gf_true  },
+        { "user.",                        _gf_true  },
+};
+
+#define DICT_COMPACT_KEY_COUNT  (sizeof (dict_compact_keys) /          \
+                                 sizeof (dict_compact_keys[0]))
+
+/* Lookup structures for the encoder: an open addressed table of the ids of
+ * whole keys, indexed by key hash, and the ids of prefixes by decreasing
+ * length.
+ */
+#define DICT_COMPACT_INDEX_SIZE 128
+
+static uint8_t        dict_compact_index[DICT_COMPACT_INDEX_SIZE];
+static uint8_t        dict_compact_prefixes[DICT_COMPACT_KEY_COUNT];
+static pthread_once_t dict_compact_once = PTHREAD_ONCE_INIT;
+
+static void
+dict_compact_keys_init (void)
+{
+        struct dict_compact_key *ck      = NULL;
+        uint32_t                 idx     = 0;
+        int                      nprefix = 0;
+        int                      i       = 0;
+        int                      j       = 0;
+
+        for (i = 1; i < DICT_COMPACT_KEY_COUNT; i++) {
+                ck = &dict_compact_keys[i];
+                ck->len = strlen (ck->key);
+
+                if (ck->prefix) {
+                        for (j = nprefix++; j > 0; j--) {
+                                if (dict_compact_keys[dict_compact_prefixes
+                                                      [j - 1]].len >= ck->len)
+                                        break;
+                                dict_compact_prefixes[j] =
+                                        dict_compact_prefixes[j - 1];
+                        }
+                        dict_compact_prefixes[j] = i;
+                        continue;
+                }
+
+                ck->dkey = dict_key_intern (ck->key);
+                ck->hash = SuperFastHash (ck->key, ck->len);
+
+                idx = ck->hash;
+                while (dict_compact_index[idx % DICT_COMPACT_INDEX_SIZE])
+                        idx++;
+                dict_compact_index[idx % DICT_COMPACT_INDEX_SIZE] = i;
+        }
+}
+
+/**
+ * dict_compact_key_count - number of well-known keys this build knows, to be
+ *                          announced to peers at handshake
+ */
+
+uint32_t
+dict_compact_key_count (void)
+{
+        return DICT_COMPACT_KEY_COUNT;
+}
+
+static inline char *
+_dict_put_varint (char *buf, uint64_t val)
+{
+        while (val > 0x7f) {
+                *buf++ = (val & 0x7f) | 0x80;
+                val >>= 7;
+        }
+        *buf++ = val;
+
+        return buf;
+}
+
+static inline int
+_dict_varint_len (uint64_t val)
+{
+        int len = 1;
+
+        while (val > 0x7f) {
+                val >>= 7;
+                len++;
+        }
+
+        return len;
+}
+
+static inline int
+_dict_get_varint (char **bufp, char *end, uint64_t *val)
+{
+        char     *buf   = *bufp;
+        uint64_t  v     = 0;
+        int       shift = 0;
+
+        while (buf < end && shift < 7 * DICT_COMPACT_VARINT_MAX) {
+                v |= (uint64_t)(*buf & 0x7f) << shift;
+                if (!(*buf++ & 0x80)) {
+                        *bufp = buf;
+                        *val = v;
+                        return 0;
+                }
+                shift += 7;
+        }
+
+        return -1;
+}
+
+/* A value qualifies for DICT_COMPACT_INT only if printing the integer back
+ * gives the very same bytes.
+ */
+static gf_boolean_t
+_dict_compact_decimal (data_t *value, int64_t *num)
+{
+        char     *data   = value->data;
+        int32_t   len    = value->len - 1;
+        int32_t   digits = 0;
+        int32_t   i      = 0;
+        uint64_t  val    = 0;
+
+        if (len < 1 || len > 20 || data[len] != '\0')
+                return _gf_false;
+
+        digits = (data[0] == '-') ? len - 1 : len;
+        if (digits < 1 || digits > 19)
+                return _gf_false;
+
+        if (data[len - digits] == '0' && (digits > 1 || data[0] == '-'))
+                return _gf_false;
+
+        for (i = len - digits; i < len; i++) {
+                if (data[i] < '0' || data[i] > '9')
+                        return _gf_false;
+                val = val * 10 + (data[i] - '0');
+        }
+
+        if (val > (uint64_t)INT64_MAX + (data[0] == '-'))
+                return _gf_false;
+
+        *num = (data[0] == '-') ? (int64_t)-val : (int64_t)val;
+
+        return _gf_true;
+}
+
+/* Reverse of the above, returns the length including the '\0' */
+static int
+_dict_compact_print (char *buf, int64_t num)
+{
+        char      tmp[20];
+        uint64_t  val = num;
+        int       len = 0;
+        int       i   = 0;
+
+        if (num < 0) {
+                buf[len++] = '-';
+                val = -val;
+        }
+
+        do {
+                tmp[i++] = '0' + val % 10;
+                val /= 10;
+        } while (val);
+
+        while (i)
+                buf[len++] = tmp[--i];
+        buf[len++] = '\0';
+
+        return len;
+}
+
+static int
+_dict_compact_key_id (data_pair_t *pair, uint32_t nkeys, int32_t *suffix)
+{
+        struct dict_compact_key *ck  = NULL;
+        uint32_t                 idx = 0;
+        int                      id  = 0;
+        int                      i   = 0;
+
+        idx = pair->key_hash;
+        while ((id = dict_compact_index[idx % DICT_COMPACT_INDEX_SIZE])) {
+                ck = &dict_compact_keys[id];
+                if (ck->hash == pair->key_hash && ck->len == pair->key_len &&
+                    !memcmp (pair->key, ck->key, ck->len))
+                        return (id < nkeys) ? id : 0;
+                idx++;
+        }
+
+        /* longest prefix first */
+        for (i = 0; (id = dict_compact_prefixes[i]); i++) {
+                ck = &dict_compact_keys[id];
+                if (id < nkeys && pair->key_len > ck->len &&
+                    !memcmp (pair->key, ck->key, ck->len)) {
+                        *suffix = ck->len;
+                        return id;
+                }
+        }
+
+        return 0;
+}
+
+/**
+ * _dict_serialize_compact - serialize a dictionary in the compact format.
+ *                           This procedure has to be called with this->lock
+ *                           held.
+ *
+ * @this:  dict to serialize
+ * @nkeys: number of entries of dict_compact_keys[] the peer knows
+ * @buf:   buffer to serialize into. This must be at least
+ *         _dict_serialized_length (this) + 2 * this->count +
+ *         DICT_COMPACT_VARINT_MAX large
+ *
+ * @return: success: length of the serialized dict
+ *          failure: -errno
+ */
+
+static int
+_dict_serialize_compact (dict_t *this, uint32_t nkeys, char *buf)
+{
+        char        *start  = buf;
+        data_pair_t *pair   = NULL;
+        int32_t      count  = 0;
+        int32_t      suffix = 0;
+        int32_t      vallen = 0;
+        int64_t      num    = 0;
+        uint64_t     zz     = 0;
+        gf_boolean_t is_int = _gf_false;
+        int          id     = 0;
+
+        nkeys = min (nkeys, DICT_COMPACT_KEY_COUNT);
+
+        *buf++ = DICT_COMPACT_MAGIC;
+        buf = _dict_put_varint (buf, this->count);
+
+        for (pair = this->members_list; pair; pair = pair->next) {
+                if (!pair->key || !pair->value ||
+                    (pair->value->len && !pair->value->data)) {
+                        gf_log ("dict", GF_LOG_ERROR, "invalid data pair");
+                        return -EINVAL;
+                }
+
+                suffix = 0;
+                is_int = _gf_false;
+                id = _dict_compact_key_id (pair, nkeys, &suffix);
+                *buf++ = id;
+                if (!id || suffix) {
+                        buf = _dict_put_varint (buf, pair->key_len - suffix);
+                        memcpy (buf, pair->key + suffix,
+                                pair->key_len - suffix);
+                        buf += pair->key_len - suffix;
+                }
+
+                vallen = pair->value->len;
+                if (vallen < 0) {
+                        gf_log ("dict", GF_LOG_ERROR,
+                                "value->len (%d) < 0", vallen);
+                        return -EINVAL;
+                }
+
+                if (_dict_compact_decimal (pair->value, &num)) {
+                        zz = ((uint64_t)num << 1) ^ -((uint64_t)num >> 63);
+                        is_int = (_dict_varint_len (zz) < vallen);
+                }
+
+                if (is_int) {
+                        *buf++ = DICT_COMPACT_INT;
+                        buf = _dict_put_varint (buf, zz);
+                } else {
+                        if (vallen <= DICT_COMPACT_SHORT_MAX) {
+                                *buf++ = vallen;
+                        } else {
+                                *buf++ = DICT_COMPACT_RAW;
+                                buf = _dict_put_varint (buf, vallen);
+                        }
+                        memcpy (buf, pair->value->data, vallen);
+                        buf += vallen;
+                }
+                count++;
+        }
+
+        if (count != this->count) {
+                gf_log ("dict", GF_LOG_ERROR,
+                        "count (%d) != data pairs found (%d)",
+                        this->count, count);
+                return -EINVAL;
+        }
+
+        return buf - start;
+}
+
+static int32_t
+_dict_unserialize_compact (char *orig_buf, int32_t size, dict_t *fill)
+{
+        struct dict_compact_key *ck     = NULL;
+        char                    *buf    = orig_buf + 1;
+        char                    *end    = orig_buf + size;
+        char                    *key    = NULL;
+        char                     nbuf[24];
+        data_t                  *value  = NULL;
+        uint64_t                 count  = 0;
+        uint64_t                 keylen = 0;
+        uint64_t                 vallen = 0;
+        uint64_t                 num    = 0;
+        uint32_t                 hash   = 0;
+        int                      mode   = DICT_KEY_COPY;
+        int                      type   = 0;
+        int                      ret    = -1;
+
+        pthread_once (&dict_compact_once, dict_compact_keys_init);
+
+        if (_dict_get_varint (&buf, end, &count) || count > size)
+                goto malformed;
+
+        fill->count = 0;
+
+        while (count--) {
+                if (buf >= end)
+                        goto malformed;
+
+                ck = NULL;
+                type = (unsigned char)*buf++;
+                if (type >= DICT_COMPACT_KEY_COUNT) {
+                        gf_log_callingfn ("dict", GF_LOG_ERROR,
+                                          "unknown key id %d", type);
+                        goto err;
+                }
+                if (type)
+                        ck = &dict_compact_keys[type];
+
+                keylen = 0;
+                if (!ck || ck->prefix) {
+                        if (_dict_get_varint (&buf, end, &keylen) ||
+                            keylen > end - buf)
+                                goto malformed;
+                }
+
+                if (ck && !ck->prefix) {
+                        key = ck->dkey->key;
+                        keylen = ck->dkey->len;
+                        hash = ck->dkey->hash;
+                        mode = DICT_KEY_STATIC;
+                } else if (ck) {
+                        key = GF_MALLOC (ck->len + keylen + 1,
+                                         gf_common_mt_char);
+                        if (!key)
+                                goto err;
+                        memcpy (key, ck->key, ck->len);
+                        memcpy (key + ck->len, buf, keylen);
+                        buf += keylen;
+                        keylen += ck->len;
+                        key[keylen] = '\0';
+                        hash = SuperFastHash (key, keylen);
+                        mode = DICT_KEY_OWNED;
+                } else {
+                        key = buf;
+                        buf += keylen;
+                        hash = SuperFastHash (key, keylen);
+                        mode = DICT_KEY_COPY;
+                }
+
+                value = get_new_data ();
+                if (!value)
+                        goto free_key;
+
+                if (buf >= end)
+                        goto free_value;
+                type = (unsigned char)*buf++;
+
+                if (type == DICT_COMPACT_INT) {
+                        if (_dict_get_varint (&buf, end, &num))
+                                goto free_value;
+                        vallen = _dict_compact_print
+                                        (nbuf, (num >> 1) ^ -(num & 1));
+                        value->data = memdup (nbuf, vallen);
+                } else {
+                        vallen = type;
+                        if (type == DICT_COMPACT_RAW &&
+                            _dict_get_varint (&buf, end, &vallen))
+                                goto free_value;
+                        if (type > DICT_COMPACT_RAW || vallen > end - buf ||
+                            vallen > INT32_MAX)
+                                goto free_value;
+                        value->data = memdup (buf, vallen);
+                        buf += vallen;
+                }
+                value->len = vallen;
+                value->is_static = 0;
+
+                if (!value->data)
+                        goto free_value;
+
+                LOCK (&fill->lock);
+                {
+                        ret = _dict_set_hashed (fill, key, keylen, hash, mode,
+                                                value, _gf_false);
+                }
+                UNLOCK (&fill->lock);
+                if (ret < 0) {
+                        data_destroy (value);
+                        goto err;
+                }
+        }
+
+        ret = 0;
+        goto out;
+
+free_value:
+        data_destroy (value);
+free_key:
+        if (mode == DICT_KEY_OWNED)
+                GF_FREE (key);
+malformed:
+        gf_log_callingfn ("dict", GF_LOG_ERROR,
+                          "malformed or undersized buffer passed (%d bytes)",
+                          size);
+err:
+        ret = -1;
+out:
+        return ret;
+}
+
+
 /**
  * dict_unserialize - unserialize a buffer into a dict
  *
@@ -2547,6 +3231,11 @@ dict_unserialize (char *orig_buf, int32_t size, dict_t **fill)
                 goto out;
         }
 
+        if ((unsigned char)buf[0] == DICT_COMPACT_MAGIC) {
+                ret = _dict_unserialize_compact (orig_buf, size, *fill);
+                goto out;
+        }
+
         if ((buf + DICT_HDR_LEN) > (orig_buf + size)) {
                 gf_log_callingfn ("dict", GF_LOG_ERROR,
                                   "undersized buffer passed. "
@@ -2594,6 +3283,13 @@ dict_unserialize (char *orig_buf, int32_t size, dict_t **fill)
                 vallen = ntoh32 (hostord);
                 buf += DICT_DATA_HDR_VAL_LEN;
 
+                if (keylen < 0 || vallen < 0) {
+                        gf_log_callingfn ("dict", GF_LOG_ERROR,
+                                          "invalid key (%d) or value (%d) "
+                                          "length", keylen, vallen);
+                        goto out;
+                }
+
                 if ((buf + keylen) > (orig_buf + size)) {
                         gf_log_callingfn ("dict", GF_LOG_ERROR,
                                           "undersized buffer passed. "
@@ -2619,7 +3315,13 @@ dict_unserialize (char *orig_buf, int32_t size, dict_t **fill)
                 value->is_static = 0;
                 buf += vallen;
 
-                dict_add (*fill, key, value);
+                LOCK (&(*fill)->lock);
+                {
+                        _dict_set_hashed (*fill, key, keylen,
+                                          SuperFastHash (key, keylen),
+                                          DICT_KEY_COPY, value, _gf_false);
+                }
+                UNLOCK (&(*fill)->lock);
         }
 
         ret = 0;
@@ -2682,6 +3384,150 @@ out:
         return ret;
 }
 
+/**
+ * dict_allocate_and_serialize_compact - serialize a dictionary into an
+ *                                       allocated buffer, using the compact
+ *                                       format if the peer supports it
+ *
+ * @this:  dict to serialize
+ * @nkeys: number of well-known keys the peer knows, 0 for the regular format
+ * @buf:   pointer to pointer to character. The allocated buffer is stored in
+ *         this pointer. The buffer has to be freed by the caller.
+ *
+ * @return: success: 0
+ *          failure: -errno
+ */
+
+int32_t
+dict_allocate_and_serialize_compact (dict_t *this, uint32_t nkeys, char **buf,
+                                     u_int *length)
+{
+        int           ret    = -EINVAL;
+        ssize_t       len = 0;
+
+        if (!nkeys)
+                return dict_allocate_and_serialize (this, buf, length);
+
+        if (!this || !buf) {
+                gf_log_callingfn ("dict", GF_LOG_DEBUG,
+                                  "dict OR buf is NULL");
+                goto out;
+        }
+
+        pthread_once (&dict_compact_once, dict_compact_keys_init);
+
+        LOCK (&this->lock);
+        {
+                /* The compact form of a pair is never more than two bytes
+                 * longer than the regular one, which is only reached for
+                 * huge keys.
+                 */
+                len = _dict_serialized_length (this);
+                if (len < 0) {
+                        ret = len;
+                        goto unlock;
+                }
+                len += 2 * this->count + DICT_COMPACT_VARINT_MAX;
+
+                *buf = GF_CALLOC (1, len, gf_common_mt_char);
+                if (*buf == NULL) {
+                        ret = -ENOMEM;
+                        goto unlock;
+                }
+
+                ret = _dict_serialize_compact (this, nkeys, *buf);
+                if (ret < 0) {
+                        GF_FREE (*buf);
+                        *buf = NULL;
+                        goto unlock;
+                }
+
+                if (length != NULL) {
+                        *length = ret;
+                }
+                ret = 0;
+        }
+unlock:
+        UNLOCK (&this->lock);
+out:
+        return ret;
+}
+
+/**
+ * dict_serialized_length_compact - return the size of the buffer needed by
+ *                                  dict_serialize_compact
+ *
+ * @this:  dict to be serialized
+ * @nkeys: number of well-known keys the peer knows, 0 for the regular format
+ *
+ * @return: success: len, an upper bound in the compact format
+ *          failure: -errno
+ */
+
+int32_t
+dict_serialized_length_compact (dict_t *this, uint32_t nkeys)
+{
+        int ret = -EINVAL;
+
+        if (!this) {
+                gf_log_callingfn ("dict", GF_LOG_WARNING, "dict is null!");
+                goto out;
+        }
+
+        LOCK (&this->lock);
+        {
+                ret = _dict_serialized_length (this);
+                if (ret >= 0 && nkeys)
+                        ret += 2 * this->count + DICT_COMPACT_VARINT_MAX;
+        }
+        UNLOCK (&this->lock);
+out:
+        return ret;
+}
+
+/**
+ * dict_serialize_compact - serialize a dictionary into a buffer, using the
+ *                          compact format if the peer supports it
+ *
+ * @this:  dict to serialize
+ * @nkeys: number of well-known keys the peer knows, 0 for the regular format
+ * @buf:   buffer to serialize into. This must be at least
+ *         dict_serialized_length_compact (this, nkeys) large
+ *
+ * @return: success: length of the serialized dict
+ *          failure: -errno
+ */
+
+int32_t
+dict_serialize_compact (dict_t *this, uint32_t nkeys, char *buf)
+{
+        int ret = -EINVAL;
+        int len = 0;
+
+        if (!this || !buf) {
+                gf_log_callingfn ("dict", GF_LOG_WARNING, "dict is null!");
+                goto out;
+        }
+
+        if (nkeys)
+                pthread_once (&dict_compact_once, dict_compact_keys_init);
+
+        LOCK (&this->lock);
+        {
+                if (nkeys) {
+                        ret = _dict_serialize_compact (this, nkeys, buf);
+                } else {
+                        len = _dict_serialized_length (this);
+                        ret = (len < 0) ? len : _dict_serialize (this, buf);
+                        if (ret == 0)
+                                ret = len;
+                }
+        }
+        UNLOCK (&this->lock);
+out:
+        return ret;
+}
+
 /**
  * _dict_serialize_value_with_delim: serialize the values in the dictionary
  * into a buffer separated by delimiter (except the last)
@@ -44,6 +44,26 @@ typedef struct _data_pair data_pair_t;
         } while (0)
 
 
+#define GF_PROTOCOL_DICT_SERIALIZE_COMPACT(this,from_dict,nkeys,to,len,   \
+                                           ope,labl) do {               \
+                int    ret     = 0;                                     \
+                                                                        \
+                if (!from_dict)                                         \
+                        break;                                          \
+                                                                        \
+                ret = dict_allocate_and_serialize_compact (from_dict,   \
+                                                           nkeys, to,   \
+                                                           &len);       \
+                if (ret < 0) {                                          \
+                        gf_log (this->name, GF_LOG_WARNING,             \
+                                "failed to get serialized dict (%s)",   \
+                                (#from_dict));                          \
+                        ope = EINVAL;                                   \
+                        goto labl;                                      \
+                }                                                       \
+        } while (0)
+
+
 #define GF_PROTOCOL_DICT_UNSERIALIZE(xl,to,buff,len,ret,ope,labl) do {  \
                 if (!len)                                               \
                         break;                                          \
@@ -78,6 +98,9 @@ struct _data_pair {
         struct _data_pair *next;
         data_t            *value;
         char              *key;
+        uint32_t           key_hash;
+        int32_t            key_len;
+        gf_boolean_t       key_static;
 };
 
 struct _dict {
@@ -95,6 +118,20 @@ struct _dict {
         gf_boolean_t    free_pair_in_use;
 };
 
+/*
+ * An interned key carries a well-known key string along with its length and
+ * hash, computed once. Lookups through the dict_*k() variants skip strlen()
+ * and hashing, and pairs created by dict_setk() share the key string instead
+ * of copying it. Interned keys are never freed.
+ */
+struct _dict_key {
+        char              *key;
+        int32_t            len;
+        uint32_t           hash;
+        struct _dict_key  *next;
+};
+typedef struct _dict_key dict_key_t;
+
 
 int32_t is_data_equal (data_t *one, data_t *two);
 void data_destroy (data_t *data);
@@ -113,6 +150,11 @@ int32_t dict_serialize (dict_t *dict, char *buf);
 int32_t dict_unserialize (char *buf, int32_t size, dict_t **fill);
 
 int32_t dict_allocate_and_serialize (dict_t *this, char **buf, u_int *length);
+int32_t dict_allocate_and_serialize_compact (dict_t *this, uint32_t nkeys,
+                                             char **buf, u_int *length);
+uint32_t dict_compact_key_count (void);
+int32_t dict_serialized_length_compact (dict_t *this, uint32_t nkeys);
+int32_t dict_serialize_compact (dict_t *this, uint32_t nkeys, char *buf);
 
 void dict_destroy (dict_t *dict);
 void dict_unref (dict_t *dict);
@@ -121,6 +163,12 @@ data_t *data_ref (data_t *data);
 void data_unref (data_t *data);
 
 int32_t dict_lookup  (dict_t *this, char *key, data_t **data);
+
+dict_key_t *dict_key_intern (const char *key);
+data_t *dict_getk (dict_t *this, dict_key_t *key);
+int32_t dict_setk (dict_t *this, dict_key_t *key, data_t *value);
+void dict_delk (dict_t *this, dict_key_t *key);
+
 /*
    TODO: provide converts for differnt byte sizes, signedness, and void *
  */
@@ -31,28 +31,283 @@
 #include <sys/epoll.h>
 
 
+/*
+ * Multi-threaded epoll dispatch.
+ *
+ * Every fd is registered with EPOLLONESHOT, so once an event for it has been
+ * returned by epoll_wait() to one dispatcher thread the fd is disarmed and
+ * no other thread can pick it up. The fd is re-armed after its handler has
+ * returned. event_select_on() called while the handler is running only
+ * records the new interest set, which is applied by the re-arm.
+ *
+ * Registrations live in slots addressed by idx. A slot is referenced by the
+ * registration and by each dispatcher running its handler, and is reused
+ * only after all of them are gone. The slot generation travels in the epoll
+ * data along with idx, so an event picked up just before the fd was
+ * unregistered is recognised as stale and dropped.
+ */
+
+struct event_slot_epoll {
+	int fd;
+	int events;
+	int gen;
+	int ref;
+	int in_handler;
+	void *data;
+	event_handler_t handler;
+	gf_lock_t lock;
+};
+
+struct event_thread_data {
+        struct event_pool *event_pool;
+        int                event_index;
+};
+
+
+static struct event_slot_epoll *
+__event_newtable (struct event_pool *event_pool, int table_idx)
+{
+        struct event_slot_epoll *table = NULL;
+        int                      i = -1;
+
+        table = GF_CALLOC (sizeof (*table), EVENT_EPOLL_SLOTS,
+                           gf_common_mt_ereg);
+        if (!table)
+                return NULL;
+
+        for (i = 0; i < EVENT_EPOLL_SLOTS; i++) {
+                table[i].fd = -1;
+                LOCK_INIT (&table[i].lock);
+        }
+
+        event_pool->ereg[table_idx] = table;
+        event_pool->slots_used[table_idx] = 0;
+
+        return table;
+}
+
+
 static int
-__event_getindex (struct event_pool *event_pool, int fd, int idx)
+__event_slot_alloc (struct event_pool *event_pool, int fd)
 {
-        int  ret = -1;
-        int  i = 0;
+        int                      i = 0;
+        int                      j = 0;
+        struct event_slot_epoll *table = NULL;
 
-        GF_VALIDATE_OR_GOTO ("event", event_pool, out);
+        for (i = 0; i < EVENT_EPOLL_TABLES; i++) {
+                if (event_pool->slots_used[i] == EVENT_EPOLL_SLOTS)
+                        continue;
 
-        if (idx > -1 && idx < event_pool->used) {
-                if (event_pool->reg[idx].fd == fd)
-                        ret = idx;
+                table = event_pool->ereg[i];
+                if (!table) {
+                        table = __event_newtable (event_pool, i);
+                        if (!table)
+                                return -1;
+                }
+
+                for (j = 0; j < EVENT_EPOLL_SLOTS; j++) {
+                        if (table[j].fd != -1)
+                                continue;
+
+                        LOCK (&table[j].lock);
+                        {
+                                /* still held by a dispatcher which has not
+                                   yet noticed the unregistration */
+                                if (table[j].ref) {
+                                        UNLOCK (&table[j].lock);
+                                        continue;
+                                }
+
+                                table[j].fd = fd;
+                                table[j].in_handler = 0;
+                                table[j].gen++;
+                        }
+                        UNLOCK (&table[j].lock);
+
+                        event_pool->slots_used[i]++;
+
+                        return i * EVENT_EPOLL_SLOTS + j;
+                }
         }
 
-        for (i=0; ret == -1 && i<event_pool->used; i++) {
-                if (event_pool->reg[i].fd == fd) {
-                        ret = i;
-                        break;
+        return -1;
+}
+
+
+static int
+event_slot_alloc (struct event_pool *event_pool, int fd)
+{
+        int  idx = -1;
+
+        pthread_mutex_lock (&event_pool->mutex);
+        {
+                idx = __event_slot_alloc (event_pool, fd);
+        }
+        pthread_mutex_unlock (&event_pool->mutex);
+
+        return idx;
+}
+
+
+/* Must be called with the slot locked. Any event still in flight for the
+ * slot carries the old generation and gets dropped, and the slot becomes
+ * reusable once the last reference to it is gone.
+ */
+static void
+__event_slot_release (struct event_slot_epoll *slot)
+{
+        slot->fd = -1;
+        slot->gen++;
+        slot->handler = NULL;
+        slot->data = NULL;
+}
+
+
+static void
+event_slot_release_account (struct event_pool *event_pool, int idx)
+{
+        pthread_mutex_lock (&event_pool->mutex);
+        {
+                event_pool->slots_used[idx / EVENT_EPOLL_SLOTS]--;
+        }
+        pthread_mutex_unlock (&event_pool->mutex);
+}
+
+
+static struct event_slot_epoll *
+event_slot_get (struct event_pool *event_pool, int idx)
+{
+        struct event_slot_epoll *slot = NULL;
+        struct event_slot_epoll *table = NULL;
+        int                      table_idx = 0;
+        int                      offset = 0;
+
+        if (idx < 0 || idx >= EVENT_EPOLL_TABLES * EVENT_EPOLL_SLOTS)
+                return NULL;
+
+        table_idx = idx / EVENT_EPOLL_SLOTS;
+        offset = idx % EVENT_EPOLL_SLOTS;
+
+        table = event_pool->ereg[table_idx];
+        if (!table)
+                return NULL;
+
+        slot = &table[offset];
+
+        LOCK (&slot->lock);
+        {
+                slot->ref++;
+        }
+        UNLOCK (&slot->lock);
+
+        return slot;
+}
+
+
+static void
+event_slot_unref (struct event_slot_epoll *slot)
+{
+        LOCK (&slot->lock);
+        {
+                slot->ref--;
+        }
+        UNLOCK (&slot->lock);
+}
+
+
+/* Find the slot of @fd, trying @idx_hint first. Callers which did not keep
+ * the idx returned by event_register() still get served by a full scan.
+ */
+static int
+event_getindex (struct event_pool *event_pool, int fd, int idx_hint)
+{
+        struct event_slot_epoll *table = NULL;
+        int                      idx = -1;
+        int                      i = 0;
+        int                      j = 0;
+
+        pthread_mutex_lock (&event_pool->mutex);
+        {
+                if (idx_hint >= 0 &&
+                    idx_hint < EVENT_EPOLL_TABLES * EVENT_EPOLL_SLOTS) {
+                        table = event_pool->ereg[idx_hint / EVENT_EPOLL_SLOTS];
+                        if (table &&
+                            table[idx_hint % EVENT_EPOLL_SLOTS].fd == fd) {
+                                idx = idx_hint;
+                                goto unlock;
+                        }
+                }
+
+                for (i = 0; i < EVENT_EPOLL_TABLES; i++) {
+                        table = event_pool->ereg[i];
+                        if (!table || !event_pool->slots_used[i])
+                                continue;
+
+                        for (j = 0; j < EVENT_EPOLL_SLOTS; j++) {
+                                if (table[j].fd == fd) {
+                                        idx = i * EVENT_EPOLL_SLOTS + j;
+                                        goto unlock;
+                                }
+                        }
                 }
         }
+unlock:
+        pthread_mutex_unlock (&event_pool->mutex);
 
-out:
-        return ret;
+        return idx;
+}
+
+
+static void
+__event_slot_set_events (struct event_slot_epoll *slot, int poll_in,
+                         int poll_out)
+{
+        switch (poll_in) {
+        case 1:
+                slot->events |= EPOLLIN;
+                break;
+        case 0:
+                slot->events &= ~EPOLLIN;
+                break;
+        case -1:
+                /* do nothing */
+                break;
+        default:
+                gf_log ("epoll", GF_LOG_ERROR,
+                        "invalid poll_in value %d", poll_in);
+                break;
+        }
+
+        switch (poll_out) {
+        case 1:
+                slot->events |= EPOLLOUT;
+                break;
+        case 0:
+                slot->events &= ~EPOLLOUT;
+                break;
+        case -1:
+                /* do nothing */
+                break;
+        default:
+                gf_log ("epoll", GF_LOG_ERROR,
+                        "invalid poll_out value %d", poll_out);
+                break;
+        }
+}
+
+
+static int
+__event_slot_arm (struct event_pool *event_pool, struct event_slot_epoll *slot,
+                  int idx, int op)
+{
+        struct epoll_event  epoll_event = {0, };
+        struct event_data  *ev_data = (void *)&epoll_event.data;
+
+        epoll_event.events = slot->events | EPOLLONESHOT;
+        ev_data->idx = idx;
+        ev_data->gen = slot->gen;
+
+        return epoll_ctl (event_pool->fd, op, slot->fd, &epoll_event);
 }
 
 
@@ -68,23 +323,11 @@ event_pool_new_epoll (int count)
         if (!event_pool)
                 goto out;
 
-        event_pool->count = count;
-        event_pool->reg = GF_CALLOC (event_pool->count,
-                                     sizeof (*event_pool->reg),
-                                     gf_common_mt_reg);
-
-        if (!event_pool->reg) {
-                GF_FREE (event_pool);
-                event_pool = NULL;
-                goto out;
-        }
-
         epfd = epoll_create (count);
 
         if (epfd == -1) {
                 gf_log ("epoll", GF_LOG_ERROR, "epoll fd creation failed (%s)",
                         strerror (errno));
-                GF_FREE (event_pool->reg);
                 GF_FREE (event_pool);
                 event_pool = NULL;
                 goto out;
@@ -94,6 +337,8 @@ event_pool_new_epoll (int count)
 
         event_pool->count = count;
 
+        event_pool->eventthreadcount = 1;
+
         pthread_mutex_init (&event_pool->mutex, NULL);
         pthread_cond_init (&event_pool->cond, NULL);
 
@@ -107,163 +352,100 @@ event_register_epoll (struct event_pool *event_pool, int fd,
                       event_handler_t handler,
                       void *data, int poll_in, int poll_out)
 {
-        int                 idx = -1;
-        int                 ret = -1;
-        struct epoll_event  epoll_event = {0, };
-        struct event_data  *ev_data = (void *)&epoll_event.data;
+        int                      idx = -1;
+        int                      ret = -1;
+        struct event_slot_epoll *slot = NULL;
 
 
         GF_VALIDATE_OR_GOTO ("event", event_pool, out);
 
-        pthread_mutex_lock (&event_pool->mutex);
-        {
-                if (event_pool->count == event_pool->used) {
-                        event_pool->count *= 2;
-
-                        event_pool->reg = GF_REALLOC (event_pool->reg,
-                                                      event_pool->count *
-                                                      sizeof (*event_pool->reg));
-
-                        if (!event_pool->reg) {
-                                gf_log ("epoll", GF_LOG_ERROR,
-                                        "event registry re-allocation failed");
-                                goto unlock;
-                        }
-                }
-
-                idx = event_pool->used;
-                event_pool->used++;
-
-                event_pool->reg[idx].fd = fd;
-                event_pool->reg[idx].events = EPOLLPRI;
-                event_pool->reg[idx].handler = handler;
-                event_pool->reg[idx].data = data;
-
-                switch (poll_in) {
-                case 1:
-                        event_pool->reg[idx].events |= EPOLLIN;
-                        break;
-                case 0:
-                        event_pool->reg[idx].events &= ~EPOLLIN;
-                        break;
-                case -1:
-                        /* do nothing */
-                        break;
-                default:
-                        gf_log ("epoll", GF_LOG_ERROR,
-                                "invalid poll_in value %d", poll_in);
-                        break;
-                }
-
-                switch (poll_out) {
-                case 1:
-                        event_pool->reg[idx].events |= EPOLLOUT;
-                        break;
-                case 0:
-                        event_pool->reg[idx].events &= ~EPOLLOUT;
-                        break;
-                case -1:
-                        /* do nothing */
-                        break;
-                default:
-                        gf_log ("epoll", GF_LOG_ERROR,
-                                "invalid poll_out value %d", poll_out);
-                        break;
-                }
+        idx = event_slot_alloc (event_pool, fd);
+        if (idx == -1) {
+                gf_log ("epoll", GF_LOG_ERROR,
+                        "could not find slot for fd=%d", fd);
+                return -1;
+        }
 
-                event_pool->changed = 1;
+        slot = event_slot_get (event_pool, idx);
 
-                epoll_event.events = event_pool->reg[idx].events;
-                ev_data->fd = fd;
-                ev_data->idx = idx;
+        LOCK (&slot->lock);
+        {
+                slot->events = EPOLLPRI;
+                slot->handler = handler;
+                slot->data = data;
 
-                ret = epoll_ctl (event_pool->fd, EPOLL_CTL_ADD, fd,
-                                 &epoll_event);
+                __event_slot_set_events (slot, poll_in, poll_out);
 
+                ret = __event_slot_arm (event_pool, slot, idx, EPOLL_CTL_ADD);
                 if (ret == -1) {
                         gf_log ("epoll", GF_LOG_ERROR,
                                 "failed to add fd(=%d) to epoll fd(=%d) (%s)",
                                 fd, event_pool->fd, strerror (errno));
-                        goto unlock;
+                        __event_slot_release (slot);
                 }
+        }
+        UNLOCK (&slot->lock);
+
+        event_slot_unref (slot);
 
-                pthread_cond_broadcast (&event_pool->cond);
+        if (ret == -1) {
+                event_slot_release_account (event_pool, idx);
+                idx = -1;
         }
-unlock:
-        pthread_mutex_unlock (&event_pool->mutex);
 
 out:
-        return ret;
+        return idx;
 }
 
 
 static int
 event_unregister_epoll (struct event_pool *event_pool, int fd, int idx_hint)
 {
-        int  idx = -1;
-        int  ret = -1;
-
-        struct epoll_event epoll_event = {0, };
-        struct event_data *ev_data = (void *)&epoll_event.data;
-        int                lastidx = -1;
+        int                      idx = -1;
+        int                      ret = -1;
+        int                      released = 0;
+        struct event_slot_epoll *slot = NULL;
 
         GF_VALIDATE_OR_GOTO ("event", event_pool, out);
 
-        pthread_mutex_lock (&event_pool->mutex);
-        {
-                idx = __event_getindex (event_pool, fd, idx_hint);
+        idx = event_getindex (event_pool, fd, idx_hint);
+        if (idx == -1) {
+                gf_log ("epoll", GF_LOG_ERROR,
+                        "index not found for fd=%d (idx_hint=%d)",
+                        fd, idx_hint);
+                errno = ENOENT;
+                goto out;
+        }
 
-                if (idx == -1) {
-                        gf_log ("epoll", GF_LOG_ERROR,
-                                "index not found for fd=%d (idx_hint=%d)",
-                                fd, idx_hint);
+        slot = event_slot_get (event_pool, idx);
+        if (!slot)
+                goto out;
+
+        LOCK (&slot->lock);
+        {
+                if (slot->fd != fd) {
+                        /* lost a race with another unregistration */
                         errno = ENOENT;
                         goto unlock;
                 }
 
                 ret = epoll_ctl (event_pool->fd, EPOLL_CTL_DEL, fd, NULL);
-
-                /* if ret is -1, this array member should never be accessed */
-                /* if it is 0, the array member might be used by idx_cache
-                 * in which case the member should not be accessed till
-                 * it is reallocated
-                 */
-
-                event_pool->reg[idx].fd = -1;
-
                 if (ret == -1) {
                         gf_log ("epoll", GF_LOG_ERROR,
                                 "fail to del fd(=%d) from epoll fd(=%d) (%s)",
                                 fd, event_pool->fd, strerror (errno));
-                        goto unlock;
                 }
 
-                lastidx = event_pool->used - 1;
-                if (lastidx == idx) {
-                        event_pool->used--;
-                        goto unlock;
-                }
-
-                epoll_event.events = event_pool->reg[lastidx].events;
-                ev_data->fd = event_pool->reg[lastidx].fd;
-                ev_data->idx = idx;
-
-                ret = epoll_ctl (event_pool->fd, EPOLL_CTL_MOD, ev_data->fd,
-                                 &epoll_event);
-                if (ret == -1) {
-                        gf_log ("epoll", GF_LOG_ERROR,
-                                "fail to modify fd(=%d) index %d to %d (%s)",
-                                ev_data->fd, event_pool->used, idx,
-                                strerror (errno));
-                        goto unlock;
-                }
-
-                /* just replace the unregistered idx by last one */
-                event_pool->reg[idx] = event_pool->reg[lastidx];
-                event_pool->used--;
+                __event_slot_release (slot);
+                released = 1;
         }
 unlock:
-        pthread_mutex_unlock (&event_pool->mutex);
+        UNLOCK (&slot->lock);
+
+        event_slot_unref (slot);
+
+        if (released)
+                event_slot_release_account (event_pool, idx);
 
 out:
         return ret;
@@ -274,74 +456,52 @@ static int
 event_select_on_epoll (struct event_pool *event_pool, int fd, int idx_hint,
                        int poll_in, int poll_out)
 {
-        int idx = -1;
-        int ret = -1;
-
-        struct epoll_event epoll_event = {0, };
-        struct event_data *ev_data = (void *)&epoll_event.data;
+        int                      idx = -1;
+        int                      ret = -1;
+        struct event_slot_epoll *slot = NULL;
 
 
         GF_VALIDATE_OR_GOTO ("event", event_pool, out);
 
-        pthread_mutex_lock (&event_pool->mutex);
-        {
-                idx = __event_getindex (event_pool, fd, idx_hint);
+        idx = event_getindex (event_pool, fd, idx_hint);
+        if (idx == -1) {
+                gf_log ("epoll", GF_LOG_ERROR,
+                        "index not found for fd=%d (idx_hint=%d)",
+                        fd, idx_hint);
+                errno = ENOENT;
+                goto out;
+        }
 
-                if (idx == -1) {
-                        gf_log ("epoll", GF_LOG_ERROR,
-                                "index not found for fd=%d (idx_hint=%d)",
-                                fd, idx_hint);
-                        errno = ENOENT;
-                        goto unlock;
-                }
+        slot = event_slot_get (event_pool, idx);
+        if (!slot)
+                goto out;
 
-                switch (poll_in) {
-                case 1:
-                        event_pool->reg[idx].events |= EPOLLIN;
-                        break;
-                case 0:
-                        event_pool->reg[idx].events &= ~EPOLLIN;
-                        break;
-                case -1:
-                        /* do nothing */
-                        break;
-                default:
-                        gf_log ("epoll", GF_LOG_ERROR,
-                                "invalid poll_in value %d", poll_in);
-                        break;
-                }
+        LOCK (&slot->lock);
+        {
+                __event_slot_set_events (slot, poll_in, poll_out);
 
-                switch (poll_out) {
-                case 1:
-                        event_pool->reg[idx].events |= EPOLLOUT;
-                        break;
-                case 0:
-                        event_pool->reg[idx].events &= ~EPOLLOUT;
-                        break;
-                case -1:
-                        /* do nothing */
-                        break;
-                default:
-                        gf_log ("epoll", GF_LOG_ERROR,
-                                "invalid poll_out value %d", poll_out);
-                        break;
+                if (slot->in_handler) {
+                        /* the fd gets re-armed with the new events once
+                           the handler returns */
+                        ret = 0;
+                        goto unlock;
                 }
 
-                epoll_event.events = event_pool->reg[idx].events;
-                ev_data->fd = fd;
-                ev_data->idx = idx;
-
-                ret = epoll_ctl (event_pool->fd, EPOLL_CTL_MOD, fd,
-                                 &epoll_event);
+                ret = __event_slot_arm (event_pool, slot, idx,
+                                        EPOLL_CTL_MOD);
                 if (ret == -1) {
                         gf_log ("epoll", GF_LOG_ERROR,
                                 "failed to modify fd(=%d) events to %d",
-                                fd, epoll_event.events);
+                                fd, slot->events);
                 }
         }
 unlock:
-        pthread_mutex_unlock (&event_pool->mutex);
+        UNLOCK (&slot->lock);
 
+        event_slot_unref (slot);
+
+        if (ret == 0)
+                ret = idx;
 out:
         return ret;
 }
@@ -349,42 +509,185 @@ out:
 
 static int
 event_dispatch_epoll_handler (struct event_pool *event_pool,
-                              struct epoll_event *events, int i)
+                              struct epoll_event *event)
 {
-        struct event_data  *event_data = NULL;
-        event_handler_t     handler = NULL;
-        void               *data = NULL;
-        int                 idx = -1;
-        int                 ret = -1;
+        struct event_data        *ev_data = NULL;
+        struct event_slot_epoll  *slot = NULL;
+        event_handler_t           handler = NULL;
+        void                     *data = NULL;
+        int                       idx = -1;
+        int                       gen = -1;
+        int                       fd = -1;
+        int                       ret = -1;
+
+
+        ev_data = (void *)&event->data;
+        idx = ev_data->idx;
+        gen = ev_data->gen;
+
+        slot = event_slot_get (event_pool, idx);
+        if (!slot) {
+                gf_log ("epoll", GF_LOG_ERROR,
+                        "no slot for idx=%d", idx);
+                return -1;
+        }
 
+        LOCK (&slot->lock);
+        {
+                if (slot->fd == -1 || slot->gen != gen) {
+                        /* unregistered (and maybe reused) meanwhile */
+                        UNLOCK (&slot->lock);
+                        goto out;
+                }
 
-        event_data = (void *)&events[i].data;
-        handler = NULL;
-        data = NULL;
+                if (slot->in_handler) {
+                        /* the fd was re-armed by an event_select_on()
+                           racing with the dispatch of the previous event.
+                           Events are level triggered, so whatever is left
+                           is reported again after the running handler
+                           re-arms the fd. */
+                        UNLOCK (&slot->lock);
+                        goto out;
+                }
 
-        pthread_mutex_lock (&event_pool->mutex);
+                slot->in_handler = 1;
+                fd = slot->fd;
+                handler = slot->handler;
+                data = slot->data;
+        }
+        UNLOCK (&slot->lock);
+
+        if (handler)
+                ret = handler (fd, idx, data,
+                               (event->events & (EPOLLIN|EPOLLPRI)),
+                               (event->events & (EPOLLOUT)),
+                               (event->events & (EPOLLERR|EPOLLHUP)));
+
+        LOCK (&slot->lock);
         {
-                idx = __event_getindex (event_pool, event_data->fd,
-                                        event_data->idx);
+                slot->in_handler = 0;
+
+                if (slot->fd == fd && slot->gen == gen) {
+                        if (__event_slot_arm (event_pool, slot, idx,
+                                              EPOLL_CTL_MOD) == -1)
+                                gf_log ("epoll", GF_LOG_ERROR,
+                                        "failed to re-arm fd(=%d) (%s)",
+                                        fd, strerror (errno));
+                }
+        }
+        UNLOCK (&slot->lock);
 
-                if (idx == -1) {
+out:
+        event_slot_unref (slot);
+
+        return ret;
+}
+
+
+static void *
+event_dispatch_epoll_worker (void *data)
+{
+        struct event_thread_data *ev_data = data;
+        struct event_pool        *event_pool = NULL;
+        struct epoll_event        event = {0, };
+        int                       myindex = -1;
+        int                       ret = -1;
+
+        event_pool = ev_data->event_pool;
+        myindex = ev_data->event_index;
+
+        GF_FREE (ev_data);
+
+        gf_log ("epoll", GF_LOG_INFO, "Started thread with index %d",
+                myindex);
+
+        for (;;) {
+                /* threads beyond the configured count leave, the
+                   thread which called event_dispatch() never does */
+                if (myindex > 0 &&
+                    myindex >= event_pool->eventthreadcount) {
+                        pthread_mutex_lock (&event_pool->mutex);
+                        {
+                                if (myindex >= event_pool->eventthreadcount) {
+                                        event_pool->pollers[myindex] = 0;
+                                        event_pool->activethreadcount--;
+                                        pthread_mutex_unlock (
+                                                &event_pool->mutex);
+                                        gf_log ("epoll", GF_LOG_INFO,
+                                                "Exited thread with index %d",
+                                                myindex);
+                                        return NULL;
+                                }
+                        }
+                        pthread_mutex_unlock (&event_pool->mutex);
+                }
+
+                /* one event at a time, so that a busy fd does not hold up
+                   the others queued behind it in the same thread */
+                ret = epoll_wait (event_pool->fd, &event, 1, -1);
+
+                if (ret == 0)
+                        /* timeout */
+                        continue;
+
+                if (ret == -1 && errno == EINTR)
+                        /* sys call */
+                        continue;
+
+                if (ret == -1) {
                         gf_log ("epoll", GF_LOG_ERROR,
-                                "index not found for fd(=%d) (idx_hint=%d)",
-                                event_data->fd, event_data->idx);
-                        goto unlock;
+                                "epoll_wait failed (%s)", strerror (errno));
+                        continue;
                 }
 
-                handler = event_pool->reg[idx].handler;
-                data = event_pool->reg[idx].data;
+                if (!event.events)
+                        continue;
+
+                event_dispatch_epoll_handler (event_pool, &event);
+        }
+
+        return NULL;
+}
+
+
+/* Must be called with event_pool->mutex held. */
+static int
+__event_start_threads (struct event_pool *event_pool)
+{
+        struct event_thread_data *ev_data = NULL;
+        pthread_t                 t_id;
+        int                       i = 0;
+        int                       ret = 0;
+
+        for (i = 1; i < event_pool->eventthreadcount; i++) {
+                if (event_pool->pollers[i])
+                        continue;
+
+                ev_data = GF_CALLOC (1, sizeof (*ev_data),
+                                     gf_common_mt_event_pool);
+                if (!ev_data) {
+                        ret = -1;
+                        break;
+                }
+
+                ev_data->event_pool = event_pool;
+                ev_data->event_index = i;
+
+                ret = gf_thread_create (&t_id, NULL,
+                                        event_dispatch_epoll_worker,
+                                        ev_data);
+                if (ret) {
+                        gf_log ("epoll", GF_LOG_WARNING,
+                                "Failed to start thread for index %d", i);
+                        GF_FREE (ev_data);
+                        break;
+                }
+
+                pthread_detach (t_id);
+                event_pool->pollers[i] = t_id;
+                event_pool->activethreadcount++;
         }
-unlock:
-        pthread_mutex_unlock (&event_pool->mutex);
 
-        if (handler)
-                ret = handler (event_data->fd, event_data->idx, data,
-                               (events[i].events & (EPOLLIN|EPOLLPRI)),
-                               (events[i].events & (EPOLLOUT)),
-                               (events[i].events & (EPOLLERR|EPOLLHUP)));
         return ret;
 }
 
@@ -392,60 +695,64 @@ unlock:
 static int
 event_dispatch_epoll (struct event_pool *event_pool)
 {
-        struct epoll_event *events = NULL;
-        int                 size = 0;
-        int                 i = 0;
-        int                 ret = -1;
+        struct event_thread_data *ev_data = NULL;
+        int                       ret = -1;
 
         GF_VALIDATE_OR_GOTO ("event", event_pool, out);
 
-        while (1) {
-                pthread_mutex_lock (&event_pool->mutex);
-                {
-                        while (event_pool->used == 0)
-                                pthread_cond_wait (&event_pool->cond,
-                                                   &event_pool->mutex);
+        ev_data = GF_CALLOC (1, sizeof (*ev_data), gf_common_mt_event_pool);
+        if (!ev_data)
+                goto out;
 
-                        if (event_pool->used > event_pool->evcache_size) {
-                                GF_FREE (event_pool->evcache);
+        ev_data->event_pool = event_pool;
+        ev_data->event_index = 0;
 
-                                event_pool->evcache = events = NULL;
+        pthread_mutex_lock (&event_pool->mutex);
+        {
+                event_pool->dispatched = 1;
+                event_pool->pollers[0] = pthread_self ();
+                event_pool->activethreadcount = 1;
 
-                                event_pool->evcache_size =
-                                        event_pool->used + 256;
+                /* the calling thread is dispatcher 0 */
+                __event_start_threads (event_pool);
+        }
+        pthread_mutex_unlock (&event_pool->mutex);
 
-                                events = GF_CALLOC (event_pool->evcache_size,
-                                                    sizeof (struct epoll_event),
-                                                    gf_common_mt_epoll_event);
-                                if (!events)
-                                        break;
+        event_dispatch_epoll_worker (ev_data);
 
-                                event_pool->evcache = events;
-                        }
-                }
-                pthread_mutex_unlock (&event_pool->mutex);
+        ret = 0;
+out:
+        return ret;
+}
 
-                ret = epoll_wait (event_pool->fd, event_pool->evcache,
-                                  event_pool->evcache_size, -1);
 
-                if (ret == 0)
-                        /* timeout */
-                        continue;
+static int
+event_reconfigure_threads_epoll (struct event_pool *event_pool, int value)
+{
+        int ret = 0;
 
-                if (ret == -1 && errno == EINTR)
-                        /* sys call */
-                        continue;
+        GF_VALIDATE_OR_GOTO ("event", event_pool, out);
 
-                size = ret;
+        if (value < 1)
+                value = 1;
+        if (value > EVENT_MAX_THREADS)
+                value = EVENT_MAX_THREADS;
 
-                for (i = 0; i < size; i++) {
-                        if (!events || !events[i].events)
-                                continue;
+        pthread_mutex_lock (&event_pool->mutex);
+        {
+                if (event_pool->eventthreadcount != value)
+                        gf_log ("epoll", GF_LOG_INFO,
+                                "Reconfigured event threads %d -> %d",
+                                event_pool->eventthreadcount, value);
 
-                        ret = event_dispatch_epoll_handler (event_pool,
-                                                            events, i);
-                }
+                /* surplus threads notice the lower count and exit after
+                   their next event */
+                event_pool->eventthreadcount = value;
+
+                if (event_pool->dispatched)
+                        ret = __event_start_threads (event_pool);
         }
+        pthread_mutex_unlock (&event_pool->mutex);
 
 out:
         return ret;
@@ -453,11 +760,12 @@ out:
 
 
 struct event_ops event_ops_epoll = {
-        .new              = event_pool_new_epoll,
-        .event_register   = event_register_epoll,
-        .event_select_on  = event_select_on_epoll,
-        .event_unregister = event_unregister_epoll,
-        .event_dispatch   = event_dispatch_epoll
+        .new                       = event_pool_new_epoll,
+        .event_register            = event_register_epoll,
+        .event_select_on           = event_select_on_epoll,
+        .event_unregister          = event_unregister_epoll,
+        .event_dispatch            = event_dispatch_epoll,
+        .event_reconfigure_threads = event_reconfigure_threads_epoll,
 };
 
 #endif
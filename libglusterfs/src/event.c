@@ -115,3 +115,23 @@ event_dispatch (struct event_pool *event_pool)
 out:
         return ret;
 }
+
+
+int
+event_reconfigure_threads (struct event_pool *event_pool, int value)
+{
+        int ret = -1;
+
+        GF_VALIDATE_OR_GOTO ("event", event_pool, out);
+
+        /* poll based dispatch is single threaded */
+        if (!event_pool->ops->event_reconfigure_threads) {
+                ret = 0;
+                goto out;
+        }
+
+        ret = event_pool->ops->event_reconfigure_threads (event_pool, value);
+
+out:
+        return ret;
+}
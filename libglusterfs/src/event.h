@@ -18,11 +18,16 @@
 
 #include <pthread.h>
 
+#define EVENT_EPOLL_TABLES 1024
+#define EVENT_EPOLL_SLOTS 1024
+#define EVENT_MAX_THREADS  32
+
 struct event_pool;
 struct event_ops;
+struct event_slot_epoll;
 struct event_data {
-	int fd;
 	int idx;
+	int gen;
 } __attribute__ ((__packed__, __may_alias__));
 
 
@@ -51,6 +56,18 @@ struct event_pool {
 
 	void *evcache;
 	int evcache_size;
+
+        /* epoll: registered fds live in slots which never move, so that
+         * an idx handed out by event_register() stays valid while other
+         * fds come and go. Tables of slots are allocated on demand.
+         */
+        struct event_slot_epoll *ereg[EVENT_EPOLL_TABLES];
+        int slots_used[EVENT_EPOLL_TABLES];
+
+        int eventthreadcount; /* number of dispatcher threads wanted */
+        int activethreadcount;
+        int dispatched;
+        pthread_t pollers[EVENT_MAX_THREADS];
 };
 
 struct event_ops {
@@ -66,6 +83,9 @@ struct event_ops {
         int (*event_unregister) (struct event_pool *event_pool, int fd, int idx);
 
         int (*event_dispatch) (struct event_pool *event_pool);
+
+        int (*event_reconfigure_threads) (struct event_pool *event_pool,
+                                          int newcount);
 };
 
 struct event_pool * event_pool_new (int count);
@@ -76,5 +96,6 @@ int event_register (struct event_pool *event_pool, int fd,
 		    void *data, int poll_in, int poll_out);
 int event_unregister (struct event_pool *event_pool, int fd, int idx);
 int event_dispatch (struct event_pool *event_pool);
+int event_reconfigure_threads (struct event_pool *event_pool, int value);
 
 #endif /* _EVENT_H_ */
@@ -238,6 +238,7 @@ typedef enum {
 	GF_FOP_FALLOCATE,
 	GF_FOP_DISCARD,
         GF_FOP_ZEROFILL,
+        GF_FOP_COMPOUND,
         GF_FOP_MAXVALUE,
 } glusterfs_fop_t;
 
@@ -389,6 +390,8 @@ struct _cmd_args {
         int              congestion_threshold;
         char             *fuse_mountopts;
 
+        uint64_t         synctask_stack_size;
+
         /* key args */
         char            *mount_point;
         char            *volfile_id;
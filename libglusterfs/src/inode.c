@@ -40,6 +40,22 @@
                 }                                                       \
         }
 
+/* without the atomic builtins the ref only changes under table->lock, and
+   inode->lock is taken as well */
+#define INODE_REF_INC(inode) GF_ATOMIC_ADD ((inode)->lock, (inode)->ref, 1)
+#define INODE_REF_DEC(inode) GF_ATOMIC_SUB ((inode)->lock, (inode)->ref, 1)
+
+/* The lru lists are allowed to grow this far past lru_cap before they are
+   trimmed, so that retiring inodes happens in batches. */
+#define INODE_LRU_BATCH(table) ((table)->lru_cap / 64)
+
+/* lru_pressure is in 1/1024ths of the configured cap. Under RSS pressure
+   it is halved once a second, down to 1/64, and it grows back by 1/16
+   a second once the pressure is gone. */
+#define INODE_LRU_PRESSURE_MAX 1024
+#define INODE_LRU_PRESSURE_MIN 16
+#define INODE_LRU_PRESSURE_INC 64
+
 static inode_t *
 __inode_unref (inode_t *inode);
 
@@ -78,10 +94,25 @@ hash_gfid (uuid_t uuid, int mod)
 }
 
 
+static pthread_mutex_t *
+dentry_hash_lock (inode_table_t *table, int hash)
+{
+        return &table->name_hash_lock[hash % INODE_HASH_LOCKS];
+}
+
+
+static pthread_mutex_t *
+inode_hash_lock (inode_table_t *table, int hash)
+{
+        return &table->inode_hash_lock[hash % INODE_HASH_LOCKS];
+}
+
+
 static void
 __dentry_hash (dentry_t *dentry)
 {
         inode_table_t   *table = NULL;
+        pthread_mutex_t *lock = NULL;
         int              hash = 0;
 
         if (!dentry) {
@@ -92,9 +123,14 @@ __dentry_hash (dentry_t *dentry)
         table = dentry->inode->table;
         hash = hash_dentry (dentry->parent, dentry->name,
                             table->hashsize);
+        lock = dentry_hash_lock (table, hash);
 
-        list_del_init (&dentry->hash);
-        list_add (&dentry->hash, &table->name_hash[hash]);
+        pthread_mutex_lock (lock);
+        {
+                list_del_init (&dentry->hash);
+                list_add (&dentry->hash, &table->name_hash[hash]);
+        }
+        pthread_mutex_unlock (lock);
 }
 
 
@@ -113,12 +149,28 @@ __is_dentry_hashed (dentry_t *dentry)
 static void
 __dentry_unhash (dentry_t *dentry)
 {
+        inode_table_t   *table = NULL;
+        pthread_mutex_t *lock = NULL;
+        int              hash = 0;
+
         if (!dentry) {
                 gf_log_callingfn (THIS->name, GF_LOG_WARNING, "dentry not found");
                 return;
         }
 
-        list_del_init (&dentry->hash);
+        if (list_empty (&dentry->hash))
+                return;
+
+        table = dentry->inode->table;
+        hash = hash_dentry (dentry->parent, dentry->name,
+                            table->hashsize);
+        lock = dentry_hash_lock (table, hash);
+
+        pthread_mutex_lock (lock);
+        {
+                list_del_init (&dentry->hash);
+        }
+        pthread_mutex_unlock (lock);
 }
 
 
@@ -224,12 +276,23 @@ __is_dentry_cyclic (dentry_t *dentry)
 static void
 __inode_unhash (inode_t *inode)
 {
+        pthread_mutex_t *lock = NULL;
+
         if (!inode) {
                 gf_log_callingfn (THIS->name, GF_LOG_WARNING, "inode not found");
                 return;
         }
 
-        list_del_init (&inode->hash);
+        if (list_empty (&inode->hash))
+                return;
+
+        lock = inode_hash_lock (inode->table, hash_gfid (inode->gfid, 65536));
+
+        pthread_mutex_lock (lock);
+        {
+                list_del_init (&inode->hash);
+        }
+        pthread_mutex_unlock (lock);
 }
 
 
@@ -259,8 +322,12 @@ __inode_hash (inode_t *inode)
         table = inode->table;
         hash = hash_gfid (inode->gfid, 65536);
 
-        list_del_init (&inode->hash);
-        list_add (&inode->hash, &table->inode_hash[hash]);
+        pthread_mutex_lock (inode_hash_lock (table, hash));
+        {
+                list_del_init (&inode->hash);
+                list_add (&inode->hash, &table->inode_hash[hash]);
+        }
+        pthread_mutex_unlock (inode_hash_lock (table, hash));
 }
 
 
@@ -351,7 +418,12 @@ __inode_passivate (inode_t *inode)
                 return;
         }
 
-        list_move_tail (&inode->list, &inode->table->lru);
+        if (inode->hot) {
+                list_move_tail (&inode->list, &inode->table->lru_hot);
+                inode->table->lru_hot_size++;
+        } else {
+                list_move_tail (&inode->list, &inode->table->lru);
+        }
         inode->table->lru_size++;
 
         list_for_each_entry_safe (dentry, t, &inode->dentry_list, inode_list) {
@@ -394,9 +466,7 @@ __inode_unref (inode_t *inode)
 
         GF_ASSERT (inode->ref);
 
-        --inode->ref;
-
-        if (!inode->ref) {
+        if (INODE_REF_DEC (inode) == 0) {
                 inode->table->active_size--;
 
                 if (inode->nlookup)
@@ -417,14 +487,64 @@ __inode_ref (inode_t *inode)
 
         if (!inode->ref) {
                 inode->table->lru_size--;
+                if (inode->hot) {
+                        inode->table->lru_hot_size--;
+                } else if (__is_inode_hashed (inode)) {
+                        /* second use, protect it from now on */
+                        inode->hot = 1;
+                }
+                if (__is_inode_hashed (inode))
+                        inode->table->lru_hits++;
                 __inode_activate (inode);
         }
-        inode->ref++;
+        INODE_REF_INC (inode);
 
         return inode;
 }
 
 
+/* Take a reference without table->lock, provided the inode already has one
+   and so is on the active list. Returns _gf_false if the caller has to go
+   through __inode_ref() under the lock. */
+static gf_boolean_t
+inode_ref_unless_zero (inode_t *inode)
+{
+#ifdef GF_HAVE_ATOMIC_BUILTINS
+        uint32_t ref = 0;
+
+        do {
+                ref = inode->ref;
+                if (!ref)
+                        return _gf_false;
+        } while (!__sync_bool_compare_and_swap (&inode->ref, ref, ref + 1));
+
+        return _gf_true;
+#else
+        return _gf_false;
+#endif
+}
+
+
+/* Drop a reference without table->lock, provided it is not the last one. */
+static gf_boolean_t
+inode_unref_unless_last (inode_t *inode)
+{
+#ifdef GF_HAVE_ATOMIC_BUILTINS
+        uint32_t ref = 0;
+
+        do {
+                ref = inode->ref;
+                if (ref <= 1)
+                        return _gf_false;
+        } while (!__sync_bool_compare_and_swap (&inode->ref, ref, ref - 1));
+
+        return _gf_true;
+#else
+        return _gf_false;
+#endif
+}
+
+
 inode_t *
 inode_unref (inode_t *inode)
 {
@@ -435,6 +555,13 @@ inode_unref (inode_t *inode)
 
         table = inode->table;
 
+        /* the root inode is never unref'd, see __inode_unref() */
+        if (inode == table->root)
+                return inode;
+
+        if (inode_unref_unless_last (inode))
+                return inode;
+
         pthread_mutex_lock (&table->lock);
         {
                 inode = __inode_unref (inode);
@@ -457,6 +584,9 @@ inode_ref (inode_t *inode)
 
         table = inode->table;
 
+        if (inode_ref_unless_zero (inode))
+                return inode;
+
         pthread_mutex_lock (&table->lock);
         {
                 inode = __inode_ref (inode);
@@ -505,7 +635,7 @@ out:
 
 
 static inode_t *
-__inode_create (inode_table_t *table)
+inode_alloc (inode_table_t *table)
 {
         inode_t  *newi = NULL;
 
@@ -538,11 +668,24 @@ __inode_create (inode_table_t *table)
                 goto out;
         }
 
+out:
+
+        return newi;
+}
+
+
+static inode_t *
+__inode_create (inode_table_t *table)
+{
+        inode_t  *newi = NULL;
+
+        newi = inode_alloc (table);
+        if (!newi)
+                return NULL;
+
         list_add (&newi->list, &table->lru);
         table->lru_size++;
 
-out:
-
         return newi;
 }
 
@@ -557,12 +700,16 @@ inode_new (inode_table_t *table)
                 return NULL;
         }
 
+        /* allocate outside the table lock */
+        inode = inode_alloc (table);
+        if (inode == NULL)
+                return NULL;
+
         pthread_mutex_lock (&table->lock);
         {
-                inode = __inode_create (table);
-                if (inode != NULL) {
-                        __inode_ref (inode);
-                }
+                list_add (&inode->list, &table->lru);
+                table->lru_size++;
+                __inode_ref (inode);
         }
         pthread_mutex_unlock (&table->lock);
 
@@ -599,18 +746,14 @@ __inode_forget (inode_t *inode, uint64_t nlookup)
 }
 
 
-dentry_t *
-__dentry_grep (inode_table_t *table, inode_t *parent, const char *name)
+/* caller holds table->lock or the stripe lock of 'hash' */
+static dentry_t *
+__dentry_grep_hashed (inode_table_t *table, inode_t *parent,
+                      const char *name, int hash)
 {
-        int       hash = 0;
         dentry_t *dentry = NULL;
         dentry_t *tmp = NULL;
 
-        if (!table || !name || !parent)
-                return NULL;
-
-        hash = hash_dentry (parent, name, table->hashsize);
-
         list_for_each_entry (tmp, &table->name_hash[hash], hash) {
                 if (tmp->parent == parent && !strcmp (tmp->name, name)) {
                         dentry = tmp;
@@ -622,11 +765,28 @@ __dentry_grep (inode_table_t *table, inode_t *parent, const char *name)
 }
 
 
+dentry_t *
+__dentry_grep (inode_table_t *table, inode_t *parent, const char *name)
+{
+        int       hash = 0;
+
+        if (!table || !name || !parent)
+                return NULL;
+
+        hash = hash_dentry (parent, name, table->hashsize);
+
+        return __dentry_grep_hashed (table, parent, name, hash);
+}
+
+
 inode_t *
 inode_grep (inode_table_t *table, inode_t *parent, const char *name)
 {
         inode_t   *inode = NULL;
         dentry_t  *dentry = NULL;
+        pthread_mutex_t *lock = NULL;
+        int        hash = 0;
+        int        need_lock = 0;
 
         if (!table || !parent || !name) {
                 gf_log_callingfn (THIS->name, GF_LOG_WARNING,
@@ -634,9 +794,27 @@ inode_grep (inode_table_t *table, inode_t *parent, const char *name)
                 return NULL;
         }
 
+        hash = hash_dentry (parent, name, table->hashsize);
+        lock = dentry_hash_lock (table, hash);
+
+        pthread_mutex_lock (lock);
+        {
+                dentry = __dentry_grep_hashed (table, parent, name, hash);
+
+                if (dentry && !inode_ref_unless_zero (dentry->inode))
+                        need_lock = 1;
+                else if (dentry)
+                        inode = dentry->inode;
+        }
+        pthread_mutex_unlock (lock);
+
+        if (!need_lock)
+                return inode;
+
+        /* the inode is on the lru list, take the slow path */
         pthread_mutex_lock (&table->lock);
         {
-                dentry = __dentry_grep (table, parent, name);
+                dentry = __dentry_grep_hashed (table, parent, name, hash);
 
                 if (dentry)
                         inode = dentry->inode;
@@ -699,6 +877,7 @@ inode_grep_for_gfid (inode_table_t *table, inode_t *parent, const char *name,
 {
         inode_t   *inode = NULL;
         dentry_t  *dentry = NULL;
+        int        hash = 0;
         int        ret = -1;
 
         if (!table || !parent || !name) {
@@ -707,9 +886,11 @@ inode_grep_for_gfid (inode_table_t *table, inode_t *parent, const char *name,
                 return ret;
         }
 
-        pthread_mutex_lock (&table->lock);
+        hash = hash_dentry (parent, name, table->hashsize);
+
+        pthread_mutex_lock (dentry_hash_lock (table, hash));
         {
-                dentry = __dentry_grep (table, parent, name);
+                dentry = __dentry_grep_hashed (table, parent, name, hash);
 
                 if (dentry)
                         inode = dentry->inode;
@@ -720,7 +901,7 @@ inode_grep_for_gfid (inode_table_t *table, inode_t *parent, const char *name,
                         ret = 0;
                 }
         }
-        pthread_mutex_unlock (&table->lock);
+        pthread_mutex_unlock (dentry_hash_lock (table, hash));
 
         return ret;
 }
@@ -775,12 +956,29 @@ inode_t *
 inode_find (inode_table_t *table, uuid_t gfid)
 {
         inode_t   *inode = NULL;
+        pthread_mutex_t *lock = NULL;
+        int        need_lock = 0;
 
         if (!table) {
                 gf_log_callingfn (THIS->name, GF_LOG_WARNING, "table not found");
                 return NULL;
         }
 
+        lock = inode_hash_lock (table, hash_gfid (gfid, 65536));
+
+        pthread_mutex_lock (lock);
+        {
+                inode = __inode_find (table, gfid);
+                if (inode && !inode_ref_unless_zero (inode)) {
+                        need_lock = 1;
+                        inode = NULL;
+                }
+        }
+        pthread_mutex_unlock (lock);
+
+        if (!need_lock)
+                return inode;
+
         pthread_mutex_lock (&table->lock);
         {
                 inode = __inode_find (table, gfid);
@@ -793,6 +991,64 @@ inode_find (inode_table_t *table, uuid_t gfid)
 }
 
 
+/* A ghost is a 31 bit fingerprint of an evicted gfid, plus one bit telling
+   which lru list it was evicted from. */
+static uint32_t *
+__inode_ghost_slot (inode_table_t *table, uuid_t gfid, uint32_t *fp)
+{
+        uint32_t hash = 0;
+
+        memcpy (&hash, gfid, sizeof (hash));
+        *fp = (hash << 1) | 2;
+
+        hash ^= hash_gfid (gfid, 65536) * 2654435761U;
+
+        return &table->lru_ghosts[hash % INODE_LRU_GHOSTS];
+}
+
+
+static void
+__inode_ghost_add (inode_table_t *table, inode_t *inode)
+{
+        uint32_t *slot = NULL;
+        uint32_t  fp = 0;
+
+        if (!table->lru_ghosts)
+                return;
+
+        slot = __inode_ghost_slot (table, inode->gfid, &fp);
+        *slot = fp | (inode->hot ? 1 : 0);
+}
+
+
+/* A gfid evicted a short while ago is being linked in again: the list it
+   was evicted from should have been larger. */
+static void
+__inode_ghost_check (inode_table_t *table, uuid_t gfid)
+{
+        uint32_t *slot = NULL;
+        uint32_t  fp = 0;
+        uint32_t  step = 0;
+
+        if (!table->lru_ghosts)
+                return;
+
+        slot = __inode_ghost_slot (table, gfid, &fp);
+        if ((*slot & ~1U) != fp)
+                return;
+
+        step = table->lru_cap / 128 + 1;
+
+        if (*slot & 1)
+                table->lru_hot_target = min (table->lru_hot_target + step,
+                                             table->lru_cap);
+        else
+                table->lru_hot_target -= min (table->lru_hot_target, step);
+
+        *slot = 0;
+}
+
+
 static inode_t *
 __inode_link (inode_t *inode, inode_t *parent, const char *name,
               struct iatt *iatt)
@@ -836,6 +1092,9 @@ __inode_link (inode_t *inode, inode_t *parent, const char *name,
                         uuid_copy (inode->gfid, iatt->ia_gfid);
                         inode->ia_type    = iatt->ia_type;
                         __inode_hash (inode);
+
+                        table->lru_misses++;
+                        __inode_ghost_check (table, inode->gfid);
                 }
         }
 
@@ -1239,6 +1498,101 @@ inode_path (inode_t *inode, const char *name, char **bufp)
 }
 
 
+/* Work out lru_cap from the configured limits. Called with table->lock
+   held, or before the table is in use. */
+static void
+__inode_table_set_cap (inode_table_t *table)
+{
+        uint64_t cap = 0;
+        uint64_t bytes_cap = 0;
+
+        cap = table->lru_limit;
+
+        if (table->lru_limit_bytes) {
+                bytes_cap = max (table->lru_limit_bytes / table->inode_size, 1);
+                if (!cap || bytes_cap < cap)
+                        cap = bytes_cap;
+        }
+
+        if (cap && table->lru_pressure < INODE_LRU_PRESSURE_MAX)
+                cap = max (cap * table->lru_pressure / INODE_LRU_PRESSURE_MAX,
+                           1);
+
+        table->lru_cap = min (cap, UINT32_MAX);
+
+        if (table->lru_cap && !table->lru_ghosts) {
+                table->lru_ghosts = GF_CALLOC (INODE_LRU_GHOSTS,
+                                               sizeof (uint32_t),
+                                               gf_common_mt_inode_ghosts);
+                table->lru_hot_target = table->lru_cap / 2;
+        }
+
+        table->lru_hot_target = min (table->lru_hot_target, table->lru_cap);
+}
+
+
+/* Sample the RSS once a second and scale lru_cap accordingly. */
+static void
+inode_table_check_pressure (inode_table_t *table)
+{
+        time_t   now = 0;
+        uint64_t rss = 0;
+        uint32_t pressure = 0;
+
+        now = time (NULL);
+        if (now == table->rss_checked)
+                return;
+
+        pthread_mutex_lock (&table->lock);
+        {
+                if (now == table->rss_checked)
+                        now = 0;
+                else
+                        table->rss_checked = now;
+        }
+        pthread_mutex_unlock (&table->lock);
+
+        if (!now)
+                return;
+
+        rss = get_mem_rss ();
+
+        pthread_mutex_lock (&table->lock);
+        {
+                pressure = table->lru_pressure;
+
+                if (rss > table->rss_limit)
+                        pressure = max (pressure / 2, INODE_LRU_PRESSURE_MIN);
+                else
+                        pressure = min (pressure + INODE_LRU_PRESSURE_INC,
+                                        INODE_LRU_PRESSURE_MAX);
+
+                if (pressure != table->lru_pressure) {
+                        gf_log (table->name, GF_LOG_DEBUG, "rss %"PRIu64", "
+                                "lru scaled to %u/%d", rss, pressure,
+                                INODE_LRU_PRESSURE_MAX);
+                        table->lru_pressure = pressure;
+                        __inode_table_set_cap (table);
+                }
+        }
+        pthread_mutex_unlock (&table->lock);
+}
+
+
+/* Evict from the hot list while it is over its share, else from the cold
+   one. */
+static inode_t *
+__inode_lru_victim (inode_table_t *table)
+{
+        if (list_empty (&table->lru) ||
+            (table->lru_hot_size > table->lru_hot_target &&
+             !list_empty (&table->lru_hot)))
+                return list_entry (table->lru_hot.next, inode_t, list);
+
+        return list_entry (table->lru.next, inode_t, list);
+}
+
+
 static int
 inode_table_prune (inode_table_t *table)
 {
@@ -1251,16 +1605,29 @@ inode_table_prune (inode_table_t *table)
         if (!table)
                 return -1;
 
+        if (table->rss_limit && table->lru_cap)
+                inode_table_check_pressure (table);
+
+        /* unlocked peek, most callers have nothing to do */
+        if (!table->purge_size &&
+            (!table->lru_cap ||
+             table->lru_size <= table->lru_cap + INODE_LRU_BATCH (table)))
+                return 0;
+
         INIT_LIST_HEAD (&purge);
 
         pthread_mutex_lock (&table->lock);
         {
-                while (table->lru_limit
-                       && table->lru_size > (table->lru_limit)) {
+                while (table->lru_cap
+                       && table->lru_size > (table->lru_cap)) {
 
-                        entry = list_entry (table->lru.next, inode_t, list);
+                        entry = __inode_lru_victim (table);
 
                         table->lru_size--;
+                        if (entry->hot)
+                                table->lru_hot_size--;
+                        table->lru_evictions++;
+                        __inode_ghost_add (table, entry);
                         __inode_retire (entry);
 
                         ret++;
@@ -1283,6 +1650,31 @@ inode_table_prune (inode_table_t *table)
 }
 
 
+int
+inode_table_set_lru_limit (inode_table_t *table, uint32_t lru_limit,
+                           uint64_t lru_limit_bytes, uint64_t rss_limit)
+{
+        if (!table)
+                return -1;
+
+        pthread_mutex_lock (&table->lock);
+        {
+                table->lru_limit = lru_limit;
+                table->lru_limit_bytes = lru_limit_bytes;
+                table->rss_limit = rss_limit;
+                if (!rss_limit)
+                        table->lru_pressure = INODE_LRU_PRESSURE_MAX;
+
+                __inode_table_set_cap (table);
+        }
+        pthread_mutex_unlock (&table->lock);
+
+        inode_table_prune (table);
+
+        return 0;
+}
+
+
 static void
 __inode_table_init_root (inode_table_t *table)
 {
@@ -1318,6 +1710,10 @@ inode_table_new (size_t lru_limit, xlator_t *xl)
         new->ctxcount = xl->graph->xl_count + 1;
 
         new->lru_limit = lru_limit;
+        new->lru_pressure = INODE_LRU_PRESSURE_MAX;
+        new->inode_size = sizeof (inode_t) + sizeof (dentry_t) +
+                new->ctxcount * sizeof (struct _inode_ctx) +
+                32 /* a typical name */;
 
         new->hashsize = 14057; /* TODO: Random Number?? */
 
@@ -1365,8 +1761,16 @@ inode_table_new (size_t lru_limit, xlator_t *xl)
 
         INIT_LIST_HEAD (&new->active);
         INIT_LIST_HEAD (&new->lru);
+        INIT_LIST_HEAD (&new->lru_hot);
         INIT_LIST_HEAD (&new->purge);
 
+        __inode_table_set_cap (new);
+
+        for (i = 0; i < INODE_HASH_LOCKS; i++) {
+                pthread_mutex_init (&new->name_hash_lock[i], NULL);
+                pthread_mutex_init (&new->inode_hash_lock[i], NULL);
+        }
+
         ret = gf_asprintf (&new->name, "%s/inode", xl->name);
         if (-1 == ret) {
                 /* TODO: This should be ok to continue, check with avati */
@@ -1383,6 +1787,7 @@ out:
                 if (new) {
                         GF_FREE (new->inode_hash);
                         GF_FREE (new->name_hash);
+                        GF_FREE (new->lru_ghosts);
                         if (new->dentry_pool)
                                 mem_pool_destroy (new->dentry_pool);
                         if (new->inode_pool)
@@ -1898,9 +2303,26 @@ inode_table_dump (inode_table_t *itable, char *prefix)
         gf_proc_dump_write(key, "%d", itable->lru_size);
         gf_proc_dump_build_key(key, prefix, "purge_size");
         gf_proc_dump_write(key, "%d", itable->purge_size);
+        gf_proc_dump_build_key(key, prefix, "lru_hot_size");
+        gf_proc_dump_write(key, "%u", itable->lru_hot_size);
+        gf_proc_dump_build_key(key, prefix, "lru_hot_target");
+        gf_proc_dump_write(key, "%u", itable->lru_hot_target);
+        gf_proc_dump_build_key(key, prefix, "lru_cap");
+        gf_proc_dump_write(key, "%u", itable->lru_cap);
+        gf_proc_dump_build_key(key, prefix, "lru_limit_bytes");
+        gf_proc_dump_write(key, "%"PRIu64, itable->lru_limit_bytes);
+        gf_proc_dump_build_key(key, prefix, "rss_limit");
+        gf_proc_dump_write(key, "%"PRIu64, itable->rss_limit);
+        gf_proc_dump_build_key(key, prefix, "lru_hits");
+        gf_proc_dump_write(key, "%"PRIu64, itable->lru_hits);
+        gf_proc_dump_build_key(key, prefix, "lru_misses");
+        gf_proc_dump_write(key, "%"PRIu64, itable->lru_misses);
+        gf_proc_dump_build_key(key, prefix, "lru_evictions");
+        gf_proc_dump_write(key, "%"PRIu64, itable->lru_evictions);
 
         INODE_DUMP_LIST(&itable->active, key, prefix, "active");
         INODE_DUMP_LIST(&itable->lru, key, prefix, "lru");
+        INODE_DUMP_LIST(&itable->lru_hot, key, prefix, "lru_hot");
         INODE_DUMP_LIST(&itable->purge, key, prefix, "purge");
 
         pthread_mutex_unlock(&itable->lock);
@@ -1973,6 +2395,36 @@ inode_table_dump_to_dict (inode_table_t *itable, char *prefix, dict_t *dict)
         if (ret)
                 goto out;
 
+        memset (key, 0, sizeof (key));
+        snprintf (key, sizeof (key), "%s.itable.lru_hot_size", prefix);
+        ret = dict_set_uint32 (dict, key, itable->lru_hot_size);
+        if (ret)
+                goto out;
+
+        memset (key, 0, sizeof (key));
+        snprintf (key, sizeof (key), "%s.itable.lru_limit", prefix);
+        ret = dict_set_uint32 (dict, key, itable->lru_cap);
+        if (ret)
+                goto out;
+
+        memset (key, 0, sizeof (key));
+        snprintf (key, sizeof (key), "%s.itable.lru_hits", prefix);
+        ret = dict_set_uint64 (dict, key, itable->lru_hits);
+        if (ret)
+                goto out;
+
+        memset (key, 0, sizeof (key));
+        snprintf (key, sizeof (key), "%s.itable.lru_misses", prefix);
+        ret = dict_set_uint64 (dict, key, itable->lru_misses);
+        if (ret)
+                goto out;
+
+        memset (key, 0, sizeof (key));
+        snprintf (key, sizeof (key), "%s.itable.lru_evictions", prefix);
+        ret = dict_set_uint64 (dict, key, itable->lru_evictions);
+        if (ret)
+                goto out;
+
         list_for_each_entry (inode, &itable->active, list) {
                 memset (key, 0, sizeof (key));
                 snprintf (key, sizeof (key), "%s.itable.active%d", prefix,
@@ -1987,6 +2439,13 @@ inode_table_dump_to_dict (inode_table_t *itable, char *prefix, dict_t *dict)
                           count++);
                 inode_dump_to_dict (inode, key, dict);
         }
+        /* lru_size covers both lists */
+        list_for_each_entry (inode, &itable->lru_hot, list) {
+                memset (key, 0, sizeof (key));
+                snprintf (key, sizeof (key), "%s.itable.lru%d", prefix,
+                          count++);
+                inode_dump_to_dict (inode, key, dict);
+        }
         count = 0;
 
         list_for_each_entry (inode, &itable->purge, list) {
@@ -20,6 +20,8 @@
 #include <sys/types.h>
 
 #define DEFAULT_INODE_MEMPOOL_ENTRIES   32 * 1024
+#define INODE_HASH_LOCKS                256 /* lock stripes per hash */
+#define INODE_LRU_GHOSTS                4096 /* recently evicted gfids kept */
 #define INODE_PATH_FMT "<gfid:%s>"
 struct _inode_table;
 typedef struct _inode_table inode_table_t;
@@ -36,6 +38,25 @@ typedef struct _dentry dentry_t;
 #include "uuid.h"
 
 
+/*
+ * table->lock serializes every change to the table: the active/lru/purge
+ * lists, dentry creation and removal, and linking. The two hash tables are
+ * additionally striped over INODE_HASH_LOCKS locks each. A hash chain is
+ * only modified with both table->lock and its stripe lock held, so lookups
+ * (inode_grep, inode_find) can walk a chain under the stripe lock alone.
+ *
+ * inode->ref is changed atomically. Taking a reference on an inode which
+ * already has one, or dropping one which is not the last, is done without
+ * any lock; only the 0 <-> 1 transitions, which move the inode between the
+ * active and lru lists, go through table->lock.
+ *
+ * Unreferenced inodes are kept 2Q style: on 'lru' when they have been used
+ * once, on 'lru_hot' once they have been brought back from the lru. The
+ * share of the lru that is kept hot adapts to which list recently evicted
+ * inodes are looked up again from (ARC's ghost lists), so a scan of many
+ * files does not push out the directories every path walk goes through.
+ * lru_size counts the inodes on both lists.
+ */
 struct _inode_table {
         pthread_mutex_t    lock;
         size_t             hashsize;    /* bucket size of inode hash and dentry hash */
@@ -48,8 +69,23 @@ struct _inode_table {
         struct list_head   active;      /* list of inodes currently active (in an fop) */
         uint32_t           active_size; /* count of inodes in active list */
         struct list_head   lru;         /* list of inodes recently used.
-                                           lru.next most recent */
-        uint32_t           lru_size;    /* count of inodes in lru list  */
+                                           lru.next least recent */
+        uint32_t           lru_size;    /* count of inodes in lru lists */
+        struct list_head   lru_hot;     /* re-referenced unused inodes */
+        uint32_t           lru_hot_size;
+        uint32_t           lru_hot_target; /* adaptive goal for lru_hot_size */
+        uint64_t           lru_limit_bytes; /* memory cap of the lru, 0: none */
+        uint64_t           rss_limit;   /* shrink the lru while the process
+                                           RSS is above this, 0: never */
+        uint32_t           lru_cap;     /* lru_limit after applying the two
+                                           limits above, 0: unlimited */
+        uint32_t           lru_pressure; /* lru_cap scale in 1/1024ths */
+        time_t             rss_checked;
+        size_t             inode_size;  /* estimated bytes per cached inode */
+        uint64_t           lru_hits;    /* inodes reused from the lru */
+        uint64_t           lru_misses;  /* inodes linked in afresh */
+        uint64_t           lru_evictions;
+        uint32_t          *lru_ghosts;  /* fingerprints of evicted gfids */
         struct list_head   purge;       /* list of inodes to be purged soon */
         uint32_t           purge_size;  /* count of inodes in purge list */
 
@@ -57,6 +93,8 @@ struct _inode_table {
         struct mem_pool   *dentry_pool; /* memory pool for dentrys */
         struct mem_pool   *fd_mem_pool; /* memory pool for fd_t */
         int                ctxcount;    /* number of slots in inode->ctx */
+        pthread_mutex_t    name_hash_lock[INODE_HASH_LOCKS];
+        pthread_mutex_t    inode_hash_lock[INODE_HASH_LOCKS];
 };
 
 
@@ -97,6 +135,7 @@ struct _inode {
         struct list_head     dentry_list;   /* list of directory entries for this inode */
         struct list_head     hash;          /* hash table pointers */
         struct list_head     list;          /* active/lru/purge */
+        char                 hot;           /* reused from the lru before */
 
 	struct _inode_ctx   *_ctx;    /* replacement for dict_t *(inode->ctx) */
 };
@@ -109,6 +148,10 @@ struct _inode {
 inode_table_t *
 inode_table_new (size_t lru_limit, xlator_t *xl);
 
+int
+inode_table_set_lru_limit (inode_table_t *table, uint32_t lru_limit,
+                           uint64_t lru_limit_bytes, uint64_t rss_limit);
+
 inode_t *
 inode_new (inode_table_t *table);
 
@@ -12,57 +12,149 @@
 #include "iobuf.h"
 #include "statedump.h"
 #include <stdio.h>
+#ifdef GF_LINUX_HOST_OS
+#include <sys/syscall.h>
+#endif
 
 
 /*
   TODO: implement destroy margins and prefetching of arenas
 */
 
-#define IOBUF_ARENA_MAX_INDEX  (sizeof (gf_iobuf_init_config) /         \
-                                (sizeof (struct iobuf_init_config)))
-
-/* Make sure this array is sorted based on pagesize */
-struct iobuf_init_config gf_iobuf_init_config[] = {
-        /* { pagesize, num_pages }, */
-        {128, 1024},
-        {512, 512},
-        {2 * 1024, 512},
-        {8 * 1024, 128},
-        {32 * 1024, 64},
-        {128 * 1024, 32},
-        {256 * 1024, 8},
-        {1 * 1024 * 1024, 2},
-};
+#define IOBUF_HUGE_PAGE_SIZE_DEFAULT (2 * GF_UNIT_MB)
+
+/* numa nodes above this are treated as "no node" */
+#define IOBUF_NUMA_MAX_NODES 64
+
+#ifndef MPOL_PREFERRED
+#define MPOL_PREFERRED 1
+#endif
+
+
+static size_t
+gf_iobuf_huge_page_size (void)
+{
+        size_t  size = IOBUF_HUGE_PAGE_SIZE_DEFAULT;
+#ifdef GF_LINUX_HOST_OS
+        FILE   *fp = NULL;
+        char    line[128] = {0,};
+        unsigned long kb = 0;
+
+        fp = fopen ("/proc/meminfo", "r");
+        if (!fp)
+                goto out;
+
+        while (fgets (line, sizeof (line), fp)) {
+                if (sscanf (line, "Hugepagesize: %lu kB", &kb) == 1) {
+                        if (kb)
+                                size = kb * GF_UNIT_KB;
+                        break;
+                }
+        }
+
+        fclose (fp);
+out:
+#endif
+        return size;
+}
+
+
+/* number of the highest online node + 1 */
+static int
+gf_iobuf_numa_nodes (void)
+{
+        int   nodes = 1;
+#ifdef GF_LINUX_HOST_OS
+        FILE *fp = NULL;
+        char  line[256] = {0,};
+        char *last = NULL;
+
+        fp = fopen ("/sys/devices/system/node/online", "r");
+        if (!fp)
+                goto out;
+
+        if (fgets (line, sizeof (line), fp)) {
+                /* "0", "0-1", "0,2-3" */
+                last = strrchr (line, '-');
+                if (!last || strrchr (line, ',') > last)
+                        last = strrchr (line, ',');
+                last = last ? last + 1 : line;
+                nodes = atoi (last) + 1;
+        }
+
+        fclose (fp);
+out:
+#endif
+        return min (max (nodes, 1), IOBUF_NUMA_MAX_NODES);
+}
+
+
+static int
+gf_iobuf_current_node (struct iobuf_pool *iobuf_pool)
+{
+#if defined(GF_LINUX_HOST_OS) && defined(SYS_getcpu)
+        unsigned int cpu = 0;
+        unsigned int node = 0;
+
+        if (!iobuf_pool->numa)
+                return -1;
+
+        if (syscall (SYS_getcpu, &cpu, &node, NULL) == 0 &&
+            node < IOBUF_NUMA_MAX_NODES)
+                return node;
+#endif
+        return -1;
+}
+
+
+/* Only a preference, the kernel still falls back to other nodes when the
+   preferred one is out of memory. Must be done before the arena is
+   touched. */
+static void
+gf_iobuf_bind_node (void *addr, size_t len, int node)
+{
+#if defined(GF_LINUX_HOST_OS) && defined(SYS_mbind)
+        unsigned long nodemask = 0;
+
+        nodemask = 1UL << node;
+
+        if (syscall (SYS_mbind, addr, len, MPOL_PREFERRED, &nodemask,
+                     sizeof (nodemask) * 8, 0) != 0)
+                gf_log ("iobuf", GF_LOG_DEBUG, "binding arena %p to node %d "
+                        "failed (%s)", addr, node, strerror (errno));
+#endif
+}
+
 
 int
-gf_iobuf_get_arena_index (size_t page_size)
+gf_iobuf_get_arena_index (struct iobuf_pool *iobuf_pool, size_t page_size)
 {
         int i = -1;
 
-        for (i = 0; i < IOBUF_ARENA_MAX_INDEX; i++) {
-                if (page_size <= gf_iobuf_init_config[i].pagesize)
+        for (i = 0; i < iobuf_pool->config_cnt; i++) {
+                if (page_size <= iobuf_pool->config[i].pagesize)
                         break;
         }
 
-        if (i >= IOBUF_ARENA_MAX_INDEX)
+        if (i >= iobuf_pool->config_cnt)
                 i = -1;
 
         return i;
 }
 
 size_t
-gf_iobuf_get_pagesize (size_t page_size)
+gf_iobuf_get_pagesize (struct iobuf_pool *iobuf_pool, size_t page_size)
 {
         int    i    = 0;
         size_t size = 0;
 
-        for (i = 0; i < IOBUF_ARENA_MAX_INDEX; i++) {
-                size = gf_iobuf_init_config[i].pagesize;
+        for (i = 0; i < iobuf_pool->config_cnt; i++) {
+                size = iobuf_pool->config[i].pagesize;
                 if (page_size <= size)
                         break;
         }
 
-        if (i >= IOBUF_ARENA_MAX_INDEX)
+        if (i >= iobuf_pool->config_cnt)
                 size = -1;
 
         return size;
@@ -73,7 +165,7 @@ __iobuf_arena_init_iobufs (struct iobuf_arena *iobuf_arena)
 {
         int                 iobuf_cnt = 0;
         struct iobuf       *iobuf = NULL;
-        int                 offset = 0;
+        size_t              offset = 0;
         int                 i = 0;
 
         GF_VALIDATE_OR_GOTO ("iobuf", iobuf_arena, out);
@@ -154,9 +246,88 @@ out:
 }
 
 
+/* mmap @size bytes starting on an @align boundary, so that transparent huge
+   pages can back all of it */
+static void *
+gf_iobuf_mmap_aligned (size_t size, size_t align)
+{
+        char   *base = NULL;
+        char   *aligned = NULL;
+        size_t  head = 0;
+        size_t  tail = 0;
+
+        base = mmap (NULL, size + align, PROT_READ|PROT_WRITE,
+                     MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED)
+                return MAP_FAILED;
+
+        aligned = GF_ALIGN_BUF (base, align);
+        head = aligned - base;
+        tail = align - head;
+
+        if (head)
+                munmap (base, head);
+        if (tail)
+                munmap (aligned + size, tail);
+
+        return aligned;
+}
+
+
+static void
+__iobuf_arena_map (struct iobuf_pool *iobuf_pool,
+                   struct iobuf_arena *iobuf_arena)
+{
+        size_t hps = iobuf_pool->huge_page_size;
+
+        if (iobuf_pool->huge_pages == GF_IOBUF_HUGE_PAGES_OFF ||
+            iobuf_arena->arena_size < hps) {
+                iobuf_arena->mem_base = mmap (NULL, iobuf_arena->arena_size,
+                                              PROT_READ|PROT_WRITE,
+                                              MAP_PRIVATE|MAP_ANONYMOUS,
+                                              -1, 0);
+                return;
+        }
+
+        /* huge pages have to be mapped and unmapped in whole pages */
+        iobuf_arena->arena_size = ((iobuf_arena->arena_size + hps - 1) / hps)
+                * hps;
+        iobuf_arena->page_count = iobuf_arena->arena_size /
+                iobuf_arena->page_size;
+
+#ifdef MAP_HUGETLB
+        if (iobuf_pool->huge_pages == GF_IOBUF_HUGE_PAGES_EXPLICIT) {
+                iobuf_arena->mem_base = mmap (NULL, iobuf_arena->arena_size,
+                                              PROT_READ|PROT_WRITE,
+                                              MAP_PRIVATE|MAP_ANONYMOUS|
+                                              MAP_HUGETLB, -1, 0);
+                if (iobuf_arena->mem_base != MAP_FAILED) {
+                        iobuf_arena->huge = _gf_true;
+                        return;
+                }
+
+                if (!iobuf_pool->huge_failures++)
+                        gf_log ("iobuf", GF_LOG_WARNING, "mapping %zu bytes "
+                                "of huge pages failed (%s), falling back to "
+                                "transparent huge pages",
+                                iobuf_arena->arena_size, strerror (errno));
+        }
+#endif
+
+        iobuf_arena->mem_base = gf_iobuf_mmap_aligned (iobuf_arena->arena_size,
+                                                       hps);
+#ifdef MADV_HUGEPAGE
+        if (iobuf_arena->mem_base != MAP_FAILED &&
+            madvise (iobuf_arena->mem_base, iobuf_arena->arena_size,
+                     MADV_HUGEPAGE) == 0)
+                iobuf_arena->huge = _gf_true;
+#endif
+}
+
+
 struct iobuf_arena *
 __iobuf_arena_alloc (struct iobuf_pool *iobuf_pool, size_t page_size,
-                     int32_t num_iobufs)
+                     int32_t num_iobufs, int node)
 {
         struct iobuf_arena *iobuf_arena = NULL;
         size_t              rounded_size = 0;
@@ -172,22 +343,27 @@ __iobuf_arena_alloc (struct iobuf_pool *iobuf_pool, size_t page_size,
         INIT_LIST_HEAD (&iobuf_arena->active.list);
         INIT_LIST_HEAD (&iobuf_arena->passive.list);
         iobuf_arena->iobuf_pool = iobuf_pool;
+        iobuf_arena->numa_node = -1;
 
-        rounded_size = gf_iobuf_get_pagesize (page_size);
+        rounded_size = gf_iobuf_get_pagesize (iobuf_pool, page_size);
 
         iobuf_arena->page_size  = rounded_size;
         iobuf_arena->page_count = num_iobufs;
 
         iobuf_arena->arena_size = rounded_size * num_iobufs;
 
-        iobuf_arena->mem_base = mmap (NULL, iobuf_arena->arena_size,
-                                      PROT_READ|PROT_WRITE,
-                                      MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+        __iobuf_arena_map (iobuf_pool, iobuf_arena);
         if (iobuf_arena->mem_base == MAP_FAILED) {
                 gf_log (THIS->name, GF_LOG_WARNING, "maping failed");
                 goto err;
         }
 
+        if (node >= 0) {
+                gf_iobuf_bind_node (iobuf_arena->mem_base,
+                                    iobuf_arena->arena_size, node);
+                iobuf_arena->numa_node = node;
+        }
+
         __iobuf_arena_init_iobufs (iobuf_arena);
         if (!iobuf_arena->iobufs) {
                 gf_log (THIS->name, GF_LOG_ERROR, "init failed");
@@ -207,7 +383,8 @@ out:
 
 
 struct iobuf_arena *
-__iobuf_arena_unprune (struct iobuf_pool *iobuf_pool, size_t page_size)
+__iobuf_arena_unprune (struct iobuf_pool *iobuf_pool, size_t page_size,
+                       int node)
 {
         struct iobuf_arena *iobuf_arena  = NULL;
         struct iobuf_arena *tmp          = NULL;
@@ -215,7 +392,7 @@ __iobuf_arena_unprune (struct iobuf_pool *iobuf_pool, size_t page_size)
 
         GF_VALIDATE_OR_GOTO ("iobuf", iobuf_pool, out);
 
-        index = gf_iobuf_get_arena_index (page_size);
+        index = gf_iobuf_get_arena_index (iobuf_pool, page_size);
         if (index == -1) {
                 gf_log ("iobuf", GF_LOG_ERROR, "page_size (%zu) of "
                         "iobufs in arena being added is greater than max "
@@ -224,6 +401,8 @@ __iobuf_arena_unprune (struct iobuf_pool *iobuf_pool, size_t page_size)
         }
 
         list_for_each_entry (tmp, &iobuf_pool->purge[index], list) {
+                if (node >= 0 && tmp->numa_node != node)
+                        continue;
                 list_del_init (&tmp->list);
                 iobuf_arena = tmp;
                 break;
@@ -235,12 +414,12 @@ out:
 
 struct iobuf_arena *
 __iobuf_pool_add_arena (struct iobuf_pool *iobuf_pool, size_t page_size,
-                        int32_t num_pages)
+                        int32_t num_pages, int node)
 {
         struct iobuf_arena *iobuf_arena  = NULL;
         int                 index        = 0;
 
-        index = gf_iobuf_get_arena_index (page_size);
+        index = gf_iobuf_get_arena_index (iobuf_pool, page_size);
         if (index == -1) {
                 gf_log ("iobuf", GF_LOG_ERROR, "page_size (%zu) of "
                         "iobufs in arena being added is greater than max "
@@ -248,11 +427,11 @@ __iobuf_pool_add_arena (struct iobuf_pool *iobuf_pool, size_t page_size,
                 return NULL;
         }
 
-        iobuf_arena = __iobuf_arena_unprune (iobuf_pool, page_size);
+        iobuf_arena = __iobuf_arena_unprune (iobuf_pool, page_size, node);
 
         if (!iobuf_arena)
                 iobuf_arena = __iobuf_arena_alloc (iobuf_pool, page_size,
-                                                   num_pages);
+                                                   num_pages, node);
 
         if (!iobuf_arena) {
                 gf_log (THIS->name, GF_LOG_WARNING, "arena not found");
@@ -276,7 +455,7 @@ iobuf_pool_add_arena (struct iobuf_pool *iobuf_pool, size_t page_size,
         pthread_mutex_lock (&iobuf_pool->mutex);
         {
                 iobuf_arena = __iobuf_pool_add_arena (iobuf_pool, page_size,
-                                                      num_pages);
+                                                      num_pages, -1);
         }
         pthread_mutex_unlock (&iobuf_pool->mutex);
 
@@ -285,23 +464,33 @@ out:
 }
 
 
-void
-iobuf_pool_destroy (struct iobuf_pool *iobuf_pool)
+static void
+__iobuf_pool_destroy_list (struct iobuf_pool *iobuf_pool,
+                           struct list_head *head)
 {
         struct iobuf_arena *iobuf_arena = NULL;
         struct iobuf_arena *tmp         = NULL;
+
+        list_for_each_entry_safe (iobuf_arena, tmp, head, list) {
+                list_del_init (&iobuf_arena->list);
+                iobuf_pool->arena_cnt--;
+                __iobuf_arena_destroy (iobuf_arena);
+        }
+}
+
+
+void
+iobuf_pool_destroy (struct iobuf_pool *iobuf_pool)
+{
         int                 i           = 0;
 
         GF_VALIDATE_OR_GOTO ("iobuf", iobuf_pool, out);
 
-        for (i = 0; i < IOBUF_ARENA_MAX_INDEX; i++) {
-                list_for_each_entry_safe (iobuf_arena, tmp,
-                                          &iobuf_pool->arenas[i], list) {
-                        list_del_init (&iobuf_arena->list);
-                        iobuf_pool->arena_cnt--;
-                        __iobuf_arena_destroy (iobuf_arena);
-                }
-
+        for (i = 0; i < iobuf_pool->config_cnt; i++) {
+                __iobuf_pool_destroy_list (iobuf_pool,
+                                           &iobuf_pool->arenas[i]);
+                __iobuf_pool_destroy_list (iobuf_pool,
+                                           &iobuf_pool->purge[i]);
         }
 
 out:
@@ -324,24 +513,211 @@ iobuf_create_stdalloc_arena (struct iobuf_pool *iobuf_pool)
         INIT_LIST_HEAD (&iobuf_arena->passive.list);
 
         iobuf_arena->iobuf_pool = iobuf_pool;
+        iobuf_arena->numa_node = -1;
 
         iobuf_arena->page_size = 0x7fffffff;
 
         list_add_tail (&iobuf_arena->list,
-                       &iobuf_pool->arenas[IOBUF_ARENA_MAX_INDEX]);
+                       &iobuf_pool->arenas[GF_IOBUF_STDALLOC_INDEX]);
 
 err:
         return;
 }
 
+
+static int
+iobuf_parse_page_classes (const char *classes,
+                          struct iobuf_init_config *config, int *count)
+{
+        char     *dup = NULL;
+        char     *entry = NULL;
+        char     *saveptr = NULL;
+        char     *num = NULL;
+        uint64_t  size = 0;
+        int32_t   pages = 0;
+        int       cnt = 0;
+        int       ret = -1;
+
+        dup = gf_strdup (classes);
+        if (!dup)
+                goto out;
+
+        for (entry = strtok_r (dup, ", ", &saveptr); entry;
+             entry = strtok_r (NULL, ", ", &saveptr)) {
+                num = strchr (entry, ':');
+                if (!num)
+                        goto out;
+                *num++ = '\0';
+
+                if (gf_string2bytesize (entry, &size) ||
+                    gf_string2int32 (num, &pages))
+                        goto out;
+
+                if (!size || size > GF_IOBUF_MAX_PAGE_SIZE || pages <= 0)
+                        goto out;
+
+                /* must be sorted, and the last list is for stdalloc */
+                if ((cnt && size <= config[cnt - 1].pagesize) ||
+                    cnt == GF_IOBUF_STDALLOC_INDEX)
+                        goto out;
+
+                config[cnt].pagesize = size;
+                config[cnt].num_pages = pages;
+                cnt++;
+        }
+
+        if (!cnt)
+                goto out;
+
+        *count = cnt;
+        ret = 0;
+out:
+        GF_FREE (dup);
+
+        return ret;
+}
+
+
+/* Move every arena of the current page classes out of the way. Idle ones
+   are freed now, the others when their last iobuf is put back. */
+static void
+__iobuf_pool_retire_list (struct iobuf_pool *iobuf_pool,
+                          struct list_head *head)
+{
+        struct iobuf_arena *iobuf_arena = NULL;
+        struct iobuf_arena *tmp         = NULL;
+
+        list_for_each_entry_safe (iobuf_arena, tmp, head, list) {
+                list_del_init (&iobuf_arena->list);
+
+                if (!iobuf_arena->active_cnt) {
+                        iobuf_pool->arena_cnt--;
+                        __iobuf_arena_destroy (iobuf_arena);
+                        continue;
+                }
+
+                iobuf_arena->retired = _gf_true;
+                list_add_tail (&iobuf_arena->list, &iobuf_pool->retired);
+        }
+}
+
+
+int
+iobuf_pool_set_page_classes (struct iobuf_pool *iobuf_pool,
+                             const char *classes)
+{
+        struct iobuf_init_config config[GF_VARIABLE_IOBUF_COUNT];
+        int                      count = 0;
+        int                      i = 0;
+        size_t                   arena_size = 0;
+        int                      ret = -1;
+
+        GF_VALIDATE_OR_GOTO ("iobuf", iobuf_pool, out);
+        GF_VALIDATE_OR_GOTO ("iobuf", classes, out);
+
+        memset (config, 0, sizeof (config));
+
+        ret = iobuf_parse_page_classes (classes, config, &count);
+        if (ret) {
+                gf_log ("iobuf", GF_LOG_ERROR, "invalid iobuf page classes "
+                        "\"%s\", expected a sorted list of "
+                        "<page-size>:<page-count>", classes);
+                goto out;
+        }
+
+        if (config[count - 1].pagesize < iobuf_pool->default_page_size) {
+                gf_log ("iobuf", GF_LOG_ERROR, "largest iobuf page class "
+                        "(%zu) is below the default page size (%zu)",
+                        config[count - 1].pagesize,
+                        iobuf_pool->default_page_size);
+                ret = -1;
+                goto out;
+        }
+
+        for (i = 0; i < count; i++)
+                arena_size += config[i].pagesize * config[i].num_pages;
+
+        pthread_mutex_lock (&iobuf_pool->mutex);
+        {
+                if (count == iobuf_pool->config_cnt &&
+                    !memcmp (config, iobuf_pool->config,
+                             count * sizeof (config[0]))) {
+                        pthread_mutex_unlock (&iobuf_pool->mutex);
+                        goto out;
+                }
+
+                for (i = 0; i < iobuf_pool->config_cnt; i++) {
+                        __iobuf_pool_retire_list (iobuf_pool,
+                                                  &iobuf_pool->arenas[i]);
+                        __iobuf_pool_retire_list (iobuf_pool,
+                                                  &iobuf_pool->filled[i]);
+                        __iobuf_pool_retire_list (iobuf_pool,
+                                                  &iobuf_pool->purge[i]);
+                }
+
+                memcpy (iobuf_pool->config, config, sizeof (config));
+                iobuf_pool->config_cnt = count;
+                iobuf_pool->arena_size = arena_size;
+
+                for (i = 0; i < count; i++)
+                        __iobuf_pool_add_arena (iobuf_pool, config[i].pagesize,
+                                                config[i].num_pages, -1);
+        }
+        pthread_mutex_unlock (&iobuf_pool->mutex);
+
+        gf_log ("iobuf", GF_LOG_DEBUG, "iobuf page classes set to %s",
+                classes);
+out:
+        return ret;
+}
+
+
+int
+iobuf_huge_pages_from_str (const char *str, gf_iobuf_huge_pages_t *huge_pages)
+{
+        if (!str || !huge_pages)
+                return -1;
+
+        if (!strcmp (str, "off"))
+                *huge_pages = GF_IOBUF_HUGE_PAGES_OFF;
+        else if (!strcmp (str, "transparent"))
+                *huge_pages = GF_IOBUF_HUGE_PAGES_TRANSPARENT;
+        else if (!strcmp (str, "explicit"))
+                *huge_pages = GF_IOBUF_HUGE_PAGES_EXPLICIT;
+        else
+                return -1;
+
+        return 0;
+}
+
+
+/* Applies to arenas allocated from now on. */
+int
+iobuf_pool_set_arena_policy (struct iobuf_pool *iobuf_pool,
+                             gf_iobuf_huge_pages_t huge_pages,
+                             gf_boolean_t numa)
+{
+        GF_VALIDATE_OR_GOTO ("iobuf", iobuf_pool, out);
+
+        pthread_mutex_lock (&iobuf_pool->mutex);
+        {
+                iobuf_pool->huge_pages = huge_pages;
+                /* nothing to prefer on a single node */
+                iobuf_pool->numa = numa && (iobuf_pool->numa_nodes > 1);
+        }
+        pthread_mutex_unlock (&iobuf_pool->mutex);
+
+        return 0;
+out:
+        return -1;
+}
+
+
 struct iobuf_pool *
 iobuf_pool_new (void)
 {
         struct iobuf_pool  *iobuf_pool = NULL;
         int                 i          = 0;
-        size_t              page_size  = 0;
-        size_t              arena_size = 0;
-        int32_t             num_pages  = 0;
 
         iobuf_pool = GF_CALLOC (sizeof (*iobuf_pool), 1,
                                 gf_common_mt_iobuf_pool);
@@ -349,28 +725,26 @@ iobuf_pool_new (void)
                 goto out;
 
         pthread_mutex_init (&iobuf_pool->mutex, NULL);
-        for (i = 0; i <= IOBUF_ARENA_MAX_INDEX; i++) {
+        for (i = 0; i < GF_VARIABLE_IOBUF_COUNT; i++) {
                 INIT_LIST_HEAD (&iobuf_pool->arenas[i]);
                 INIT_LIST_HEAD (&iobuf_pool->filled[i]);
                 INIT_LIST_HEAD (&iobuf_pool->purge[i]);
         }
+        INIT_LIST_HEAD (&iobuf_pool->retired);
 
         iobuf_pool->default_page_size  = 128 * GF_UNIT_KB;
+        iobuf_pool->huge_page_size = gf_iobuf_huge_page_size ();
+        iobuf_pool->numa_nodes = gf_iobuf_numa_nodes ();
 
-        arena_size = 0;
-        for (i = 0; i < IOBUF_ARENA_MAX_INDEX; i++) {
-                page_size = gf_iobuf_init_config[i].pagesize;
-                num_pages = gf_iobuf_init_config[i].num_pages;
-
-                iobuf_pool_add_arena (iobuf_pool, page_size, num_pages);
-
-                arena_size += page_size * num_pages;
+        if (iobuf_pool_set_page_classes (iobuf_pool,
+                                         GF_IOBUF_DEFAULT_PAGE_CLASSES)) {
+                GF_FREE (iobuf_pool);
+                iobuf_pool = NULL;
+                goto out;
         }
 
         /* Need an arena to handle all the bigger iobuf requests */
         iobuf_create_stdalloc_arena (iobuf_pool);
-
-        iobuf_pool->arena_size = arena_size;
 out:
 
         return iobuf_pool;
@@ -413,7 +787,7 @@ iobuf_pool_prune (struct iobuf_pool *iobuf_pool)
 
         pthread_mutex_lock (&iobuf_pool->mutex);
         {
-                for (i = 0; i < IOBUF_ARENA_MAX_INDEX; i++) {
+                for (i = 0; i < iobuf_pool->config_cnt; i++) {
                         if (list_empty (&iobuf_pool->arenas[i])) {
                                 continue;
                         }
@@ -431,16 +805,20 @@ out:
 }
 
 
+/* Prefer an arena on the caller's node (@node, -1 when NUMA placement is
+   off). A new local arena is only skipped when it cannot be allocated. */
 struct iobuf_arena *
-__iobuf_select_arena (struct iobuf_pool *iobuf_pool, size_t page_size)
+__iobuf_select_arena (struct iobuf_pool *iobuf_pool, size_t page_size,
+                      int node)
 {
         struct iobuf_arena *iobuf_arena  = NULL;
+        struct iobuf_arena *remote       = NULL;
         struct iobuf_arena *trav         = NULL;
         int                 index        = 0;
 
         GF_VALIDATE_OR_GOTO ("iobuf", iobuf_pool, out);
 
-        index = gf_iobuf_get_arena_index (page_size);
+        index = gf_iobuf_get_arena_index (iobuf_pool, page_size);
         if (index == -1) {
                 gf_log ("iobuf", GF_LOG_ERROR, "page_size (%zu) of "
                         "iobufs in arena being added is greater than max "
@@ -450,16 +828,30 @@ __iobuf_select_arena (struct iobuf_pool *iobuf_pool, size_t page_size)
 
         /* look for unused iobuf from the head-most arena */
         list_for_each_entry (trav, &iobuf_pool->arenas[index], list) {
-                if (trav->passive_cnt) {
+                if (!trav->passive_cnt)
+                        continue;
+                if (node < 0 || trav->numa_node == node) {
                         iobuf_arena = trav;
                         break;
                 }
+                if (!remote)
+                        remote = trav;
         }
 
         if (!iobuf_arena) {
                 /* all arenas were full, find the right count to add */
                 iobuf_arena = __iobuf_pool_add_arena (iobuf_pool, page_size,
-                                                      gf_iobuf_init_config[index].num_pages);
+                                                      iobuf_pool->config[index].num_pages,
+                                                      node);
+                if (!iobuf_arena)
+                        iobuf_arena = remote;
+        }
+
+        if (iobuf_arena && node >= 0) {
+                if (iobuf_arena->numa_node == node)
+                        iobuf_pool->numa_local++;
+                else
+                        iobuf_pool->numa_remote++;
         }
 
 out:
@@ -511,7 +903,7 @@ __iobuf_get (struct iobuf_arena *iobuf_arena, size_t page_size)
                 iobuf_arena->max_active = iobuf_arena->active_cnt;
 
         if (iobuf_arena->passive_cnt == 0) {
-                index = gf_iobuf_get_arena_index (page_size);
+                index = gf_iobuf_get_arena_index (iobuf_pool, page_size);
                 if (index == -1) {
                         gf_log ("iobuf", GF_LOG_ERROR, "page_size (%zu) of "
                                 "iobufs in arena being added is greater "
@@ -528,7 +920,8 @@ out:
 }
 
 struct iobuf *
-iobuf_get_from_stdalloc (struct iobuf_pool *iobuf_pool, size_t page_size)
+iobuf_get_from_stdalloc (struct iobuf_pool *iobuf_pool, size_t page_size,
+                         size_t align)
 {
         struct iobuf       *iobuf       = NULL;
         struct iobuf_arena *iobuf_arena = NULL;
@@ -536,7 +929,7 @@ iobuf_get_from_stdalloc (struct iobuf_pool *iobuf_pool, size_t page_size)
         int                 ret         = -1;
 
         /* The first arena in the 'MAX-INDEX' will always be used for misc */
-        list_for_each_entry (trav, &iobuf_pool->arenas[IOBUF_ARENA_MAX_INDEX],
+        list_for_each_entry (trav, &iobuf_pool->arenas[GF_IOBUF_STDALLOC_INDEX],
                              list) {
                 iobuf_arena = trav;
                 break;
@@ -546,13 +939,12 @@ iobuf_get_from_stdalloc (struct iobuf_pool *iobuf_pool, size_t page_size)
         if (!iobuf)
                 goto out;
 
-        /* 4096 is the alignment */
-        iobuf->free_ptr = GF_CALLOC (1, ((page_size + GF_IOBUF_ALIGN_SIZE) - 1),
+        iobuf->free_ptr = GF_CALLOC (1, ((page_size + align) - 1),
                                      gf_common_mt_char);
         if (!iobuf->free_ptr)
                 goto out;
 
-        iobuf->ptr = GF_ALIGN_BUF (iobuf->free_ptr, GF_IOBUF_ALIGN_SIZE);
+        iobuf->ptr = GF_ALIGN_BUF (iobuf->free_ptr, align);
         iobuf->iobuf_arena = iobuf_arena;
         LOCK_INIT (&iobuf->lock);
 
@@ -577,30 +969,23 @@ iobuf_get2 (struct iobuf_pool *iobuf_pool, size_t page_size)
         struct iobuf       *iobuf        = NULL;
         struct iobuf_arena *iobuf_arena  = NULL;
         size_t              rounded_size = 0;
+        int                 node         = -1;
 
         if (page_size == 0) {
                 page_size = iobuf_pool->default_page_size;
         }
 
-        rounded_size = gf_iobuf_get_pagesize (page_size);
-        if (rounded_size == -1) {
-                /* make sure to provide the requested buffer with standard
-                   memory allocations */
-                iobuf = iobuf_get_from_stdalloc (iobuf_pool, page_size);
-
-                gf_log ("iobuf", GF_LOG_DEBUG, "request for iobuf of size %zu "
-                        "is serviced using standard calloc() (%p) as it "
-                        "exceeds the maximum available buffer size",
-                        page_size, iobuf);
-
-                iobuf_pool->request_misses++;
-                return iobuf;
-        }
+        node = gf_iobuf_current_node (iobuf_pool);
 
         pthread_mutex_lock (&iobuf_pool->mutex);
         {
+                rounded_size = gf_iobuf_get_pagesize (iobuf_pool, page_size);
+                if (rounded_size == -1)
+                        goto unlock;
+
                 /* most eligible arena for picking an iobuf */
-                iobuf_arena = __iobuf_select_arena (iobuf_pool, rounded_size);
+                iobuf_arena = __iobuf_select_arena (iobuf_pool, rounded_size,
+                                                    node);
                 if (!iobuf_arena)
                         goto unlock;
 
@@ -609,10 +994,49 @@ iobuf_get2 (struct iobuf_pool *iobuf_pool, size_t page_size)
                         goto unlock;
 
                 __iobuf_ref (iobuf);
-         }
+        }
 unlock:
         pthread_mutex_unlock (&iobuf_pool->mutex);
 
+        if (rounded_size == -1) {
+                /* make sure to provide the requested buffer with standard
+                   memory allocations */
+                iobuf = iobuf_get_from_stdalloc (iobuf_pool, page_size,
+                                                 GF_IOBUF_ALIGN_SIZE);
+
+                gf_log ("iobuf", GF_LOG_DEBUG, "request for iobuf of size %zu "
+                        "is serviced using standard calloc() (%p) as it "
+                        "exceeds the maximum available buffer size",
+                        page_size, iobuf);
+
+                iobuf_pool->request_misses++;
+        }
+
+        return iobuf;
+}
+
+/* An iobuf whose data starts on an @align (power of two) boundary, for
+ * payloads that end up being written with O_DIRECT.
+ */
+struct iobuf *
+iobuf_get_page_aligned (struct iobuf_pool *iobuf_pool, size_t page_size,
+                        size_t align)
+{
+        struct iobuf *iobuf = NULL;
+
+        if (page_size == 0)
+                page_size = iobuf_pool->default_page_size;
+
+        /* page classes of a multiple of @align are aligned in their arena */
+        page_size = (page_size + align - 1) & ~(align - 1);
+
+        iobuf = iobuf_get2 (iobuf_pool, page_size);
+        if (iobuf && ((unsigned long) iobuf->ptr & (align - 1))) {
+                iobuf_unref (iobuf);
+                iobuf = iobuf_get_from_stdalloc (iobuf_pool, page_size,
+                                                 align);
+        }
+
         return iobuf;
 }
 
@@ -621,14 +1045,18 @@ iobuf_get (struct iobuf_pool *iobuf_pool)
 {
         struct iobuf       *iobuf        = NULL;
         struct iobuf_arena *iobuf_arena  = NULL;
+        int                 node         = -1;
 
         GF_VALIDATE_OR_GOTO ("iobuf", iobuf_pool, out);
 
+        node = gf_iobuf_current_node (iobuf_pool);
+
         pthread_mutex_lock (&iobuf_pool->mutex);
         {
                 /* most eligible arena for picking an iobuf */
                 iobuf_arena = __iobuf_select_arena (iobuf_pool,
-                                                    iobuf_pool->default_page_size);
+                                                    iobuf_pool->default_page_size,
+                                                    node);
                 if (!iobuf_arena) {
                         gf_log (THIS->name, GF_LOG_WARNING, "arena not found");
                         goto unlock;
@@ -661,7 +1089,22 @@ __iobuf_put (struct iobuf *iobuf, struct iobuf_arena *iobuf_arena)
 
         iobuf_pool = iobuf_arena->iobuf_pool;
 
-        index = gf_iobuf_get_arena_index (iobuf_arena->page_size);
+        if (iobuf_arena->retired) {
+                list_del_init (&iobuf->list);
+                iobuf_arena->active_cnt--;
+
+                list_add (&iobuf->list, &iobuf_arena->passive.list);
+                iobuf_arena->passive_cnt++;
+
+                if (iobuf_arena->active_cnt == 0) {
+                        list_del_init (&iobuf_arena->list);
+                        iobuf_pool->arena_cnt--;
+                        __iobuf_arena_destroy (iobuf_arena);
+                }
+                goto out;
+        }
+
+        index = gf_iobuf_get_arena_index (iobuf_pool, iobuf_arena->page_size);
         if (index == -1) {
                 gf_log ("iobuf", GF_LOG_DEBUG, "freeing the iobuf (%p) "
                         "allocated with standard calloc()", iobuf);
@@ -1067,6 +1510,10 @@ iobuf_arena_info_dump (struct iobuf_arena *iobuf_arena, const char *key_prefix)
         gf_proc_dump_write(key, "%"PRIu64, iobuf_arena->max_active);
         gf_proc_dump_build_key(key, key_prefix, "page_size");
         gf_proc_dump_write(key, "%"PRIu64, iobuf_arena->page_size);
+        gf_proc_dump_build_key(key, key_prefix, "numa_node");
+        gf_proc_dump_write(key, "%d", iobuf_arena->numa_node);
+        gf_proc_dump_build_key(key, key_prefix, "huge_pages");
+        gf_proc_dump_write(key, "%d", iobuf_arena->huge);
         list_for_each_entry (trav, &iobuf_arena->active.list, list) {
                 gf_proc_dump_build_key(key, key_prefix,"active_iobuf.%d", i++);
                 gf_proc_dump_add_section(key);
@@ -1105,8 +1552,27 @@ iobuf_stats_dump (struct iobuf_pool *iobuf_pool)
                            iobuf_pool->arena_cnt);
         gf_proc_dump_write("iobuf_pool.request_misses", "%"PRId64,
                            iobuf_pool->request_misses);
+        gf_proc_dump_write("iobuf_pool.huge_pages", "%d",
+                           iobuf_pool->huge_pages);
+        gf_proc_dump_write("iobuf_pool.huge_page_size", "%zu",
+                           iobuf_pool->huge_page_size);
+        gf_proc_dump_write("iobuf_pool.huge_failures", "%"PRIu64,
+                           iobuf_pool->huge_failures);
+        gf_proc_dump_write("iobuf_pool.numa_nodes", "%d",
+                           iobuf_pool->numa_nodes);
+        gf_proc_dump_write("iobuf_pool.numa", "%d", iobuf_pool->numa);
+        gf_proc_dump_write("iobuf_pool.numa_local", "%"PRIu64,
+                           iobuf_pool->numa_local);
+        gf_proc_dump_write("iobuf_pool.numa_remote", "%"PRIu64,
+                           iobuf_pool->numa_remote);
+        for (j = 0; j < iobuf_pool->config_cnt; j++) {
+                snprintf (msg, sizeof (msg), "iobuf_pool.page_class.%d", j);
+                gf_proc_dump_write (msg, "%zu:%d",
+                                    iobuf_pool->config[j].pagesize,
+                                    iobuf_pool->config[j].num_pages);
+        }
 
-        for (j = 0; j < IOBUF_ARENA_MAX_INDEX; j++) {
+        for (j = 0; j < iobuf_pool->config_cnt; j++) {
                 list_for_each_entry (trav, &iobuf_pool->arenas[j], list) {
                         snprintf(msg, sizeof(msg),
                                  "arena.%d", i);
@@ -1130,6 +1596,12 @@ iobuf_stats_dump (struct iobuf_pool *iobuf_pool)
                 }
 
         }
+        list_for_each_entry (trav, &iobuf_pool->retired, list) {
+                snprintf(msg, sizeof(msg), "retired.%d", i);
+                gf_proc_dump_add_section(msg);
+                iobuf_arena_info_dump(trav,msg);
+                i++;
+        }
 
         pthread_mutex_unlock(&iobuf_pool->mutex);
 
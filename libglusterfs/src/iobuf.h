@@ -19,6 +19,24 @@
 
 #define GF_VARIABLE_IOBUF_COUNT 32
 
+/* the last list of each kind is reserved for the stdalloc arena */
+#define GF_IOBUF_STDALLOC_INDEX (GF_VARIABLE_IOBUF_COUNT - 1)
+
+/* { pagesize:num_pages, ... }, sorted on pagesize. Can be replaced at runtime
+   with iobuf_pool_set_page_classes(). */
+#define GF_IOBUF_DEFAULT_PAGE_CLASSES  "128:1024,512:512,2KB:512,8KB:128,"  \
+                                       "32KB:64,128KB:32,256KB:8,1MB:2"
+
+#define GF_IOBUF_MAX_PAGE_SIZE (64 * GF_UNIT_MB)
+
+/* How the memory of big arenas is backed. Arenas smaller than a huge page
+   always use normal pages. */
+typedef enum {
+        GF_IOBUF_HUGE_PAGES_OFF = 0,
+        GF_IOBUF_HUGE_PAGES_TRANSPARENT, /* madvise (MADV_HUGEPAGE) */
+        GF_IOBUF_HUGE_PAGES_EXPLICIT,    /* MAP_HUGETLB, falls back to THP */
+} gf_iobuf_huge_pages_t;
+
 /* Lets try to define the new anonymous mapping
  * flag, in case the system is still using the
  * now deprecated MAP_ANON flag.
@@ -100,6 +118,12 @@ struct iobuf_arena {
                                            (unused by itself) */
         uint64_t            alloc_cnt;  /* total allocs in this pool */
         int                 max_active; /* max active buffers at a given time */
+
+        int                 numa_node;  /* node the memory prefers, -1 if the
+                                           arena is not bound */
+        gf_boolean_t        huge;       /* backed by huge pages */
+        gf_boolean_t        retired;    /* belongs to a replaced set of page
+                                           classes, freed once idle */
 };
 
 
@@ -122,6 +146,21 @@ struct iobuf_pool {
 
         uint64_t            request_misses; /* mostly the requests for higher
                                                value of iobufs */
+
+        struct iobuf_init_config config[GF_VARIABLE_IOBUF_COUNT];
+        int                 config_cnt; /* number of page classes in use */
+        struct list_head    retired;    /* arenas of replaced page classes
+                                           which still have active iobufs */
+
+        gf_iobuf_huge_pages_t huge_pages;
+        size_t              huge_page_size;
+        uint64_t            huge_failures; /* MAP_HUGETLB mmaps which failed */
+
+        gf_boolean_t        numa;       /* allocate arenas per NUMA node */
+        int                 numa_nodes;
+        uint64_t            numa_local; /* iobufs served from the caller's
+                                           node */
+        uint64_t            numa_remote;
 };
 
 
@@ -159,4 +198,15 @@ void   iobuf_stats_dump (struct iobuf_pool *iobuf_pool);
 
 struct iobuf *
 iobuf_get2 (struct iobuf_pool *iobuf_pool, size_t page_size);
+struct iobuf *
+iobuf_get_page_aligned (struct iobuf_pool *iobuf_pool, size_t page_size,
+                        size_t align);
+
+int iobuf_pool_set_page_classes (struct iobuf_pool *iobuf_pool,
+                                 const char *classes);
+int iobuf_pool_set_arena_policy (struct iobuf_pool *iobuf_pool,
+                                 gf_iobuf_huge_pages_t huge_pages,
+                                 gf_boolean_t numa);
+int iobuf_huge_pages_from_str (const char *str,
+                               gf_iobuf_huge_pages_t *huge_pages);
 #endif /* !_IOBUF_H_ */
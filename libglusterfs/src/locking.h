@@ -36,5 +36,23 @@ typedef pthread_spinlock_t gf_lock_t;
 typedef pthread_mutex_t gf_lock_t;
 #endif /* HAVE_SPINLOCK */
 
+/*
+ * Atomic add and subtract, evaluating to the new value. @lk (a gf_lock_t)
+ * is only taken by compilers without the __sync builtins, e.g. on RHEL5
+ * i386. A more comprehensive feature test is shown at
+ * http://lists.iptel.org/pipermail/semsdev/2010-October/005075.html
+ */
+#if (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 1)) && !defined(__i386__)
+# define GF_HAVE_ATOMIC_BUILTINS 1
+# define GF_ATOMIC_ADD(lk,op,n) __sync_add_and_fetch (&(op), (n))
+# define GF_ATOMIC_SUB(lk,op,n) __sync_sub_and_fetch (&(op), (n))
+#else
+/* gcc 'statement expressions', they work with llvm/clang too */
+# define GF_ATOMIC_ADD(lk,op,n) ({ LOCK (&(lk)); (op) += (n); UNLOCK (&(lk)); \
+                        (op); })
+# define GF_ATOMIC_SUB(lk,op,n) ({ LOCK (&(lk)); (op) -= (n); UNLOCK (&(lk)); \
+                        (op); })
+#endif
+
 
 #endif /* _LOCKING_H */
@@ -20,6 +20,7 @@
 #include <time.h>
 #include <locale.h>
 #include <string.h>
+#include <ctype.h>
 #include <stdlib.h>
 
 #include <libintl.h>
@@ -129,6 +130,8 @@ gf_log_set_loglevel (gf_loglevel_t level)
                 ctx->log.loglevel = level;
 }
 
+static void gf_log_async_flush (glusterfs_ctx_t *ctx);
+
 void
 gf_log_flush (void)
 {
@@ -138,6 +141,9 @@ gf_log_flush (void)
         this = THIS;
         ctx = this->ctx;
 
+        if (ctx)
+                gf_log_async_flush (ctx);
+
         if (ctx && ctx->log.logger == gf_logger_glusterlog) {
                 pthread_mutex_lock (&ctx->log.logfile_mutex);
                 fflush (ctx->log.gf_log_logfile);
@@ -287,6 +293,1262 @@ gf_log_rotate(glusterfs_ctx_t *ctx)
         return;
 }
 
+/*
+ * Asynchronous logging
+ *
+ * Every thread that logs gets a ring of its own. Messages are copied into
+ * it without taking any lock, and a writer thread merges the rings in the
+ * order the messages were logged (by a global sequence number), writes them
+ * out and flushes the log file once per batch instead of once per message.
+ * Consecutive repeats of a message within log-flush-timeout seconds are
+ * written once, followed by a count.
+ *
+ * With defer_format set, the format string and the arguments are queued
+ * instead of the formatted text and the writer thread does the formatting.
+ * Formats whose arguments cannot be captured this way (%n, %m, positional
+ * or wide arguments) are formatted by the caller.
+ *
+ * A ring has one producer, its thread, and one consumer, whoever holds
+ * async->drain, so head and tail only need memory barriers. A message which
+ * does not fit in the ring, or finds it full for too long, is written by
+ * the caller itself after draining all the rings, keeping the order.
+ */
+
+#define GF_LOG_RING_MIN         (4 * 1024)
+#define GF_LOG_RING_MAX         (16 * 1024 * 1024)
+#define GF_LOG_SPACE_WAIT_MAX   1000    /* times 1ms a producer waits for
+                                           room in its ring */
+#define GF_LOG_SPEC_MAX         64
+
+#define GF_LOG_ALIGN(x)         (((x) + 7) & ~((size_t) 7))
+
+enum {
+        GF_LOG_REC_PAD,                 /* skip to the start of the ring */
+        GF_LOG_REC_TEXT,                /* formatted message */
+        GF_LOG_REC_ARGS,                /* format string and arguments */
+};
+
+enum {
+        GF_LOG_STYLE_PLAIN,             /* no header, gf_msg_plain */
+        GF_LOG_STYLE_LOG,               /* gf_log, gf_log_callingfn */
+        GF_LOG_STYLE_MSG,               /* gf_msg, follows log.logformat */
+};
+
+struct gf_log_rec {
+        uint32_t          size;         /* of the whole record, aligned */
+        uint8_t           type;
+        uint8_t           style;
+        uint8_t           level;
+        uint8_t           unused;
+        int32_t           line;
+        int32_t           graph_id;
+        int32_t           errnum;
+        uint16_t          domain_len;   /* all lengths include the '\0' */
+        uint16_t          callstr_len;
+        uint32_t          body_len;
+        unsigned long     seq;
+        uint64_t          msgid;
+        struct timeval    tv;
+        const char       *file;         /* __FILE__ and __FUNCTION__ */
+        const char       *function;
+        char              data[];       /* domain, callstr, text or format,
+                                           packed arguments */
+};
+
+struct gf_log_ring {
+        struct gf_log_ring     *next;
+        char                   *buf;
+        unsigned long           size;   /* power of two */
+        volatile unsigned long  head;   /* producer */
+        volatile unsigned long  tail;   /* consumer */
+        volatile int            dead;   /* owning thread exited */
+        unsigned long           dropped;
+        unsigned long           dropped_seen;
+};
+
+struct gf_log_strbuf {
+        char   *buf;
+        size_t  len;
+        size_t  size;
+};
+
+struct gf_log_async {
+        glusterfs_ctx_t            *ctx;
+        pthread_t                   writer;
+        gf_boolean_t                running;
+        volatile int                enabled;    /* producers may queue */
+        volatile int                sleeping;
+        int                         stop;
+        pthread_mutex_t             lock;       /* rings list, writer sleep */
+        pthread_cond_t              cond;
+        pthread_mutex_t             drain;      /* consumer of all rings */
+        pthread_key_t               key;
+        struct gf_log_ring * volatile rings;
+        unsigned long               seq;
+        gf_lock_t                   seq_lock;   /* seq, without atomics */
+
+        /* the rest is used with drain held */
+        struct gf_log_strbuf        line;
+        struct gf_log_strbuf        body;
+        gf_boolean_t                dirty;      /* written but not flushed */
+        time_t                      time_sec;   /* time_str caches this */
+        char                        time_str[GF_LOG_TIMESTR_SIZE];
+
+        gf_boolean_t                last_valid; /* last message written */
+        struct gf_log_rec           last;
+        struct gf_log_strbuf        last_domain;
+        struct gf_log_strbuf        last_callstr;
+        struct gf_log_strbuf        last_body;
+        uint32_t                    repeated;   /* suppressed repeats of it */
+        struct timeval              repeat_first;
+        struct timeval              repeat_last;
+};
+
+/* one conversion of a printf format */
+struct gf_log_conv {
+        const char *end;                /* past the conversion character */
+        char        type;               /* 'i'nt, 'u'nsigned, 'd'ouble,
+                                           'D' long double, 'p', 's' */
+        char        len;                /* 0, 'H' (hh), 'h', 'l', 'L' (ll),
+                                           'j', 'z', 't' */
+        char        star_width;
+        char        star_prec;
+        int         prec;
+};
+
+static int
+gf_log_strbuf_reserve (struct gf_log_strbuf *sb, size_t len)
+{
+        char   *buf = NULL;
+        size_t  size = 0;
+
+        if (sb->len + len + 1 <= sb->size)
+                return 0;
+
+        size = max (max (sb->size * 2, sb->len + len + 1), 256);
+        buf = realloc (sb->buf, size);
+        if (!buf)
+                return -1;
+
+        sb->buf = buf;
+        sb->size = size;
+
+        return 0;
+}
+
+static void
+gf_log_strbuf_add (struct gf_log_strbuf *sb, const char *str, size_t len)
+{
+        if (gf_log_strbuf_reserve (sb, len))
+                return;
+
+        memcpy (sb->buf + sb->len, str, len);
+        sb->len += len;
+        sb->buf[sb->len] = '\0';
+}
+
+static void
+gf_log_strbuf_set (struct gf_log_strbuf *sb, const char *str)
+{
+        sb->len = 0;
+        gf_log_strbuf_add (sb, str, strlen (str));
+}
+
+static void
+gf_log_strbuf_printf (struct gf_log_strbuf *sb, const char *fmt, ...)
+{
+        va_list ap;
+        int     ret = 0;
+
+        if (gf_log_strbuf_reserve (sb, 0))
+                return;
+
+        va_start (ap, fmt);
+        ret = vsnprintf (sb->buf + sb->len, sb->size - sb->len, fmt, ap);
+        va_end (ap);
+
+        if (ret < 0)
+                return;
+
+        if (sb->len + ret >= sb->size) {
+                if (gf_log_strbuf_reserve (sb, ret))
+                        return;
+
+                va_start (ap, fmt);
+                ret = vsnprintf (sb->buf + sb->len, sb->size - sb->len, fmt,
+                                 ap);
+                va_end (ap);
+
+                if (ret < 0)
+                        return;
+        }
+
+        sb->len += ret;
+}
+
+static int
+gf_log_parse_conv (const char *p, struct gf_log_conv *conv)
+{
+        const char *q = p + 1;
+
+        memset (conv, 0, sizeof (*conv));
+        conv->prec = -1;
+
+        while (*q && strchr ("-+ #0'", *q))
+                q++;
+
+        if (*q == '*') {
+                conv->star_width = 1;
+                q++;
+        }
+        while (isdigit (*q))
+                q++;
+        if (*q == '$')
+                return -1;
+
+        if (*q == '.') {
+                q++;
+                if (*q == '*') {
+                        conv->star_prec = 1;
+                        q++;
+                } else {
+                        conv->prec = 0;
+                        while (isdigit (*q))
+                                conv->prec = conv->prec * 10 + (*q++ - '0');
+                }
+        }
+
+        switch (*q) {
+        case 'h':
+                conv->len = (q[1] == 'h') ? 'H' : 'h';
+                q += (q[1] == 'h') ? 2 : 1;
+                break;
+        case 'l':
+                conv->len = (q[1] == 'l') ? 'L' : 'l';
+                q += (q[1] == 'l') ? 2 : 1;
+                break;
+        case 'L':
+        case 'q':
+                conv->len = 'L';
+                q++;
+                break;
+        case 'Z':
+                conv->len = 'z';
+                q++;
+                break;
+        case 'j':
+        case 'z':
+        case 't':
+                conv->len = *q++;
+                break;
+        }
+
+        switch (*q) {
+        case 'd':
+        case 'i':
+                conv->type = 'i';
+                break;
+        case 'o':
+        case 'u':
+        case 'x':
+        case 'X':
+                conv->type = 'u';
+                break;
+        case 'c':
+                if (conv->len)
+                        return -1;
+                conv->type = 'i';
+                break;
+        case 'e':
+        case 'E':
+        case 'f':
+        case 'F':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+                if (conv->len == 'L')
+                        conv->type = 'D';
+                else if (!conv->len || conv->len == 'l')
+                        conv->type = 'd';
+                else
+                        return -1;
+                break;
+        case 's':
+        case 'p':
+                if (conv->len)
+                        return -1;
+                conv->type = *q;
+                break;
+        default:
+                return -1;
+        }
+
+        conv->end = q + 1;
+
+        return 0;
+}
+
+#define GF_LOG_PUT(out, off, val) do {                                  \
+                if (out)                                                \
+                        memcpy ((out) + (off), &(val), sizeof (val));   \
+                (off) += sizeof (val);                                  \
+        } while (0)
+
+#define GF_LOG_GET(in, off, val) do {                                   \
+                memcpy (&(val), (in) + (off), sizeof (val));            \
+                (off) += sizeof (val);                                  \
+        } while (0)
+
+/* Copy the arguments of @fmt to @out, or only count their size if @out is
+   NULL. Returns -1 when the format cannot be deferred. */
+static ssize_t
+gf_log_pack_args (const char *fmt, va_list ap, char *out)
+{
+        struct gf_log_conv  conv;
+        const char         *p = NULL;
+        const char         *s = NULL;
+        size_t              off = 0;
+        long long           ll = 0;
+        unsigned long long  ull = 0;
+        double              d = 0;
+        long double         ld = 0;
+        void               *ptr = NULL;
+        uint32_t            slen = 0;
+        int                 prec = 0;
+
+        for (p = fmt; *p; p++) {
+                if (*p != '%')
+                        continue;
+                if (p[1] == '%') {
+                        p++;
+                        continue;
+                }
+
+                if (gf_log_parse_conv (p, &conv))
+                        return -1;
+
+                prec = conv.prec;
+                if (conv.star_width) {
+                        ll = va_arg (ap, int);
+                        GF_LOG_PUT (out, off, ll);
+                }
+                if (conv.star_prec) {
+                        ll = va_arg (ap, int);
+                        prec = ll;
+                        GF_LOG_PUT (out, off, ll);
+                }
+
+                switch (conv.type) {
+                case 'i':
+                        switch (conv.len) {
+                        case 'l': ll = va_arg (ap, long); break;
+                        case 'L': ll = va_arg (ap, long long); break;
+                        case 'j': ll = va_arg (ap, intmax_t); break;
+                        case 'z': ll = va_arg (ap, ssize_t); break;
+                        case 't': ll = va_arg (ap, ptrdiff_t); break;
+                        default:  ll = va_arg (ap, int); break;
+                        }
+                        GF_LOG_PUT (out, off, ll);
+                        break;
+                case 'u':
+                        switch (conv.len) {
+                        case 'l': ull = va_arg (ap, unsigned long); break;
+                        case 'L': ull = va_arg (ap, unsigned long long); break;
+                        case 'j': ull = va_arg (ap, uintmax_t); break;
+                        case 'z': ull = va_arg (ap, size_t); break;
+                        case 't': ull = va_arg (ap, ptrdiff_t); break;
+                        default:  ull = va_arg (ap, unsigned int); break;
+                        }
+                        GF_LOG_PUT (out, off, ull);
+                        break;
+                case 'd':
+                        d = va_arg (ap, double);
+                        GF_LOG_PUT (out, off, d);
+                        break;
+                case 'D':
+                        ld = va_arg (ap, long double);
+                        GF_LOG_PUT (out, off, ld);
+                        break;
+                case 'p':
+                        ptr = va_arg (ap, void *);
+                        GF_LOG_PUT (out, off, ptr);
+                        break;
+                case 's':
+                        s = va_arg (ap, const char *);
+                        if (!s)
+                                slen = UINT32_MAX;
+                        else if (prec >= 0)
+                                slen = strnlen (s, prec);
+                        else
+                                slen = strlen (s);
+                        GF_LOG_PUT (out, off, slen);
+                        if (slen != UINT32_MAX) {
+                                if (out) {
+                                        memcpy (out + off, s, slen);
+                                        out[off + slen] = '\0';
+                                }
+                                off += slen + 1;
+                        }
+                        break;
+                }
+
+                p = conv.end - 1;
+        }
+
+        return off;
+}
+
+/* Format @fmt with the arguments gf_log_pack_args() saved in @args. */
+static void
+gf_log_unpack_args (struct gf_log_strbuf *sb, const char *fmt,
+                    const char *args)
+{
+        struct gf_log_conv  conv;
+        const char         *p = NULL;
+        const char         *c = NULL;
+        const char         *lit = NULL;
+        char                spec[GF_LOG_SPEC_MAX];
+        size_t              off = 0;
+        size_t              j = 0;
+        long long           ll = 0;
+        unsigned long long  ull = 0;
+        double              d = 0;
+        long double         ld = 0;
+        void               *ptr = NULL;
+        uint32_t            slen = 0;
+
+        lit = fmt;
+        for (p = fmt; *p; p++) {
+                if (*p != '%')
+                        continue;
+
+                gf_log_strbuf_add (sb, lit, p - lit);
+                if (p[1] == '%') {
+                        gf_log_strbuf_add (sb, "%", 1);
+                        lit = ++p + 1;
+                        continue;
+                }
+
+                if (gf_log_parse_conv (p, &conv))
+                        return;
+
+                /* the conversion with '*' replaced by the saved values */
+                for (c = p, j = 0; c < conv.end &&
+                     j < GF_LOG_SPEC_MAX - 24; c++) {
+                        if (*c != '*') {
+                                spec[j++] = *c;
+                                continue;
+                        }
+                        GF_LOG_GET (args, off, ll);
+                        if (ll < 0 && c > p && c[-1] == '.') {
+                                /* a negative precision is no precision */
+                                j--;
+                                continue;
+                        }
+                        j += snprintf (spec + j, sizeof (spec) - j, "%lld",
+                                       ll);
+                }
+                spec[j] = '\0';
+
+                switch (conv.type) {
+                case 'i':
+                        GF_LOG_GET (args, off, ll);
+                        switch (conv.len) {
+                        case 'l': gf_log_strbuf_printf (sb, spec, (long) ll);
+                                  break;
+                        case 'L': gf_log_strbuf_printf (sb, spec, ll);
+                                  break;
+                        case 'j': gf_log_strbuf_printf (sb, spec,
+                                                        (intmax_t) ll);
+                                  break;
+                        case 'z': gf_log_strbuf_printf (sb, spec,
+                                                        (ssize_t) ll);
+                                  break;
+                        case 't': gf_log_strbuf_printf (sb, spec,
+                                                        (ptrdiff_t) ll);
+                                  break;
+                        default:  gf_log_strbuf_printf (sb, spec, (int) ll);
+                                  break;
+                        }
+                        break;
+                case 'u':
+                        GF_LOG_GET (args, off, ull);
+                        switch (conv.len) {
+                        case 'l': gf_log_strbuf_printf (sb, spec,
+                                                        (unsigned long) ull);
+                                  break;
+                        case 'L': gf_log_strbuf_printf (sb, spec, ull);
+                                  break;
+                        case 'j': gf_log_strbuf_printf (sb, spec,
+                                                        (uintmax_t) ull);
+                                  break;
+                        case 'z': gf_log_strbuf_printf (sb, spec,
+                                                        (size_t) ull);
+                                  break;
+                        case 't': gf_log_strbuf_printf (sb, spec,
+                                                        (ptrdiff_t) ull);
+                                  break;
+                        default:  gf_log_strbuf_printf (sb, spec,
+                                                        (unsigned int) ull);
+                                  break;
+                        }
+                        break;
+                case 'd':
+                        GF_LOG_GET (args, off, d);
+                        gf_log_strbuf_printf (sb, spec, d);
+                        break;
+                case 'D':
+                        GF_LOG_GET (args, off, ld);
+                        gf_log_strbuf_printf (sb, spec, ld);
+                        break;
+                case 'p':
+                        GF_LOG_GET (args, off, ptr);
+                        gf_log_strbuf_printf (sb, spec, ptr);
+                        break;
+                case 's':
+                        GF_LOG_GET (args, off, slen);
+                        if (slen == UINT32_MAX) {
+                                gf_log_strbuf_printf (sb, spec, (char *) NULL);
+                        } else {
+                                gf_log_strbuf_printf (sb, spec, args + off);
+                                off += slen + 1;
+                        }
+                        break;
+                }
+
+                lit = conv.end;
+                p = conv.end - 1;
+        }
+
+        gf_log_strbuf_add (sb, lit, strlen (lit));
+}
+
+static void
+gf_log_async_wake (struct gf_log_async *async)
+{
+        pthread_mutex_lock (&async->lock);
+        {
+                pthread_cond_signal (&async->cond);
+        }
+        pthread_mutex_unlock (&async->lock);
+}
+
+static void
+gf_log_ring_release (void *data)
+{
+        struct gf_log_ring *ring = data;
+
+        __sync_synchronize ();
+        ring->dead = 1;
+}
+
+static struct gf_log_ring *
+gf_log_ring_get (struct gf_log_async *async)
+{
+        struct gf_log_ring *ring = NULL;
+        unsigned long       size = GF_LOG_RING_MIN;
+
+        ring = pthread_getspecific (async->key);
+        if (ring)
+                return ring;
+
+        while (size < async->ctx->log.ring_size && size < GF_LOG_RING_MAX)
+                size <<= 1;
+
+        ring = CALLOC (1, sizeof (*ring));
+        if (!ring)
+                return NULL;
+
+        ring->buf = MALLOC (size);
+        if (!ring->buf) {
+                FREE (ring);
+                return NULL;
+        }
+        ring->size = size;
+
+        pthread_mutex_lock (&async->lock);
+        {
+                ring->next = async->rings;
+                __sync_synchronize ();
+                async->rings = ring;
+        }
+        pthread_mutex_unlock (&async->lock);
+
+        pthread_setspecific (async->key, ring);
+
+        return ring;
+}
+
+/* Make room for @size bytes in the ring, starting over at the beginning if
+   they do not fit before the end. Returns the new head, 0 on failure. */
+static unsigned long
+gf_log_ring_reserve (struct gf_log_async *async, struct gf_log_ring *ring,
+                     size_t size, struct gf_log_rec **recp)
+{
+        struct gf_log_rec *pad = NULL;
+        unsigned long      head = 0;
+        unsigned long      off = 0;
+        unsigned long      skip = 0;
+        int                waited = 0;
+
+        head = ring->head;
+        off = head & (ring->size - 1);
+        skip = (ring->size - off < size) ? ring->size - off : 0;
+
+        while (ring->size - (head - ring->tail) < skip + size) {
+                /* the writer must never wait for itself */
+                if (pthread_equal (pthread_self (), async->writer) ||
+                    waited++ >= GF_LOG_SPACE_WAIT_MAX || !async->enabled)
+                        return 0;
+
+                gf_log_async_wake (async);
+                usleep (1000);
+        }
+
+        /* do not overwrite what the consumer may still be reading */
+        __sync_synchronize ();
+
+        if (skip) {
+                pad = (struct gf_log_rec *) (ring->buf + off);
+                pad->size = skip;
+                pad->type = GF_LOG_REC_PAD;
+                head += skip;
+                off = 0;
+        }
+
+        *recp = (struct gf_log_rec *) (ring->buf + off);
+
+        return head + size;
+}
+
+static void
+gf_log_rec_fill (struct gf_log_async *async, struct gf_log_rec *rec,
+                 size_t size, int style, const char *domain, size_t domain_len,
+                 const char *file, const char *function, int line,
+                 gf_loglevel_t level, int errnum, uint64_t msgid,
+                 const char *callstr, size_t callstr_len, const char *body,
+                 size_t body_len, gf_boolean_t deferred, va_list ap)
+{
+        xlator_t *this = THIS;
+
+        rec->size = size;
+        rec->type = deferred ? GF_LOG_REC_ARGS : GF_LOG_REC_TEXT;
+        rec->style = style;
+        rec->level = level;
+        rec->line = line;
+        rec->graph_id = this->graph ? this->graph->id : 0;
+        rec->errnum = errnum;
+        rec->domain_len = domain_len;
+        rec->callstr_len = callstr_len;
+        rec->body_len = body_len;
+        rec->msgid = msgid;
+        rec->file = file;
+        rec->function = function;
+        gettimeofday (&rec->tv, NULL);
+
+        memcpy (rec->data, domain, domain_len);
+        if (callstr_len)
+                memcpy (rec->data + domain_len, callstr, callstr_len);
+        memcpy (rec->data + domain_len + callstr_len, body, body_len);
+        if (deferred)
+                gf_log_pack_args (body, ap, rec->data + domain_len +
+                                  callstr_len + body_len);
+
+        rec->seq = GF_ATOMIC_ADD (async->seq_lock, async->seq, 1) - 1;
+}
+
+static void __gf_log_async_drain (struct gf_log_async *async);
+static void gf_log_async_write (struct gf_log_async *async,
+                                struct gf_log_rec *rec);
+static void gf_log_async_flush_repeats (struct gf_log_async *async);
+
+/* Write out what is queued, and @rec if given, from any thread. With @all
+   set repeats still being counted are written out too. */
+static void
+gf_log_async_drain (struct gf_log_async *async, struct gf_log_rec *rec,
+                    gf_boolean_t wait, gf_boolean_t all)
+{
+        glusterfs_ctx_t *ctx = async->ctx;
+        int              tries = 0;
+
+        /* do not hang a crashing process on a writer that holds the lock */
+        while (pthread_mutex_trylock (&async->drain) != 0) {
+                if (!wait && ++tries > 1000)
+                        return;
+                usleep (1000);
+        }
+
+        pthread_mutex_lock (&ctx->log.logfile_mutex);
+        {
+                __gf_log_async_drain (async);
+                if (rec)
+                        gf_log_async_write (async, rec);
+                if (all)
+                        gf_log_async_flush_repeats (async);
+                if (async->dirty && ctx->log.logfile)
+                        fflush (ctx->log.logfile);
+                async->dirty = _gf_false;
+        }
+        pthread_mutex_unlock (&ctx->log.logfile_mutex);
+
+        pthread_mutex_unlock (&async->drain);
+}
+
+/* Queue a message for the writer thread. Either @text is the formatted
+   message, or @fmt and @ap are. */
+static int
+gf_log_enqueue (glusterfs_ctx_t *ctx, int style, const char *domain,
+                const char *file, const char *function, int line,
+                gf_loglevel_t level, int errnum, uint64_t msgid,
+                const char *callstr, const char *text, const char *fmt,
+                va_list ap)
+{
+        struct gf_log_async *async = ctx->log.async;
+        struct gf_log_ring  *ring = NULL;
+        struct gf_log_rec   *rec = NULL;
+        char                *msg = NULL;
+        ssize_t              args_len = -1;
+        size_t               domain_len = 0;
+        size_t               callstr_len = 0;
+        size_t               body_len = 0;
+        size_t               size = 0;
+        unsigned long        head = 0;
+        va_list              aq;
+
+        if (!text && ctx->log.defer_format) {
+                va_copy (aq, ap);
+                args_len = gf_log_pack_args (fmt, aq, NULL);
+                va_end (aq);
+        }
+
+        if (!text && args_len < 0) {
+                if (vasprintf (&msg, fmt, ap) < 0)
+                        return -1;
+                text = msg;
+        }
+
+        domain_len = min (strlen (domain) + 1, UINT16_MAX);
+        callstr_len = callstr ? min (strlen (callstr) + 1, UINT16_MAX) : 0;
+        body_len = strlen (text ? text : fmt) + 1;
+
+        size = GF_LOG_ALIGN (sizeof (*rec) + domain_len + callstr_len +
+                             body_len + max (args_len, 0));
+
+        ring = gf_log_ring_get (async);
+        if (ring && size <= ring->size / 2)
+                head = gf_log_ring_reserve (async, ring, size, &rec);
+
+        if (head) {
+                va_copy (aq, ap);
+                gf_log_rec_fill (async, rec, size, style, domain, domain_len,
+                                 file, function, line, level, errnum, msgid,
+                                 callstr, callstr_len, text ? text : fmt,
+                                 body_len, !text, aq);
+                va_end (aq);
+
+                __sync_synchronize ();
+                ring->head = head;
+                __sync_synchronize ();
+
+                if (async->sleeping)
+                        gf_log_async_wake (async);
+                goto out;
+        }
+
+        if (ring && pthread_equal (pthread_self (), async->writer)) {
+                ring->dropped++;
+                goto out;
+        }
+
+        /* too big for the ring, or the writer is stuck: write it here */
+        rec = MALLOC (size);
+        if (!rec)
+                goto out;
+
+        va_copy (aq, ap);
+        gf_log_rec_fill (async, rec, size, style, domain, domain_len, file,
+                         function, line, level, errnum, msgid, callstr,
+                         callstr_len, text ? text : fmt, body_len, !text, aq);
+        va_end (aq);
+
+        gf_log_async_drain (async, rec, _gf_true, _gf_false);
+
+        FREE (rec);
+out:
+        FREE (msg);
+
+        return 0;
+}
+
+static int
+gf_log_enqueue_text (glusterfs_ctx_t *ctx, int style, const char *domain,
+                     const char *file, const char *function, int line,
+                     gf_loglevel_t level, const char *text, ...)
+{
+        va_list ap;
+        int     ret = 0;
+
+        va_start (ap, text);
+        ret = gf_log_enqueue (ctx, style, domain, file, function, line, level,
+                              0, 0, NULL, text, NULL, ap);
+        va_end (ap);
+
+        return ret;
+}
+
+static struct gf_log_rec *
+gf_log_ring_peek (struct gf_log_ring *ring)
+{
+        struct gf_log_rec *rec = NULL;
+        unsigned long      head = 0;
+
+        head = ring->head;
+        /* read the record only after the head which covers it */
+        __sync_synchronize ();
+
+        while (ring->tail != head) {
+                rec = (struct gf_log_rec *) (ring->buf +
+                                             (ring->tail & (ring->size - 1)));
+                if (rec->type != GF_LOG_REC_PAD)
+                        return rec;
+                ring->tail += rec->size;
+        }
+
+        return NULL;
+}
+
+static void
+gf_log_async_emit (struct gf_log_async *async, struct gf_log_rec *rec,
+                   const char *domain, const char *callstr, const char *body)
+{
+        glusterfs_ctx_t      *ctx = async->ctx;
+        struct gf_log_strbuf *sb = &async->line;
+
+        sb->len = 0;
+
+        if (rec->style != GF_LOG_STYLE_PLAIN) {
+                if (rec->tv.tv_sec != async->time_sec || !async->time_sec) {
+                        gf_time_fmt (async->time_str, sizeof (async->time_str),
+                                     rec->tv.tv_sec, gf_timefmt_FT);
+                        async->time_sec = rec->tv.tv_sec;
+                }
+
+                gf_log_strbuf_printf (sb, "[%s.%"GF_PRI_SUSECONDS"] %s ",
+                                      async->time_str, rec->tv.tv_usec,
+                                      gf_level_strings[rec->level]);
+                if (rec->style == GF_LOG_STYLE_MSG &&
+                    ctx->log.logformat != gf_logformat_traditional)
+                        gf_log_strbuf_printf (sb, "[MSGID: %"PRIu64"] ",
+                                              rec->msgid);
+                gf_log_strbuf_printf (sb, "[%s:%d:%s] ", rec->file, rec->line,
+                                      rec->function);
+                if (callstr)
+                        gf_log_strbuf_printf (sb, "%s ", callstr);
+                gf_log_strbuf_printf (sb, "%d-%s: ", rec->graph_id, domain);
+        }
+
+        gf_log_strbuf_add (sb, body, strlen (body));
+
+        if (rec->errnum)
+                gf_log_strbuf_printf (sb, " [%s]", strerror (rec->errnum));
+
+        if (!sb->buf)
+                return;
+
+        if (ctx->log.logfile) {
+                fprintf (ctx->log.logfile, "%s\n", sb->buf);
+                async->dirty = _gf_true;
+        } else if (rec->style == GF_LOG_STYLE_PLAIN ||
+                   ctx->log.loglevel >= rec->level) {
+                fprintf (stderr, "%s\n", sb->buf);
+        }
+
+#ifdef GF_LINUX_HOST_OS
+        /* We want only serious logs in 'syslog', not our debug
+         * and trace logs */
+        if (ctx->log.gf_log_syslog && rec->level &&
+            (rec->level <= ctx->log.sys_log_level))
+                syslog ((rec->level-1), "%s\n", sb->buf);
+#endif
+}
+
+static void
+gf_log_async_flush_repeats (struct gf_log_async *async)
+{
+        struct gf_log_rec  rec;
+        char               first[GF_LOG_TIMESTR_SIZE] = {0,};
+        char               msg[GF_LOG_TIMESTR_SIZE * 2] = {0,};
+
+        if (!async->repeated)
+                return;
+
+        rec = async->last;
+        rec.tv = async->repeat_last;
+        rec.errnum = 0;
+
+        gf_time_fmt (first, sizeof (first), async->repeat_first.tv_sec,
+                     gf_timefmt_FT);
+        snprintf (msg, sizeof (msg), "last message repeated %u times since "
+                  "[%s.%"GF_PRI_SUSECONDS"]", async->repeated, first,
+                  async->repeat_first.tv_usec);
+
+        gf_log_async_emit (async, &rec, async->last_domain.buf,
+                           async->last_callstr.len ?
+                           async->last_callstr.buf : NULL, msg);
+
+        async->repeated = 0;
+        /* a new window starts with the summary */
+        async->last.tv = async->repeat_last;
+}
+
+static gf_boolean_t
+gf_log_async_is_repeat (struct gf_log_async *async, struct gf_log_rec *rec,
+                        const char *domain, const char *callstr)
+{
+        struct gf_log_rec *last = &async->last;
+
+        if (!async->last_valid || rec->style == GF_LOG_STYLE_PLAIN)
+                return _gf_false;
+
+        if (rec->level != last->level || rec->style != last->style ||
+            rec->line != last->line || rec->file != last->file ||
+            rec->function != last->function || rec->errnum != last->errnum ||
+            rec->msgid != last->msgid || rec->graph_id != last->graph_id)
+                return _gf_false;
+
+        if (!!callstr != !!async->last_callstr.len ||
+            (callstr && strcmp (callstr, async->last_callstr.buf)))
+                return _gf_false;
+
+        return !strcmp (domain, async->last_domain.buf) &&
+                !strcmp (async->body.buf, async->last_body.buf);
+}
+
+static void
+gf_log_async_write (struct gf_log_async *async, struct gf_log_rec *rec)
+{
+        glusterfs_ctx_t *ctx = async->ctx;
+        const char      *domain = NULL;
+        const char      *callstr = NULL;
+        const char      *body = NULL;
+
+        domain = rec->data;
+        if (rec->callstr_len)
+                callstr = rec->data + rec->domain_len;
+        body = rec->data + rec->domain_len + rec->callstr_len;
+
+        async->body.len = 0;
+        if (rec->type == GF_LOG_REC_ARGS)
+                gf_log_unpack_args (&async->body, body, body + rec->body_len);
+        else
+                gf_log_strbuf_add (&async->body, body, rec->body_len - 1);
+        if (!async->body.buf)
+                return;
+
+        if (ctx->log.flush_timeout &&
+            gf_log_async_is_repeat (async, rec, domain, callstr) &&
+            rec->tv.tv_sec - async->last.tv.tv_sec < ctx->log.flush_timeout) {
+                if (!async->repeated++)
+                        async->repeat_first = rec->tv;
+                async->repeat_last = rec->tv;
+                return;
+        }
+
+        gf_log_async_flush_repeats (async);
+        gf_log_async_emit (async, rec, domain, callstr, async->body.buf);
+
+        async->last = *rec;
+        async->last_valid = _gf_true;
+        gf_log_strbuf_set (&async->last_domain, domain);
+        gf_log_strbuf_set (&async->last_callstr, callstr ? callstr : "");
+        gf_log_strbuf_set (&async->last_body, async->body.buf);
+}
+
+/* Write out everything queued, oldest first. Called with async->drain and
+   log.logfile_mutex held. */
+static void
+__gf_log_async_drain (struct gf_log_async *async)
+{
+        glusterfs_ctx_t    *ctx = async->ctx;
+        struct gf_log_ring *rings = NULL;
+        struct gf_log_ring *ring = NULL;
+        struct gf_log_ring *best = NULL;
+        struct gf_log_rec  *rec = NULL;
+        struct gf_log_rec  *oldest = NULL;
+        struct timeval      now = {0,};
+        unsigned long       dropped = 0;
+
+        rings = async->rings;
+        __sync_synchronize ();
+
+        for (;;) {
+                best = NULL;
+                oldest = NULL;
+                for (ring = rings; ring; ring = ring->next) {
+                        rec = gf_log_ring_peek (ring);
+                        if (rec && (!oldest ||
+                                    (long) (rec->seq - oldest->seq) < 0)) {
+                                best = ring;
+                                oldest = rec;
+                        }
+                }
+
+                if (!best)
+                        break;
+
+                gf_log_async_write (async, oldest);
+
+                __sync_synchronize ();
+                best->tail += oldest->size;
+        }
+
+        for (ring = rings; ring; ring = ring->next) {
+                dropped += ring->dropped - ring->dropped_seen;
+                ring->dropped_seen = ring->dropped;
+        }
+
+        if (dropped) {
+                gf_log_async_flush_repeats (async);
+                async->body.len = 0;
+                gf_log_strbuf_printf (&async->body, "%lu log messages were "
+                                      "dropped, the log buffer was full",
+                                      dropped);
+                memset (&async->last, 0, sizeof (async->last));
+                async->last.style = GF_LOG_STYLE_LOG;
+                async->last.level = GF_LOG_WARNING;
+                async->last.file = "logging.c";
+                async->last.function = __FUNCTION__;
+                async->last.line = __LINE__;
+                gettimeofday (&async->last.tv, NULL);
+                if (async->body.buf)
+                        gf_log_async_emit (async, &async->last, "logging",
+                                           NULL, async->body.buf);
+                async->last_valid = _gf_false;
+        }
+
+        if (async->repeated) {
+                gettimeofday (&now, NULL);
+                if (now.tv_sec - async->last.tv.tv_sec >=
+                    ctx->log.flush_timeout)
+                        gf_log_async_flush_repeats (async);
+        }
+}
+
+static void
+gf_log_async_reap (struct gf_log_async *async)
+{
+        struct gf_log_ring *ring = NULL;
+        struct gf_log_ring *prev = NULL;
+        struct gf_log_ring *next = NULL;
+
+        /* nobody may be walking the rings while they are freed */
+        pthread_mutex_lock (&async->drain);
+        pthread_mutex_lock (&async->lock);
+        {
+                for (ring = async->rings; ring; ring = next) {
+                        next = ring->next;
+                        if (!ring->dead || ring->head != ring->tail) {
+                                prev = ring;
+                                continue;
+                        }
+
+                        if (prev)
+                                prev->next = next;
+                        else
+                                async->rings = next;
+
+                        FREE (ring->buf);
+                        FREE (ring);
+                }
+        }
+        pthread_mutex_unlock (&async->lock);
+        pthread_mutex_unlock (&async->drain);
+}
+
+static gf_boolean_t
+gf_log_async_pending (struct gf_log_async *async)
+{
+        struct gf_log_ring *ring = NULL;
+
+        for (ring = async->rings; ring; ring = ring->next) {
+                if (ring->head != ring->tail)
+                        return _gf_true;
+        }
+
+        return async->repeated != 0;
+}
+
+static void *
+gf_log_async_writer (void *data)
+{
+        struct gf_log_async *async = data;
+        struct timespec      ts = {0,};
+        gf_boolean_t         stop = _gf_false;
+
+        while (!stop) {
+                /* rotation may log, so not with the rings drained */
+                gf_log_rotate (async->ctx);
+
+                gf_log_async_drain (async, NULL, _gf_true, _gf_false);
+                gf_log_async_reap (async);
+
+                pthread_mutex_lock (&async->lock);
+                {
+                        stop = async->stop;
+                        async->sleeping = 1;
+                        __sync_synchronize ();
+
+                        if (!stop && !gf_log_async_pending (async)) {
+                                clock_gettime (CLOCK_REALTIME, &ts);
+                                ts.tv_sec += 1;
+                                pthread_cond_timedwait (&async->cond,
+                                                        &async->lock, &ts);
+                        }
+
+                        async->sleeping = 0;
+                }
+                pthread_mutex_unlock (&async->lock);
+        }
+
+        gf_log_async_drain (async, NULL, _gf_true, _gf_true);
+
+        return NULL;
+}
+
+static int
+gf_log_async_start (glusterfs_ctx_t *ctx)
+{
+        struct gf_log_async *async = NULL;
+        int                  ret = -1;
+
+        pthread_mutex_lock (&ctx->log.logfile_mutex);
+        {
+                if (!ctx->log.async) {
+                        async = CALLOC (1, sizeof (*async));
+                        if (!async)
+                                goto unlock;
+
+                        async->ctx = ctx;
+                        pthread_mutex_init (&async->lock, NULL);
+                        pthread_mutex_init (&async->drain, NULL);
+                        LOCK_INIT (&async->seq_lock);
+                        pthread_cond_init (&async->cond, NULL);
+                        if (pthread_key_create (&async->key,
+                                                gf_log_ring_release)) {
+                                FREE (async);
+                                goto unlock;
+                        }
+                        ctx->log.async = async;
+                }
+                ret = 0;
+        }
+unlock:
+        pthread_mutex_unlock (&ctx->log.logfile_mutex);
+
+        if (ret)
+                return ret;
+
+        async = ctx->log.async;
+
+        pthread_mutex_lock (&async->lock);
+        {
+                if (!async->running) {
+                        async->stop = 0;
+                        ret = gf_thread_create (&async->writer, NULL,
+                                                gf_log_async_writer, async);
+                        if (!ret)
+                                async->running = _gf_true;
+                }
+                async->enabled = async->running;
+        }
+        pthread_mutex_unlock (&async->lock);
+
+        return ret;
+}
+
+static void
+gf_log_async_stop (glusterfs_ctx_t *ctx)
+{
+        struct gf_log_async *async = ctx->log.async;
+        gf_boolean_t         running = _gf_false;
+
+        if (!async)
+                return;
+
+        pthread_mutex_lock (&async->lock);
+        {
+                async->enabled = 0;
+                running = async->running;
+                async->running = _gf_false;
+                async->stop = 1;
+                pthread_cond_signal (&async->cond);
+        }
+        pthread_mutex_unlock (&async->lock);
+
+        if (running)
+                pthread_join (async->writer, NULL);
+
+        /* whatever was queued while the writer was exiting */
+        gf_log_async_drain (async, NULL, _gf_true, _gf_true);
+}
+
+/* the writer thread is running, and messages should be queued to it */
+static struct gf_log_async *
+gf_log_async_get (glusterfs_ctx_t *ctx)
+{
+        struct gf_log_async *async = ctx->log.async;
+
+        if (async && async->enabled)
+                return async;
+
+        return NULL;
+}
+
+static void
+gf_log_async_flush (glusterfs_ctx_t *ctx)
+{
+        if (ctx->log.async)
+                gf_log_async_drain (ctx->log.async, NULL, _gf_false,
+                                    _gf_true);
+}
+
+int
+gf_log_set_log_buf_size (size_t size)
+{
+        glusterfs_ctx_t *ctx = THIS->ctx;
+
+        if (!ctx)
+                return -1;
+
+        ctx->log.ring_size = min (size, GF_LOG_RING_MAX);
+
+        if (!size) {
+                gf_log_async_stop (ctx);
+                return 0;
+        }
+
+        return gf_log_async_start (ctx);
+}
+
+void
+gf_log_set_log_flush_timeout (uint32_t timeout)
+{
+        glusterfs_ctx_t *ctx = THIS->ctx;
+
+        if (ctx)
+                ctx->log.flush_timeout = timeout;
+}
+
+void
+gf_log_set_defer_format (int defer)
+{
+        glusterfs_ctx_t *ctx = THIS->ctx;
+
+        if (ctx)
+                ctx->log.defer_format = defer;
+}
+
 void
 gf_log_globals_fini (void)
 {
@@ -313,6 +1575,9 @@ gf_log_fini (void *data)
                 goto out;
         }
 
+        /* write out what the writer thread has not yet */
+        gf_log_async_stop (ctx);
+
         pthread_mutex_lock (&ctx->log.logfile_mutex);
         {
                 if (ctx->log.logfile) {
@@ -549,6 +1814,8 @@ gf_log_globals_init (void *data)
         ctx->log.sys_log_level    = GF_LOG_CRITICAL;
         ctx->log.logger           = gf_logger_glusterlog;
         ctx->log.logformat        = gf_logformat_withmsgid;
+        ctx->log.flush_timeout    = GF_LOG_FLUSH_TIMEOUT_DEFAULT;
+        ctx->log.defer_format     = 0;
 
 #ifdef GF_LINUX_HOST_OS
         /* For the 'syslog' output. one can grep 'GlusterFS' in syslog
@@ -737,6 +2004,15 @@ _gf_log_callingfn (const char *domain, const char *file, const char *function,
                 goto out;
         }
 
+        if (gf_log_async_get (ctx)) {
+                va_start (ap, fmt);
+                ret = gf_log_enqueue (ctx, GF_LOG_STYLE_LOG, domain, basename,
+                                      function, line, level, 0, 0, callstr,
+                                      NULL, fmt, ap);
+                va_end (ap);
+                goto out;
+        }
+
         ret = gettimeofday (&tv, NULL);
         if (-1 == ret)
                 goto out;
@@ -819,6 +2095,12 @@ _gf_msg_plain_internal (gf_loglevel_t level, const char *msg)
                  * to the gluster log. The ideal way to do things would be to
                  * not have the extra control file check */
         case gf_logger_glusterlog:
+                if (gf_log_async_get (ctx)) {
+                        gf_log_enqueue_text (ctx, GF_LOG_STYLE_PLAIN, "", "",
+                                             "", 0, level, msg);
+                        break;
+                }
+
                 pthread_mutex_lock (&ctx->log.logfile_mutex);
                 {
                         if (ctx->log.logfile) {
@@ -1407,6 +2689,7 @@ _gf_msg (const char *domain, const char *file, const char *function,
         glusterfs_ctx_t *ctx = NULL;
         char             callstr[GF_LOG_BACKTRACE_SIZE] = {0,};
         int              passcallstr = 0;
+        const char      *basename = NULL;
 
         /* in args check */
         if (!domain || !file || !function || !fmt) {
@@ -1442,6 +2725,21 @@ _gf_msg (const char *domain, const char *file, const char *function,
         }
 #endif /* HAVE_BACKTRACE */
 
+        /* queue it to the writer thread, unless it goes to syslog */
+        if (gf_log_async_get (ctx) &&
+            !(ctx->log.logger == gf_logger_syslog &&
+              ctx->log.log_control_file_found && ctx->log.gf_log_syslog)) {
+                GET_FILE_NAME_TO_LOG (file, basename);
+
+                va_start (ap, fmt);
+                ret = gf_log_enqueue (ctx, GF_LOG_STYLE_MSG, domain, basename,
+                                      function, line, level, errnum, msgid,
+                                      (passcallstr ? callstr : NULL), NULL,
+                                      fmt, ap);
+                va_end (ap);
+                goto out;
+        }
+
         /* form the message */
         va_start (ap, fmt);
         ret = vasprintf (&msgstr, fmt, ap);
@@ -1573,6 +2871,15 @@ _gf_log (const char *domain, const char *file, const char *function, int line,
         }
 
 log:
+        if (gf_log_async_get (ctx)) {
+                va_start (ap, fmt);
+                gf_log_enqueue (ctx, GF_LOG_STYLE_LOG, domain, basename,
+                                function, line, level, 0, 0, NULL, NULL, fmt,
+                                ap);
+                va_end (ap);
+                goto out;
+        }
+
         ret = gettimeofday (&tv, NULL);
         if (-1 == ret)
                 goto out;
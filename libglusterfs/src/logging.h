@@ -83,6 +83,7 @@ typedef enum {
 
 #define DEFAULT_LOG_FILE_DIRECTORY            DATADIR "/log/glusterfs"
 #define DEFAULT_LOG_LEVEL                     GF_LOG_INFO
+#define GF_LOG_FLUSH_TIMEOUT_DEFAULT          5
 
 typedef struct gf_log_handle_ {
         pthread_mutex_t  logfile_mutex;
@@ -100,6 +101,12 @@ typedef struct gf_log_handle_ {
         gf_log_format_t  logformat;
         char            *ident;
         int              log_control_file_found;
+        size_t           ring_size;     /* per-thread log ring, 0 when
+                                           messages are written directly */
+        uint32_t         flush_timeout; /* repeats of a message within this
+                                           many seconds are written once */
+        int              defer_format;  /* the writer thread formats */
+        struct gf_log_async *async;
 } gf_log_handle_t;
 
 void gf_log_globals_init (void *ctx);
@@ -248,6 +255,9 @@ void gf_log_enable_syslog (void);
 gf_loglevel_t gf_log_get_loglevel (void);
 void gf_log_set_loglevel (gf_loglevel_t level);
 void gf_log_flush (void);
+int gf_log_set_log_buf_size (size_t size);
+void gf_log_set_log_flush_timeout (uint32_t timeout);
+void gf_log_set_defer_format (int defer);
 gf_loglevel_t gf_log_get_xl_loglevel (void *xl);
 void gf_log_set_xl_loglevel (void *xl, gf_loglevel_t level);
 
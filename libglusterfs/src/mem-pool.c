@@ -20,7 +20,7 @@
 #define mem_pool_chunkhead2ptr(head)     ((head) + GF_MEM_POOL_PAD_BOUNDARY)
 #define mem_pool_ptr2chunkhead(ptr)      ((ptr) - GF_MEM_POOL_PAD_BOUNDARY)
 #define is_mem_chunk_in_use(ptr)         (*ptr == 1)
-#define mem_pool_from_ptr(ptr)           ((ptr) + GF_MEM_POOL_LIST_BOUNDARY)
+#define mem_slab_from_ptr(ptr)           ((ptr) + GF_MEM_POOL_LIST_BOUNDARY)
 
 #define GLUSTERFS_ENV_MEM_ACCT_STR  "GLUSTERFS_DISABLE_MEM_ACCT"
 
@@ -276,16 +276,393 @@ free:
 
 
 
+/*
+ * Per-thread magazines.
+ *
+ * Each thread owns one magazine per pool it has touched, indexed by the
+ * pool's id in a thread specific array. A magazine is a stack of free chunk
+ * heads; it is refilled from and drained to the pool depot half a magazine
+ * at a time, so the depot lock is taken once per many mem_get/mem_put calls.
+ *
+ * mem_pool_tls_lock serializes pool id allocation and the attach/detach of
+ * magazines to pools, which only happens on the first use of a pool by a
+ * thread, on thread exit and on pool destruction.
+ */
+
+#define GF_MEM_POOL_MAGAZINE_MIN 4
+#define GF_MEM_POOL_MAGAZINE_MAX 64
+
+struct mem_magazine {
+        struct mem_pool   *pool;
+        struct list_head   pool_list;
+        int                size;
+        int                rounds;
+        uint64_t           alloc_count;
+        void              *chunks[];
+};
+
+struct mem_pool_thread_cache {
+        unsigned int          nr_mags;
+        struct mem_magazine **mags;
+};
+
+/* every chunk head points to its slab, in the place of the pool pointer */
+struct mem_slab {
+        struct list_head   list;
+        struct mem_pool   *pool;
+        unsigned long      free;       /* chunks in the depot */
+};
+
+#define GF_MEM_SLAB_HEADER_SIZE  (sizeof (struct mem_slab))
+
+static pthread_once_t    mem_pool_tls_once = PTHREAD_ONCE_INIT;
+static pthread_key_t     mem_pool_tls_key;
+static pthread_mutex_t   mem_pool_tls_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct mem_pool **mem_pool_ids;
+static unsigned int      mem_pool_nr_ids;
+
+
+static void
+__mem_pool_update_counts (struct mem_pool *pool, int hot_delta)
+{
+        pool->hot_count  += hot_delta;
+        pool->cold_count -= hot_delta;
+
+        if (pool->max_alloc < pool->hot_count)
+                pool->max_alloc = pool->hot_count;
+
+        pool->curr_stdalloc = pool->hot_count - (int) pool->slab_count;
+        if (pool->curr_stdalloc < 0)
+                pool->curr_stdalloc = 0;
+        if (pool->max_stdalloc < pool->curr_stdalloc)
+                pool->max_stdalloc = pool->curr_stdalloc;
+}
+
+
+static int
+__mem_pool_add_slab (struct mem_pool *pool)
+{
+        struct mem_slab  *slab = NULL;
+        struct list_head *list = NULL;
+        void             *chunks = NULL;
+        unsigned long     i = 0;
+
+        slab = GF_CALLOC (1, GF_MEM_SLAB_HEADER_SIZE +
+                          (pool->slab_count * pool->padded_sizeof_type),
+                          gf_common_mt_long);
+        if (!slab)
+                return -1;
+
+        slab->pool = pool;
+        slab->free = pool->slab_count;
+
+        chunks = ((void *)slab) + GF_MEM_SLAB_HEADER_SIZE;
+        for (i = 0; i < pool->slab_count; i++) {
+                list = chunks + (i * pool->padded_sizeof_type);
+                INIT_LIST_HEAD (list);
+                *(struct mem_slab **) mem_slab_from_ptr ((void *)list) = slab;
+                list_add_tail (list, &pool->list);
+        }
+
+        list_add_tail (&slab->list, &pool->slabs);
+        pool->nr_slabs++;
+        pool->cold_count += pool->slab_count;
+
+        return 0;
+}
+
+
+/*
+ * Give back a slab all chunks of which are in the depot, so that a burst
+ * does not pin its peak memory for the life of the pool. The first slab is
+ * kept, and so is one slab worth of other free chunks, not to add and free
+ * a slab over and over at the boundary.
+ */
+static void
+__mem_pool_release_slab (struct mem_pool *pool, struct mem_slab *slab)
+{
+        struct list_head *list = NULL;
+        void             *chunks = NULL;
+        unsigned long     i = 0;
+
+        if (slab == list_entry (pool->slabs.next, struct mem_slab, list))
+                return;
+
+        if (pool->cold_count < (int) (2 * pool->slab_count))
+                return;
+
+        chunks = ((void *)slab) + GF_MEM_SLAB_HEADER_SIZE;
+        for (i = 0; i < pool->slab_count; i++) {
+                list = chunks + (i * pool->padded_sizeof_type);
+                list_del_init (list);
+        }
+
+        list_del (&slab->list);
+        pool->nr_slabs--;
+        pool->cold_count -= pool->slab_count;
+        pool->slabs_released++;
+
+        GF_FREE (slab);
+}
+
+
+/* Take one chunk head out of the depot, growing the pool if it is empty. */
+static void *
+__mem_pool_get_chunk (struct mem_pool *pool)
+{
+        struct list_head *list = NULL;
+        struct mem_slab  *slab = NULL;
+
+        if (list_empty (&pool->list)) {
+                pool->pool_misses++;
+                if (__mem_pool_add_slab (pool) != 0)
+                        return NULL;
+        }
+
+        list = pool->list.next;
+        list_del_init (list);
+
+        slab = *(struct mem_slab **) mem_slab_from_ptr ((void *)list);
+        slab->free--;
+
+        return list;
+}
+
+
+static void
+__mem_pool_put_chunk (struct mem_pool *pool, void *head)
+{
+        struct list_head *list = head;
+        struct mem_slab  *slab = NULL;
+
+        /* most recently used first, leaving the chunks of a slab added
+           for a burst at the tail for their slab to empty out */
+        list_add (list, &pool->list);
+
+        slab = *(struct mem_slab **) mem_slab_from_ptr (head);
+        if (++slab->free == pool->slab_count)
+                __mem_pool_release_slab (pool, slab);
+}
+
+
+/* Fill an empty magazine half way from the depot. */
+static void
+mem_magazine_refill (struct mem_pool *pool, struct mem_magazine *mag)
+{
+        void *head = NULL;
+        int   want = 0;
+
+        want = mag->size / 2;
+
+        LOCK (&pool->lock);
+        {
+                pool->alloc_count += mag->alloc_count;
+                mag->alloc_count = 0;
+
+                while (mag->rounds < want) {
+                        head = __mem_pool_get_chunk (pool);
+                        if (!head)
+                                break;
+                        mag->chunks[mag->rounds++] = head;
+                }
+                __mem_pool_update_counts (pool, mag->rounds);
+        }
+        UNLOCK (&pool->lock);
+}
+
+
+/* Return @count chunks of a magazine to the depot. */
+static void
+mem_magazine_drain (struct mem_pool *pool, struct mem_magazine *mag,
+                    int count)
+{
+        int i = 0;
+
+        LOCK (&pool->lock);
+        {
+                pool->alloc_count += mag->alloc_count;
+                mag->alloc_count = 0;
+
+                /* counted first, for __mem_pool_release_slab to see
+                   them in the depot */
+                __mem_pool_update_counts (pool, -count);
+                for (i = 0; i < count; i++)
+                        __mem_pool_put_chunk (pool,
+                                              mag->chunks[--mag->rounds]);
+        }
+        UNLOCK (&pool->lock);
+}
+
+
+static void
+mem_pool_thread_cache_destroy (void *ptr)
+{
+        struct mem_pool_thread_cache *tc = ptr;
+        struct mem_magazine          *mag = NULL;
+        unsigned int                  i = 0;
+
+        if (!tc)
+                return;
+
+        for (i = 0; i < tc->nr_mags; i++) {
+                mag = tc->mags[i];
+                if (!mag)
+                        continue;
+
+                pthread_mutex_lock (&mem_pool_tls_lock);
+                {
+                        if (mag->pool) {
+                                mem_magazine_drain (mag->pool, mag,
+                                                    mag->rounds);
+                                list_del_init (&mag->pool_list);
+                        }
+                }
+                pthread_mutex_unlock (&mem_pool_tls_lock);
+
+                FREE (mag);
+        }
+
+        FREE (tc->mags);
+        FREE (tc);
+}
+
+
+static void
+mem_pool_tls_init (void)
+{
+        int ret = 0;
+
+        ret = pthread_key_create (&mem_pool_tls_key,
+                                  mem_pool_thread_cache_destroy);
+        if (ret)
+                gf_log ("mem-pool", GF_LOG_WARNING,
+                        "failed to create the pthread key, per-thread "
+                        "magazines are disabled");
+}
+
+
+static struct mem_magazine *
+mem_magazine_attach (struct mem_pool *pool, struct mem_pool_thread_cache *tc)
+{
+        struct mem_magazine  *mag = NULL;
+        struct mem_magazine **mags = NULL;
+        unsigned int          nr_mags = 0;
+
+        if (!tc) {
+                tc = CALLOC (1, sizeof (*tc));
+                if (!tc)
+                        return NULL;
+
+                if (pthread_setspecific (mem_pool_tls_key, tc) != 0) {
+                        FREE (tc);
+                        return NULL;
+                }
+        }
+
+        if (pool->id >= tc->nr_mags) {
+                nr_mags = pool->id + 16;
+                mags = REALLOC (tc->mags, nr_mags * sizeof (*mags));
+                if (!mags)
+                        return NULL;
+                memset (mags + tc->nr_mags, 0,
+                        (nr_mags - tc->nr_mags) * sizeof (*mags));
+                tc->mags = mags;
+                tc->nr_mags = nr_mags;
+        }
+
+        /* A magazine left behind by a destroyed pool which had the same
+         * id. It was detached (and emptied) by mem_pool_destroy.
+         */
+        mag = tc->mags[pool->id];
+        if (mag && mag->size != pool->magazine_size) {
+                FREE (mag);
+                tc->mags[pool->id] = NULL;
+                mag = NULL;
+        }
+
+        if (!mag) {
+                mag = CALLOC (1, sizeof (*mag) +
+                              pool->magazine_size * sizeof (void *));
+                if (!mag)
+                        return NULL;
+                mag->size = pool->magazine_size;
+                INIT_LIST_HEAD (&mag->pool_list);
+                tc->mags[pool->id] = mag;
+        }
+
+        pthread_mutex_lock (&mem_pool_tls_lock);
+        {
+                mag->pool = pool;
+                mag->rounds = 0;
+                mag->alloc_count = 0;
+                list_add (&mag->pool_list, &pool->magazines);
+        }
+        pthread_mutex_unlock (&mem_pool_tls_lock);
+
+        return mag;
+}
+
+
+static inline struct mem_magazine *
+mem_magazine_get (struct mem_pool *pool)
+{
+        struct mem_pool_thread_cache *tc = NULL;
+        struct mem_magazine          *mag = NULL;
+
+        tc = pthread_getspecific (mem_pool_tls_key);
+        if (tc && pool->id < tc->nr_mags) {
+                mag = tc->mags[pool->id];
+                if (mag && mag->pool == pool)
+                        return mag;
+        }
+
+        return mem_magazine_attach (pool, tc);
+}
+
+
+static int
+mem_pool_id_get (struct mem_pool *pool)
+{
+        struct mem_pool **ids = NULL;
+        unsigned int      nr_ids = 0;
+        unsigned int      i = 0;
+        int               ret = -1;
+
+        pthread_mutex_lock (&mem_pool_tls_lock);
+        {
+                for (i = 0; i < mem_pool_nr_ids; i++)
+                        if (!mem_pool_ids[i])
+                                break;
+
+                if (i == mem_pool_nr_ids) {
+                        nr_ids = mem_pool_nr_ids + 64;
+                        ids = REALLOC (mem_pool_ids, nr_ids * sizeof (*ids));
+                        if (!ids)
+                                goto unlock;
+                        memset (ids + mem_pool_nr_ids, 0,
+                                (nr_ids - mem_pool_nr_ids) * sizeof (*ids));
+                        mem_pool_ids = ids;
+                        mem_pool_nr_ids = nr_ids;
+                }
+
+                mem_pool_ids[i] = pool;
+                pool->id = i;
+                ret = 0;
+        }
+unlock:
+        pthread_mutex_unlock (&mem_pool_tls_lock);
+
+        return ret;
+}
+
+
 struct mem_pool *
 mem_pool_new_fn (unsigned long sizeof_type,
                  unsigned long count, char *name)
 {
         struct mem_pool  *mem_pool = NULL;
         unsigned long     padded_sizeof_type = 0;
-        void             *pool = NULL;
-        int               i = 0;
         int               ret = 0;
-        struct list_head *list = NULL;
         glusterfs_ctx_t  *ctx = NULL;
 
         if (!sizeof_type || !count) {
@@ -294,6 +671,8 @@ mem_pool_new_fn (unsigned long sizeof_type,
         }
         padded_sizeof_type = sizeof_type + GF_MEM_POOL_PAD_BOUNDARY;
 
+        pthread_once (&mem_pool_tls_once, mem_pool_tls_init);
+
         mem_pool = GF_CALLOC (sizeof (*mem_pool), 1, gf_common_mt_mem_pool);
         if (!mem_pool)
                 return NULL;
@@ -309,27 +688,25 @@ mem_pool_new_fn (unsigned long sizeof_type,
 
         LOCK_INIT (&mem_pool->lock);
         INIT_LIST_HEAD (&mem_pool->list);
+        INIT_LIST_HEAD (&mem_pool->slabs);
+        INIT_LIST_HEAD (&mem_pool->magazines);
         INIT_LIST_HEAD (&mem_pool->global_list);
 
         mem_pool->padded_sizeof_type = padded_sizeof_type;
-        mem_pool->cold_count = count;
         mem_pool->real_sizeof_type = sizeof_type;
+        mem_pool->slab_count = count;
 
-        pool = GF_CALLOC (count, padded_sizeof_type, gf_common_mt_long);
-        if (!pool) {
-                GF_FREE (mem_pool->name);
-                GF_FREE (mem_pool);
-                return NULL;
-        }
+        mem_pool->magazine_size = count / 8;
+        if (mem_pool->magazine_size < GF_MEM_POOL_MAGAZINE_MIN)
+                mem_pool->magazine_size = GF_MEM_POOL_MAGAZINE_MIN;
+        if (mem_pool->magazine_size > GF_MEM_POOL_MAGAZINE_MAX)
+                mem_pool->magazine_size = GF_MEM_POOL_MAGAZINE_MAX;
 
-        for (i = 0; i < count; i++) {
-                list = pool + (i * (padded_sizeof_type));
-                INIT_LIST_HEAD (list);
-                list_add_tail (list, &mem_pool->list);
-        }
+        if (__mem_pool_add_slab (mem_pool) != 0)
+                goto err;
 
-        mem_pool->pool = pool;
-        mem_pool->pool_end = pool + (count * (padded_sizeof_type));
+        if (mem_pool_id_get (mem_pool) != 0)
+                goto err;
 
         /* add this pool to the global list */
         ctx = THIS->ctx;
@@ -340,6 +717,15 @@ mem_pool_new_fn (unsigned long sizeof_type,
 
 out:
         return mem_pool;
+
+err:
+        if (!list_empty (&mem_pool->slabs))
+                GF_FREE (list_entry (mem_pool->slabs.next, struct mem_slab,
+                                     list));
+        LOCK_DESTROY (&mem_pool->lock);
+        GF_FREE (mem_pool->name);
+        GF_FREE (mem_pool);
+        return NULL;
 }
 
 void*
@@ -363,105 +749,54 @@ mem_get0 (struct mem_pool *mem_pool)
 void *
 mem_get (struct mem_pool *mem_pool)
 {
-        struct list_head *list = NULL;
-        void             *ptr = NULL;
-        int             *in_use = NULL;
-        struct mem_pool **pool_ptr = NULL;
+        struct mem_magazine *mag = NULL;
+        void                *ptr = NULL;
+        int                 *in_use = NULL;
 
         if (!mem_pool) {
                 gf_log_callingfn ("mem-pool", GF_LOG_ERROR, "invalid argument");
                 return NULL;
         }
 
-        LOCK (&mem_pool->lock);
-        {
-                mem_pool->alloc_count++;
-                if (mem_pool->cold_count) {
-                        list = mem_pool->list.next;
-                        list_del (list);
-
-                        mem_pool->hot_count++;
-                        mem_pool->cold_count--;
+        mag = mem_magazine_get (mem_pool);
+        if (mag) {
+                if (!mag->rounds)
+                        mem_magazine_refill (mem_pool, mag);
 
-                        if (mem_pool->max_alloc < mem_pool->hot_count)
-                                mem_pool->max_alloc = mem_pool->hot_count;
+                if (!mag->rounds)
+                        return NULL;
 
-                        ptr = list;
-                        in_use = (ptr + GF_MEM_POOL_LIST_BOUNDARY +
-                                  GF_MEM_POOL_PTR);
-                        *in_use = 1;
-
-                        goto fwd_addr_out;
+                ptr = mag->chunks[--mag->rounds];
+                mag->alloc_count++;
+        } else {
+                /* No thread cache available, go to the depot directly. */
+                LOCK (&mem_pool->lock);
+                {
+                        mem_pool->alloc_count++;
+                        ptr = __mem_pool_get_chunk (mem_pool);
+                        if (ptr)
+                                __mem_pool_update_counts (mem_pool, 1);
                 }
+                UNLOCK (&mem_pool->lock);
 
-                /* This is a problem area. If we've run out of
-                 * chunks in our slab above, we need to allocate
-                 * enough memory to service this request.
-                 * The problem is, these individual chunks will fail
-                 * the first address range check in __is_member. Now, since
-                 * we're not allocating a full second slab, we wont have
-                 * enough info perform the range check in __is_member.
-                 *
-                 * I am working around this by performing a regular allocation
-                 * , just the way the caller would've done when not using the
-                 * mem-pool. That also means, we're not padding the size with
-                 * the list_head structure because, this will not be added to
-                 * the list of chunks that belong to the mem-pool allocated
-                 * initially.
-                 *
-                 * This is the best we can do without adding functionality for
-                 * managing multiple slabs. That does not interest us at present
-                 * because it is too much work knowing that a better slab
-                 * allocator is coming RSN.
-                 */
-                mem_pool->pool_misses++;
-                mem_pool->curr_stdalloc++;
-                if (mem_pool->max_stdalloc < mem_pool->curr_stdalloc)
-                        mem_pool->max_stdalloc = mem_pool->curr_stdalloc;
-                ptr = GF_CALLOC (1, mem_pool->padded_sizeof_type,
-                                 gf_common_mt_mem_pool);
-
-                /* Memory coming from the heap need not be transformed from a
-                 * chunkhead to a usable pointer since it is not coming from
-                 * the pool.
-                 */
-        }
-fwd_addr_out:
-        pool_ptr = mem_pool_from_ptr (ptr);
-        *pool_ptr = (struct mem_pool *)mem_pool;
-        ptr = mem_pool_chunkhead2ptr (ptr);
-        UNLOCK (&mem_pool->lock);
-
-        return ptr;
-}
-
-
-static int
-__is_member (struct mem_pool *pool, void *ptr)
-{
-        if (!pool || !ptr) {
-                gf_log_callingfn ("mem-pool", GF_LOG_ERROR, "invalid argument");
-                return -1;
+                if (!ptr)
+                        return NULL;
         }
 
-        if (ptr < pool->pool || ptr >= pool->pool_end)
-                return 0;
-
-        if ((mem_pool_ptr2chunkhead (ptr) - pool->pool)
-            % pool->padded_sizeof_type)
-                return -1;
+        in_use = (ptr + GF_MEM_POOL_LIST_BOUNDARY + GF_MEM_POOL_PTR);
+        *in_use = 1;
 
-        return 1;
+        return mem_pool_chunkhead2ptr (ptr);
 }
 
 
 void
 mem_put (void *ptr)
 {
-        struct list_head *list = NULL;
+        struct mem_magazine *mag = NULL;
         int    *in_use = NULL;
         void   *head = NULL;
-        struct mem_pool **tmp = NULL;
+        struct mem_slab **tmp = NULL;
         struct mem_pool *pool = NULL;
 
         if (!ptr) {
@@ -469,64 +804,43 @@ mem_put (void *ptr)
                 return;
         }
 
-        list = head = mem_pool_ptr2chunkhead (ptr);
-        tmp = mem_pool_from_ptr (head);
-        if (!tmp) {
+        head = mem_pool_ptr2chunkhead (ptr);
+        tmp = mem_slab_from_ptr (head);
+        if (!tmp || !*tmp) {
                 gf_log_callingfn ("mem-pool", GF_LOG_ERROR,
                                   "ptr header is corrupted");
                 return;
         }
 
-        pool = *tmp;
+        pool = (*tmp)->pool;
         if (!pool) {
                 gf_log_callingfn ("mem-pool", GF_LOG_ERROR,
                                   "mem-pool ptr is NULL");
                 return;
         }
+
+        in_use = (head + GF_MEM_POOL_LIST_BOUNDARY + GF_MEM_POOL_PTR);
+        if (!is_mem_chunk_in_use (in_use)) {
+                gf_log_callingfn ("mem-pool", GF_LOG_CRITICAL,
+                                  "mem_put called on freed ptr %p of mem "
+                                  "pool %p", ptr, pool);
+                return;
+        }
+        *in_use = 0;
+
+        mag = mem_magazine_get (pool);
+        if (mag) {
+                if (mag->rounds == mag->size)
+                        mem_magazine_drain (pool, mag, mag->size / 2);
+
+                mag->chunks[mag->rounds++] = head;
+                return;
+        }
+
         LOCK (&pool->lock);
         {
-
-                switch (__is_member (pool, ptr))
-                {
-                case 1:
-                        in_use = (head + GF_MEM_POOL_LIST_BOUNDARY +
-                                  GF_MEM_POOL_PTR);
-                        if (!is_mem_chunk_in_use(in_use)) {
-                                gf_log_callingfn ("mem-pool", GF_LOG_CRITICAL,
-                                                  "mem_put called on freed ptr %p of mem "
-                                                  "pool %p", ptr, pool);
-                                break;
-                        }
-                        pool->hot_count--;
-                        pool->cold_count++;
-                        *in_use = 0;
-                        list_add (list, &pool->list);
-                        break;
-                case -1:
-                        /* For some reason, the address given is within
-                         * the address range of the mem-pool but does not align
-                         * with the expected start of a chunk that includes
-                         * the list headers also. Sounds like a problem in
-                         * layers of clouds up above us. ;)
-                         */
-                        abort ();
-                        break;
-                case 0:
-                        /* The address is outside the range of the mem-pool. We
-                         * assume here that this address was allocated at a
-                         * point when the mem-pool was out of chunks in mem_get
-                         * or the programmer has made a mistake by calling the
-                         * wrong de-allocation interface. We do
-                         * not have enough info to distinguish between the two
-                         * situations.
-                         */
-                        pool->curr_stdalloc--;
-                        GF_FREE (list);
-                        break;
-                default:
-                        /* log error */
-                        break;
-                }
+                __mem_pool_update_counts (pool, -1);
+                __mem_pool_put_chunk (pool, head);
         }
         UNLOCK (&pool->lock);
 }
@@ -534,6 +848,11 @@ mem_put (void *ptr)
 void
 mem_pool_destroy (struct mem_pool *pool)
 {
+        struct mem_magazine *mag = NULL;
+        struct mem_magazine *tmp = NULL;
+        struct mem_slab     *slab = NULL;
+        struct mem_slab     *slab_tmp = NULL;
+
         if (!pool)
                 return;
 
@@ -542,9 +861,29 @@ mem_pool_destroy (struct mem_pool *pool)
 
         list_del (&pool->global_list);
 
+        /* The chunks cached in magazines belong to the slabs freed below,
+         * so the magazines are just emptied and left for their threads to
+         * reuse.
+         */
+        pthread_mutex_lock (&mem_pool_tls_lock);
+        {
+                list_for_each_entry_safe (mag, tmp, &pool->magazines,
+                                          pool_list) {
+                        mag->pool = NULL;
+                        mag->rounds = 0;
+                        list_del_init (&mag->pool_list);
+                }
+                mem_pool_ids[pool->id] = NULL;
+        }
+        pthread_mutex_unlock (&mem_pool_tls_lock);
+
+        list_for_each_entry_safe (slab, slab_tmp, &pool->slabs, list) {
+                list_del (&slab->list);
+                GF_FREE (slab);
+        }
+
         LOCK_DESTROY (&pool->lock);
         GF_FREE (pool->name);
-        GF_FREE (pool->pool);
         GF_FREE (pool);
 
         return;
@@ -175,22 +175,44 @@ out:
         return dup_mem;
 }
 
+/*
+ * A mem_pool hands out fixed size chunks carved out of slabs. Every thread
+ * keeps a small magazine of free chunks per pool so that mem_get/mem_put
+ * normally complete without taking any lock; magazines exchange chunks with
+ * the shared depot (@list) in batches under @lock. When the depot runs dry a
+ * new slab of @slab_count chunks is added instead of falling back to the heap,
+ * and slabs other than the first are freed again once all of their chunks
+ * are back in the depot.
+ *
+ * Counters are maintained at depot exchange time and are therefore
+ * approximate by up to one magazine per thread:
+ *   hot_count      - chunks outside the depot (in use or held in magazines)
+ *   cold_count     - chunks in the depot
+ *   pool_misses    - number of times the depot was empty and a slab was added
+ *   slabs_released - number of slabs freed again
+ *   curr_stdalloc  - chunks in use beyond the capacity of the first slab
+ */
 struct mem_pool {
         struct list_head  list;
         int               hot_count;
         int               cold_count;
         gf_lock_t         lock;
         unsigned long     padded_sizeof_type;
-        void             *pool;
-        void             *pool_end;
+        unsigned long     slab_count;
+        struct list_head  slabs;
+        int               nr_slabs;
         int               real_sizeof_type;
         uint64_t          alloc_count;
         uint64_t          pool_misses;
+        uint64_t          slabs_released;
         int               max_alloc;
         int               curr_stdalloc;
         int               max_stdalloc;
         char             *name;
         struct list_head  global_list;
+        unsigned int      id;
+        int               magazine_size;
+        struct list_head  magazines;
 };
 
 struct mem_pool *
@@ -124,6 +124,17 @@ enum gf_common_mem_types_ {
         gf_common_mt_txn_opinfo_obj_t     = 108,
 	gf_common_mt_strfd_t              = 109,
 	gf_common_mt_strfd_data_t         = 110,
+        gf_common_mt_dict_buckets_t       = 111,
+        gf_common_mt_ereg                 = 112,
+        gf_common_mt_inode_ghosts         = 113,
+        gf_common_mt_rpcclnt_savedframe_hash_t = 114,
+        gf_common_mt_drc_shard_table_t    = 115,
+        gf_common_mt_compound_args_t      = 116,
+        gf_common_mt_compound_rsp_t       = 117,
+        gf_common_mt_compound_serial_t    = 118,
+        gf_common_mt_rpcsvc_sched_t       = 119,
+        gf_common_mt_rpcsvc_sched_client_t = 120,
+        gf_common_mt_rpcsvc_sched_class_t = 121,
         gf_common_mt_end
 };
 #endif
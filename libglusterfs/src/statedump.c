@@ -15,6 +15,7 @@
 #include "statedump.h"
 #include "stack.h"
 #include "common-utils.h"
+#include "syncop.h"
 
 #ifdef HAVE_MALLOC_H
 #include <malloc.h>
@@ -333,6 +334,11 @@ gf_proc_dump_mempool_info (glusterfs_ctx_t *ctx)
 
                 gf_proc_dump_write ("pool-misses", "%"PRIu64, pool->pool_misses);
                 gf_proc_dump_write ("max-stdalloc", "%d", pool->max_stdalloc);
+                gf_proc_dump_write ("slab-count", "%d", pool->nr_slabs);
+                gf_proc_dump_write ("slabs-released", "%"PRIu64,
+                                    pool->slabs_released);
+                gf_proc_dump_write ("magazine-size", "%d",
+                                    pool->magazine_size);
         }
 }
 
@@ -762,8 +768,10 @@ gf_proc_dump_info (int signum, glusterfs_ctx_t *ctx)
 
         if (GF_PROC_DUMP_IS_OPTION_ENABLED (iobuf))
                 iobuf_stats_dump (ctx->iobuf_pool);
-        if (GF_PROC_DUMP_IS_OPTION_ENABLED (callpool))
+        if (GF_PROC_DUMP_IS_OPTION_ENABLED (callpool)) {
                 gf_proc_dump_pending_frames (ctx->pool);
+                syncenv_dump (ctx->env);
+        }
 
         if (ctx->master) {
                 gf_proc_dump_add_section ("fuse");
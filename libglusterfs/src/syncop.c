@@ -14,6 +14,9 @@
 #endif
 
 #include "syncop.h"
+#include "statedump.h"
+
+#include <sys/mman.h>
 
 int
 syncopctx_setfsuid (void *uid)
@@ -209,14 +212,165 @@ out:
 	return ret;
 }
 
+/* The processor of the calling thread, or -1 */
+static int
+syncenv_index (struct syncenv *env)
+{
+        pthread_t self = pthread_self ();
+        int       i = 0;
+
+        for (i = 0; i < env->procmax; i++) {
+                if (env->proc[i].processor &&
+                    pthread_equal (env->proc[i].processor, self))
+                        return i;
+        }
+
+        return -1;
+}
+
+
+/*
+ * Every processor has a runq of its own. A woken task goes back to the
+ * runq of the processor it last ran on, a new one to that of the processor
+ * creating it (or to the next one in turn when created by another thread),
+ * so that it mostly resumes where its stack and frames are cache hot.
+ * A processor with nothing to run takes the oldest task of the first busy
+ * runq it finds before going to sleep.
+ */
 static void
+syncenv_queue (struct syncenv *env, struct synctask *task)
+{
+        struct syncproc *proc = NULL;
+        struct syncproc *idle = NULL;
+        struct synctask *curr = NULL;
+        int              self = -1;
+        int              queued = 0;
+        int              signal = 0;
+        int              i = 0;
+
+        self = syncenv_index (env);
+        if (self >= 0)
+                curr = synctask_get ();
+
+        proc = task->proc;
+        if (!proc) {
+                i = self;
+                if (i < 0)
+                        i = (GF_ATOMIC_ADD (env->lock, env->next, 1) - 1) %
+                                env->procmax;
+                proc = &env->proc[i];
+        }
+
+        for (i = 0; !queued; i++) {
+                pthread_mutex_lock (&proc->lock);
+                {
+                        /* a processor which exited has an empty runq and
+                           must keep it so, unless none is left */
+                        if (proc->processor || i >= env->procmax) {
+                                list_add_tail (&task->all_tasks, &proc->runq);
+                                if (++proc->runcount > proc->runmax)
+                                        proc->runmax = proc->runcount;
+                                GF_ATOMIC_ADD (env->lock, env->runcount, 1);
+                                queued = 1;
+
+                                /* a task woken by another task keeps
+                                   waiting for the waker to yield, which
+                                   may take long, unless someone idle
+                                   steals it */
+                                if (proc->sleeping)
+                                        pthread_cond_signal (&proc->cond);
+                                else if (proc->runcount > 1 ||
+                                         self != (proc - env->proc) ||
+                                         (curr && curr != task))
+                                        signal = 1;
+                        }
+                }
+                pthread_mutex_unlock (&proc->lock);
+
+                if (!queued)
+                        proc = &env->proc[(proc - env->proc + 1) %
+                                          env->procmax];
+        }
+
+        if (!signal)
+                return;
+
+        /* the processor is busy, let an idle one steal the task */
+        for (i = 0; i < env->procmax; i++) {
+                idle = &env->proc[i];
+                if (idle == proc || !idle->sleeping)
+                        continue;
+
+                pthread_mutex_lock (&idle->lock);
+                {
+                        if (idle->sleeping)
+                                pthread_cond_signal (&idle->cond);
+                }
+                pthread_mutex_unlock (&idle->lock);
+                break;
+        }
+}
+
+
+/* Take the oldest task off the runq of @proc */
+static struct synctask *
+syncenv_dequeue (struct syncproc *proc, gf_boolean_t steal)
+{
+        struct synctask *task = NULL;
+
+        pthread_mutex_lock (&proc->lock);
+        {
+                if (!list_empty (&proc->runq)) {
+                        task = list_entry (proc->runq.next, struct synctask,
+                                           all_tasks);
+                        list_del_init (&task->all_tasks);
+                        proc->runcount--;
+                        GF_ATOMIC_SUB (proc->env->lock, proc->env->runcount,
+                                       1);
+                        if (steal)
+                                proc->stolen++;
+                }
+        }
+        pthread_mutex_unlock (&proc->lock);
+
+        return task;
+}
+
+
+static struct synctask *
+syncenv_steal (struct syncproc *proc)
+{
+        struct syncenv  *env = NULL;
+        struct syncproc *victim = NULL;
+        struct synctask *task = NULL;
+        int              i = 0;
+
+        env = proc->env;
+
+        for (i = 1; env->runcount && i < env->procmax; i++) {
+                victim = &env->proc[((proc - env->proc) + i) % env->procmax];
+                if (!victim->runcount)
+                        continue;
+
+                task = syncenv_dequeue (victim, _gf_true);
+                if (task) {
+                        proc->steals++;
+                        break;
+                }
+        }
+
+        return task;
+}
+
+
+/* Called with task->lock held, returns 1 if @task has to be queued */
+static int
 __run (struct synctask *task)
 {
         struct syncenv *env = NULL;
 
         env = task->env;
 
-        list_del_init (&task->all_tasks);
         switch (task->state) {
         case SYNCTASK_INIT:
         case SYNCTASK_SUSPEND:
@@ -224,27 +378,27 @@ __run (struct synctask *task)
         case SYNCTASK_RUN:
                 gf_log (task->xl->name, GF_LOG_DEBUG,
                         "re-running already running task");
-                env->runcount--;
-                break;
+                return 0;
         case SYNCTASK_WAIT:
-                env->waitcount--;
+                GF_ATOMIC_SUB (env->lock, env->waitcount, 1);
                 break;
         case SYNCTASK_DONE:
                 gf_log (task->xl->name, GF_LOG_WARNING,
                         "running completed task");
-		return;
+		return 0;
 	case SYNCTASK_ZOMBIE:
 		gf_log (task->xl->name, GF_LOG_WARNING,
 			"attempted to wake up zombie!!");
-		return;
+		return 0;
         }
 
-        list_add_tail (&task->all_tasks, &env->runq);
-        env->runcount++;
         task->state = SYNCTASK_RUN;
+
+        return 1;
 }
 
 
+/* Called with task->lock held */
 static void
 __wait (struct synctask *task)
 {
@@ -252,19 +406,15 @@ __wait (struct synctask *task)
 
         env = task->env;
 
-        list_del_init (&task->all_tasks);
         switch (task->state) {
         case SYNCTASK_INIT:
         case SYNCTASK_SUSPEND:
-                break;
         case SYNCTASK_RUN:
-                env->runcount--;
                 break;
         case SYNCTASK_WAIT:
                 gf_log (task->xl->name, GF_LOG_WARNING,
                         "re-waiting already waiting task");
-                env->waitcount--;
-                break;
+                return;
         case SYNCTASK_DONE:
                 gf_log (task->xl->name, GF_LOG_WARNING,
                         "running completed task");
@@ -275,8 +425,7 @@ __wait (struct synctask *task)
 		return;
         }
 
-        list_add_tail (&task->all_tasks, &env->waitq);
-        env->waitcount++;
+        GF_ATOMIC_ADD (env->lock, env->waitcount, 1);
         task->state = SYNCTASK_WAIT;
 }
 
@@ -305,20 +454,22 @@ synctask_yield (struct synctask *task)
 void
 synctask_wake (struct synctask *task)
 {
-        struct syncenv *env = NULL;
+        int queue = 0;
 
-        env = task->env;
-
-        pthread_mutex_lock (&env->mutex);
+        LOCK (&task->lock);
         {
                 task->woken = 1;
 
-                if (task->slept)
-                        __run (task);
-
-		pthread_cond_broadcast (&env->cond);
+                if (task->slept) {
+                        queue = __run (task);
+                        if (queue)
+                                task->slept = 0;
+                }
         }
-        pthread_mutex_unlock (&env->mutex);
+        UNLOCK (&task->lock);
+
+        if (queue)
+                syncenv_queue (task->env, task);
 }
 
 void
@@ -340,13 +491,87 @@ synctask_wrap (struct synctask *old_task)
 }
 
 
+/*
+ * Stacks are mapped with a guard page below them, so that an overflow
+ * faults instead of silently corrupting another stack or the heap. Those
+ * of finished tasks are kept for the next ones, which saves the mapping
+ * and the page faults of a fresh stack for every short task. The cache is
+ * linked through the top word of every stack, which a task always touches.
+ */
+#define SYNCENV_STACK_LINK(env, stack)                                  \
+        (*(void **) ((char *) (stack) + (env)->stacksize - sizeof (void *)))
+
+static void *
+syncenv_stack_get (struct syncenv *env)
+{
+        void *stack = NULL;
+        char *base = NULL;
+
+        pthread_mutex_lock (&env->stack_lock);
+        {
+                stack = env->stack_cache;
+                if (stack) {
+                        env->stack_cache = SYNCENV_STACK_LINK (env, stack);
+                        env->stacks_cached--;
+                }
+                env->stacks_inuse++;
+        }
+        pthread_mutex_unlock (&env->stack_lock);
+
+        if (stack)
+                return stack;
+
+        base = mmap (NULL, env->guardsize + env->stacksize,
+                     PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                     -1, 0);
+        if (base == MAP_FAILED) {
+                pthread_mutex_lock (&env->stack_lock);
+                {
+                        env->stacks_inuse--;
+                }
+                pthread_mutex_unlock (&env->stack_lock);
+                return NULL;
+        }
+
+        if (mprotect (base, env->guardsize, PROT_NONE) != 0)
+                gf_log ("syncop", GF_LOG_DEBUG, "could not protect the "
+                        "guard page of a stack (%s)", strerror (errno));
+
+        return base + env->guardsize;
+}
+
+
+static void
+syncenv_stack_put (struct syncenv *env, void *stack)
+{
+        if (!stack)
+                return;
+
+        pthread_mutex_lock (&env->stack_lock);
+        {
+                env->stacks_inuse--;
+                if (env->stacks_cached < SYNCENV_STACK_CACHE_MAX) {
+                        SYNCENV_STACK_LINK (env, stack) = env->stack_cache;
+                        env->stack_cache = stack;
+                        env->stacks_cached++;
+                        stack = NULL;
+                }
+        }
+        pthread_mutex_unlock (&env->stack_lock);
+
+        if (stack)
+                munmap ((char *) stack - env->guardsize,
+                        env->guardsize + env->stacksize);
+}
+
+
 void
 synctask_destroy (struct synctask *task)
 {
         if (!task)
                 return;
 
-        FREE (task->stack);
+        syncenv_stack_put (task->env, task->stack);
 
         if (task->opframe)
                 STACK_DESTROY (task->opframe->root);
@@ -356,6 +581,8 @@ synctask_destroy (struct synctask *task)
                pthread_cond_destroy (&task->cond);
         }
 
+        LOCK_DESTROY (&task->lock);
+
         FREE (task);
 }
 
@@ -428,6 +655,7 @@ synctask_create (struct syncenv *env, synctask_fn_t fn, synctask_cbk_t cbk,
 
         INIT_LIST_HEAD (&newtask->all_tasks);
         INIT_LIST_HEAD (&newtask->waitq);
+        LOCK_INIT (&newtask->lock);
 
         if (getcontext (&newtask->ctx) < 0) {
                 gf_log ("syncop", GF_LOG_ERROR,
@@ -436,7 +664,7 @@ synctask_create (struct syncenv *env, synctask_fn_t fn, synctask_cbk_t cbk,
                 goto err;
         }
 
-        newtask->stack = CALLOC (1, env->stacksize);
+        newtask->stack = syncenv_stack_get (env);
         if (!newtask->stack) {
                 gf_log ("syncop", GF_LOG_ERROR,
                         "out of memory for stack");
@@ -468,7 +696,7 @@ synctask_create (struct syncenv *env, synctask_fn_t fn, synctask_cbk_t cbk,
 	return newtask;
 err:
         if (newtask) {
-                FREE (newtask->stack);
+                syncenv_stack_put (env, newtask->stack);
                 if (newtask->opframe)
                         STACK_DESTROY (newtask->opframe->root);
                 FREE (newtask);
@@ -516,45 +744,97 @@ synctask_new (struct syncenv *env, synctask_fn_t fn, synctask_cbk_t cbk,
 }
 
 
+/* Stop @proc if it has been idle long enough and is not needed */
+static gf_boolean_t
+syncenv_proc_exit (struct syncproc *proc)
+{
+        struct syncenv *env = NULL;
+        gf_boolean_t    exited = _gf_false;
+
+        env = proc->env;
+
+        pthread_mutex_lock (&env->mutex);
+        {
+                if (env->procs <= env->procmin)
+                        goto unlock;
+
+                pthread_mutex_lock (&proc->lock);
+                {
+                        if (list_empty (&proc->runq)) {
+                                proc->processor = 0;
+                                exited = _gf_true;
+                        }
+                }
+                pthread_mutex_unlock (&proc->lock);
+
+                if (exited)
+                        env->procs--;
+        }
+unlock:
+        pthread_mutex_unlock (&env->mutex);
+
+        return exited;
+}
+
+
 struct synctask *
 syncenv_task (struct syncproc *proc)
 {
         struct syncenv   *env = NULL;
         struct synctask  *task = NULL;
         struct timespec   sleep_till = {0, };
+        int               runcount = 0;
         int               ret = 0;
 
         env = proc->env;
 
-        pthread_mutex_lock (&env->mutex);
-        {
-                while (list_empty (&env->runq)) {
-                        sleep_till.tv_sec = time (NULL) + SYNCPROC_IDLE_TIME;
-                        ret = pthread_cond_timedwait (&env->cond, &env->mutex,
-                                                      &sleep_till);
-                        if (!list_empty (&env->runq))
-                                break;
-                        if ((ret == ETIMEDOUT) &&
-                            (env->procs > env->procmin)) {
-                                task = NULL;
-                                env->procs--;
-                                memset (proc, 0, sizeof (*proc));
-                                goto unlock;
+        for (;;) {
+                task = syncenv_dequeue (proc, _gf_false);
+                if (task)
+                        break;
+
+                task = syncenv_steal (proc);
+                if (task)
+                        break;
+
+                pthread_mutex_lock (&proc->lock);
+                {
+                        proc->sleeping = 1;
+                        /* pairs with the wakeup in syncenv_queue() */
+#ifdef GF_HAVE_ATOMIC_BUILTINS
+                        __sync_synchronize ();
+                        runcount = env->runcount;
+#else
+                        LOCK (&env->lock);
+                        runcount = env->runcount;
+                        UNLOCK (&env->lock);
+#endif
+
+                        if (list_empty (&proc->runq) && !runcount) {
+                                sleep_till.tv_sec = time (NULL) +
+                                        SYNCPROC_IDLE_TIME;
+                                ret = pthread_cond_timedwait (&proc->cond,
+                                                              &proc->lock,
+                                                              &sleep_till);
                         }
-                }
 
-                task = list_entry (env->runq.next, struct synctask, all_tasks);
+                        proc->sleeping = 0;
+                }
+                pthread_mutex_unlock (&proc->lock);
 
-                list_del_init (&task->all_tasks);
-                env->runcount--;
+                if ((ret == ETIMEDOUT) && syncenv_proc_exit (proc))
+                        return NULL;
+                ret = 0;
+        }
 
+        LOCK (&task->lock);
+        {
                 task->woken = 0;
                 task->slept = 0;
 
                 task->proc = proc;
         }
-unlock:
-        pthread_mutex_unlock (&env->mutex);
+        UNLOCK (&task->lock);
 
         return task;
 }
@@ -564,6 +844,7 @@ void
 synctask_switchto (struct synctask *task)
 {
         struct syncenv *env = NULL;
+        int             queue = 0;
 
         env = task->env;
 
@@ -585,16 +866,19 @@ synctask_switchto (struct synctask *task)
                 return;
         }
 
-        pthread_mutex_lock (&env->mutex);
+        LOCK (&task->lock);
         {
                 if (task->woken) {
-                        __run (task);
+                        queue = __run (task);
                 } else {
                         task->slept = 1;
                         __wait (task);
                 }
         }
-        pthread_mutex_unlock (&env->mutex);
+        UNLOCK (&task->lock);
+
+        if (queue)
+                syncenv_queue (env, task);
 }
 
 void *
@@ -612,6 +896,7 @@ syncenv_processor (void *thdata)
                 if (!task)
                         break;
 
+                proc->runs++;
                 synctask_switchto (task);
 
                 syncenv_scale (env);
@@ -629,6 +914,10 @@ syncenv_scale (struct syncenv *env)
         int  i = 0;
         int  ret = 0;
 
+        /* mostly there are enough processors, do not take the lock */
+        if (env->procs > env->runcount)
+                return;
+
         pthread_mutex_lock (&env->mutex);
         {
                 if (env->procs > env->runcount)
@@ -646,7 +935,6 @@ syncenv_scale (struct syncenv *env)
                                         break;
                         }
 
-                        env->proc[i].env = env;
                         ret = gf_thread_create (&env->proc[i].processor, NULL,
 						syncenv_processor, &env->proc[i]);
                         if (ret)
@@ -667,6 +955,59 @@ syncenv_destroy (struct syncenv *env)
 }
 
 
+void
+syncenv_dump (struct syncenv *env)
+{
+        struct syncproc *proc = NULL;
+        char             key[GF_DUMP_MAX_BUF_LEN];
+        int              i = 0;
+
+        if (!env)
+                return;
+
+        gf_proc_dump_add_section ("syncenv");
+        gf_proc_dump_write ("procs", "%d", env->procs);
+        gf_proc_dump_write ("procmin", "%d", env->procmin);
+        gf_proc_dump_write ("procmax", "%d", env->procmax);
+        gf_proc_dump_write ("runcount", "%d", env->runcount);
+        gf_proc_dump_write ("waitcount", "%d", env->waitcount);
+        gf_proc_dump_write ("stacksize", "%zu", env->stacksize);
+        gf_proc_dump_write ("stacks_inuse", "%d", env->stacks_inuse);
+        gf_proc_dump_write ("stacks_cached", "%d", env->stacks_cached);
+
+        for (i = 0; i < env->procmax; i++) {
+                proc = &env->proc[i];
+
+                pthread_mutex_lock (&proc->lock);
+                {
+                        if (!proc->processor && !proc->runs)
+                                goto unlock;
+
+                        gf_proc_dump_build_key (key, "syncproc", "%d.running",
+                                                i);
+                        gf_proc_dump_write (key, "%d", !!proc->processor);
+                        gf_proc_dump_build_key (key, "syncproc",
+                                                "%d.runq_depth", i);
+                        gf_proc_dump_write (key, "%d", proc->runcount);
+                        gf_proc_dump_build_key (key, "syncproc",
+                                                "%d.runq_max", i);
+                        gf_proc_dump_write (key, "%d", proc->runmax);
+                        gf_proc_dump_build_key (key, "syncproc", "%d.runs",
+                                                i);
+                        gf_proc_dump_write (key, "%"PRIu64, proc->runs);
+                        gf_proc_dump_build_key (key, "syncproc", "%d.steals",
+                                                i);
+                        gf_proc_dump_write (key, "%"PRIu64, proc->steals);
+                        gf_proc_dump_build_key (key, "syncproc", "%d.stolen",
+                                                i);
+                        gf_proc_dump_write (key, "%"PRIu64, proc->stolen);
+                }
+unlock:
+                pthread_mutex_unlock (&proc->lock);
+        }
+}
+
+
 struct syncenv *
 syncenv_new (size_t stacksize, int procmin, int procmax)
 {
@@ -688,19 +1029,28 @@ syncenv_new (size_t stacksize, int procmin, int procmax)
                 return NULL;
 
         pthread_mutex_init (&newenv->mutex, NULL);
-        pthread_cond_init (&newenv->cond, NULL);
 
-        INIT_LIST_HEAD (&newenv->runq);
-        INIT_LIST_HEAD (&newenv->waitq);
+        pthread_mutex_init (&newenv->stack_lock, NULL);
+
+        LOCK_INIT (&newenv->lock);
 
         newenv->stacksize    = SYNCENV_DEFAULT_STACKSIZE;
         if (stacksize)
                 newenv->stacksize = stacksize;
+        newenv->guardsize = sysconf (_SC_PAGESIZE);
+        newenv->stacksize = (newenv->stacksize + newenv->guardsize - 1) &
+                ~(newenv->guardsize - 1);
 	newenv->procmin = procmin;
 	newenv->procmax = procmax;
 
-        for (i = 0; i < newenv->procmin; i++) {
+        for (i = 0; i < newenv->procmax; i++) {
                 newenv->proc[i].env = newenv;
+                pthread_mutex_init (&newenv->proc[i].lock, NULL);
+                pthread_cond_init (&newenv->proc[i].cond, NULL);
+                INIT_LIST_HEAD (&newenv->proc[i].runq);
+        }
+
+        for (i = 0; i < newenv->procmin; i++) {
                 ret = gf_thread_create (&newenv->proc[i].processor, NULL,
 					syncenv_processor, &newenv->proc[i]);
                 if (ret)
@@ -64,6 +64,7 @@ struct synctask {
         synctask_state_t    state;
         void               *opaque;
         void               *stack;
+        gf_lock_t           lock;  /* woken, slept and state */
         int                 woken;
         int                 slept;
         int                 ret;
@@ -87,6 +88,17 @@ struct syncproc {
         ucontext_t          sched;
         struct syncenv     *env;
         struct synctask    *current;
+
+        /* tasks woken on this processor, others may steal from it */
+        pthread_mutex_t     lock;
+        pthread_cond_t      cond;  /* idle processor, pair @lock */
+        struct list_head    runq;
+        int                 runcount;
+        int                 runmax;
+        int                 sleeping;
+        uint64_t            runs;
+        uint64_t            steals;   /* tasks taken from other runqs */
+        uint64_t            stolen;   /* tasks others took from this one */
 };
 
 /* hosts the scheduler thread and framework for executing synctasks */
@@ -94,18 +106,22 @@ struct syncenv {
         struct syncproc     proc[SYNCENV_PROC_MAX];
         int                 procs;
 
-        struct list_head    runq;
-        int                 runcount;
-        struct list_head    waitq;
+        int                 runcount;  /* on all the runqs */
         int                 waitcount;
+        unsigned int        next;      /* for tasks woken by other threads */
+        gf_lock_t           lock;      /* the counters, without atomics */
 
 	int                 procmin;
 	int                 procmax;
 
-        pthread_mutex_t     mutex;
-        pthread_cond_t      cond;
+        pthread_mutex_t     mutex;     /* starting and stopping processors */
 
         size_t              stacksize;
+        size_t              guardsize;  /* inaccessible, below each stack */
+        pthread_mutex_t     stack_lock;
+        void               *stack_cache;  /* stacks of finished tasks */
+        int                 stacks_cached;
+        int                 stacks_inuse;
 };
 
 
@@ -239,10 +255,12 @@ struct syncopctx {
 
 
 #define SYNCENV_DEFAULT_STACKSIZE (2 * 1024 * 1024)
+#define SYNCENV_STACK_CACHE_MAX 64
 
 struct syncenv * syncenv_new (size_t stacksize, int procmin, int procmax);
 void syncenv_destroy (struct syncenv *);
 void syncenv_scale (struct syncenv *env);
+void syncenv_dump (struct syncenv *env);
 
 int synctask_new (struct syncenv *, synctask_fn_t, synctask_cbk_t, call_frame_t* frame, void *);
 struct synctask *synctask_create (struct syncenv *, synctask_fn_t,
@@ -19,6 +19,150 @@
 #include "globals.h"
 #include "timespec.h"
 
+#define GF_TIMER_TICK_NS   (GF_TIMER_TICK_MS * 1000000ULL)
+#define GF_TIMER_ROOT_MASK (GF_TIMER_ROOT_SIZE - 1)
+#define GF_TIMER_VEC_MASK  (GF_TIMER_VEC_SIZE - 1)
+#define GF_TIMER_MAX_TICKS ((1ULL << (GF_TIMER_ROOT_BITS +               \
+                                      GF_TIMER_VEC_LEVELS *              \
+                                      GF_TIMER_VEC_BITS)) - 1)
+
+/* longest sleep of gf_timer_proc, so that 'fin' is noticed */
+#define GF_TIMER_IDLE_TICKS (1000 / GF_TIMER_TICK_MS)
+
+static int
+__gf_timer_vec_index (uint64_t jiffies, int level)
+{
+        return (jiffies >> (GF_TIMER_ROOT_BITS + level * GF_TIMER_VEC_BITS))
+                & GF_TIMER_VEC_MASK;
+}
+
+/* Expiry times are rounded up and the current time down, so that a timer
+   never fires early. */
+static uint64_t
+gf_timer_ticks (gf_timer_registry_t *reg, struct timespec *ts,
+                gf_boolean_t round_up)
+{
+        uint64_t ns = TS ((*ts));
+
+        if (ns <= reg->base)
+                return 0;
+
+        ns -= reg->base;
+        if (round_up)
+                ns += GF_TIMER_TICK_NS - 1;
+
+        return ns / GF_TIMER_TICK_NS;
+}
+
+static void
+__gf_timer_add (gf_timer_registry_t *reg, gf_timer_t *event)
+{
+        struct list_head *slot = NULL;
+        uint64_t          expires = event->expires;
+        uint64_t          delta = 0;
+        int               level = 0;
+
+        if (expires < reg->jiffies) {
+                /* already due, run it on the next tick */
+                slot = &reg->root[reg->jiffies & GF_TIMER_ROOT_MASK];
+                goto add;
+        }
+
+        delta = expires - reg->jiffies;
+        if (delta < GF_TIMER_ROOT_SIZE) {
+                slot = &reg->root[expires & GF_TIMER_ROOT_MASK];
+                goto add;
+        }
+
+        if (delta > GF_TIMER_MAX_TICKS) {
+                /* park it in the last slot reachable, it gets re-filed
+                   when that slot is cascaded */
+                delta = GF_TIMER_MAX_TICKS;
+                expires = reg->jiffies + delta;
+        }
+
+        for (level = 0; level < GF_TIMER_VEC_LEVELS - 1; level++) {
+                if (delta < (1ULL << (GF_TIMER_ROOT_BITS +
+                                      (level + 1) * GF_TIMER_VEC_BITS)))
+                        break;
+        }
+        slot = &reg->vec[level][__gf_timer_vec_index (expires, level)];
+add:
+        list_add_tail (&event->list, slot);
+}
+
+static int
+__gf_timer_cascade (gf_timer_registry_t *reg, int level, int index)
+{
+        gf_timer_t       *event = NULL;
+        gf_timer_t       *tmp = NULL;
+        struct list_head  head;
+
+        INIT_LIST_HEAD (&head);
+        list_splice_init (&reg->vec[level][index], &head);
+
+        list_for_each_entry_safe (event, tmp, &head, list) {
+                list_del_init (&event->list);
+                __gf_timer_add (reg, event);
+        }
+
+        return index;
+}
+
+/* Move every timer due up to and including tick 'now' to reg->expired. */
+static void
+__gf_timer_advance (gf_timer_registry_t *reg, uint64_t now)
+{
+        gf_timer_t *event = NULL;
+        gf_timer_t *tmp = NULL;
+        int         index = 0;
+        int         level = 0;
+
+        while (reg->jiffies <= now) {
+                if (!reg->armed) {
+                        /* nothing in the wheel, skip ahead */
+                        reg->jiffies = now + 1;
+                        break;
+                }
+
+                index = reg->jiffies & GF_TIMER_ROOT_MASK;
+                for (level = 0; !index && level < GF_TIMER_VEC_LEVELS;
+                     level++)
+                        index = __gf_timer_cascade (reg, level,
+                                        __gf_timer_vec_index (reg->jiffies,
+                                                              level));
+                index = reg->jiffies & GF_TIMER_ROOT_MASK;
+                reg->jiffies++;
+
+                list_for_each_entry_safe (event, tmp, &reg->root[index],
+                                          list) {
+                        list_move_tail (&event->list, &reg->expired);
+                        event->state = GF_TIMER_EXPIRED;
+                        reg->armed--;
+                }
+        }
+}
+
+/* Tick at which something may next be due: the next non-empty root slot,
+   or the next cascade, whichever comes first. */
+static uint64_t
+__gf_timer_next (gf_timer_registry_t *reg)
+{
+        uint64_t tick = reg->jiffies;
+        uint64_t limit = 0;
+
+        if (!reg->armed)
+                return reg->jiffies + GF_TIMER_IDLE_TICKS;
+
+        limit = (reg->jiffies | GF_TIMER_ROOT_MASK) + 1;
+        for (; tick < limit; tick++) {
+                if (!list_empty (&reg->root[tick & GF_TIMER_ROOT_MASK]))
+                        break;
+        }
+
+        return min (tick, reg->jiffies + GF_TIMER_IDLE_TICKS);
+}
+
 gf_timer_t *
 gf_timer_call_after (glusterfs_ctx_t *ctx,
                      struct timespec delta,
@@ -27,8 +171,6 @@ gf_timer_call_after (glusterfs_ctx_t *ctx,
 {
         gf_timer_registry_t *reg = NULL;
         gf_timer_t *event = NULL;
-        gf_timer_t *trav = NULL;
-        uint64_t at = 0;
 
         if (ctx == NULL)
         {
@@ -43,33 +185,28 @@ gf_timer_call_after (glusterfs_ctx_t *ctx,
                 return NULL;
         }
 
-        event = GF_CALLOC (1, sizeof (*event), gf_common_mt_gf_timer_t);
+        event = mem_get0 (reg->pool);
         if (!event) {
                 return NULL;
         }
+        INIT_LIST_HEAD (&event->list);
         timespec_now (&event->at);
         timespec_adjust_delta (&event->at, delta);
-        at = TS (event->at);
+        event->expires = gf_timer_ticks (reg, &event->at, _gf_true);
         event->callbk = callbk;
         event->data = data;
         event->xl = THIS;
         pthread_mutex_lock (&reg->lock);
         {
-                trav = reg->active.prev;
-                while (trav != &reg->active) {
-                        if (TS (trav->at) < at)
-                                break;
-                        trav = trav->prev;
-                }
-                event->prev = trav;
-                event->next = event->prev->next;
-                event->prev->next = event;
-                event->next->prev = event;
+                event->state = GF_TIMER_ARMED;
+                __gf_timer_add (reg, event);
+                reg->armed++;
+                if (event->expires < reg->wakeup)
+                        pthread_cond_signal (&reg->cond);
         }
         pthread_mutex_unlock (&reg->lock);
         return event;
 }
-
 int32_t
 gf_timer_call_stale (gf_timer_registry_t *reg,
                      gf_timer_t *event)
@@ -80,12 +217,8 @@ gf_timer_call_stale (gf_timer_registry_t *reg,
                 return 0;
         }
 
-        event->next->prev = event->prev;
-        event->prev->next = event->next;
-        event->next = &reg->stale;
-        event->prev = event->next->prev;
-        event->next->prev = event;
-        event->prev->next = event;
+        list_move_tail (&event->list, &reg->stale);
+        event->state = GF_TIMER_STALE;
 
         return 0;
 }
@@ -105,26 +238,56 @@ gf_timer_call_cancel (glusterfs_ctx_t *ctx,
         reg = gf_timer_registry_init (ctx);
         if (!reg) {
                 gf_log ("timer", GF_LOG_ERROR, "!reg");
-                GF_FREE (event);
+                mem_put (event);
                 return 0;
         }
 
         pthread_mutex_lock (&reg->lock);
         {
-                event->next->prev = event->prev;
-                event->prev->next = event->next;
+                list_del_init (&event->list);
+                if (event->state == GF_TIMER_ARMED)
+                        reg->armed--;
         }
         pthread_mutex_unlock (&reg->lock);
 
-        GF_FREE (event);
+        mem_put (event);
         return 0;
 }
 
+static void
+__gf_timer_free_list (struct list_head *head)
+{
+        gf_timer_t *event = NULL;
+        gf_timer_t *tmp = NULL;
+
+        list_for_each_entry_safe (event, tmp, head, list) {
+                list_del_init (&event->list);
+                mem_put (event);
+        }
+}
+
+static void
+__gf_timer_wait (gf_timer_registry_t *reg, uint64_t tick)
+{
+        struct timespec deadline = {0, };
+        uint64_t        ns = reg->base + tick * GF_TIMER_TICK_NS;
+
+        deadline.tv_sec = ns / 1000000000ULL;
+        deadline.tv_nsec = ns % 1000000000ULL;
+
+        reg->wakeup = tick;
+        pthread_cond_timedwait (&reg->cond, &reg->lock, &deadline);
+        reg->wakeup = 0;
+}
+
 void *
 gf_timer_proc (void *ctx)
 {
         gf_timer_registry_t *reg = NULL;
-        const struct timespec sleepts = {.tv_sec = 1, .tv_nsec = 0, };
+        gf_timer_t          *event = NULL;
+        struct timespec      now_ts = {0, };
+        int                  i = 0;
+        int                  j = 0;
 
         if (ctx == NULL)
         {
@@ -139,49 +302,61 @@ gf_timer_proc (void *ctx)
         }
 
         while (!reg->fin) {
-                uint64_t now;
-                struct timespec now_ts;
-                gf_timer_t *event = NULL;
-
+                /* collect everything that is due in one go ... */
                 timespec_now (&now_ts);
-                now = TS (now_ts);
+                pthread_mutex_lock (&reg->lock);
+                {
+                        __gf_timer_advance (reg, gf_timer_ticks (reg, &now_ts,
+                                                                 _gf_false));
+                }
+                pthread_mutex_unlock (&reg->lock);
+
+                /* ... and run it. The lock is dropped around each callback
+                   since callbacks arm and cancel timers themselves. */
                 while (1) {
-                        uint64_t at;
-                        char need_cbk = 0;
+                        event = NULL;
 
                         pthread_mutex_lock (&reg->lock);
                         {
-                                event = reg->active.next;
-                                at = TS (event->at);
-                                if (event != &reg->active && now >= at) {
-                                        need_cbk = 1;
+                                if (!list_empty (&reg->expired)) {
+                                        event = list_entry (reg->expired.next,
+                                                            gf_timer_t, list);
                                         gf_timer_call_stale (reg, event);
                                 }
                         }
                         pthread_mutex_unlock (&reg->lock);
+
+                        if (!event)
+                                break;
+
                         if (event->xl)
                                 THIS = event->xl;
-                        if (need_cbk)
-                                event->callbk  (event->data);
+                        event->callbk (event->data);
+                }
 
-                        else
-                                break;
+                pthread_mutex_lock (&reg->lock);
+                {
+                        if (list_empty (&reg->expired) && !reg->fin)
+                                __gf_timer_wait (reg, __gf_timer_next (reg));
                 }
-                nanosleep (&sleepts, NULL);
+                pthread_mutex_unlock (&reg->lock);
         }
 
         pthread_mutex_lock (&reg->lock);
         {
-                while (reg->active.next != &reg->active) {
-                        gf_timer_call_cancel (ctx, reg->active.next);
-                }
-
-                while (reg->stale.next != &reg->stale) {
-                        gf_timer_call_cancel (ctx, reg->stale.next);
-                }
+                for (i = 0; i < GF_TIMER_ROOT_SIZE; i++)
+                        __gf_timer_free_list (&reg->root[i]);
+                for (i = 0; i < GF_TIMER_VEC_LEVELS; i++)
+                        for (j = 0; j < GF_TIMER_VEC_SIZE; j++)
+                                __gf_timer_free_list (&reg->vec[i][j]);
+                __gf_timer_free_list (&reg->expired);
+                __gf_timer_free_list (&reg->stale);
+                reg->armed = 0;
         }
         pthread_mutex_unlock (&reg->lock);
         pthread_mutex_destroy (&reg->lock);
+        pthread_cond_destroy (&reg->cond);
+        mem_pool_destroy (reg->pool);
         GF_FREE (((glusterfs_ctx_t *)ctx)->timer);
 
         return NULL;
@@ -190,6 +365,11 @@ gf_timer_proc (void *ctx)
 gf_timer_registry_t *
 gf_timer_registry_init (glusterfs_ctx_t *ctx)
 {
+        struct timespec    now = {0, };
+        pthread_condattr_t attr;
+        int                i = 0;
+        int                j = 0;
+
         if (ctx == NULL) {
                 gf_log_callingfn ("timer", GF_LOG_ERROR, "invalid argument");
                 return NULL;
@@ -203,11 +383,29 @@ gf_timer_registry_init (glusterfs_ctx_t *ctx)
                 if (!reg)
                         goto out;
 
+                reg->pool = mem_pool_new (gf_timer_t, 1024);
+                if (!reg->pool) {
+                        GF_FREE (reg);
+                        goto out;
+                }
+
                 pthread_mutex_init (&reg->lock, NULL);
-                reg->active.next = &reg->active;
-                reg->active.prev = &reg->active;
-                reg->stale.next = &reg->stale;
-                reg->stale.prev = &reg->stale;
+                /* deadlines are computed from timespec_now() */
+                pthread_condattr_init (&attr);
+                pthread_condattr_setclock (&attr, CLOCK_MONOTONIC);
+                pthread_cond_init (&reg->cond, &attr);
+                pthread_condattr_destroy (&attr);
+
+                INIT_LIST_HEAD (&reg->expired);
+                INIT_LIST_HEAD (&reg->stale);
+                for (i = 0; i < GF_TIMER_ROOT_SIZE; i++)
+                        INIT_LIST_HEAD (&reg->root[i]);
+                for (i = 0; i < GF_TIMER_VEC_LEVELS; i++)
+                        for (j = 0; j < GF_TIMER_VEC_SIZE; j++)
+                                INIT_LIST_HEAD (&reg->vec[i][j]);
+
+                timespec_now (&now);
+                reg->base = TS (now);
 
                 ctx->timer = reg;
                 gf_thread_create (&reg->th, NULL, gf_timer_proc, ctx);
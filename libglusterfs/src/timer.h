@@ -23,20 +23,51 @@
 
 typedef void (*gf_timer_cbk_t) (void *);
 
+/*
+ * Timers are kept in a hierarchical timing wheel. Time is counted in ticks
+ * of GF_TIMER_TICK_MS since the registry was created. The root level has
+ * one slot per tick for the next GF_TIMER_ROOT_SIZE ticks; each following
+ * level covers GF_TIMER_VEC_SIZE times the span of the previous one and
+ * is cascaded into the lower levels as the wheel turns. Arming and
+ * cancelling a timer is a list insert/delete in one slot.
+ */
+#define GF_TIMER_TICK_MS    10
+#define GF_TIMER_ROOT_BITS  8
+#define GF_TIMER_VEC_BITS   6
+#define GF_TIMER_ROOT_SIZE  (1 << GF_TIMER_ROOT_BITS)
+#define GF_TIMER_VEC_SIZE   (1 << GF_TIMER_VEC_BITS)
+#define GF_TIMER_VEC_LEVELS 4
+
+typedef enum {
+        GF_TIMER_ARMED,   /* waiting in a wheel slot */
+        GF_TIMER_EXPIRED, /* due, waiting for gf_timer_proc to run it */
+        GF_TIMER_STALE,   /* callback has been run */
+} gf_timer_state_t;
+
 struct _gf_timer {
-        struct _gf_timer *next, *prev;
-        struct timespec    at;
+        struct list_head  list;
+        struct timespec   at;
+        uint64_t          expires; /* in ticks */
+        gf_timer_state_t  state;
         gf_timer_cbk_t    callbk;
         void             *data;
         xlator_t         *xl;
 };
 
 struct _gf_timer_registry {
-        pthread_t        th;
-        char             fin;
-        struct _gf_timer stale;
-        struct _gf_timer active;
-        pthread_mutex_t  lock;
+        pthread_t         th;
+        char              fin;
+        pthread_mutex_t   lock;
+        pthread_cond_t    cond;
+        struct mem_pool  *pool;
+        uint64_t          base;        /* monotonic ns of tick 0 */
+        uint64_t          jiffies;     /* next tick to be processed */
+        uint64_t          wakeup;      /* tick gf_timer_proc sleeps until */
+        uint64_t          armed;       /* timers sitting in the wheel */
+        struct list_head  expired;
+        struct list_head  stale;
+        struct list_head  root[GF_TIMER_ROOT_SIZE];
+        struct list_head  vec[GF_TIMER_VEC_LEVELS][GF_TIMER_VEC_SIZE];
 };
 
 typedef struct _gf_timer gf_timer_t;
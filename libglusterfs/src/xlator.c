@@ -82,6 +82,7 @@ fill_defaults (xlator_t *xl)
 	SET_DEFAULT_FOP (fallocate);
 	SET_DEFAULT_FOP (discard);
         SET_DEFAULT_FOP (zerofill);
+        SET_DEFAULT_FOP (compound);
 
         SET_DEFAULT_FOP (getspec);
 
@@ -85,6 +85,41 @@ struct _loc {
 };
 
 
+/*
+ * A link of a compound fop. Only the members used by the fop of the link are
+ * set, see compound-fop.h for helpers filling them in.
+ */
+typedef struct _compound_args {
+        glusterfs_fop_t     fop;
+        loc_t               loc;
+        fd_t               *fd;
+        char               *volume;
+        char               *name;
+        int32_t             cmd;
+        struct gf_flock     flock;
+        entrylk_cmd         entrylk_cmd;
+        entrylk_type        entrylk_type;
+        gf_xattrop_flags_t  optype;
+        int32_t             flags;
+        dict_t             *xattr;
+        struct iovec       *vector;
+        int32_t             count;
+        off_t               offset;
+        struct iobref      *iobref;
+        dict_t             *xdata;
+} compound_args_t;
+
+/* Reply to a link of a compound fop */
+typedef struct _compound_rsp {
+        int32_t             op_ret;
+        int32_t             op_errno;
+        struct iatt         prebuf;
+        struct iatt         postbuf;
+        dict_t             *xattr;
+        dict_t             *xdata;
+} compound_rsp_t;
+
+
 typedef int32_t (*fop_getspec_cbk_t) (call_frame_t *frame,
                                       void *cookie,
                                       xlator_t *this,
@@ -442,6 +477,19 @@ typedef int32_t (*fop_zerofill_cbk_t) (call_frame_t *frame,
                                       struct iatt *preop_stbuf,
                                       struct iatt *postop_stbuf, dict_t *xdata);
 
+/* op_ret is 0 if all the links succeeded, otherwise -1 with op_errno of the
+ * first link which failed. rsp has one entry per link which was executed,
+ * the failed one included.
+ */
+typedef int32_t (*fop_compound_cbk_t) (call_frame_t *frame,
+                                       void *cookie,
+                                       xlator_t *this,
+                                       int32_t op_ret,
+                                       int32_t op_errno,
+                                       compound_rsp_t *rsp,
+                                       int32_t count,
+                                       dict_t *xdata);
+
 typedef int32_t (*fop_lookup_t) (call_frame_t *frame,
                                  xlator_t *this,
                                  loc_t *loc,
@@ -680,6 +728,15 @@ typedef int32_t (*fop_zerofill_t) (call_frame_t *frame,
                                   off_t len,
                                   dict_t *xdata);
 
+/* Executes the links of args in order, stopping at the first failure. args
+ * has to stay valid until the fop unwinds.
+ */
+typedef int32_t (*fop_compound_t) (call_frame_t *frame,
+                                   xlator_t *this,
+                                   compound_args_t *args,
+                                   int32_t count,
+                                   dict_t *xdata);
+
 struct xlator_fops {
         fop_lookup_t         lookup;
         fop_stat_t           stat;
@@ -726,6 +783,7 @@ struct xlator_fops {
 	fop_fallocate_t	     fallocate;
 	fop_discard_t	     discard;
         fop_zerofill_t       zerofill;
+        fop_compound_t       compound;
 
         /* these entries are used for a typechecking hack in STACK_WIND _only_ */
         fop_lookup_cbk_t         lookup_cbk;
@@ -773,6 +831,7 @@ struct xlator_fops {
 	fop_fallocate_cbk_t	 fallocate_cbk;
 	fop_discard_cbk_t	 discard_cbk;
         fop_zerofill_cbk_t       zerofill_cbk;
+        fop_compound_cbk_t       compound_cbk;
 };
 
 typedef int32_t (*cbk_forget_t) (xlator_t *this,
@@ -54,6 +54,7 @@ __saved_frames_get_timedout (struct saved_frames *frames, uint32_t timeout,
 		if ((tmp->saved_at.tv_sec + timeout) < current->tv_sec) {
 			bailout_frame = tmp;
 			list_del_init (&bailout_frame->list);
+                        list_del_init (&bailout_frame->hash);
 			frames->count--;
 		}
 	}
@@ -77,6 +78,59 @@ _is_lock_fop (struct saved_frame *sframe)
                 (fop == GFS3_OP_FENTRYLK));
 }
 
+/* xids are handed out in sequence, so their low bits spread them evenly */
+static struct list_head *
+__saved_frames_bucket (struct saved_frames *frames, int64_t callid)
+{
+        return &frames->hash[callid & (frames->hash_size - 1)];
+}
+
+
+static int
+__saved_frames_hash_init (struct saved_frames *frames, uint32_t size)
+{
+        struct list_head   *hash = NULL;
+        struct saved_frame *tmp = NULL;
+        uint32_t            i = 0;
+
+        hash = GF_CALLOC (size, sizeof (*hash),
+                          gf_common_mt_rpcclnt_savedframe_hash_t);
+        if (!hash)
+                return -1;
+
+        for (i = 0; i < size; i++)
+                INIT_LIST_HEAD (&hash[i]);
+
+        GF_FREE (frames->hash);
+        frames->hash = hash;
+        frames->hash_size = size;
+
+        list_for_each_entry (tmp, &frames->sf.list, list)
+                list_add_tail (&tmp->hash, __saved_frames_bucket (frames,
+                                                        tmp->rpcreq->xid));
+        list_for_each_entry (tmp, &frames->lk_sf.list, list)
+                list_add_tail (&tmp->hash, __saved_frames_bucket (frames,
+                                                        tmp->rpcreq->xid));
+
+        return 0;
+}
+
+
+static struct saved_frame *
+__saved_frame_lookup (struct saved_frames *frames, int64_t callid)
+{
+        struct saved_frame *tmp = NULL;
+
+        list_for_each_entry (tmp, __saved_frames_bucket (frames, callid),
+                             hash) {
+                if (tmp->rpcreq->xid == callid)
+                        return tmp;
+        }
+
+        return NULL;
+}
+
+
 struct saved_frame *
 __saved_frames_put (struct saved_frames *frames, void *frame,
                     struct rpc_req *rpcreq)
@@ -91,6 +145,7 @@ __saved_frames_put (struct saved_frames *frames, void *frame,
 
         memset (saved_frame, 0, sizeof (*saved_frame));
 	INIT_LIST_HEAD (&saved_frame->list);
+        INIT_LIST_HEAD (&saved_frame->hash);
 
 	saved_frame->capital_this = THIS;
 	saved_frame->frame        = frame;
@@ -102,8 +157,16 @@ __saved_frames_put (struct saved_frames *frames, void *frame,
         else
                 list_add_tail (&saved_frame->list, &frames->sf.list);
 
+        list_add_tail (&saved_frame->hash,
+                       __saved_frames_bucket (frames, rpcreq->xid));
+
 	frames->count++;
 
+        /* keep the chains short, the old table still works if this fails */
+        if (frames->count > 2 * frames->hash_size &&
+            frames->hash_size < SAVED_FRAMES_HASH_MAX)
+                __saved_frames_hash_init (frames, 2 * frames->hash_size);
+
 out:
 	return saved_frame;
 }
@@ -119,6 +182,7 @@ saved_frames_delete (struct saved_frame *saved_frame,
         pthread_mutex_lock (&conn->lock);
         {
                 list_del_init (&saved_frame->list);
+                list_del_init (&saved_frame->hash);
                 conn->saved_frames->count--;
         }
         pthread_mutex_unlock (&conn->lock);
@@ -283,6 +347,11 @@ saved_frames_new (void)
 	INIT_LIST_HEAD (&saved_frames->sf.list);
 	INIT_LIST_HEAD (&saved_frames->lk_sf.list);
 
+        if (__saved_frames_hash_init (saved_frames, SAVED_FRAMES_HASH_MIN)) {
+                GF_FREE (saved_frames);
+                return NULL;
+        }
+
 	return saved_frames;
 }
 
@@ -299,21 +368,11 @@ __saved_frame_copy (struct saved_frames *frames, int64_t callid,
                 goto out;
         }
 
-	list_for_each_entry (tmp, &frames->sf.list, list) {
-		if (tmp->rpcreq->xid == callid) {
-			*saved_frame = *tmp;
-                        ret = 0;
-			goto out;
-		}
-	}
-
-	list_for_each_entry (tmp, &frames->lk_sf.list, list) {
-		if (tmp->rpcreq->xid == callid) {
-			*saved_frame = *tmp;
-                        ret = 0;
-			goto out;
-		}
-	}
+        tmp = __saved_frame_lookup (frames, callid);
+        if (tmp) {
+                *saved_frame = *tmp;
+                ret = 0;
+        }
 
 out:
 	return ret;
@@ -324,28 +383,13 @@ struct saved_frame *
 __saved_frame_get (struct saved_frames *frames, int64_t callid)
 {
 	struct saved_frame *saved_frame = NULL;
-	struct saved_frame *tmp = NULL;
 
-	list_for_each_entry (tmp, &frames->sf.list, list) {
-		if (tmp->rpcreq->xid == callid) {
-			list_del_init (&tmp->list);
-			frames->count--;
-			saved_frame = tmp;
-			goto out;
-		}
-	}
-
-	list_for_each_entry (tmp, &frames->lk_sf.list, list) {
-		if (tmp->rpcreq->xid == callid) {
-			list_del_init (&tmp->list);
-			frames->count--;
-			saved_frame = tmp;
-			goto out;
-		}
-	}
-
-out:
+        saved_frame = __saved_frame_lookup (frames, callid);
 	if (saved_frame) {
+                list_del_init (&saved_frame->list);
+                list_del_init (&saved_frame->hash);
+                frames->count--;
+
                 THIS  = saved_frame->capital_this;
         }
 
@@ -392,6 +436,7 @@ saved_frames_unwind (struct saved_frames *saved_frames)
                                        trav->rpcreq->conn->rpc_clnt->reqpool);
 
 		list_del_init (&trav->list);
+                list_del_init (&trav->hash);
                 mem_put (trav);
 	}
 }
@@ -405,6 +450,7 @@ saved_frames_destroy (struct saved_frames *frames)
 
 	saved_frames_unwind (frames);
 
+        GF_FREE (frames->hash);
 	GF_FREE (frames);
 }
 
@@ -50,6 +50,7 @@ struct saved_frame {
 			struct saved_frame *frame_prev;
 		};
 	};
+        struct list_head         hash;
         void                    *capital_this;
 	void                    *frame;
 	struct timeval           saved_at;
@@ -57,10 +58,15 @@ struct saved_frame {
         rpc_transport_rsp_t      rsp;
 };
 
+#define SAVED_FRAMES_HASH_MIN 64
+#define SAVED_FRAMES_HASH_MAX (64 * 1024)
+
 struct saved_frames {
 	int64_t            count;
-	struct saved_frame sf;
-	struct saved_frame lk_sf;
+	struct saved_frame sf;     /* in the order they were sent, */
+	struct saved_frame lk_sf;  /* for call_bail */
+        struct list_head  *hash;   /* by xid, for matching replies */
+        uint32_t           hash_size;
 };
 
 
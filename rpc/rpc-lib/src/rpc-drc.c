@@ -26,50 +26,22 @@
 #include <netinet/in.h>
 #include <unistd.h>
 
-/**
- * rpcsvc_drc_op_destroy - Destroys the cached reply
- *
- * @param drc - the main drc structure
- * @param reply - the cached reply to destroy
- * @return NULL if reply is destroyed, reply otherwise
- */
-static drc_cached_op_t *
-rpcsvc_drc_op_destroy (rpcsvc_drc_globals_t *drc, drc_cached_op_t *reply)
-{
-        GF_ASSERT (drc);
-        GF_ASSERT (reply);
-
-        if (reply->state == DRC_OP_IN_TRANSIT)
-                return reply;
-
-        iobref_unref (reply->msg.iobref);
-        if (reply->msg.rpchdr)
-                GF_FREE (reply->msg.rpchdr);
-        if (reply->msg.proghdr)
-                GF_FREE (reply->msg.proghdr);
-        if (reply->msg.progpayload)
-                GF_FREE (reply->msg.progpayload);
-
-        list_del (&reply->global_list);
-        reply->client->op_count--;
-        drc->op_count--;
-        mem_put (reply);
-        reply = NULL;
-
-        return reply;
-}
+#define DRC_SHARD(drc, hash)    (&(drc)->shards[(hash) >> (32 - DRC_SHARD_BITS)])
+#define DRC_BUCKET(shard, hash) (((hash) ^ ((hash) >> 15)) &          \
+                                 ((shard)->table_size - 1))
 
 /**
- * rpcsvc_drc_op_rb_unref - This function is used in rb tree cleanup only
+ * rpcsvc_drc_client_ref - ref the drc client
  *
- * @param reply - the cached reply to unref
- * @param drc - the main drc structure
- * @return void
+ * @param client - the drc client to ref
+ * @return client
  */
-static void
-rpcsvc_drc_rb_op_destroy (void *reply, void *drc)
+static drc_client_t *
+rpcsvc_drc_client_ref (drc_client_t *client)
 {
-        rpcsvc_drc_op_destroy (drc, (drc_cached_op_t *)reply);
+        GF_ASSERT (client);
+        GF_ATOMIC_ADD (client->lock, client->ref, 1);
+        return client;
 }
 
 /**
@@ -81,136 +53,163 @@ rpcsvc_drc_rb_op_destroy (void *reply, void *drc)
 static void
 rpcsvc_remove_drc_client (drc_client_t *client)
 {
-        rb_destroy (client->rbtree, rpcsvc_drc_rb_op_destroy);
         list_del (&client->client_list);
+        LOCK_DESTROY (&client->lock);
         GF_FREE (client);
 }
 
 /**
- * rpcsvc_client_lookup - Given a sockaddr_storage, find the client if it exists
+ * __rpcsvc_drc_client_unref - unref the drc client, and destroy
+ *                             the client on last unref; drc lock held
  *
  * @param drc - the main drc structure
- * @param sockaddr - the network address of the client to be looked up
- * @return drc client if it exists, NULL otherwise
+ * @param client - the drc client to unref
+ * @return NULL if it is the last unref, client otherwise
  */
 static drc_client_t *
-rpcsvc_client_lookup (rpcsvc_drc_globals_t *drc,
-                      struct sockaddr_storage *sockaddr)
+__rpcsvc_drc_client_unref (rpcsvc_drc_globals_t *drc, drc_client_t *client)
 {
-        drc_client_t    *client = NULL;
-
         GF_ASSERT (drc);
-        GF_ASSERT (sockaddr);
-
-        if (list_empty (&drc->clients_head))
-            return NULL;
+        GF_ASSERT (client->ref);
 
-        list_for_each_entry (client, &drc->clients_head, client_list) {
-                if (gf_sock_union_equal_addr (&client->sock_union,
-                                              (union gf_sock_union *)sockaddr))
-                        return client;
+        if (GF_ATOMIC_SUB (client->lock, client->ref, 1) == 0) {
+                drc->client_count--;
+                rpcsvc_remove_drc_client (client);
+                client = NULL;
         }
 
-        return NULL;
+        return client;
+}
+
+/* Drop a ref without the drc lock, provided it is not the last one.
+   Returns _gf_false if the caller has to go through
+   __rpcsvc_drc_client_unref() under the lock. */
+static gf_boolean_t
+rpcsvc_drc_client_unref_unless_last (drc_client_t *client)
+{
+#ifdef GF_HAVE_ATOMIC_BUILTINS
+        uint32_t        ref     = 0;
+
+        do {
+                ref = client->ref;
+                if (ref <= 1)
+                        return _gf_false;
+        } while (!__sync_bool_compare_and_swap (&client->ref, ref, ref - 1));
+
+        return _gf_true;
+#else
+        return _gf_false;
+#endif
 }
 
 /**
- * drc_compare_reqs - Used by rbtree to determine if incoming req matches with
- *                    an existing node(cached reply) in rbtree
+ * rpcsvc_drc_client_unref - unref the drc client, and destroy
+ *                           the client on last unref
  *
- * @param item - pointer to the incoming req
- * @param rb_node_data - pointer to an rbtree node (cached reply)
- * @param param - drc pointer - unused here, but used in *op_destroy
- * @return 0 if req matches reply, else (req->xid - reply->xid)
+ * Only the last ref is dropped under the drc lock, so that a lookup by
+ * address never finds a client which is being destroyed.
+ *
+ * @param drc - the main drc structure
+ * @param client - the drc client to unref
+ * @return NULL if it is the last unref, client otherwise
  */
-int
-drc_compare_reqs (const void *item, const void *rb_node_data, void *param)
+static drc_client_t *
+rpcsvc_drc_client_unref (rpcsvc_drc_globals_t *drc, drc_client_t *client)
 {
-        int               ret      = -1;
-        rpcsvc_request_t *req      = NULL;
-        drc_cached_op_t  *reply    = NULL;
-
-        GF_ASSERT (item);
-        GF_ASSERT (rb_node_data);
-        GF_ASSERT (param);
-
-        req = (rpcsvc_request_t *)item;
-        reply = (drc_cached_op_t *)rb_node_data;
+        GF_ASSERT (drc);
+        GF_ASSERT (client->ref);
 
-        ret = req->xid - reply->xid;
-        if (ret != 0)
-                return ret;
+        if (rpcsvc_drc_client_unref_unless_last (client))
+                return client;
 
-        if (req->prognum == reply->prognum &&
-            req->procnum == reply->procnum &&
-            req->progver == reply->progversion)
-                return 0;
+        LOCK (&drc->lock);
+        {
+                client = __rpcsvc_drc_client_unref (drc, client);
+        }
+        UNLOCK (&drc->lock);
 
-        return 1;
+        return client;
 }
 
 /**
- * drc_rb_calloc - used by rbtree api to allocate memory for nodes
+ * rpcsvc_drc_op_destroy - Destroys a cached op which is no longer
+ *                         in any shard
  *
- * @param allocator - the libavl_allocator structure used by rbtree
- * @param size - not needed by this function
- * @return pointer to new cached reply (node in rbtree)
+ * @param drc - the main drc structure
+ * @param reply - the cached reply to destroy
+ * @return void
  */
-static void *
-drc_rb_calloc (struct libavl_allocator *allocator, size_t size)
+static void
+rpcsvc_drc_op_destroy (rpcsvc_drc_globals_t *drc, drc_cached_op_t *reply)
 {
-        rpcsvc_drc_globals_t *drc = NULL;
+        GF_ASSERT (drc);
+        GF_ASSERT (reply);
 
-        /* get the drc pointer by simple typecast, since allocator
-         * is the first member of rpcsvc_drc_globals_t
-         */
-        drc = (rpcsvc_drc_globals_t *)allocator;
+        if (reply->msg.iobref)
+                iobref_unref (reply->msg.iobref);
+        if (reply->msg.rpchdr)
+                GF_FREE (reply->msg.rpchdr);
+        if (reply->msg.proghdr)
+                GF_FREE (reply->msg.proghdr);
+        if (reply->msg.progpayload)
+                GF_FREE (reply->msg.progpayload);
 
-        return mem_get (drc->mempool);
+        GF_ATOMIC_SUB (reply->client->lock, reply->client->op_count, 1);
+        rpcsvc_drc_client_unref (drc, reply->client);
+        mem_put (reply);
 }
 
 /**
- * drc_rb_free - used by rbtree api to free a node
+ * rpcsvc_drc_destroy_ops - Destroys a batch of cached ops
  *
- * @param a - the libavl_allocator structure used by rbtree api
- * @param block - node that needs to be freed
+ * @param drc - the main drc structure
+ * @param ops - list of ops unlinked from their shard
  * @return void
  */
 static void
-drc_rb_free (struct libavl_allocator *a, void *block)
+rpcsvc_drc_destroy_ops (rpcsvc_drc_globals_t *drc, struct list_head *ops)
 {
-        mem_put (block);
+        drc_cached_op_t    *reply       = NULL;
+        drc_cached_op_t    *tmp         = NULL;
+
+        list_for_each_entry_safe (reply, tmp, ops, lru_list) {
+                list_del (&reply->lru_list);
+                rpcsvc_drc_op_destroy (drc, reply);
+        }
 }
 
 /**
- * drc_init_client_cache - initialize a drc client and its rb tree
+ * rpcsvc_client_lookup - Given a sockaddr_storage, find the client if it exists
  *
  * @param drc - the main drc structure
- * @param client - the drc client to be initialized
- * @return 0 on success, -1 on failure
+ * @param sockaddr - the network address of the client to be looked up
+ * @return drc client if it exists, NULL otherwise
  */
-static int
-drc_init_client_cache (rpcsvc_drc_globals_t *drc, drc_client_t *client)
+static drc_client_t *
+rpcsvc_client_lookup (rpcsvc_drc_globals_t *drc,
+                      struct sockaddr_storage *sockaddr)
 {
+        drc_client_t    *client = NULL;
+
         GF_ASSERT (drc);
-        GF_ASSERT (client);
+        GF_ASSERT (sockaddr);
 
-        drc->allocator.libavl_malloc = drc_rb_calloc;
-        drc->allocator.libavl_free = drc_rb_free;
+        if (list_empty (&drc->clients_head))
+            return NULL;
 
-        client->rbtree = rb_create (drc_compare_reqs, drc,
-                                    (struct libavl_allocator *)drc);
-        if (!client->rbtree) {
-                gf_log (GF_RPCSVC, GF_LOG_DEBUG, "rb tree creation failed");
-                return -1;
+        list_for_each_entry (client, &drc->clients_head, client_list) {
+                if (gf_sock_union_equal_addr (&client->sock_union,
+                                              (union gf_sock_union *)sockaddr))
+                        return client;
         }
 
-        return 0;
+        return NULL;
 }
 
 /**
  * rpcsvc_get_drc_client - find the drc client with given sockaddr, else
- *                         allocate and initialize a new drc client
+ *                         allocate and initialize a new drc client;
+ *                         drc lock held
  *
  * @param drc - the main drc structure
  * @param sockaddr - network address of client
@@ -238,14 +237,8 @@ rpcsvc_get_drc_client (rpcsvc_drc_globals_t *drc,
         client->ref = 0;
         client->sock_union = (union gf_sock_union)*sockaddr;
         client->op_count = 0;
+        LOCK_INIT (&client->lock);
 
-        if (drc_init_client_cache (drc, client)) {
-                gf_log (GF_RPCSVC, GF_LOG_DEBUG,
-                        "initialization of drc client failed");
-                GF_FREE (client);
-                client = NULL;
-                goto out;
-        }
         drc->client_count++;
 
         list_add (&client->client_list, &drc->clients_head);
@@ -283,81 +276,117 @@ rpcsvc_need_drc (rpcsvc_request_t *req)
 }
 
 /**
- * rpcsvc_drc_client_ref - ref the drc client
+ * rpcsvc_drc_cksum - checksum the start of the request arguments, so that
+ *                    a reused xid is not taken for a retransmission
  *
- * @param client - the drc client to ref
- * @return client
+ * @param req - incoming request
+ * @return the checksum
  */
-static drc_client_t *
-rpcsvc_drc_client_ref (drc_client_t *client)
+static uint32_t
+rpcsvc_drc_cksum (rpcsvc_request_t *req)
 {
-        GF_ASSERT (client);
-        client->ref++;
-        return client;
+        if (!req->count || !req->msg[0].iov_len)
+                return 0;
+
+        return SuperFastHash (req->msg[0].iov_base,
+                              min (req->msg[0].iov_len, DRC_CKSUM_LEN));
 }
 
 /**
- * rpcsvc_drc_client_unref - unref the drc client, and destroy
- *                           the client on last unref
+ * rpcsvc_drc_hash - hash of the (client, xid, checksum) key; the top bits
+ *                   pick the shard, the rest the bucket within the shard
  *
- * @param drc - the main drc structure
- * @param client - the drc client to unref
- * @return NULL if it is the last unref, client otherwise
+ * @param client - the drc client
+ * @param xid - xid of the request
+ * @param cksum - checksum of the request
+ * @return the hash
  */
-static drc_client_t *
-rpcsvc_drc_client_unref (rpcsvc_drc_globals_t *drc, drc_client_t *client)
+static uint32_t
+rpcsvc_drc_hash (drc_client_t *client, uint32_t xid, uint32_t cksum)
 {
-        GF_ASSERT (drc);
-        GF_ASSERT (client->ref);
+        uint32_t        hash    = 0;
 
-        client->ref--;
-        if (!client->ref) {
-                drc->client_count--;
-                rpcsvc_remove_drc_client (client);
-                client = NULL;
-        }
+        hash = xid ^ cksum ^ (uint32_t)((unsigned long) client >> 4);
 
-        return client;
+        return hash * 0x9e3779b1;
 }
 
 /**
- * rpcsvc_drc_lookup - lookup a request to see if it is already cached
+ * __rpcsvc_drc_find - find the cached op of a request in its shard;
+ *                     shard lock held
  *
+ * @param shard - the shard of the request
  * @param req - incoming request
- * @return cached reply of req if found, NULL otherwise
+ * @param client - drc client of the request
+ * @param hash - hash of the request key
+ * @param cksum - checksum of the request
+ * @return cached op if found, NULL otherwise
  */
-drc_cached_op_t *
-rpcsvc_drc_lookup (rpcsvc_request_t *req)
+static drc_cached_op_t *
+__rpcsvc_drc_find (drc_shard_t *shard, rpcsvc_request_t *req,
+                   drc_client_t *client, uint32_t hash, uint32_t cksum)
 {
-        drc_client_t           *client = NULL;
-        drc_cached_op_t        *reply  = NULL;
-
-        GF_ASSERT (req);
+        drc_cached_op_t    *reply       = NULL;
 
-        if (!req->trans->drc_client) {
-                client = rpcsvc_get_drc_client (req->svc->drc,
-                                                &req->trans->peerinfo.sockaddr);
-                if (!client)
-                        goto out;
-                req->trans->drc_client = client;
+        list_for_each_entry (reply, &shard->table[DRC_BUCKET (shard, hash)],
+                             hash_list) {
+                if (reply->hash == hash && reply->client == client &&
+                    reply->xid == req->xid && reply->cksum == cksum &&
+                    reply->prognum == req->prognum &&
+                    reply->procnum == req->procnum &&
+                    reply->progversion == req->progver)
+                        return reply;
         }
 
-        client = rpcsvc_drc_client_ref (req->trans->drc_client);
+        return NULL;
+}
 
-        if (client->op_count == 0)
-                goto out;
+/**
+ * __rpcsvc_drc_shard_vacate - unlink the oldest ops of a full shard, as
+ *                             many as the lru factor asks for, in one go;
+ *                             shard lock held
+ *
+ * @param drc - the main drc structure
+ * @param shard - the full shard
+ * @param victims - list the evicted ops are moved to; the caller destroys
+ *                  them once the shard is unlocked
+ * @return void
+ */
+static void
+__rpcsvc_drc_shard_vacate (rpcsvc_drc_globals_t *drc, drc_shard_t *shard,
+                           struct list_head *victims)
+{
+        uint32_t            i           = 0;
+        uint32_t            n           = 0;
+        drc_cached_op_t    *reply       = NULL;
+        drc_cached_op_t    *tmp         = NULL;
 
-        reply = rb_find (client->rbtree, req);
+        GF_ASSERT (drc);
 
- out:
-        if (client)
-                rpcsvc_drc_client_unref (req->svc->drc, client);
+        n = shard->max_op_count / drc->lru_factor;
+        if (!n)
+                n = 1;
+
+        list_for_each_entry_safe_reverse (reply, tmp, &shard->lru, lru_list) {
+                /* Don't delete ops that are in transit */
+                if (reply->state == DRC_OP_IN_TRANSIT)
+                        continue;
 
-        return reply;
+                list_del_init (&reply->hash_list);
+                list_move (&reply->lru_list, victims);
+                shard->op_count--;
+                i++;
+                if (i >= n)
+                        break;
+        }
+
+        shard->evictions += i;
+        shard->eviction_runs++;
 }
 
 /**
- * rpcsvc_send_cached_reply - send the cached reply for the incoming request
+ * rpcsvc_send_cached_reply - send the cached reply for the incoming request;
+ *                            shard lock held
  *
  * @param req - incoming request (which is a duplicate in this case)
  * @param reply - the cached reply for req
@@ -374,17 +403,123 @@ rpcsvc_send_cached_reply (rpcsvc_request_t *req, drc_cached_op_t *reply)
         gf_log (GF_RPCSVC, GF_LOG_DEBUG, "sending cached reply: xid: %d, "
                 "client: %s", req->xid, req->trans->peerinfo.identifier);
 
-        rpcsvc_drc_client_ref (reply->client);
         ret = rpcsvc_transport_submit (req->trans,
                      reply->msg.rpchdr, reply->msg.rpchdrcount,
                      reply->msg.proghdr, reply->msg.proghdrcount,
                      reply->msg.progpayload, reply->msg.progpayloadcount,
                      reply->msg.iobref, req->trans_private);
-        rpcsvc_drc_client_unref (req->svc->drc, reply->client);
 
         return ret;
 }
 
+/**
+ * rpcsvc_drc_handle - look the request up in the cache. A retransmission
+ *                     of a completed request is answered with the cached
+ *                     reply, one whose original is still in transit is
+ *                     dropped. A fresh request is cached as in transit.
+ *
+ * @param req - incoming request
+ * @return 1 if the request was a duplicate and needs no further processing,
+ *         0 otherwise
+ */
+int
+rpcsvc_drc_handle (rpcsvc_request_t *req)
+{
+        int                        ret            = 0;
+        uint32_t                   cksum          = 0;
+        uint32_t                   hash           = 0;
+        drc_client_t              *client         = NULL;
+        drc_cached_op_t           *reply          = NULL;
+        drc_shard_t               *shard          = NULL;
+        rpcsvc_drc_globals_t      *drc            = NULL;
+        struct list_head           victims;
+
+        GF_ASSERT (req);
+
+        drc = req->svc->drc;
+        INIT_LIST_HEAD (&victims);
+
+        client = req->trans->drc_client;
+        if (!client) {
+                LOCK (&drc->lock);
+                {
+                        client = rpcsvc_get_drc_client (drc,
+                                         &req->trans->peerinfo.sockaddr);
+                        if (client)
+                                req->trans->drc_client =
+                                        rpcsvc_drc_client_ref (client);
+                }
+                UNLOCK (&drc->lock);
+
+                if (!client) {
+                        gf_log (GF_RPCSVC, GF_LOG_DEBUG, "drc client is NULL");
+                        goto out;
+                }
+        }
+
+        cksum = rpcsvc_drc_cksum (req);
+        hash = rpcsvc_drc_hash (client, req->xid, cksum);
+        shard = DRC_SHARD (drc, hash);
+
+        LOCK (&shard->lock);
+        {
+                reply = __rpcsvc_drc_find (shard, req, client, hash, cksum);
+
+                /* retransmission of completed request, send cached reply */
+                if (reply && reply->state == DRC_OP_CACHED) {
+                        gf_log (GF_RPCSVC, GF_LOG_INFO, "duplicate request:"
+                                " XID: 0x%x", req->xid);
+                        rpcsvc_send_cached_reply (req, reply);
+                        shard->cache_hits++;
+                        ret = 1;
+
+                } /* retransmitted request, original op in transit, drop it */
+                else if (reply) {
+                        gf_log (GF_RPCSVC, GF_LOG_INFO, "op in transit,"
+                                " discarding. XID: 0x%x", req->xid);
+                        shard->intransit_hits++;
+                        ret = 1;
+
+                } /* fresh request, cache it as in-transit and proceed */
+                else {
+                        shard->misses++;
+
+                        reply = mem_get (drc->mempool);
+                        if (!reply)
+                                goto unlock;
+
+                        memset (reply, 0, sizeof (*reply));
+                        reply->client = rpcsvc_drc_client_ref (client);
+                        reply->xid = req->xid;
+                        reply->cksum = cksum;
+                        reply->hash = hash;
+                        reply->prognum = req->prognum;
+                        reply->progversion = req->progver;
+                        reply->procnum = req->procnum;
+                        reply->state = DRC_OP_IN_TRANSIT;
+
+                        /* shard is full, free up some space */
+                        if (shard->op_count >= shard->max_op_count)
+                                __rpcsvc_drc_shard_vacate (drc, shard,
+                                                           &victims);
+
+                        list_add (&reply->hash_list,
+                                  &shard->table[DRC_BUCKET (shard, hash)]);
+                        list_add (&reply->lru_list, &shard->lru);
+                        shard->op_count++;
+                        GF_ATOMIC_ADD (client->lock, client->op_count, 1);
+
+                        req->reply = reply;
+                }
+        }
+unlock:
+        UNLOCK (&shard->lock);
+
+        rpcsvc_drc_destroy_ops (drc, &victims);
+ out:
+        return ret;
+}
+
 /**
  * rpcsvc_cache_reply - cache the reply for the processed request 'req'
  *
@@ -404,160 +539,38 @@ rpcsvc_cache_reply (rpcsvc_request_t *req, struct iobref *iobref,
                     struct iovec *proghdr, int proghdrcount,
                     struct iovec *payload, int payloadcount)
 {
-        int                       ret              = -1;
         drc_cached_op_t          *reply            = NULL;
+        drc_shard_t              *shard            = NULL;
+        rpc_transport_msg_t       msg              = {0, };
 
         GF_ASSERT (req);
         GF_ASSERT (req->reply);
 
         reply = req->reply;
+        shard = DRC_SHARD (req->svc->drc, reply->hash);
 
-        reply->state = DRC_OP_CACHED;
-
-        reply->msg.iobref = iobref_ref (iobref);
+        msg.iobref = iobref_ref (iobref);
 
-        reply->msg.rpchdrcount = rpchdrcount;
-        reply->msg.rpchdr = iov_dup (rpchdr, rpchdrcount);
+        msg.rpchdrcount = rpchdrcount;
+        msg.rpchdr = iov_dup (rpchdr, rpchdrcount);
 
-        reply->msg.proghdrcount = proghdrcount;
-        reply->msg.proghdr = iov_dup (proghdr, proghdrcount);
+        msg.proghdrcount = proghdrcount;
+        msg.proghdr = iov_dup (proghdr, proghdrcount);
 
-        reply->msg.progpayloadcount = payloadcount;
+        msg.progpayloadcount = payloadcount;
         if (payloadcount)
-                reply->msg.progpayload = iov_dup (payload, payloadcount);
-
-        //        rpcsvc_drc_client_unref (req->svc->drc, req->trans->drc_client);
-        //        rpcsvc_drc_op_unref (req->svc->drc, reply);
-        ret = 0;
-
-        return ret;
-}
-
-/**
- * rpcsvc_vacate_drc_entries - free up some percentage of drc cache
- *                             based on the lru factor
- *
- * @param drc - the main drc structure
- * @return void
- */
-static void
-rpcsvc_vacate_drc_entries (rpcsvc_drc_globals_t *drc)
-{
-        uint32_t            i           = 0;
-        uint32_t            n           = 0;
-        drc_cached_op_t    *reply       = NULL;
-        drc_cached_op_t    *tmp         = NULL;
-        drc_client_t       *client      = NULL;
-
-        GF_ASSERT (drc);
-
-        n = drc->global_cache_size / drc->lru_factor;
-
-        list_for_each_entry_safe_reverse (reply, tmp, &drc->cache_head, global_list) {
-                /* Don't delete ops that are in transit */
-                if (reply->state == DRC_OP_IN_TRANSIT)
-                        continue;
+                msg.progpayload = iov_dup (payload, payloadcount);
 
-                client = reply->client;
-
-                (void *)rb_delete (client->rbtree, reply);
-
-                rpcsvc_drc_op_destroy (drc, reply);
-                rpcsvc_drc_client_unref (drc, client);
-                i++;
-                if (i >= n)
-                        break;
+        LOCK (&shard->lock);
+        {
+                reply->msg = msg;
+                reply->state = DRC_OP_CACHED;
         }
-}
-
-/**
- * rpcsvc_add_op_to_cache - insert the cached op into the client rbtree and drc list
- *
- * @param drc - the main drc structure
- * @param reply - the op to be inserted
- * @return 0 on success, -1 on failure
- */
-static int
-rpcsvc_add_op_to_cache (rpcsvc_drc_globals_t *drc, drc_cached_op_t *reply)
-{
-        drc_client_t        *client         = NULL;
-        drc_cached_op_t    **tmp_reply      = NULL;
-
-        GF_ASSERT (drc);
-        GF_ASSERT (reply);
-
-        client = reply->client;
-
-        /* cache is full, free up some space */
-        if (drc->op_count >= drc->global_cache_size)
-                rpcsvc_vacate_drc_entries (drc);
-
-        tmp_reply = (drc_cached_op_t **)rb_probe (client->rbtree, reply);
-        if (*tmp_reply != reply) {
-                /* should never happen */
-                gf_log (GF_RPCSVC, GF_LOG_ERROR,
-                        "DRC failed to detect duplicates");
-                return -1;
-        } else if (*tmp_reply == NULL) {
-                /* mem alloc failed */
-                return -1;
-        }
-
-        client->op_count++;
-        list_add (&reply->global_list, &drc->cache_head);
-        drc->op_count++;
+        UNLOCK (&shard->lock);
 
         return 0;
 }
 
-/**
- * rpcsvc_cache_request - cache the in-transition incoming request
- *
- * @param req - incoming request
- * @return 0 on success, -1 on failure
- */
-int
-rpcsvc_cache_request (rpcsvc_request_t *req)
-{
-        int                        ret            = -1;
-        drc_client_t              *client         = NULL;
-        drc_cached_op_t           *reply          = NULL;
-        rpcsvc_drc_globals_t      *drc            = NULL;
-
-        GF_ASSERT (req);
-
-        drc = req->svc->drc;
-
-        client = req->trans->drc_client;
-        if (!client) {
-                gf_log (GF_RPCSVC, GF_LOG_DEBUG, "drc client is NULL");
-                goto out;
-        }
-
-        reply = mem_get (drc->mempool);
-        if (!reply)
-                goto out;
-
-        reply->client = rpcsvc_drc_client_ref (client);
-        reply->xid = req->xid;
-        reply->prognum = req->prognum;
-        reply->progversion = req->progver;
-        reply->procnum = req->procnum;
-        reply->state = DRC_OP_IN_TRANSIT;
-        req->reply = reply;
-
-        ret = rpcsvc_add_op_to_cache (drc, reply);
-        if (ret) {
-                req->reply = NULL;
-                rpcsvc_drc_op_destroy (drc, reply);
-                rpcsvc_drc_client_unref (drc, client);
-                gf_log (GF_RPCSVC, GF_LOG_DEBUG, "Failed to add op to drc cache");
-        }
-
- out:
-        return ret;
-}
-
 /**
  *
  * rpcsvc_drc_priv - function which dumps the drc state
@@ -571,7 +584,15 @@ rpcsvc_drc_priv (rpcsvc_drc_globals_t *drc)
         int                      i                         = 0;
         char                     key[GF_DUMP_MAX_BUF_LEN]  = {0};
         drc_client_t            *client                    = NULL;
+        drc_shard_t             *shard                     = NULL;
         char                     ip[INET6_ADDRSTRLEN]      = {0};
+        uint32_t                 op_count                  = 0;
+        uint64_t                 hits                      = 0;
+        uint64_t                 intransit_hits            = 0;
+        uint64_t                 misses                    = 0;
+        uint64_t                 evictions                 = 0;
+        uint64_t                 eviction_runs             = 0;
+        double                   uptime                    = 0;
 
         if (!drc || drc->status == DRC_UNINITIATED) {
                 gf_log (GF_RPCSVC, GF_LOG_DEBUG, "DRC is "
@@ -581,6 +602,22 @@ rpcsvc_drc_priv (rpcsvc_drc_globals_t *drc)
 
         gf_proc_dump_add_section("rpc.drc");
 
+        /* the counters are read without the shard locks */
+        for (i = 0; i < DRC_SHARD_COUNT; i++) {
+                shard = &drc->shards[i];
+                op_count += shard->op_count;
+                hits += shard->cache_hits;
+                intransit_hits += shard->intransit_hits;
+                misses += shard->misses;
+                evictions += shard->evictions;
+                eviction_runs += shard->eviction_runs;
+        }
+        i = 0;
+
+        uptime = time (NULL) - drc->start_time;
+        if (uptime < 1)
+                uptime = 1;
+
         if (TRY_LOCK (&drc->lock))
                 return -1;
 
@@ -591,7 +628,7 @@ rpcsvc_drc_priv (rpcsvc_drc_globals_t *drc)
         gf_proc_dump_write (key, "%d", drc->client_count);
 
         gf_proc_dump_build_key (key, "drc", "current_cache_size");
-        gf_proc_dump_write (key, "%d", drc->op_count);
+        gf_proc_dump_write (key, "%u", op_count);
 
         gf_proc_dump_build_key (key, "drc", "max_cache_size");
         gf_proc_dump_write (key, "%d", drc->global_cache_size);
@@ -599,11 +636,32 @@ rpcsvc_drc_priv (rpcsvc_drc_globals_t *drc)
         gf_proc_dump_build_key (key, "drc", "lru_factor");
         gf_proc_dump_write (key, "%d", drc->lru_factor);
 
+        gf_proc_dump_build_key (key, "drc", "shard_count");
+        gf_proc_dump_write (key, "%d", DRC_SHARD_COUNT);
+
         gf_proc_dump_build_key (key, "drc", "duplicate_request_count");
-        gf_proc_dump_write (key, "%d", drc->cache_hits);
+        gf_proc_dump_write (key, "%"PRIu64, hits);
 
         gf_proc_dump_build_key (key, "drc", "in_transit_duplicate_requests");
-        gf_proc_dump_write (key, "%d", drc->intransit_hits);
+        gf_proc_dump_write (key, "%"PRIu64, intransit_hits);
+
+        gf_proc_dump_build_key (key, "drc", "miss_count");
+        gf_proc_dump_write (key, "%"PRIu64, misses);
+
+        gf_proc_dump_build_key (key, "drc", "eviction_count");
+        gf_proc_dump_write (key, "%"PRIu64, evictions);
+
+        gf_proc_dump_build_key (key, "drc", "eviction_runs");
+        gf_proc_dump_write (key, "%"PRIu64, eviction_runs);
+
+        gf_proc_dump_build_key (key, "drc", "hits_per_sec");
+        gf_proc_dump_write (key, "%.2f", (hits + intransit_hits) / uptime);
+
+        gf_proc_dump_build_key (key, "drc", "misses_per_sec");
+        gf_proc_dump_write (key, "%.2f", misses / uptime);
+
+        gf_proc_dump_build_key (key, "drc", "evictions_per_sec");
+        gf_proc_dump_write (key, "%.2f", evictions / uptime);
 
         list_for_each_entry (client, &drc->clients_head, client_list) {
                 gf_proc_dump_build_key (key, "client", "%d.ip-address", i);
@@ -680,7 +738,7 @@ rpcsvc_drc_notify (rpcsvc_t *svc, void *xl,
                 if (list_empty (&drc->clients_head))
                         break;
                 /* should be the last unref */
-                rpcsvc_drc_client_unref (drc, client);
+                __rpcsvc_drc_client_unref (drc, client);
                 trans->drc_client = NULL;
                 break;
 
@@ -693,6 +751,91 @@ rpcsvc_drc_notify (rpcsvc_t *svc, void *xl,
         return ret;
 }
 
+/**
+ * rpcsvc_drc_shards_init - set up the shards of the cache, each taking an
+ *                          equal part of the global cache size
+ *
+ * @param drc - the main drc structure
+ * @return 0 on success, -1 on failure
+ */
+static int
+rpcsvc_drc_shards_init (rpcsvc_drc_globals_t *drc)
+{
+        drc_shard_t    *shard   = NULL;
+        uint32_t        size    = 0;
+        int             i       = 0;
+        uint32_t        j       = 0;
+
+        for (i = 0; i < DRC_SHARD_COUNT; i++) {
+                shard = &drc->shards[i];
+
+                LOCK_INIT (&shard->lock);
+                INIT_LIST_HEAD (&shard->lru);
+
+                shard->max_op_count = drc->global_cache_size / DRC_SHARD_COUNT;
+                if (!shard->max_op_count)
+                        shard->max_op_count = 1;
+
+                for (size = 1; size < shard->max_op_count; size <<= 1)
+                        ;
+                shard->table = GF_CALLOC (size, sizeof (*shard->table),
+                                          gf_common_mt_drc_shard_table_t);
+                if (!shard->table)
+                        return -1;
+                shard->table_size = size;
+
+                for (j = 0; j < size; j++)
+                        INIT_LIST_HEAD (&shard->table[j]);
+        }
+
+        return 0;
+}
+
+/**
+ * rpcsvc_drc_shards_destroy - drop the cached replies and tear down the
+ *                             shards. Ops still in transit are referenced
+ *                             by their requests and are left alone.
+ *
+ * @param drc - the main drc structure
+ * @return void
+ */
+static void
+rpcsvc_drc_shards_destroy (rpcsvc_drc_globals_t *drc)
+{
+        drc_shard_t        *shard       = NULL;
+        drc_cached_op_t    *reply       = NULL;
+        drc_cached_op_t    *tmp         = NULL;
+        int                 i           = 0;
+        struct list_head    victims;
+
+        for (i = 0; i < DRC_SHARD_COUNT; i++) {
+                shard = &drc->shards[i];
+                if (!shard->table)
+                        continue;
+
+                INIT_LIST_HEAD (&victims);
+
+                LOCK (&shard->lock);
+                {
+                        list_for_each_entry_safe (reply, tmp, &shard->lru,
+                                                  lru_list) {
+                                if (reply->state == DRC_OP_IN_TRANSIT)
+                                        continue;
+                                list_del_init (&reply->hash_list);
+                                list_move (&reply->lru_list, &victims);
+                                shard->op_count--;
+                        }
+                }
+                UNLOCK (&shard->lock);
+
+                rpcsvc_drc_destroy_ops (drc, &victims);
+
+                GF_FREE (shard->table);
+                shard->table = NULL;
+                LOCK_DESTROY (&shard->lock);
+        }
+}
+
 /**
  * rpcsvc_drc_init - Initialize the duplicate request cache service
  *
@@ -777,7 +920,14 @@ rpcsvc_drc_init (rpcsvc_t *svc, dict_t *options)
         drc->lru_factor = (drc_lru_factor_t) drc_factor;
 
         INIT_LIST_HEAD (&drc->clients_head);
-        INIT_LIST_HEAD (&drc->cache_head);
+
+        ret = rpcsvc_drc_shards_init (drc);
+        if (ret) {
+                gf_log (GF_RPCSVC, GF_LOG_ERROR, "Failed to allocate the DRC"
+                        " hash tables, drc-size: %d", drc->global_cache_size);
+                goto out;
+        }
+        drc->start_time = time (NULL);
 
         ret = rpcsvc_register_notify (svc, rpcsvc_drc_notify, THIS);
         if (ret) {
@@ -791,6 +941,7 @@ rpcsvc_drc_init (rpcsvc_t *svc, dict_t *options)
  out:
         UNLOCK (&drc->lock);
         if (ret == -1) {
+                rpcsvc_drc_shards_destroy (drc);
                 if (drc->mempool) {
                         mem_pool_destroy (drc->mempool);
                         drc->mempool = NULL;
@@ -813,8 +964,10 @@ rpcsvc_drc_deinit (rpcsvc_t *svc)
         if (!drc)
                 return (0);
 
-        LOCK (&drc->lock);
         (void) rpcsvc_unregister_notify (svc, rpcsvc_drc_notify, THIS);
+        rpcsvc_drc_shards_destroy (drc);
+
+        LOCK (&drc->lock);
         if (drc->mempool) {
                 mem_pool_destroy (drc->mempool);
                 drc->mempool = NULL;
@@ -20,32 +20,57 @@
 #include "rpcsvc.h"
 #include "locking.h"
 #include "dict.h"
-#include "rb.h"
+
+/* cached ops are spread over this many independently locked shards */
+#define DRC_SHARD_BITS             4
+#define DRC_SHARD_COUNT            (1 << DRC_SHARD_BITS)
+
+/* no. of request bytes hashed into the checksum of a cached op */
+#define DRC_CKSUM_LEN              256
 
 /* per-client cache structure */
 struct drc_client {
+        /* only taken where atomic builtins are missing */
+        gf_lock_t                  lock;
         uint32_t                   ref;
         union gf_sock_union        sock_union;
-        /* pointers to the cache */
-        struct rb_table           *rbtree;
         /* no. of ops currently cached */
         uint32_t                   op_count;
         struct list_head           client_list;
 };
 
+/* a cached op is found by (client, xid, checksum of the request) */
 struct drc_cached_op {
         drc_op_state_t                 state;
         uint32_t                       xid;
+        uint32_t                       cksum;
+        uint32_t                       hash;
         int                            prognum;
         int                            progversion;
         int                            procnum;
         rpc_transport_msg_t            msg;
         drc_client_t                  *client;
-        struct list_head               client_list;
-        struct list_head               global_list;
+        struct list_head               hash_list;
+        struct list_head               lru_list;
         int32_t                        ref;
 };
 
+struct drc_shard {
+        gf_lock_t                 lock;
+        struct list_head         *table;
+        uint32_t                  table_size;
+        /* newest first */
+        struct list_head          lru;
+        uint32_t                  op_count;
+        uint32_t                  max_op_count;
+        uint64_t                  cache_hits;
+        uint64_t                  intransit_hits;
+        uint64_t                  misses;
+        uint64_t                  evictions;
+        uint64_t                  eviction_runs;
+};
+typedef struct drc_shard drc_shard_t;
+
 /* global drc definitions */
 enum drc_status {
         DRC_UNINITIATED,
@@ -54,30 +79,25 @@ enum drc_status {
 typedef enum drc_status drc_status_t;
 
 struct drc_globals {
-        /* allocator must be the first member since
-         * it is used so in gf_libavl_allocator
-         */
-        struct libavl_allocator   allocator;
         drc_type_t                type;
         /* configurable size parameter */
         uint32_t                  global_cache_size;
         drc_lru_factor_t          lru_factor;
+        /* protects the client list */
         gf_lock_t                 lock;
         drc_status_t              status;
-        uint32_t                  op_count;
-        uint64_t                  cache_hits;
-        uint64_t                  intransit_hits;
         struct mem_pool          *mempool;
-        struct list_head          cache_head;
         uint32_t                  client_count;
         struct list_head          clients_head;
+        time_t                    start_time;
+        drc_shard_t               shards[DRC_SHARD_COUNT];
 };
 
 int
 rpcsvc_need_drc (rpcsvc_request_t *req);
 
-drc_cached_op_t *
-rpcsvc_drc_lookup (rpcsvc_request_t *req);
+int
+rpcsvc_drc_handle (rpcsvc_request_t *req);
 
 int
 rpcsvc_send_cached_reply (rpcsvc_request_t *req, drc_cached_op_t *reply);
@@ -88,9 +108,6 @@ rpcsvc_cache_reply (rpcsvc_request_t *req, struct iobref *iobref,
                     struct iovec *proghdr, int proghdrcount,
                     struct iovec *payload, int payloadcount);
 
-int
-rpcsvc_cache_request (rpcsvc_request_t *req);
-
 int32_t
 rpcsvc_drc_priv (rpcsvc_drc_globals_t *drc);
 
@@ -199,6 +199,7 @@ struct rpc_transport {
         char                      *name;
         void                      *dnscache;
         void                      *drc_client;
+        void                      *sched_client;
         data_t                    *buf;
         int32_t                  (*init)   (rpc_transport_t *this);
         void                     (*fini)   (rpc_transport_t *this);
@@ -210,6 +211,8 @@ struct rpc_transport {
 
         uint64_t                   total_bytes_read;
         uint64_t                   total_bytes_write;
+        uint64_t                   total_write_calls;
+        uint64_t                   total_write_msgs;
 
         struct list_head           list;
         int                        bind_insecure;
@@ -33,6 +33,9 @@ typedef int (*rpcsvc_notify_t) (struct rpcsvc_state *, void *mydata,
 struct drc_globals;
 typedef struct drc_globals rpcsvc_drc_globals_t;
 
+struct rpcsvc_sched;
+typedef struct rpcsvc_sched rpcsvc_sched_t;
+
 /* Contains global state required for all the RPC services.
  */
 typedef struct rpcsvc_state {
@@ -73,6 +76,7 @@ typedef struct rpcsvc_state {
         rpcsvc_notify_t         notifyfn;
         struct mem_pool         *rxpool;
         rpcsvc_drc_globals_t    *drc;
+        rpcsvc_sched_t          *sched;
 
 	/* per-client limit of outstanding rpc requests */
         int                     outstanding_rpc_limit;
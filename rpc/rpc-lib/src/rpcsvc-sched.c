@@ -0,0 +1,607 @@
+/*
+  Copyright (c) 2014 Red Hat, Inc. <http://www.redhat.com>
+  This file is part of GlusterFS.
+
+  This file is licensed to you under your choice of the GNU Lesser
+  General Public License, version 3 or any later version (LGPLv3 or
+  later), or the GNU General Public License, version 2 (GPLv2), in all
+  cases as published by the Free Software Foundation.
+*/
+
+#ifndef _CONFIG_H
+#define _CONFIG_H
+#include "config.h"
+#endif
+
+#include "rpcsvc.h"
+#include "rpcsvc-sched.h"
+#include "locking.h"
+#include "common-utils.h"
+#include "statedump.h"
+#include "mem-pool.h"
+
+#include <fnmatch.h>
+#include <sys/time.h>
+
+static void
+rpcsvc_sched_classes_free (rpcsvc_sched_class_t *classes, int count)
+{
+        int i = 0;
+
+        if (!classes)
+                return;
+
+        for (i = 0; i < count; i++)
+                GF_FREE (classes[i].pattern);
+
+        GF_FREE (classes);
+}
+
+/**
+ * rpcsvc_sched_classes_parse - parse the client classes option
+ *
+ * @param str    - comma separated list of <address-pattern>:<weight>
+ * @param classes - on success, the parsed classes in option order
+ * @param count  - on success, the number of classes
+ * @return 0 on success, -1 on a malformed list
+ */
+static int
+rpcsvc_sched_classes_parse (const char *str, rpcsvc_sched_class_t **classes,
+                            int *count)
+{
+        rpcsvc_sched_class_t *parsed  = NULL;
+        char                 *dup     = NULL;
+        char                 *entry   = NULL;
+        char                 *saveptr = NULL;
+        char                 *sep     = NULL;
+        const char           *c       = NULL;
+        uint32_t              weight  = 0;
+        int                   n       = 1;
+        int                   i       = 0;
+        int                   ret     = -1;
+
+        for (c = str; *c; c++)
+                if (*c == ',')
+                        n++;
+
+        dup = gf_strdup (str);
+        parsed = GF_CALLOC (n, sizeof (*parsed),
+                            gf_common_mt_rpcsvc_sched_class_t);
+        if (!dup || !parsed)
+                goto out;
+
+        for (entry = strtok_r (dup, ",", &saveptr); entry;
+             entry = strtok_r (NULL, ",", &saveptr)) {
+                sep = strrchr (entry, ':');
+                if (!sep || sep == entry) {
+                        gf_log (GF_RPCSVC, GF_LOG_ERROR, "invalid client "
+                                "class \"%s\", expected <pattern>:<weight>",
+                                entry);
+                        goto out;
+                }
+
+                *sep = '\0';
+                if (gf_string2uint32 (sep + 1, &weight) || weight == 0 ||
+                    weight > RPCSVC_SCHED_MAX_WEIGHT) {
+                        gf_log (GF_RPCSVC, GF_LOG_ERROR, "invalid weight "
+                                "\"%s\" of client class %s, should be "
+                                "1 - %d", sep + 1, entry,
+                                RPCSVC_SCHED_MAX_WEIGHT);
+                        goto out;
+                }
+
+                parsed[i].pattern = gf_strdup (entry);
+                if (!parsed[i].pattern)
+                        goto out;
+                parsed[i].weight = weight;
+                i++;
+        }
+
+        *classes = parsed;
+        *count = i;
+        parsed = NULL;
+        ret = 0;
+out:
+        if (parsed)
+                rpcsvc_sched_classes_free (parsed, i);
+        GF_FREE (dup);
+        return ret;
+}
+
+/* the first class matching the client decides the weight of its requests,
+ * for the requests it sends with a negative pid the internal class matches
+ * too */
+static void
+__rpcsvc_sched_classify (rpcsvc_sched_t *sched, rpcsvc_sched_client_t *client)
+{
+        rpcsvc_sched_class_t *class    = NULL;
+        gf_boolean_t          internal = _gf_false;
+        int                   i        = 0;
+
+        client->class = client->internal_class = -1;
+        client->weight = client->internal_weight = 1;
+
+        for (i = 0; i < sched->class_count; i++) {
+                class = &sched->classes[i];
+
+                internal = (strcmp (class->pattern,
+                                    RPCSVC_SCHED_INTERNAL_CLASS) == 0);
+                if (!internal && fnmatch (class->pattern, client->addr, 0))
+                        continue;
+
+                if (client->internal_class < 0) {
+                        client->internal_class = i;
+                        client->internal_weight = class->weight;
+                }
+
+                if (!internal) {
+                        client->class = i;
+                        client->weight = class->weight;
+                        break;
+                }
+        }
+}
+
+/* cost of a request against the deficit of its client: a turn is worth
+ * RPCSVC_SCHED_MAX_WEIGHT, so that it dispatches as many requests as the
+ * weight of their class */
+static int32_t
+rpcsvc_sched_cost (rpcsvc_sched_client_t *client, rpcsvc_request_t *req)
+{
+        uint32_t weight = 0;
+
+        /* gluster's own daemons identify themselves by a negative pid */
+        weight = (req->pid < 0) ? client->internal_weight : client->weight;
+
+        return RPCSVC_SCHED_MAX_WEIGHT / weight;
+}
+
+static rpcsvc_sched_client_t *
+__rpcsvc_sched_client_new (rpcsvc_sched_t *sched, rpcsvc_request_t *req)
+{
+        rpcsvc_sched_client_t *client = NULL;
+        char                  *port   = NULL;
+
+        client = GF_CALLOC (1, sizeof (*client),
+                            gf_common_mt_rpcsvc_sched_client_t);
+        if (!client)
+                return NULL;
+
+        INIT_LIST_HEAD (&client->list);
+        INIT_LIST_HEAD (&client->active);
+        INIT_LIST_HEAD (&client->requests);
+
+        /* classes match the address without the port */
+        strncpy (client->addr, req->trans->peerinfo.identifier,
+                 sizeof (client->addr) - 1);
+        if (req->trans->peerinfo.sockaddr.ss_family != AF_UNIX) {
+                port = strrchr (client->addr, ':');
+                if (port)
+                        *port = '\0';
+        }
+
+        __rpcsvc_sched_classify (sched, client);
+
+        list_add_tail (&client->list, &sched->clients);
+        req->trans->sched_client = client;
+
+        return client;
+}
+
+/**
+ * __rpcsvc_sched_pick - take the next request to dispatch, if the in-flight
+ *                       budget allows one
+ *
+ * Deficit round robin: the client at the head of the active list is topped
+ * up with RPCSVC_SCHED_MAX_WEIGHT when it ran out of deficit, and keeps its
+ * turn until the cost of the requests it dispatched used the deficit up, or
+ * its queue is empty.
+ *
+ * @param sched - the scheduler, locked
+ * @param now   - time of the pick, for the wait time accounting
+ * @return the request, NULL if there is none or the budget is used up
+ */
+static rpcsvc_request_t *
+__rpcsvc_sched_pick (rpcsvc_sched_t *sched, struct timeval *now)
+{
+        rpcsvc_sched_client_t *client = NULL;
+        rpcsvc_request_t      *req    = NULL;
+        int64_t                wait   = 0;
+
+        if (list_empty (&sched->active))
+                return NULL;
+
+        if (sched->enabled && sched->inflight >= sched->limit)
+                return NULL;
+
+        client = list_entry (sched->active.next, rpcsvc_sched_client_t,
+                             active);
+        if (client->deficit <= 0)
+                client->deficit += RPCSVC_SCHED_MAX_WEIGHT;
+
+        req = list_entry (client->requests.next, rpcsvc_request_t,
+                          sched_list);
+        list_del_init (&req->sched_list);
+
+        client->deficit -= rpcsvc_sched_cost (client, req);
+        client->queued--;
+        sched->queued--;
+        client->inflight++;
+        sched->inflight++;
+
+        wait = (now->tv_sec - req->sched_time.tv_sec) * 1000000
+                + (now->tv_usec - req->sched_time.tv_usec);
+        if (wait < 0)
+                wait = 0;
+        client->dispatched++;
+        client->wait_total += wait;
+        if (wait > client->wait_max)
+                client->wait_max = wait;
+
+        if (!client->queued) {
+                client->deficit = 0;
+                list_del_init (&client->active);
+        } else if (client->deficit <= 0) {
+                list_move_tail (&client->active, &sched->active);
+        }
+
+        return req;
+}
+
+static void
+rpcsvc_sched_dispatch (rpcsvc_request_t *req)
+{
+        int ret = -1;
+
+        /* Before going to xlator code, set the THIS properly */
+        THIS = req->svc->mydata;
+
+        ret = req->sched_actor->actor (req);
+
+        rpcsvc_check_and_reply_error (ret, NULL, req);
+}
+
+/* dispatches queued requests as long as the budget allows */
+static void
+rpcsvc_sched_drain (rpcsvc_sched_t *sched)
+{
+        rpcsvc_request_t *req = NULL;
+        struct timeval    now = {0, };
+
+        for (;;) {
+                gettimeofday (&now, NULL);
+
+                LOCK (&sched->lock);
+                {
+                        req = __rpcsvc_sched_pick (sched, &now);
+                }
+                UNLOCK (&sched->lock);
+
+                if (!req)
+                        break;
+
+                rpcsvc_sched_dispatch (req);
+        }
+}
+
+/* requests in flight finish in the reply path of the actors, with whatever
+ * locks the xlators hold there, so the requests they make room for are
+ * dispatched from here */
+static void *
+rpcsvc_sched_worker (void *data)
+{
+        rpcsvc_sched_t *sched = data;
+
+        for (;;) {
+                pthread_mutex_lock (&sched->wake_lock);
+                {
+                        while (!sched->wake)
+                                pthread_cond_wait (&sched->wake_cond,
+                                                   &sched->wake_lock);
+                        sched->wake = _gf_false;
+                }
+                pthread_mutex_unlock (&sched->wake_lock);
+
+                rpcsvc_sched_drain (sched);
+        }
+
+        return NULL;
+}
+
+static void
+rpcsvc_sched_wake (rpcsvc_sched_t *sched)
+{
+        pthread_mutex_lock (&sched->wake_lock);
+        {
+                sched->wake = _gf_true;
+                pthread_cond_signal (&sched->wake_cond);
+        }
+        pthread_mutex_unlock (&sched->wake_lock);
+}
+
+/**
+ * rpcsvc_sched_submit - hand a request over to the fair-share scheduler
+ *
+ * Requests of actors which may wait for other requests (blocking locks) are
+ * not scheduled, they could otherwise hold the whole budget while waiting
+ * for a request stuck in a queue.
+ *
+ * @param req       - the request, accepted and ready for its actor
+ * @param actor     - the actor of the request
+ * @param hdr_iobuf - the buffer the request was read into, which a queued
+ *                    request has to keep
+ * @return 1 if the scheduler took the request (it is dispatched or queued),
+ *         0 if the caller has to run the actor itself
+ */
+int
+rpcsvc_sched_submit (rpcsvc_request_t *req, rpcsvc_actor_t *actor,
+                     struct iobuf *hdr_iobuf)
+{
+        rpcsvc_sched_t        *sched  = NULL;
+        rpcsvc_sched_client_t *client = NULL;
+
+        sched = req->svc->sched;
+        if (!sched || !sched->enabled || actor->blocking)
+                return 0;
+
+        LOCK (&sched->lock);
+        {
+                client = req->trans->sched_client;
+                if (!client) {
+                        client = __rpcsvc_sched_client_new (sched, req);
+                        if (!client) {
+                                UNLOCK (&sched->lock);
+                                return 0;
+                        }
+                }
+
+                req->sched_client = client;
+                req->sched_actor = actor;
+                gettimeofday (&req->sched_time, NULL);
+
+                /* the message of the request points into it */
+                if (hdr_iobuf && !req->hdr_iobuf)
+                        req->hdr_iobuf = iobuf_ref (hdr_iobuf);
+
+                list_add_tail (&req->sched_list, &client->requests);
+                client->queued++;
+                sched->queued++;
+                if (client->queued == 1)
+                        list_add_tail (&client->active, &sched->active);
+        }
+        UNLOCK (&sched->lock);
+
+        rpcsvc_sched_drain (sched);
+
+        return 1;
+}
+
+/**
+ * rpcsvc_sched_done - a scheduled request finished, have the worker
+ *                     dispatch the next one
+ *
+ * @param req - the request, about to be destroyed
+ */
+void
+rpcsvc_sched_done (rpcsvc_request_t *req)
+{
+        rpcsvc_sched_t        *sched  = NULL;
+        rpcsvc_sched_client_t *client = NULL;
+        uint32_t               queued = 0;
+
+        sched = req->svc->sched;
+        client = req->sched_client;
+
+        LOCK (&sched->lock);
+        {
+                client->inflight--;
+                sched->inflight--;
+                queued = sched->queued;
+        }
+        UNLOCK (&sched->lock);
+
+        if (queued)
+                rpcsvc_sched_wake (sched);
+}
+
+/**
+ * rpcsvc_sched_forget - drop the queue of a transport which is going away
+ *
+ * All requests hold a ref on their transport, so the queue is empty by now.
+ *
+ * @param svc   - the rpc service
+ * @param trans - the transport
+ */
+void
+rpcsvc_sched_forget (rpcsvc_t *svc, rpc_transport_t *trans)
+{
+        rpcsvc_sched_t        *sched  = NULL;
+        rpcsvc_sched_client_t *client = NULL;
+
+        sched = svc->sched;
+        if (!sched)
+                return;
+
+        LOCK (&sched->lock);
+        {
+                client = trans->sched_client;
+                trans->sched_client = NULL;
+                if (client)
+                        list_del_init (&client->list);
+        }
+        UNLOCK (&sched->lock);
+
+        GF_FREE (client);
+}
+
+/**
+ * rpcsvc_sched_reconfigure - set up the scheduler from the rpc.fair-share*
+ *                            options
+ *
+ * The scheduler is only allocated once fair-share gets enabled. Disabling it
+ * or raising the limit releases queued requests right away.
+ *
+ * @param svc     - the rpc service
+ * @param options - the options of the rpc service
+ * @return 0 on success, -1 on invalid options
+ */
+int
+rpcsvc_sched_reconfigure (rpcsvc_t *svc, dict_t *options)
+{
+        rpcsvc_sched_t        *sched       = NULL;
+        rpcsvc_sched_client_t *client      = NULL;
+        rpcsvc_sched_class_t  *classes     = NULL;
+        rpcsvc_sched_class_t  *old_classes = NULL;
+        char                  *classes_str = NULL;
+        gf_boolean_t           enabled     = _gf_false;
+        uint32_t               limit       = RPCSVC_SCHED_DEFAULT_LIMIT;
+        int                    count       = 0;
+        int                    old_count   = 0;
+
+        enabled = dict_get_str_boolean (options, "rpc.fair-share", _gf_false);
+        if (!enabled && !svc->sched)
+                return 0;
+
+        if (dict_get_uint32 (options, "rpc.fair-share-limit", &limit) ||
+            limit == 0)
+                limit = RPCSVC_SCHED_DEFAULT_LIMIT;
+
+        if (dict_get_str (options, "rpc.fair-share-classes", &classes_str))
+                classes_str = RPCSVC_SCHED_DEFAULT_CLASSES;
+
+        if (rpcsvc_sched_classes_parse (classes_str, &classes, &count))
+                return -1;
+
+        if (!svc->sched) {
+                sched = GF_CALLOC (1, sizeof (*sched),
+                                   gf_common_mt_rpcsvc_sched_t);
+                if (!sched) {
+                        rpcsvc_sched_classes_free (classes, count);
+                        return -1;
+                }
+
+                LOCK_INIT (&sched->lock);
+                INIT_LIST_HEAD (&sched->clients);
+                INIT_LIST_HEAD (&sched->active);
+                pthread_mutex_init (&sched->wake_lock, NULL);
+                pthread_cond_init (&sched->wake_cond, NULL);
+
+                if (gf_thread_create (&sched->worker, NULL,
+                                      rpcsvc_sched_worker, sched)) {
+                        gf_log (GF_RPCSVC, GF_LOG_ERROR, "could not start "
+                                "the fair-share scheduler");
+                        pthread_cond_destroy (&sched->wake_cond);
+                        pthread_mutex_destroy (&sched->wake_lock);
+                        LOCK_DESTROY (&sched->lock);
+                        GF_FREE (sched);
+                        rpcsvc_sched_classes_free (classes, count);
+                        return -1;
+                }
+                pthread_detach (sched->worker);
+
+                svc->sched = sched;
+        }
+        sched = svc->sched;
+
+        LOCK (&sched->lock);
+        {
+                old_classes = sched->classes;
+                old_count = sched->class_count;
+                sched->classes = classes;
+                sched->class_count = count;
+                sched->limit = limit;
+                sched->enabled = enabled;
+
+                list_for_each_entry (client, &sched->clients, list)
+                        __rpcsvc_sched_classify (sched, client);
+        }
+        UNLOCK (&sched->lock);
+
+        rpcsvc_sched_classes_free (old_classes, old_count);
+
+        gf_log (GF_RPCSVC, GF_LOG_INFO, "fair-share scheduling %s (limit: "
+                "%u, classes: %s)", enabled ? "enabled" : "disabled", limit,
+                classes_str);
+
+        rpcsvc_sched_wake (sched);
+
+        return 0;
+}
+
+/**
+ * rpcsvc_sched_priv - dump the scheduler state and the per-client queues
+ *
+ * @param svc - the rpc service
+ * @return 0 on success, -1 if the scheduler is busy
+ */
+int32_t
+rpcsvc_sched_priv (rpcsvc_t *svc)
+{
+        rpcsvc_sched_t        *sched  = NULL;
+        rpcsvc_sched_client_t *client = NULL;
+        char                   key[GF_DUMP_MAX_BUF_LEN] = {0, };
+        int                    i      = 0;
+
+        sched = svc->sched;
+        if (!sched)
+                return 0;
+
+        gf_proc_dump_add_section ("rpc.fair-share");
+
+        if (TRY_LOCK (&sched->lock))
+                return -1;
+
+        gf_proc_dump_build_key (key, "fair-share", "enabled");
+        gf_proc_dump_write (key, "%d", sched->enabled);
+
+        gf_proc_dump_build_key (key, "fair-share", "limit");
+        gf_proc_dump_write (key, "%u", sched->limit);
+
+        gf_proc_dump_build_key (key, "fair-share", "inflight");
+        gf_proc_dump_write (key, "%u", sched->inflight);
+
+        gf_proc_dump_build_key (key, "fair-share", "queued");
+        gf_proc_dump_write (key, "%u", sched->queued);
+
+        for (i = 0; i < sched->class_count; i++) {
+                gf_proc_dump_build_key (key, "class", "%d.pattern", i);
+                gf_proc_dump_write (key, "%s", sched->classes[i].pattern);
+                gf_proc_dump_build_key (key, "class", "%d.weight", i);
+                gf_proc_dump_write (key, "%u", sched->classes[i].weight);
+        }
+
+        i = 0;
+        list_for_each_entry (client, &sched->clients, list) {
+                gf_proc_dump_build_key (key, "client", "%d.address", i);
+                gf_proc_dump_write (key, "%s", client->addr);
+                gf_proc_dump_build_key (key, "client", "%d.class", i);
+                gf_proc_dump_write (key, "%s", (client->class < 0) ? "N/A" :
+                                    sched->classes[client->class].pattern);
+                gf_proc_dump_build_key (key, "client", "%d.weight", i);
+                gf_proc_dump_write (key, "%u", client->weight);
+                gf_proc_dump_build_key (key, "client", "%d.internal_class",
+                                        i);
+                gf_proc_dump_write (key, "%s", (client->internal_class < 0) ?
+                                    "N/A" : sched->classes
+                                    [client->internal_class].pattern);
+                gf_proc_dump_build_key (key, "client", "%d.internal_weight",
+                                        i);
+                gf_proc_dump_write (key, "%u", client->internal_weight);
+                gf_proc_dump_build_key (key, "client", "%d.queue_depth", i);
+                gf_proc_dump_write (key, "%u", client->queued);
+                gf_proc_dump_build_key (key, "client", "%d.inflight", i);
+                gf_proc_dump_write (key, "%u", client->inflight);
+                gf_proc_dump_build_key (key, "client", "%d.dispatched", i);
+                gf_proc_dump_write (key, "%"PRIu64, client->dispatched);
+                gf_proc_dump_build_key (key, "client", "%d.avg_wait_usec", i);
+                gf_proc_dump_write (key, "%"PRIu64, client->dispatched ?
+                                    client->wait_total / client->dispatched :
+                                    0);
+                gf_proc_dump_build_key (key, "client", "%d.max_wait_usec", i);
+                gf_proc_dump_write (key, "%"PRIu64, client->wait_max);
+                i++;
+        }
+
+        UNLOCK (&sched->lock);
+        return 0;
+}
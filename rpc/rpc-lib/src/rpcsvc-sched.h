@@ -0,0 +1,113 @@
+/*
+  Copyright (c) 2014 Red Hat, Inc. <http://www.redhat.com>
+  This file is part of GlusterFS.
+
+  This file is licensed to you under your choice of the GNU Lesser
+  General Public License, version 3 or any later version (LGPLv3 or
+  later), or the GNU General Public License, version 2 (GPLv2), in all
+  cases as published by the Free Software Foundation.
+*/
+
+#ifndef _RPCSVC_SCHED_H
+#define _RPCSVC_SCHED_H
+
+#ifndef _CONFIG_H
+#define _CONFIG_H
+#include "config.h"
+#endif
+
+#include "rpcsvc-common.h"
+#include "rpcsvc.h"
+#include "locking.h"
+#include "dict.h"
+
+/*
+ * Fair-share scheduling of rpc requests.
+ *
+ * At most 'limit' requests run in the actors at any time. Requests arriving
+ * beyond that are queued per client (connection), and the queues are drained
+ * with deficit round robin: on its turn a client may dispatch as many
+ * requests as the weight of their class before the next client gets its
+ * turn. Requests are dispatched by the poller which queued them, as long as
+ * the limit allows, and otherwise by a worker thread of the scheduler once
+ * requests in flight finish.
+ */
+
+#define RPCSVC_SCHED_DEFAULT_LIMIT      64
+#define RPCSVC_SCHED_DEFAULT_CLASSES    "internal:1,*:4"
+#define RPCSVC_SCHED_MAX_WEIGHT         1024
+
+/* matches requests sent with a negative pid (rebalance, geo-replication,
+ * self-heal daemon ...) instead of an address pattern */
+#define RPCSVC_SCHED_INTERNAL_CLASS     "internal"
+
+struct rpcsvc_sched_class {
+        char                      *pattern;
+        uint32_t                   weight;
+};
+typedef struct rpcsvc_sched_class rpcsvc_sched_class_t;
+
+/* per-client queue */
+struct rpcsvc_sched_client {
+        /* all clients, rpcsvc_sched_t:clients */
+        struct list_head           list;
+        /* clients with queued requests, rpcsvc_sched_t:active */
+        struct list_head           active;
+        struct list_head           requests;
+
+        char                       addr[UNIX_PATH_MAX];
+        /* index into rpcsvc_sched_t:classes, -1 if none matched, for the
+         * requests of the client and for those it sends with a negative
+         * pid */
+        int                        class;
+        uint32_t                   weight;
+        int                        internal_class;
+        uint32_t                   internal_weight;
+        int32_t                    deficit;
+
+        uint32_t                   queued;
+        uint32_t                   inflight;
+        uint64_t                   dispatched;
+        /* time spent in the queue, in usecs */
+        uint64_t                   wait_total;
+        uint64_t                   wait_max;
+};
+typedef struct rpcsvc_sched_client rpcsvc_sched_client_t;
+
+struct rpcsvc_sched {
+        gf_lock_t                  lock;
+        gf_boolean_t               enabled;
+        uint32_t                   limit;
+        uint32_t                   inflight;
+        uint32_t                   queued;
+
+        struct list_head           clients;
+        struct list_head           active;
+
+        rpcsvc_sched_class_t      *classes;
+        int                        class_count;
+
+        /* dispatches queued requests once requests in flight finish */
+        pthread_t                  worker;
+        pthread_mutex_t            wake_lock;
+        pthread_cond_t             wake_cond;
+        gf_boolean_t               wake;
+};
+
+int
+rpcsvc_sched_reconfigure (rpcsvc_t *svc, dict_t *options);
+
+int
+rpcsvc_sched_submit (rpcsvc_request_t *req, rpcsvc_actor_t *actor,
+                     struct iobuf *hdr_iobuf);
+
+void
+rpcsvc_sched_done (rpcsvc_request_t *req);
+
+void
+rpcsvc_sched_forget (rpcsvc_t *svc, rpc_transport_t *trans);
+
+int32_t
+rpcsvc_sched_priv (rpcsvc_t *svc);
+
+#endif /* _RPCSVC_SCHED_H */
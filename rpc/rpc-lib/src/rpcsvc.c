@@ -29,6 +29,7 @@
 #include "rpc-common-xdr.h"
 #include "syncop.h"
 #include "rpc-drc.h"
+#include "rpcsvc-sched.h"
 
 #include <errno.h>
 #include <pthread.h>
@@ -320,6 +321,9 @@ rpcsvc_request_destroy (rpcsvc_request_t *req)
         */
         rpcsvc_request_outstanding (req->svc, req->trans, -1);
 
+        if (req->sched_client)
+                rpcsvc_sched_done (req);
+
         rpc_transport_unref (req->trans);
 
 	GF_FREE (req->auxgidlarge);
@@ -512,8 +516,6 @@ rpcsvc_handle_rpc_call (rpcsvc_t *svc, rpc_transport_t *trans,
         uint16_t                port           = 0;
         gf_boolean_t            is_unix        = _gf_false;
         gf_boolean_t            unprivileged   = _gf_false;
-        drc_cached_op_t        *reply          = NULL;
-        rpcsvc_drc_globals_t   *drc            = NULL;
 
         if (!trans || !svc)
                 return -1;
@@ -568,36 +570,11 @@ rpcsvc_handle_rpc_call (rpcsvc_t *svc, rpc_transport_t *trans,
         }
 
         /* DRC */
-        if (rpcsvc_need_drc (req)) {
-                drc = req->svc->drc;
-
-                LOCK (&drc->lock);
-                reply = rpcsvc_drc_lookup (req);
-
-                /* retransmission of completed request, send cached reply */
-                if (reply && reply->state == DRC_OP_CACHED) {
-                        gf_log (GF_RPCSVC, GF_LOG_INFO, "duplicate request:"
-                                " XID: 0x%x", req->xid);
-                        ret = rpcsvc_send_cached_reply (req, reply);
-                        drc->cache_hits++;
-                        UNLOCK (&drc->lock);
-                        goto out;
-
-                } /* retransmitted request, original op in transit, drop it */
-                else if (reply && reply->state == DRC_OP_IN_TRANSIT) {
-                        gf_log (GF_RPCSVC, GF_LOG_INFO, "op in transit,"
-                                " discarding. XID: 0x%x", req->xid);
-                        ret = 0;
-                        drc->intransit_hits++;
-                        rpcsvc_request_destroy (req);
-                        UNLOCK (&drc->lock);
-                        goto out;
-
-                } /* fresh request, cache it as in-transit and proceed */
-                else {
-                        ret = rpcsvc_cache_request (req);
-                }
-                UNLOCK (&drc->lock);
+        if (rpcsvc_need_drc (req) && rpcsvc_drc_handle (req)) {
+                /* duplicate, answered from the cache or dropped */
+                rpcsvc_request_destroy (req);
+                ret = 0;
+                goto out;
         }
 
         if (req->rpc_err == SUCCESS) {
@@ -624,6 +601,12 @@ rpcsvc_handle_rpc_call (rpcsvc_t *svc, rpc_transport_t *trans,
                                             (synctask_fn_t) actor_fn,
                                             rpcsvc_check_and_reply_error, NULL,
                                             req);
+                } else if (rpcsvc_sched_submit (req, actor,
+                                                msg->hdr_iobuf)) {
+                        /* dispatched or queued by the fair-share scheduler,
+                         * which takes care of the reply to actor errors */
+                        ret = 0;
+                        goto out;
                 } else {
                         ret = actor_fn (req);
                 }
@@ -737,6 +720,8 @@ rpcsvc_notify (rpc_transport_t *trans, void *mydata,
                 break;
 
         case RPC_TRANSPORT_CLEANUP:
+                rpcsvc_sched_forget (svc, trans);
+
                 listener = rpcsvc_get_listener (svc, -1, trans->listener);
                 if (listener == NULL) {
                         goto out;
@@ -1144,7 +1129,6 @@ rpcsvc_submit_generic (rpcsvc_request_t *req, struct iovec *proghdr,
         size_t                  msglen     = 0;
         size_t                  hdrlen     = 0;
         char                    new_iobref = 0;
-        rpcsvc_drc_globals_t   *drc        = NULL;
 
         if ((!req) || (!req->trans))
                 return -1;
@@ -1181,13 +1165,9 @@ rpcsvc_submit_generic (rpcsvc_request_t *req, struct iovec *proghdr,
 
         /* cache the request in the duplicate request cache for appropriate ops */
         if ((req->reply) && (rpcsvc_need_drc (req))) {
-                drc = req->svc->drc;
-
-                LOCK (&drc->lock);
                 ret = rpcsvc_cache_reply (req, iobref, &recordhdr, 1,
                                           proghdr, hdrcount,
                                           payload, payloadcount);
-                UNLOCK (&drc->lock);
         }
 
         ret = rpcsvc_transport_submit (trans, &recordhdr, 1, proghdr, hdrcount,
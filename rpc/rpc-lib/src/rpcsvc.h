@@ -254,6 +254,13 @@ struct rpcsvc_request {
 
         /* pointer to cached reply for use in DRC */
         drc_cached_op_t         *reply;
+
+        /* fair-share scheduling: the queue of the client while waiting for
+         * dispatch, NULL if the request is not scheduled */
+        struct list_head         sched_list;
+        struct timeval           sched_time;
+        struct rpcsvc_sched_client *sched_client;
+        struct rpcsvc_actor_desc *sched_actor;
 };
 
 #define rpcsvc_request_program(req) ((rpcsvc_program_t *)((req)->prog))
@@ -350,6 +357,11 @@ typedef struct rpcsvc_actor_desc {
         /* Can actor be ran on behalf an unprivileged requestor? */
         gf_boolean_t            unprivileged;
         drc_op_type_t           op_type;
+
+        /* Can the actor wait for other requests (blocking locks)? Such
+         * requests are never held back by the fair-share scheduler.
+         */
+        gf_boolean_t            blocking;
 } rpcsvc_actor_t;
 
 /* Describes a program and its version along with the function pointers
@@ -487,6 +499,9 @@ rpcsvc_submit_generic (rpcsvc_request_t *req, struct iovec *proghdr,
 extern int
 rpcsvc_error_reply (rpcsvc_request_t *req);
 
+int
+rpcsvc_check_and_reply_error (int ret, call_frame_t *frame, void *opaque);
+
 #define RPCSVC_PEER_STRLEN      1024
 #define RPCSVC_AUTH_ACCEPT      1
 #define RPCSVC_AUTH_REJECT      2
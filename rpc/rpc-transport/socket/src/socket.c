@@ -36,6 +36,9 @@
 #include <netinet/tcp.h>
 #include <rpc/xdr.h>
 #include <sys/ioctl.h>
+#ifdef GF_SOCKET_ZEROCOPY
+#include <linux/errqueue.h>
+#endif
 #define GF_LOG_ERRNO(errno) ((errno == ENOTCONN) ? GF_LOG_DEBUG : GF_LOG_ERROR)
 #define SA(ptr) ((struct sockaddr *)ptr)
 
@@ -44,6 +47,7 @@
 #define SSL_PRIVATE_KEY_OPT "transport.socket.ssl-private-key"
 #define SSL_CA_LIST_OPT     "transport.socket.ssl-ca-list"
 #define OWN_THREAD_OPT      "transport.socket.own-thread"
+#define SSL_KTLS_OPT        "transport.socket.ssl-ktls"
 
 /* TBD: do automake substitutions etc. (ick) to set these. */
 #if !defined(DEFAULT_CERT_PATH)
@@ -250,6 +254,9 @@ ssl_setup_connection (rpc_transport_t *this, int server)
 	GF_VALIDATE_OR_GOTO(this->name,this->private,done);
 	priv = this->private;
 
+        priv->ktls_tx = 0;
+        priv->ktls_rx = 0;
+
 	priv->ssl_ssl = SSL_new(priv->ssl_ctx);
 	if (!priv->ssl_ssl) {
 		gf_log(this->name,GF_LOG_ERROR,"SSL_new failed");
@@ -290,6 +297,26 @@ ssl_setup_connection (rpc_transport_t *this, int server)
 		NID_commonName, peer_CN, sizeof(peer_CN)-1);
 	peer_CN[sizeof(peer_CN)-1] = '\0';
 	gf_log(this->name,GF_LOG_INFO,"peer CN = %s", peer_CN);
+
+#ifdef GF_SOCKET_KTLS
+        /*
+         * If OpenSSL managed to hand the session keys to the kernel, the
+         * socket now carries plain application data in that direction and
+         * the regular readv/writev paths can be used on it.
+         */
+        if (SSL_get_options (priv->ssl_ssl) & SSL_OP_ENABLE_KTLS) {
+                priv->ktls_tx = BIO_get_ktls_send (SSL_get_wbio (priv->ssl_ssl))
+                                ? 1 : 0;
+                priv->ktls_rx = BIO_get_ktls_recv (SSL_get_rbio (priv->ssl_ssl))
+                                ? 1 : 0;
+                gf_log (this->name, GF_LOG_DEBUG,
+                        "kernel TLS for %s: send %s, receive %s (%s)",
+                        this->peerinfo.identifier,
+                        priv->ktls_tx ? "on" : "off",
+                        priv->ktls_rx ? "on" : "off",
+                        SSL_get_cipher_name (priv->ssl_ssl));
+        }
+#endif
 	return 0;
 
 	/* Error paths. */
@@ -324,7 +351,7 @@ __socket_ssl_readv (rpc_transport_t *this, struct iovec *opvector, int opcount)
 	priv = this->private;
 	sock = priv->sock;
 
-	if (priv->use_ssl) {
+	if (priv->use_ssl && !priv->ktls_rx) {
 		ret = ssl_read_one (this, opvector->iov_base, opvector->iov_len);
 	} else {
 		ret = readv (sock, opvector, IOV_MIN(opcount));
@@ -417,6 +444,101 @@ out:
 	return ret;
 }
 
+/* Plain sockets are read through a small per-connection buffer. Every
+ * readv() fills the caller's vector and takes whatever else is queued on
+ * the socket into the buffer, so that the headers of back-to-back records
+ * come in with one syscall, while large reads (write payloads) still land
+ * directly in their iobuf. What is left in the buffer is served to the next
+ * read, which may be for the next record (see socket_event_poll_in()).
+ */
+static int
+__socket_buffered_readv (rpc_transport_t *this, struct iovec *opvector,
+                         int opcount)
+{
+        socket_private_t        *priv = NULL;
+        struct gf_sock_incoming *in = NULL;
+        struct iovec             iov[GF_SOCKET_RB_IOV];
+        size_t                   req_len = 0;
+        size_t                   rb_len = 0;
+        int                      count = 0;
+        int                      ret = -1;
+
+        priv = this->private;
+        in = &priv->incoming;
+
+        if (in->rb_start < in->rb_end) {
+                req_len = iov_length (opvector, opcount);
+                ret = iov_load (opvector, opcount, &in->rb_buf[in->rb_start],
+                                min (req_len, (in->rb_end - in->rb_start)));
+                in->rb_start += ret;
+                goto out;
+        }
+
+        in->rb_start = 0;
+        in->rb_end = 0;
+
+        if (!in->rb_buf) {
+                in->rb_buf = GF_MALLOC (GF_SOCKET_RB_SIZE, gf_common_mt_char);
+                if (!in->rb_buf) {
+                        ret = readv (priv->sock, opvector, IOV_MIN (opcount));
+                        goto out;
+                }
+        }
+
+        count = min (opcount, (GF_SOCKET_RB_IOV - 1));
+        memcpy (iov, opvector, count * sizeof (*iov));
+        req_len = iov_length (iov, count);
+
+        /* inside a large fragment only read ahead what a header needs, the
+           payload which follows it is better read in place */
+        rb_len = GF_SOCKET_RB_SIZE;
+        if ((in->record_state == SP_STATE_READING_FRAG) &&
+            ((RPC_FRAGSIZE (in->fraghdr) - in->frag.bytes_read)
+             > GF_SOCKET_RB_SIZE))
+                rb_len = GF_SOCKET_RA_MAX;
+
+        iov[count].iov_base = in->rb_buf;
+        iov[count].iov_len = rb_len;
+
+        ret = readv (priv->sock, iov, count + 1);
+        if ((ret > 0) && ((size_t) ret > req_len)) {
+                in->rb_end = ret - req_len;
+                ret = req_len;
+        }
+out:
+        return ret;
+}
+
+
+/* whether the receive buffer holds all the fragments of the next record */
+static int
+__socket_buffered_record (socket_private_t *priv)
+{
+        struct gf_sock_incoming *in = NULL;
+        uint32_t                 fraghdr = 0;
+        size_t                   offset = 0;
+
+        in = &priv->incoming;
+        if (in->record_state != SP_STATE_NADA)
+                return 0;
+
+        offset = in->rb_start;
+        while ((in->rb_end - offset) >= sizeof (fraghdr)) {
+                memcpy (&fraghdr, &in->rb_buf[offset], sizeof (fraghdr));
+                fraghdr = ntoh32 (fraghdr);
+
+                offset += sizeof (fraghdr) + RPC_FRAGSIZE (fraghdr);
+                if (offset > in->rb_end)
+                        break;
+
+                if (RPC_LASTFRAG (fraghdr))
+                        return 1;
+        }
+
+        return 0;
+}
+
+
 static gf_boolean_t
 __does_socket_rwv_error_need_logging (socket_private_t *priv, int write)
 {
@@ -472,7 +594,7 @@ __socket_rwv (rpc_transport_t *this, struct iovec *vector, int count,
                         continue;
                 }
                 if (write) {
-			if (priv->use_ssl) {
+			if (priv->use_ssl && !priv->ktls_tx) {
 				ret = ssl_write_one(this,
 					opvector->iov_base, opvector->iov_len);
 			}
@@ -484,9 +606,18 @@ __socket_rwv (rpc_transport_t *this, struct iovec *vector, int count,
                                 /* done for now */
                                 break;
                         }
+                        if (ret > 0)
+                                this->total_write_calls++;
                         this->total_bytes_write += ret;
                 } else {
-			ret = __socket_cached_read (this, opvector, opcount);
+			if (priv->use_ssl && !priv->ktls_rx) {
+				ret = __socket_cached_read (this, opvector,
+							    opcount);
+			}
+			else {
+				ret = __socket_buffered_readv (this, opvector,
+							       opcount);
+			}
 
 			if (ret == 0) {
 				gf_log(this->name,GF_LOG_DEBUG,"EOF on socket");
@@ -842,8 +973,10 @@ __socket_reset (rpc_transport_t *this)
         }
 
         GF_FREE (priv->incoming.request_info);
+        GF_FREE (priv->incoming.rb_buf);
 
         memset (&priv->incoming, 0, sizeof (priv->incoming));
+        priv->zerocopy_on = 0;
 
         event_unregister (this->ctx->event_pool, priv->sock, priv->idx);
 
@@ -978,11 +1111,292 @@ __socket_ioq_flush (rpc_transport_t *this)
                 __socket_ioq_entry_free (entry);
         }
 
+        /* the socket is going away, nothing will be sent from these */
+        while (!list_empty (&priv->zc_pending)) {
+                entry = list_entry (priv->zc_pending.next, struct ioq, list);
+                __socket_ioq_entry_free (entry);
+        }
+
 out:
         return;
 }
 
 
+/* An entry has been written out. One sent with MSG_ZEROCOPY keeps its
+ * iobref until the kernel reports that it is done with the pages.
+ */
+static void
+__socket_ioq_entry_done (rpc_transport_t *this, struct ioq *entry)
+{
+        socket_private_t *priv = this->private;
+
+        this->total_write_msgs++;
+
+        /* the kernel may already have reported the pages as released
+           while the tail of the entry was still queued */
+        if (entry->zc_sent &&
+            ((int32_t)(entry->zc_seq - priv->zc_done) >= 0)) {
+                list_del_init (&entry->list);
+                list_add_tail (&entry->list, &priv->zc_pending);
+                return;
+        }
+
+        __socket_ioq_entry_free (entry);
+}
+
+
+#ifdef GF_SOCKET_ZEROCOPY
+static int
+__socket_zerocopy_enable (rpc_transport_t *this)
+{
+        socket_private_t *priv = this->private;
+        int               on = 1;
+
+        if (priv->zerocopy_on)
+                return 1;
+
+        if (setsockopt (priv->sock, SOL_SOCKET, SO_ZEROCOPY, &on,
+                        sizeof (on)) == -1) {
+                gf_log (this->name, GF_LOG_DEBUG, "SO_ZEROCOPY not "
+                        "supported on %s (%s), sending with copies",
+                        this->peerinfo.identifier, strerror (errno));
+                priv->zerocopy_min = 0;
+                return 0;
+        }
+
+        priv->zerocopy_on = 1;
+        priv->zc_next = 0;
+        priv->zc_done = 0;
+
+        return 1;
+}
+
+
+/* Reads the MSG_ZEROCOPY completions off the error queue and releases the
+ * entries they cover. For TCP the kernel reports them in order, so the
+ * upper end of each range is all that matters.
+ */
+static int
+__socket_zerocopy_reap (rpc_transport_t *this)
+{
+        socket_private_t         *priv = this->private;
+        struct sock_extended_err *serr = NULL;
+        struct cmsghdr           *cmsg = NULL;
+        struct msghdr             msg = {0, };
+        struct ioq               *entry = NULL;
+        struct ioq               *tmp = NULL;
+        char                      control[128];
+        int                       count = 0;
+
+        if (!priv->zerocopy_on)
+                return 0;
+
+        for (;;) {
+                memset (&msg, 0, sizeof (msg));
+                msg.msg_control = control;
+                msg.msg_controllen = sizeof (control);
+
+                if (recvmsg (priv->sock, &msg, MSG_ERRQUEUE) == -1)
+                        break;
+
+                for (cmsg = CMSG_FIRSTHDR (&msg); cmsg;
+                     cmsg = CMSG_NXTHDR (&msg, cmsg)) {
+                        serr = (struct sock_extended_err *) CMSG_DATA (cmsg);
+                        if ((serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY) ||
+                            (serr->ee_errno != 0))
+                                continue;
+
+                        count++;
+
+                        if ((int32_t)(serr->ee_data + 1 - priv->zc_done) > 0)
+                                priv->zc_done = serr->ee_data + 1;
+
+                        list_for_each_entry_safe (entry, tmp,
+                                                  &priv->zc_pending, list) {
+                                if ((int32_t)(entry->zc_seq - priv->zc_done)
+                                    >= 0)
+                                        break;
+                                __socket_ioq_entry_free (entry);
+                        }
+
+                        /* the kernel had to copy anyway (e.g. loopback),
+                           pinning pages only adds to the cost */
+                        if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+                                if (priv->zerocopy_min)
+                                        gf_log (this->name, GF_LOG_DEBUG,
+                                                "zerocopy sends to %s are "
+                                                "copied, disabling",
+                                                this->peerinfo.identifier);
+                                priv->zerocopy_min = 0;
+                        }
+                }
+        }
+
+        return count;
+}
+#endif
+
+
+/* Gathers the pending vectors of @entries into as few sendmsg() calls as
+ * IOV_MAX allows. Entries which are written out are completed.
+ *
+ * return value:
+ *   0 = all of them were written
+ *  -1 = error
+ * > 0 = the socket is full
+ */
+static int
+__socket_send_entries (rpc_transport_t *this, struct ioq **entries, int count)
+{
+        socket_private_t *priv = this->private;
+        struct iovec      iov[GF_SOCKET_SEND_IOV];
+        struct msghdr     msg = {0, };
+        struct ioq       *entry = NULL;
+        int               iovcnt = 0;
+        int               zerocopy = 0;
+        int               flags = 0;
+        int               ret = -1;
+        size_t            moved = 0;
+        int               i = 0;
+        int               j = 0;
+
+        for (;;) {
+                iovcnt = 0;
+                zerocopy = 0;
+                for (i = 0; i < count; i++) {
+                        entry = entries[i];
+                        if (!entry)
+                                continue;
+                        for (j = 0; j < entry->pending_count; j++) {
+                                if (iovcnt == IOV_MIN (GF_SOCKET_SEND_IOV))
+                                        break;
+                                iov[iovcnt++] = entry->pending_vector[j];
+                        }
+                        zerocopy |= entry->zerocopy;
+                }
+
+                if (!iovcnt) {
+                        ret = 0;
+                        break;
+                }
+
+                flags = 0;
+#ifdef GF_SOCKET_ZEROCOPY
+                /* the kTLS ULP refuses MSG_ZEROCOPY */
+                if (zerocopy && priv->zerocopy_min && !priv->use_ssl &&
+                    __socket_zerocopy_enable (this))
+                        flags |= MSG_ZEROCOPY;
+#endif
+                msg.msg_iov = iov;
+                msg.msg_iovlen = iovcnt;
+
+                ret = sendmsg (priv->sock, &msg, flags);
+#ifdef GF_SOCKET_ZEROCOPY
+                if ((ret == -1) && (errno == ENOBUFS) &&
+                    (flags & MSG_ZEROCOPY)) {
+                        /* out of optmem for pinned pages, copy this one */
+                        flags = 0;
+                        ret = sendmsg (priv->sock, &msg, flags);
+                }
+#endif
+                if (ret == 0 || (ret == -1 && errno == EAGAIN)) {
+                        /* done for now */
+                        ret = 1;
+                        break;
+                }
+                if (ret == -1) {
+                        if (errno == EINTR)
+                                continue;
+
+                        if (__does_socket_rwv_error_need_logging (priv, 1)) {
+                                gf_log (this->name, GF_LOG_WARNING,
+                                        "sendmsg on %s failed (%s)",
+                                        this->peerinfo.identifier,
+                                        strerror (errno));
+                        }
+                        break;
+                }
+
+                this->total_bytes_write += ret;
+                this->total_write_calls++;
+
+                moved = ret;
+                for (i = 0; i < count; i++) {
+                        entry = entries[i];
+                        if (!entry)
+                                continue;
+
+                        while (entry->pending_count) {
+                                if (!entry->pending_vector[0].iov_len) {
+                                        entry->pending_vector++;
+                                        entry->pending_count--;
+                                        continue;
+                                }
+                                if (!moved)
+                                        break;
+
+                                if (flags & MSG_ZEROCOPY) {
+                                        entry->zc_sent = 1;
+                                        entry->zc_seq = priv->zc_next;
+                                }
+                                if (moved >= entry->pending_vector[0].iov_len) {
+                                        moved -= entry->pending_vector[0].iov_len;
+                                        entry->pending_vector++;
+                                        entry->pending_count--;
+                                } else {
+                                        entry->pending_vector[0].iov_base += moved;
+                                        entry->pending_vector[0].iov_len -= moved;
+                                        moved = 0;
+                                }
+                        }
+
+                        if (entry->pending_count)
+                                break;
+
+                        entries[i] = NULL;
+                        __socket_ioq_entry_done (this, entry);
+                }
+
+                if (flags & MSG_ZEROCOPY)
+                        priv->zc_next++;
+        }
+
+        return ret;
+}
+
+
+/* Writes out the ioq, several entries per syscall. */
+static int
+__socket_ioq_churn_batch (rpc_transport_t *this)
+{
+        socket_private_t *priv = this->private;
+        struct ioq       *entries[GF_SOCKET_SEND_ENTRIES];
+        struct ioq       *entry = NULL;
+        int               count = 0;
+        int               iovcnt = 0;
+        int               ret = 0;
+
+        while (!list_empty (&priv->ioq)) {
+                count = 0;
+                iovcnt = 0;
+                list_for_each_entry (entry, &priv->ioq, list) {
+                        if ((count == GF_SOCKET_SEND_ENTRIES) ||
+                            (count && (iovcnt + entry->pending_count
+                                       > IOV_MIN (GF_SOCKET_SEND_IOV))))
+                                break;
+                        entries[count++] = entry;
+                        iovcnt += entry->pending_count;
+                }
+
+                ret = __socket_send_entries (this, entries, count);
+                if (ret != 0)
+                        break;
+        }
+
+        return ret;
+}
+
+
 static int
 __socket_ioq_churn_entry (rpc_transport_t *this, struct ioq *entry, int direct)
 {
@@ -990,6 +1404,11 @@ __socket_ioq_churn_entry (rpc_transport_t *this, struct ioq *entry, int direct)
 	socket_private_t *priv = NULL;
 	char              a_byte = 0;
 
+        priv = this->private;
+
+        if ((!priv->use_ssl || priv->ktls_tx) && !priv->own_thread)
+                return __socket_send_entries (this, &entry, 1);
+
         ret = __socket_writev (this, entry->pending_vector,
                                entry->pending_count,
                                &entry->pending_vector,
@@ -998,8 +1417,7 @@ __socket_ioq_churn_entry (rpc_transport_t *this, struct ioq *entry, int direct)
         if (ret == 0) {
                 /* current entry was completely written */
                 GF_ASSERT (entry->pending_count == 0);
-                __socket_ioq_entry_free (entry);
-		priv = this->private;
+                __socket_ioq_entry_done (this, entry);
 		if (priv->own_thread) {
 			/*
 			 * The pipe should only remain readable if there are
@@ -1029,14 +1447,18 @@ __socket_ioq_churn (rpc_transport_t *this)
 
         priv = this->private;
 
-        while (!list_empty (&priv->ioq)) {
-                /* pick next entry */
-                entry = priv->ioq_next;
+        if ((!priv->use_ssl || priv->ktls_tx) && !priv->own_thread) {
+                ret = __socket_ioq_churn_batch (this);
+        } else {
+                while (!list_empty (&priv->ioq)) {
+                        /* pick next entry */
+                        entry = priv->ioq_next;
 
-                ret = __socket_ioq_churn_entry (this, entry, 0);
+                        ret = __socket_ioq_churn_entry (this, entry, 0);
 
-                if (ret != 0)
-                        break;
+                        if (ret != 0)
+                                break;
+                }
         }
 
         if (!priv->own_thread && list_empty (&priv->ioq)) {
@@ -1312,8 +1734,12 @@ sp_state_read_proghdr:
 sp_state_read_proghdr_xdata:
                 if (in->payload_vector.iov_base == NULL) {
 
+                        /* the payload follows the header up to the end of
+                           the record, keep it aligned for O_DIRECT */
                         size = RPC_FRAGSIZE (in->fraghdr) - frag->bytes_read;
-                        iobuf = iobuf_get2 (this->ctx->iobuf_pool, size);
+                        iobuf = iobuf_get_page_aligned (this->ctx->iobuf_pool,
+                                                        size,
+                                                        GF_SOCKET_PAYLOAD_ALIGN);
                         if (!iobuf) {
                                 ret = -1;
                                 break;
@@ -2106,16 +2532,49 @@ out:
 }
 
 
+static void
+socket_uncork (rpc_transport_t *this)
+{
+        socket_private_t *priv = this->private;
+        int               ret = 0;
+
+        pthread_mutex_lock (&priv->lock);
+        {
+                if (--priv->corked || (priv->connected != 1) ||
+                    list_empty (&priv->ioq))
+                        goto unlock;
+
+                ret = __socket_ioq_churn (this);
+                if (ret > 0) {
+                        /* continue writing on POLLOUT */
+                        priv->idx = event_select_on (this->ctx->event_pool,
+                                                     priv->sock, priv->idx,
+                                                     -1, 1);
+                } else if (ret == -1) {
+                        __socket_disconnect (this);
+                }
+        }
+unlock:
+        pthread_mutex_unlock (&priv->lock);
+}
+
+
 static int
 socket_event_poll_in (rpc_transport_t *this)
 {
         int                     ret    = -1;
+        int                     more   = 0;
+        int                     corked = 0;
         rpc_transport_pollin_t *pollin = NULL;
         socket_private_t       *priv = this->private;
 
-        ret = socket_proto_state_machine (this, &pollin);
+        do {
+                pollin = NULL;
+                ret = socket_proto_state_machine (this, &pollin);
+
+                if (pollin == NULL)
+                        break;
 
-        if (pollin != NULL) {
                 priv->ot_state = OT_CALLBACK;
                 ret = rpc_transport_notify (this, RPC_TRANSPORT_MSG_RECEIVED,
                                             pollin);
@@ -2123,7 +2582,28 @@ socket_event_poll_in (rpc_transport_t *this)
                         priv->ot_state = OT_RUNNING;
                 }
                 rpc_transport_pollin_destroy (pollin);
-        }
+
+                /* a record which is already in the receive buffer will not
+                   raise another POLLIN, handle it now. Partial ones will,
+                   once the rest of them arrives. */
+                pthread_mutex_lock (&priv->lock);
+                {
+                        more = (priv->connected == 1) &&
+                                (priv->ot_state != OT_PLEASE_DIE) &&
+                                __socket_buffered_record (priv);
+
+                        /* hold back what gets submitted while a burst of
+                           records is handled, to send it in one go */
+                        if (more && !corked && !priv->own_thread) {
+                                priv->corked++;
+                                corked = 1;
+                        }
+                }
+                pthread_mutex_unlock (&priv->lock);
+        } while ((ret >= 0) && more);
+
+        if (corked)
+                socket_uncork (this);
 
         return ret;
 }
@@ -2200,6 +2680,35 @@ out:
 }
 
 
+#ifdef GF_SOCKET_ZEROCOPY
+/* POLLERR is also how the kernel signals zerocopy completions, which are
+ * no reason to disconnect
+ */
+static int
+socket_event_poll_zerocopy (rpc_transport_t *this)
+{
+        socket_private_t *priv = this->private;
+        socklen_t         len = sizeof (int);
+        int               err = 0;
+        int               ret = 0;
+
+        pthread_mutex_lock (&priv->lock);
+        {
+                ret = __socket_zerocopy_reap (this);
+        }
+        pthread_mutex_unlock (&priv->lock);
+
+        if (ret == 0)
+                return -1;
+
+        if (getsockopt (priv->sock, SOL_SOCKET, SO_ERROR, &err, &len) || err)
+                return -1;
+
+        return 0;
+}
+#endif
+
+
 /* reads rpc_requests during pollin */
 static int
 socket_event_handler (int fd, int idx, void *data,
@@ -2233,6 +2742,11 @@ socket_event_handler (int fd, int idx, void *data,
                 ret = socket_event_poll_in (this);
         }
 
+#ifdef GF_SOCKET_ZEROCOPY
+        if (!ret && poll_err && (socket_event_poll_zerocopy (this) == 0))
+                poll_err = 0;
+#endif
+
         if ((ret < 0) || poll_err) {
                 /* Logging has happened already in earlier cases */
                 gf_log ("transport", ((ret >= 0) ? GF_LOG_INFO : GF_LOG_DEBUG),
@@ -2246,6 +2760,53 @@ out:
 }
 
 
+#ifdef GF_SOCKET_KTLS
+/*
+ * Once the kernel does the record layer in both directions, the socket
+ * carries plain data and the connection can leave its own thread for the
+ * event threads, like one without SSL. Data OpenSSL has already read would
+ * never raise an event there, so such a connection stays on its thread.
+ */
+static int
+socket_ktls_handoff (rpc_transport_t *this)
+{
+        socket_private_t *priv = this->private;
+        int               ret  = -1;
+
+        pthread_mutex_lock (&priv->lock);
+        {
+                if (!priv->ktls_tx || !priv->ktls_rx ||
+                    priv->connected != 1 || priv->ot_state != OT_RUNNING ||
+                    SSL_has_pending (priv->ssl_ssl))
+                        goto unlock;
+
+                priv->own_thread = _gf_false;
+                priv->idx = event_register (this->ctx->event_pool,
+                                            priv->sock, socket_event_handler,
+                                            this, 1,
+                                            !list_empty (&priv->ioq));
+                if (priv->idx == -1) {
+                        priv->own_thread = _gf_true;
+                        goto unlock;
+                }
+
+                priv->ktls_handoff = _gf_true;
+                priv->ot_state = OT_IDLE;
+                ret = 0;
+        }
+unlock:
+        pthread_mutex_unlock (&priv->lock);
+
+        if (!ret)
+                gf_log (this->name, GF_LOG_DEBUG,
+                        "kernel TLS on both directions for %s, moving to "
+                        "the event threads", this->peerinfo.identifier);
+
+        return ret;
+}
+#endif
+
+
 static void *
 socket_poller (void *ctx)
 {
@@ -2292,6 +2853,12 @@ socket_poller (void *ctx)
                         "asynchronous rpc_transport_notify failed");
         }
 
+#ifdef GF_SOCKET_KTLS
+        if (socket_ktls_handoff (this) == 0)
+                /* our reference now belongs to the event registration */
+                return NULL;
+#endif
+
         gen = priv->ot_gen;
 	for (;;) {
 		pthread_mutex_lock(&priv->lock);
@@ -2550,6 +3117,7 @@ socket_server_event_handler (int fd, int idx, void *data,
 			new_priv->use_ssl = priv->use_ssl;
 			new_priv->sock = new_sock;
 			new_priv->own_thread = priv->own_thread;
+                        new_priv->zerocopy_min = priv->zerocopy_min;
 
                         new_priv->ssl_ctx = priv->ssl_ctx;
 			if (priv->use_ssl && !priv->own_thread) {
@@ -2681,6 +3249,12 @@ socket_connect (rpc_transport_t *this, int port)
         pthread_mutex_lock (&priv->lock);
         {
                 sock = priv->sock;
+                /* a new connection does its handshake on its own thread
+                   again */
+                if (sock == -1 && priv->ktls_handoff) {
+                        priv->own_thread = _gf_true;
+                        priv->ktls_handoff = _gf_false;
+                }
         }
         pthread_mutex_unlock (&priv->lock);
 
@@ -2740,6 +3314,11 @@ socket_connect (rpc_transport_t *this, int port)
                         goto unlock;
                 }
 
+                /* nothing buffered from a previous connection applies */
+                priv->incoming.rb_start = 0;
+                priv->incoming.rb_end = 0;
+                priv->zerocopy_on = 0;
+
                 /* Cant help if setting socket options fails. We can continue
                  * working nonetheless.
                  */
@@ -3082,7 +3661,7 @@ socket_submit_request (rpc_transport_t *this, rpc_transport_req_t *req)
                 if (!entry)
                         goto unlock;
 
-                if (list_empty (&priv->ioq)) {
+                if (list_empty (&priv->ioq) && !priv->corked) {
                         ret = __socket_ioq_churn_entry (this, entry, 1);
 
                         if (ret == 0) {
@@ -3156,7 +3735,14 @@ socket_submit_reply (rpc_transport_t *this, rpc_transport_reply_t *reply)
                 if (!entry)
                         goto unlock;
 
-                if (list_empty (&priv->ioq)) {
+                /* large read payloads can be sent without copying them */
+                if (priv->zerocopy_min &&
+                    (iov_length (reply->msg.progpayload,
+                                 reply->msg.progpayloadcount)
+                     >= priv->zerocopy_min))
+                        entry->zerocopy = 1;
+
+                if (list_empty (&priv->ioq) && !priv->corked) {
                         ret = __socket_ioq_churn_entry (this, entry, 1);
 
                         if (ret == 0) {
@@ -3355,6 +3941,16 @@ reconfigure (rpc_transport_t *this, dict_t *options)
 
         priv->windowsize = (int)windowsize;
 
+        optstr = NULL;
+        if (dict_get_str (this->options, "transport.socket.zerocopy-threshold",
+                          &optstr) == 0) {
+                if (gf_string2bytesize (optstr, &priv->zerocopy_min) != 0) {
+                        gf_log (this->name, GF_LOG_ERROR,
+                                "invalid number format: %s", optstr);
+                        goto out;
+                }
+        }
+
         if (dict_get (this->options, "non-blocking-io")) {
                 optstr = data_to_str (dict_get (this->options,
                                                 "non-blocking-io"));
@@ -3421,6 +4017,7 @@ socket_init (rpc_transport_t *this)
         priv->bio = 0;
         priv->windowsize = GF_DEFAULT_SOCKET_WINDOW_SIZE;
         INIT_LIST_HEAD (&priv->ioq);
+        INIT_LIST_HEAD (&priv->zc_pending);
 
         /* All the below section needs 'this->options' to be present */
         if (!this->options)
@@ -3512,6 +4109,16 @@ socket_init (rpc_transport_t *this)
                 priv->backlog = backlog;
         }
 
+        optstr = NULL;
+        if (dict_get_str (this->options, "transport.socket.zerocopy-threshold",
+                          &optstr) == 0) {
+                if (gf_string2bytesize (optstr, &priv->zerocopy_min) != 0) {
+                        gf_log (this->name, GF_LOG_ERROR,
+                                "invalid number format: %s", optstr);
+                        return -1;
+                }
+        }
+
         optstr = NULL;
 
          /* Check if socket read failures are to be logged */
@@ -3580,6 +4187,16 @@ socket_init (rpc_transport_t *this)
          */
         priv->use_ssl = priv->ssl_enabled;
 
+        priv->ssl_ktls = _gf_false;
+#ifdef GF_SOCKET_KTLS
+	if (dict_get_str(this->options,SSL_KTLS_OPT,&optstr) == 0) {
+                if (gf_string2boolean (optstr, &priv->ssl_ktls) != 0) {
+                        gf_log (this->name, GF_LOG_ERROR,
+				"invalid value given for ssl-ktls boolean");
+		}
+	}
+#endif
+
 	priv->own_thread = priv->use_ssl;
 	if (dict_get_str(this->options,OWN_THREAD_OPT,&optstr) == 0) {
                 if (gf_string2boolean (optstr, &priv->own_thread) != 0) {
@@ -3594,8 +4211,30 @@ socket_init (rpc_transport_t *this)
 	if (priv->use_ssl) {
 		SSL_library_init();
 		SSL_load_error_strings();
+#ifdef GF_SOCKET_KTLS
+                if (priv->ssl_ktls) {
+                        /*
+                         * Still talks TLSv1 to old peers, but lets new ones
+                         * agree on TLSv1.2, which the kernel can offload.
+                         * TLSv1.3 is left out as its post-handshake messages
+                         * cannot be received through kTLS by OpenSSL 3.0.
+                         */
+                        priv->ssl_meth = (SSL_METHOD *)TLS_method();
+                } else
+#endif
 		priv->ssl_meth = (SSL_METHOD *)TLSv1_method();
 		priv->ssl_ctx = SSL_CTX_new(priv->ssl_meth);
+#ifdef GF_SOCKET_KTLS
+                if (priv->ssl_ktls) {
+                        SSL_CTX_set_max_proto_version (priv->ssl_ctx,
+                                                       TLS1_2_VERSION);
+                        /* a renegotiation would arrive as a non-data
+                           record, which kTLS cannot pass to us */
+                        SSL_CTX_set_options (priv->ssl_ctx,
+                                             SSL_OP_ENABLE_KTLS |
+                                             SSL_OP_NO_RENEGOTIATION);
+                }
+#endif
 
                 if (SSL_CTX_set_cipher_list(priv->ssl_ctx,
                                             "HIGH:-SSLv2") == 0) {
@@ -3683,6 +4322,7 @@ fini (rpc_transport_t *this)
                         "transport %p destroyed", this);
 
                 pthread_mutex_destroy (&priv->lock);
+                GF_FREE (priv->incoming.rb_buf);
 		if (priv->ssl_private_key) {
 			GF_FREE(priv->ssl_private_key);
 		}
@@ -3769,6 +4409,9 @@ struct volume_options options[] = {
         { .key   = {"transport.socket.read-fail-log"},
           .type  = GF_OPTION_TYPE_BOOL
         },
+        { .key   = {"transport.socket.zerocopy-threshold"},
+          .type  = GF_OPTION_TYPE_SIZET
+        },
         { .key   = {SSL_ENABLED_OPT},
           .type  = GF_OPTION_TYPE_BOOL
         },
@@ -3784,5 +4427,8 @@ struct volume_options options[] = {
 	{ .key   = {OWN_THREAD_OPT},
 	  .type  = GF_OPTION_TYPE_BOOL
 	},
+        { .key   = {SSL_KTLS_OPT},
+          .type  = GF_OPTION_TYPE_BOOL
+        },
         { .key = {NULL} }
 };
@@ -106,6 +106,9 @@ struct ioq {
         struct iovec      *pending_vector;
         int                pending_count;
         struct iobref     *iobref;
+        char               zerocopy;  /* may go out with MSG_ZEROCOPY */
+        char               zc_sent;   /* did, kept until the kernel is done */
+        uint32_t           zc_seq;    /* last zerocopy send it was part of */
 };
 
 typedef struct {
@@ -160,6 +163,25 @@ struct gf_sock_incoming_frag {
 
 #define GF_SOCKET_RA_MAX 1024
 
+/* receive buffer of plain (non-SSL) sockets, carried across records */
+#define GF_SOCKET_RB_SIZE 4096
+#define GF_SOCKET_RB_IOV  8
+
+/* alignment of the iobuf a write payload is received into */
+#define GF_SOCKET_PAYLOAD_ALIGN 4096
+
+/* ioq entries and vectors gathered into one sendmsg() */
+#define GF_SOCKET_SEND_ENTRIES 64
+#define GF_SOCKET_SEND_IOV     256
+
+#if defined(MSG_ZEROCOPY) && defined(SO_ZEROCOPY)
+#define GF_SOCKET_ZEROCOPY 1
+#endif
+
+#if defined(SSL_OP_ENABLE_KTLS) && !defined(OPENSSL_NO_KTLS)
+#define GF_SOCKET_KTLS 1
+#endif
+
 struct gf_sock_incoming {
         sp_rpcrecord_state_t  record_state;
         struct gf_sock_incoming_frag frag;
@@ -182,6 +204,10 @@ struct gf_sock_incoming {
 	size_t               ra_max;
 	size_t               ra_served;
 	char                *ra_buf;
+
+        char                *rb_buf;
+        size_t               rb_start;
+        size_t               rb_end;
 };
 
 typedef enum {
@@ -227,12 +253,23 @@ typedef struct {
 	char                  *ssl_own_cert;
 	char                  *ssl_private_key;
 	char                  *ssl_ca_list;
+        gf_boolean_t           ssl_ktls;
+        char                   ktls_tx;  /* kernel encrypts what we send */
+        char                   ktls_rx;  /* kernel decrypts what we read */
+        gf_boolean_t           ktls_handoff; /* left own_thread for the
+                                                event threads */
 	pthread_t              thread;
 	int                    pipe[2];
 	gf_boolean_t           own_thread;
         ot_state_t             ot_state;
         uint32_t               ot_gen;
         gf_boolean_t           is_server;
+        int                    corked;
+        uint64_t               zerocopy_min;  /* 0 = never */
+        char                   zerocopy_on;
+        uint32_t               zc_next;
+        uint32_t               zc_done;
+        struct list_head       zc_pending;
 } socket_private_t;
 
 
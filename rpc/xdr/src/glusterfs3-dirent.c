@@ -0,0 +1,190 @@
+/*
+  Copyright (c) 2014 Red Hat, Inc. <http://www.redhat.com>
+  This file is part of GlusterFS.
+
+  This file is licensed to you under your choice of the GNU Lesser
+  General Public License, version 3 or any later version (LGPLv3 or
+  later), or the GNU General Public License, version 2 (GPLv2), in all
+  cases as published by the Free Software Foundation.
+*/
+
+#ifndef _CONFIG_H
+#define _CONFIG_H
+#include "config.h"
+#endif
+
+#include "glusterfs3.h"
+#include "gf-dirent.h"
+#include "dict.h"
+
+/*
+ * Streaming encoder of readdirp replies. The wire format is the one of
+ * xdr_gfs3_readdirp_rsp, but the entries are encoded straight from the
+ * gf_dirent_t list: no gfs3_dirplist node and no serialized dict buffer is
+ * allocated per entry.
+ */
+
+static u_int
+gfs3_xdr_iatt_length (void)
+{
+        struct gf_iatt stat = {0, };
+
+        return xdr_sizeof ((xdrproc_t) xdr_gf_iatt, &stat);
+}
+
+/**
+ * gfs3_readdirp_rsp_length - size of the buffer gfs3_encode_readdirp_rsp
+ *                            needs
+ *
+ * @param rsp        - the reply, without entries
+ * @param entries    - the entries, or NULL
+ * @param xdata_keys - compact dict format of the peer, 0 for the regular one
+ * @return the size, an upper bound when the compact dict format is used,
+ *         -1 on failure
+ */
+ssize_t
+gfs3_readdirp_rsp_length (gfs3_readdirp_rsp *rsp, gf_dirent_t *entries,
+                          uint32_t xdata_keys)
+{
+        gf_dirent_t *entry     = NULL;
+        ssize_t      len       = 0;
+        u_int        entry_len = 0;
+        int32_t      dict_len  = 0;
+
+        /* op_ret, op_errno, end of the entry list and xdata */
+        len = 4 * XDR_BYTES_PER_UNIT + XDR_ROUNDUP (rsp->xdata.xdata_len);
+
+        if (!entries)
+                return len;
+
+        /* list link, d_ino, d_off, d_len, d_type, name and dict lengths */
+        entry_len = 9 * XDR_BYTES_PER_UNIT + gfs3_xdr_iatt_length ();
+
+        list_for_each_entry (entry, &entries->list, list) {
+                len += entry_len + XDR_ROUNDUP (strlen (entry->d_name));
+
+                if (!entry->dict)
+                        continue;
+
+                dict_len = dict_serialized_length_compact (entry->dict,
+                                                           xdata_keys);
+                if (dict_len < 0)
+                        return -1;
+                len += XDR_ROUNDUP (dict_len);
+        }
+
+        return len;
+}
+
+/* encodes the dict as opaque<>, serializing it in place */
+static bool_t
+gfs3_encode_dict (XDR *xdr, dict_t *dict, uint32_t xdata_keys)
+{
+        char    *buf      = NULL;
+        u_int    pos      = 0;
+        u_int    len      = 0;
+        int32_t  dict_len = 0;
+
+        pos = xdr_getpos (xdr);
+        if (!xdr_u_int (xdr, &len))
+                return FALSE;
+
+        if (!dict)
+                return TRUE;
+
+        dict_len = dict_serialized_length_compact (dict, xdata_keys);
+        if (dict_len <= 0)
+                return (dict_len == 0);
+
+        buf = (char *) xdr_inline (xdr, XDR_ROUNDUP (dict_len));
+        if (!buf)
+                return FALSE;
+
+        dict_len = dict_serialize_compact (dict, xdata_keys, buf);
+        if (dict_len < 0)
+                return FALSE;
+
+        len = dict_len;
+        memset (buf + len, 0, XDR_ROUNDUP (len) - len);
+
+        if (!xdr_setpos (xdr, pos) || !xdr_u_int (xdr, &len))
+                return FALSE;
+
+        return xdr_setpos (xdr, pos + XDR_BYTES_PER_UNIT + XDR_ROUNDUP (len));
+}
+
+static bool_t
+gfs3_encode_dirplist (XDR *xdr, gf_dirent_t *entry, uint32_t xdata_keys)
+{
+        gfs3_dirplist trav = {0, };
+        bool_t        more = TRUE;
+
+        trav.d_ino  = entry->d_ino;
+        trav.d_off  = entry->d_off;
+        trav.d_len  = entry->d_len;
+        trav.d_type = entry->d_type;
+        trav.name   = entry->d_name;
+
+        gf_stat_from_iatt (&trav.stat, &entry->d_stat);
+
+        if (!xdr_bool (xdr, &more))
+                return FALSE;
+        if (!xdr_u_quad_t (xdr, &trav.d_ino))
+                return FALSE;
+        if (!xdr_u_quad_t (xdr, &trav.d_off))
+                return FALSE;
+        if (!xdr_u_int (xdr, &trav.d_len))
+                return FALSE;
+        if (!xdr_u_int (xdr, &trav.d_type))
+                return FALSE;
+        if (!xdr_string (xdr, &trav.name, ~0))
+                return FALSE;
+        if (!xdr_gf_iatt (xdr, &trav.stat))
+                return FALSE;
+
+        return gfs3_encode_dict (xdr, entry->dict, xdata_keys);
+}
+
+/**
+ * gfs3_encode_readdirp_rsp - encode a readdirp reply with its entries
+ *
+ * @param outmsg     - the buffer, at least gfs3_readdirp_rsp_length () large
+ * @param rsp        - the reply, rsp->reply is ignored
+ * @param entries    - the entries, or NULL
+ * @param xdata_keys - compact dict format of the peer, 0 for the regular one
+ * @return the encoded length, -1 on failure
+ */
+ssize_t
+gfs3_encode_readdirp_rsp (struct iovec outmsg, gfs3_readdirp_rsp *rsp,
+                          gf_dirent_t *entries, uint32_t xdata_keys)
+{
+        gf_dirent_t *entry = NULL;
+        bool_t       more  = FALSE;
+        XDR          xdr;
+
+        if (!outmsg.iov_base || !rsp)
+                return -1;
+
+        xdrmem_create (&xdr, outmsg.iov_base, (unsigned int)outmsg.iov_len,
+                       XDR_ENCODE);
+
+        if (!xdr_int (&xdr, &rsp->op_ret))
+                return -1;
+        if (!xdr_int (&xdr, &rsp->op_errno))
+                return -1;
+
+        if (entries) {
+                list_for_each_entry (entry, &entries->list, list) {
+                        if (!gfs3_encode_dirplist (&xdr, entry, xdata_keys))
+                                return -1;
+                }
+        }
+
+        if (!xdr_bool (&xdr, &more))
+                return -1;
+        if (!xdr_bytes (&xdr, (char **)&rsp->xdata.xdata_val,
+                        (u_int *) &rsp->xdata.xdata_len, ~0))
+                return -1;
+
+        return xdr_encoded_length (xdr);
+}
@@ -2056,3 +2056,148 @@ xdr_gf_event_notify_rsp (XDR *xdrs, gf_event_notify_rsp *objp)
 		 return FALSE;
 	return TRUE;
 }
+
+bool_t
+xdr_gfs3_compound_op (XDR *xdrs, gfs3_compound_op *objp)
+{
+	register int32_t *buf;
+        buf = NULL;
+
+	 if (!xdr_enum (xdrs, (enum_t *) objp))
+		 return FALSE;
+	return TRUE;
+}
+
+bool_t
+xdr_gfs3_compound_link_req (XDR *xdrs, gfs3_compound_link_req *objp)
+{
+	register int32_t *buf;
+        buf = NULL;
+
+	 if (!xdr_gfs3_compound_op (xdrs, &objp->op))
+		 return FALSE;
+	switch (objp->op) {
+	case GFS3_COMPOUND_INODELK:
+		 if (!xdr_gfs3_inodelk_req (xdrs, &objp->gfs3_compound_link_req_u.inodelk_req))
+			 return FALSE;
+		break;
+	case GFS3_COMPOUND_FINODELK:
+		 if (!xdr_gfs3_finodelk_req (xdrs, &objp->gfs3_compound_link_req_u.finodelk_req))
+			 return FALSE;
+		break;
+	case GFS3_COMPOUND_ENTRYLK:
+		 if (!xdr_gfs3_entrylk_req (xdrs, &objp->gfs3_compound_link_req_u.entrylk_req))
+			 return FALSE;
+		break;
+	case GFS3_COMPOUND_FENTRYLK:
+		 if (!xdr_gfs3_fentrylk_req (xdrs, &objp->gfs3_compound_link_req_u.fentrylk_req))
+			 return FALSE;
+		break;
+	case GFS3_COMPOUND_XATTROP:
+		 if (!xdr_gfs3_xattrop_req (xdrs, &objp->gfs3_compound_link_req_u.xattrop_req))
+			 return FALSE;
+		break;
+	case GFS3_COMPOUND_FXATTROP:
+		 if (!xdr_gfs3_fxattrop_req (xdrs, &objp->gfs3_compound_link_req_u.fxattrop_req))
+			 return FALSE;
+		break;
+	case GFS3_COMPOUND_SETXATTR:
+		 if (!xdr_gfs3_setxattr_req (xdrs, &objp->gfs3_compound_link_req_u.setxattr_req))
+			 return FALSE;
+		break;
+	case GFS3_COMPOUND_FSETXATTR:
+		 if (!xdr_gfs3_fsetxattr_req (xdrs, &objp->gfs3_compound_link_req_u.fsetxattr_req))
+			 return FALSE;
+		break;
+	case GFS3_COMPOUND_WRITE:
+		 if (!xdr_gfs3_write_req (xdrs, &objp->gfs3_compound_link_req_u.write_req))
+			 return FALSE;
+		break;
+	default:
+		return FALSE;
+	}
+	return TRUE;
+}
+
+bool_t
+xdr_gfs3_compound_link_rsp (XDR *xdrs, gfs3_compound_link_rsp *objp)
+{
+	register int32_t *buf;
+        buf = NULL;
+
+	 if (!xdr_gfs3_compound_op (xdrs, &objp->op))
+		 return FALSE;
+	switch (objp->op) {
+	case GFS3_COMPOUND_INODELK:
+		 if (!xdr_gf_common_rsp (xdrs, &objp->gfs3_compound_link_rsp_u.inodelk_rsp))
+			 return FALSE;
+		break;
+	case GFS3_COMPOUND_FINODELK:
+		 if (!xdr_gf_common_rsp (xdrs, &objp->gfs3_compound_link_rsp_u.finodelk_rsp))
+			 return FALSE;
+		break;
+	case GFS3_COMPOUND_ENTRYLK:
+		 if (!xdr_gf_common_rsp (xdrs, &objp->gfs3_compound_link_rsp_u.entrylk_rsp))
+			 return FALSE;
+		break;
+	case GFS3_COMPOUND_FENTRYLK:
+		 if (!xdr_gf_common_rsp (xdrs, &objp->gfs3_compound_link_rsp_u.fentrylk_rsp))
+			 return FALSE;
+		break;
+	case GFS3_COMPOUND_XATTROP:
+		 if (!xdr_gfs3_xattrop_rsp (xdrs, &objp->gfs3_compound_link_rsp_u.xattrop_rsp))
+			 return FALSE;
+		break;
+	case GFS3_COMPOUND_FXATTROP:
+		 if (!xdr_gfs3_fxattrop_rsp (xdrs, &objp->gfs3_compound_link_rsp_u.fxattrop_rsp))
+			 return FALSE;
+		break;
+	case GFS3_COMPOUND_SETXATTR:
+		 if (!xdr_gf_common_rsp (xdrs, &objp->gfs3_compound_link_rsp_u.setxattr_rsp))
+			 return FALSE;
+		break;
+	case GFS3_COMPOUND_FSETXATTR:
+		 if (!xdr_gf_common_rsp (xdrs, &objp->gfs3_compound_link_rsp_u.fsetxattr_rsp))
+			 return FALSE;
+		break;
+	case GFS3_COMPOUND_WRITE:
+		 if (!xdr_gfs3_write_rsp (xdrs, &objp->gfs3_compound_link_rsp_u.write_rsp))
+			 return FALSE;
+		break;
+	default:
+		return FALSE;
+	}
+	return TRUE;
+}
+
+bool_t
+xdr_gfs3_compound_req (XDR *xdrs, gfs3_compound_req *objp)
+{
+	register int32_t *buf;
+        buf = NULL;
+
+	 if (!xdr_array (xdrs, (char **)&objp->links.links_val, (u_int *) &objp->links.links_len, ~0,
+		sizeof (gfs3_compound_link_req), (xdrproc_t) xdr_gfs3_compound_link_req))
+		 return FALSE;
+	 if (!xdr_bytes (xdrs, (char **)&objp->xdata.xdata_val, (u_int *) &objp->xdata.xdata_len, ~0))
+		 return FALSE;
+	return TRUE;
+}
+
+bool_t
+xdr_gfs3_compound_rsp (XDR *xdrs, gfs3_compound_rsp *objp)
+{
+	register int32_t *buf;
+        buf = NULL;
+
+	 if (!xdr_int (xdrs, &objp->op_ret))
+		 return FALSE;
+	 if (!xdr_int (xdrs, &objp->op_errno))
+		 return FALSE;
+	 if (!xdr_array (xdrs, (char **)&objp->links.links_val, (u_int *) &objp->links.links_len, ~0,
+		sizeof (gfs3_compound_link_rsp), (xdrproc_t) xdr_gfs3_compound_link_rsp))
+		 return FALSE;
+	 if (!xdr_bytes (xdrs, (char **)&objp->xdata.xdata_val, (u_int *) &objp->xdata.xdata_len, ~0))
+		 return FALSE;
+	return TRUE;
+}
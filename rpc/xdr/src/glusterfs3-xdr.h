@@ -1183,6 +1183,77 @@ struct gf_event_notify_rsp {
 };
 typedef struct gf_event_notify_rsp gf_event_notify_rsp;
 
+enum gfs3_compound_op {
+	GFS3_COMPOUND_INODELK = 1,
+	GFS3_COMPOUND_FINODELK = 2,
+	GFS3_COMPOUND_ENTRYLK = 3,
+	GFS3_COMPOUND_FENTRYLK = 4,
+	GFS3_COMPOUND_XATTROP = 5,
+	GFS3_COMPOUND_FXATTROP = 6,
+	GFS3_COMPOUND_SETXATTR = 7,
+	GFS3_COMPOUND_FSETXATTR = 8,
+	GFS3_COMPOUND_WRITE = 9,
+};
+typedef enum gfs3_compound_op gfs3_compound_op;
+
+struct gfs3_compound_link_req {
+	gfs3_compound_op op;
+	union {
+		gfs3_inodelk_req inodelk_req;
+		gfs3_finodelk_req finodelk_req;
+		gfs3_entrylk_req entrylk_req;
+		gfs3_fentrylk_req fentrylk_req;
+		gfs3_xattrop_req xattrop_req;
+		gfs3_fxattrop_req fxattrop_req;
+		gfs3_setxattr_req setxattr_req;
+		gfs3_fsetxattr_req fsetxattr_req;
+		gfs3_write_req write_req;
+	} gfs3_compound_link_req_u;
+};
+typedef struct gfs3_compound_link_req gfs3_compound_link_req;
+
+struct gfs3_compound_link_rsp {
+	gfs3_compound_op op;
+	union {
+		gf_common_rsp inodelk_rsp;
+		gf_common_rsp finodelk_rsp;
+		gf_common_rsp entrylk_rsp;
+		gf_common_rsp fentrylk_rsp;
+		gfs3_xattrop_rsp xattrop_rsp;
+		gfs3_fxattrop_rsp fxattrop_rsp;
+		gf_common_rsp setxattr_rsp;
+		gf_common_rsp fsetxattr_rsp;
+		gfs3_write_rsp write_rsp;
+	} gfs3_compound_link_rsp_u;
+};
+typedef struct gfs3_compound_link_rsp gfs3_compound_link_rsp;
+
+struct gfs3_compound_req {
+	struct {
+		u_int links_len;
+		gfs3_compound_link_req *links_val;
+	} links;
+	struct {
+		u_int xdata_len;
+		char *xdata_val;
+	} xdata;
+};
+typedef struct gfs3_compound_req gfs3_compound_req;
+
+struct gfs3_compound_rsp {
+	int op_ret;
+	int op_errno;
+	struct {
+		u_int links_len;
+		gfs3_compound_link_rsp *links_val;
+	} links;
+	struct {
+		u_int xdata_len;
+		char *xdata_val;
+	} xdata;
+};
+typedef struct gfs3_compound_rsp gfs3_compound_rsp;
+
 /* the xdr functions */
 
 #if defined(__STDC__) || defined(__cplusplus)
@@ -1284,6 +1355,11 @@ extern  bool_t xdr_gf_set_lk_ver_rsp (XDR *, gf_set_lk_ver_rsp*);
 extern  bool_t xdr_gf_set_lk_ver_req (XDR *, gf_set_lk_ver_req*);
 extern  bool_t xdr_gf_event_notify_req (XDR *, gf_event_notify_req*);
 extern  bool_t xdr_gf_event_notify_rsp (XDR *, gf_event_notify_rsp*);
+extern  bool_t xdr_gfs3_compound_op (XDR *, gfs3_compound_op*);
+extern  bool_t xdr_gfs3_compound_link_req (XDR *, gfs3_compound_link_req*);
+extern  bool_t xdr_gfs3_compound_link_rsp (XDR *, gfs3_compound_link_rsp*);
+extern  bool_t xdr_gfs3_compound_req (XDR *, gfs3_compound_req*);
+extern  bool_t xdr_gfs3_compound_rsp (XDR *, gfs3_compound_rsp*);
 
 #else /* K&R C */
 extern bool_t xdr_gf_statfs ();
@@ -1384,6 +1460,11 @@ extern bool_t xdr_gf_set_lk_ver_rsp ();
 extern bool_t xdr_gf_set_lk_ver_req ();
 extern bool_t xdr_gf_event_notify_req ();
 extern bool_t xdr_gf_event_notify_rsp ();
+extern bool_t xdr_gfs3_compound_op ();
+extern bool_t xdr_gfs3_compound_link_req ();
+extern bool_t xdr_gfs3_compound_link_rsp ();
+extern bool_t xdr_gfs3_compound_req ();
+extern bool_t xdr_gfs3_compound_rsp ();
 
 #endif /* K&R C */
 
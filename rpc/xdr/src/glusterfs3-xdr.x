@@ -1,4 +1,9 @@
 #define GF_REQUEST_MAXGROUPS    16
+
+/* xdata<> and dict<> carry a serialized dict_t. Replies to clients which
+ * announced "compact-xdata" at setvolume may use the compact encoding of
+ * dict_allocate_and_serialize_compact(), told apart by its first byte.
+ */
 struct gf_statfs {
 	unsigned hyper bsize;
 	unsigned hyper frsize;
@@ -754,3 +759,56 @@ struct gf_event_notify_rsp {
 	int op_errno;
 	opaque dict<>;
 };
+
+/* Compound fop: an ordered list of fops the brick executes one after the
+ * other, stopping at the first failure. Write payloads of all the WRITE
+ * links follow the request, in order.
+ */
+enum gfs3_compound_op {
+        GFS3_COMPOUND_INODELK   = 1,
+        GFS3_COMPOUND_FINODELK  = 2,
+        GFS3_COMPOUND_ENTRYLK   = 3,
+        GFS3_COMPOUND_FENTRYLK  = 4,
+        GFS3_COMPOUND_XATTROP   = 5,
+        GFS3_COMPOUND_FXATTROP  = 6,
+        GFS3_COMPOUND_SETXATTR  = 7,
+        GFS3_COMPOUND_FSETXATTR = 8,
+        GFS3_COMPOUND_WRITE     = 9
+};
+
+union gfs3_compound_link_req switch (gfs3_compound_op op) {
+        case GFS3_COMPOUND_INODELK:   gfs3_inodelk_req   inodelk_req;
+        case GFS3_COMPOUND_FINODELK:  gfs3_finodelk_req  finodelk_req;
+        case GFS3_COMPOUND_ENTRYLK:   gfs3_entrylk_req   entrylk_req;
+        case GFS3_COMPOUND_FENTRYLK:  gfs3_fentrylk_req  fentrylk_req;
+        case GFS3_COMPOUND_XATTROP:   gfs3_xattrop_req   xattrop_req;
+        case GFS3_COMPOUND_FXATTROP:  gfs3_fxattrop_req  fxattrop_req;
+        case GFS3_COMPOUND_SETXATTR:  gfs3_setxattr_req  setxattr_req;
+        case GFS3_COMPOUND_FSETXATTR: gfs3_fsetxattr_req fsetxattr_req;
+        case GFS3_COMPOUND_WRITE:     gfs3_write_req     write_req;
+};
+
+union gfs3_compound_link_rsp switch (gfs3_compound_op op) {
+        case GFS3_COMPOUND_INODELK:   gf_common_rsp      inodelk_rsp;
+        case GFS3_COMPOUND_FINODELK:  gf_common_rsp      finodelk_rsp;
+        case GFS3_COMPOUND_ENTRYLK:   gf_common_rsp      entrylk_rsp;
+        case GFS3_COMPOUND_FENTRYLK:  gf_common_rsp      fentrylk_rsp;
+        case GFS3_COMPOUND_XATTROP:   gfs3_xattrop_rsp   xattrop_rsp;
+        case GFS3_COMPOUND_FXATTROP:  gfs3_fxattrop_rsp  fxattrop_rsp;
+        case GFS3_COMPOUND_SETXATTR:  gf_common_rsp      setxattr_rsp;
+        case GFS3_COMPOUND_FSETXATTR: gf_common_rsp      fsetxattr_rsp;
+        case GFS3_COMPOUND_WRITE:     gfs3_write_rsp     write_rsp;
+};
+
+struct gfs3_compound_req {
+        gfs3_compound_link_req  links<>;
+        opaque                  xdata<>; /* Extra data */
+};
+
+/* Only the links which were executed have a reply */
+struct gfs3_compound_rsp {
+        int                     op_ret;
+        int                     op_errno;
+        gfs3_compound_link_rsp  links<>;
+        opaque                  xdata<>; /* Extra data */
+};
@@ -267,4 +267,14 @@ gf_stat_from_iatt (struct gf_iatt *gf_stat, struct iatt *iatt)
 	gf_stat->ia_ctime_nsec = iatt->ia_ctime_nsec ;
 }
 
+struct _gf_dirent_t;
+
+ssize_t
+gfs3_readdirp_rsp_length (gfs3_readdirp_rsp *rsp, struct _gf_dirent_t *entries,
+                          uint32_t xdata_keys);
+
+ssize_t
+gfs3_encode_readdirp_rsp (struct iovec outmsg, gfs3_readdirp_rsp *rsp,
+                          struct _gf_dirent_t *entries, uint32_t xdata_keys);
+
 #endif /* !_GLUSTERFS3_H */
@@ -24,6 +24,8 @@
 #define xdr_decoded_length(xdr) (((size_t)(&xdr)->x_private) - ((size_t)(&xdr)->x_base))
 
 #define XDR_BYTES_PER_UNIT      4
+#define XDR_ROUNDUP(len)        (((len) + XDR_BYTES_PER_UNIT - 1) &     \
+                                 ~(XDR_BYTES_PER_UNIT - 1))
 
 ssize_t
 xdr_serialize_generic (struct iovec outmsg, void *res, xdrproc_t proc);
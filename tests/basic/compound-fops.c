@@ -0,0 +1,267 @@
+/*
+ * Copyright (c) 2014 Red Hat, Inc. <http://www.redhat.com>
+ * This file is part of GlusterFS.
+ *
+ * This file is licensed to you under your choice of the GNU Lesser
+ * General Public License, version 3 or any later version (LGPLv3 or
+ * later), or the GNU General Public License, version 2 (GPLv2), in all
+ * cases as published by the Free Software Foundation.
+ */
+
+/*
+ * Drives the serial execution of compound fops, which protocol/client falls
+ * back to when the brick does not know GFS3_OP_COMPOUND, over a "brick"
+ * answering xattrop and inodelk. A post-op and unlock compound, as AFR sends
+ * it, has to execute its links in order, and has to stop at the first link
+ * which fails. The same compound sent through performance/io-threads has to
+ * be queued and resumed like any other fop.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "glusterfs.h"
+#include "globals.h"
+#include "xlator.h"
+#include "stack.h"
+#include "call-stub.h"
+#include "compound-fop.h"
+
+static char             trace[256];
+static int              xattrop_errno;
+
+static pthread_mutex_t  mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   cond  = PTHREAD_COND_INITIALIZER;
+static int              done;
+static int              op_ret;
+static int              op_errno;
+static int              rsp_count;
+
+static void
+trace_fop (const char *fop)
+{
+        if (trace[0])
+                strcat (trace, " ");
+        strcat (trace, fop);
+}
+
+static int32_t
+brick_xattrop (call_frame_t *frame, xlator_t *this, loc_t *loc,
+               gf_xattrop_flags_t optype, dict_t *xattr, dict_t *xdata)
+{
+        trace_fop ("xattrop");
+
+        if (xattrop_errno)
+                STACK_UNWIND_STRICT (xattrop, frame, -1, xattrop_errno, NULL,
+                                     NULL);
+        else
+                STACK_UNWIND_STRICT (xattrop, frame, 0, 0, xattr, NULL);
+        return 0;
+}
+
+static int32_t
+brick_inodelk (call_frame_t *frame, xlator_t *this, const char *volume,
+               loc_t *loc, int32_t cmd, struct gf_flock *flock, dict_t *xdata)
+{
+        trace_fop (flock->l_type == F_UNLCK ? "unlock" : "lock");
+
+        STACK_UNWIND_STRICT (inodelk, frame, 0, 0, NULL);
+        return 0;
+}
+
+/* as protocol/client does for a brick which does not know compound fops */
+static int32_t
+brick_compound (call_frame_t *frame, xlator_t *this, compound_args_t *args,
+                int32_t count, dict_t *xdata)
+{
+        return compound_fop_serial (frame, this, args, count, xdata);
+}
+
+static struct xlator_fops brick_fops = {
+        .xattrop  = brick_xattrop,
+        .inodelk  = brick_inodelk,
+        .compound = brick_compound,
+};
+
+static struct xlator_cbks brick_cbks;
+
+static int32_t
+compound_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+              int32_t ret, int32_t err, compound_rsp_t *rsp, int32_t count,
+              dict_t *xdata)
+{
+        pthread_mutex_lock (&mutex);
+        {
+                op_ret = ret;
+                op_errno = err;
+                rsp_count = count;
+                done = 1;
+                pthread_cond_signal (&cond);
+        }
+        pthread_mutex_unlock (&mutex);
+
+        return 0;
+}
+
+/* post-op and unlock of a transaction, as AFR sends them */
+static compound_args_t *
+post_op_unlock (loc_t *loc, dict_t *xattr)
+{
+        compound_args_t *args  = NULL;
+        struct gf_flock  flock = {0, };
+
+        args = compound_args_new (2);
+        if (!args)
+                return NULL;
+
+        flock.l_type = F_UNLCK;
+        if (compound_args_xattrop (&args[0], loc, GF_XATTROP_ADD_ARRAY, xattr,
+                                   NULL) ||
+            compound_args_inodelk (&args[1], "domain", loc, F_SETLK, &flock,
+                                   NULL)) {
+                compound_args_destroy (args, 2);
+                return NULL;
+        }
+
+        return args;
+}
+
+static int
+do_compound (xlator_t *xl, compound_args_t *args, int32_t count)
+{
+        call_frame_t *frame = NULL;
+
+        frame = create_frame (xl, xl->ctx->pool);
+        if (!frame)
+                return -1;
+
+        trace[0] = '\0';
+        done = 0;
+
+        STACK_WIND (frame, compound_cbk, xl, xl->fops->compound, args, count,
+                    NULL);
+
+        pthread_mutex_lock (&mutex);
+        {
+                while (!done)
+                        pthread_cond_wait (&cond, &mutex);
+        }
+        pthread_mutex_unlock (&mutex);
+
+        STACK_DESTROY (frame->root);
+
+        return op_ret;
+}
+
+#define CHECK(cond, msg) do {                                   \
+                if (!(cond)) {                                  \
+                        fprintf (stderr, "FAIL: %s\n", msg);    \
+                        return 1;                               \
+                }                                               \
+        } while (0)
+
+int
+main (int argc, char *argv[])
+{
+        glusterfs_ctx_t *ctx    = NULL;
+        xlator_t        *brick  = NULL;
+        xlator_t        *iot    = NULL;
+        xlator_list_t   *child  = NULL;
+        xlator_list_t   *parent = NULL;
+        compound_args_t *args   = NULL;
+        dict_t          *xattr  = NULL;
+        loc_t            loc    = {0, };
+
+        ctx = glusterfs_ctx_new ();
+        if (!ctx || glusterfs_globals_init (ctx))
+                return 1;
+        THIS->ctx = ctx;
+
+        ctx->pool = calloc (1, sizeof (call_pool_t));
+        if (!ctx->pool)
+                return 1;
+        INIT_LIST_HEAD (&ctx->pool->all_frames);
+        LOCK_INIT (&ctx->pool->lock);
+        ctx->pool->frame_mem_pool = mem_pool_new (call_frame_t, 16);
+        ctx->pool->stack_mem_pool = mem_pool_new (call_stack_t, 16);
+        ctx->stub_mem_pool = mem_pool_new (call_stub_t, 16);
+        ctx->dict_pool = mem_pool_new (dict_t, 16);
+        ctx->dict_pair_pool = mem_pool_new (data_pair_t, 16);
+        ctx->dict_data_pool = mem_pool_new (data_t, 16);
+        if (!ctx->pool->frame_mem_pool || !ctx->pool->stack_mem_pool ||
+            !ctx->stub_mem_pool || !ctx->dict_pool || !ctx->dict_pair_pool ||
+            !ctx->dict_data_pool)
+                return 1;
+
+        brick = calloc (1, sizeof (*brick));
+        iot = calloc (1, sizeof (*iot));
+        child = calloc (1, sizeof (*child));
+        parent = calloc (1, sizeof (*parent));
+        if (!brick || !iot || !child || !parent)
+                return 1;
+
+        brick->name = "brick";
+        brick->type = "storage/fake";
+        brick->ctx = ctx;
+        brick->fops = &brick_fops;
+        brick->cbks = &brick_cbks;
+        parent->xlator = iot;
+        brick->parents = parent;
+
+        iot->name = "iot";
+        iot->ctx = ctx;
+        iot->options = dict_new ();
+        if (!iot->options)
+                return 1;
+        CHECK (!xlator_set_type (iot, "performance/io-threads"),
+               "loading performance/io-threads");
+        child->xlator = brick;
+        iot->children = child;
+        CHECK (!xlator_init (iot), "init of io-threads");
+
+        loc.path = "/file";
+        loc.name = "file";
+        xattr = dict_new ();
+        if (!xattr || dict_set_str (xattr, "trusted.afr.dirty", "0"))
+                return 1;
+
+        args = post_op_unlock (&loc, xattr);
+        CHECK (args, "building the compound fop");
+
+        /* links executed in order */
+        do_compound (brick, args, 2);
+        CHECK (op_ret == 0 && rsp_count == 2, "serial: both links succeed");
+        CHECK (!strcmp (trace, "xattrop unlock"), "serial: order of links");
+
+        /* the post-op fails, the unlock must not be executed */
+        xattrop_errno = EIO;
+        do_compound (brick, args, 2);
+        CHECK (op_ret == -1 && op_errno == EIO && rsp_count == 1,
+               "serial: failed link ends the compound fop");
+        CHECK (!strcmp (trace, "xattrop"), "serial: link after a failure");
+        xattrop_errno = 0;
+
+        /* queued by io-threads, resumed on one of its workers */
+        do_compound (iot, args, 2);
+        CHECK (op_ret == 0 && rsp_count == 2, "io-threads: both links");
+        CHECK (!strcmp (trace, "xattrop unlock"),
+               "io-threads: order of links");
+
+        compound_args_destroy (args, 2);
+
+        /* a link for a fop which compound fops do not carry */
+        args = compound_args_new (1);
+        CHECK (args, "building the compound fop");
+        args[0].fop = GF_FOP_STAT;
+        do_compound (brick, args, 1);
+        CHECK (op_ret == -1 && op_errno == ENOTSUP && rsp_count == 1,
+               "serial: unsupported link");
+        compound_args_destroy (args, 1);
+
+        dict_unref (xattr);
+
+        return 0;
+}
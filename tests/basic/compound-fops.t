@@ -0,0 +1,88 @@
+#!/bin/bash
+
+# With cluster.use-compound-fops, AFR sends the post-op and the unlock of a
+# write to each brick as one compound fop. The data and the changelog on the
+# bricks must come out as without it, and no lock may be left behind. The
+# tester covers the link by link execution protocol/client falls back to.
+
+. $(dirname $0)/../include.rc
+. $(dirname $0)/../volume.rc
+
+# compound fops sent by the client xlator $1 (as GFS3_OP_COMPOUND, or link
+# by link when $2 is "serial")
+function compound_fops {
+        local client=$1
+        local key=compound_fops${2:+_$2}
+        local dump=$(generate_mount_statedump $V0)
+        sed -n "/^\[xlator.protocol.client.$client.priv\]/,/^\[/p" $dump | \
+                grep "^$key=" | cut -f2 -d'='
+        cleanup_mount_statedump $V0
+}
+
+# inodelks held on the brick $1
+function active_inodelks {
+        local dump=$(generate_brick_statedump $V0 $H0 $1)
+        grep "^inodelk.*(ACTIVE)" $dump | wc -l
+        cleanup_statedump $(get_brick_pid $V0 $H0 $1)
+}
+
+cleanup;
+
+TEST build_tester $(dirname $0)/compound-fops.c $(libglusterfs_tester_flags)
+TEST $(dirname $0)/compound-fops
+rm -f $(dirname $0)/compound-fops
+
+TEST glusterd
+TEST pidof glusterd
+
+TEST $CLI volume create $V0 replica 2 $H0:$B0/${V0}0 $H0:$B0/${V0}1
+TEST $CLI volume set $V0 cluster.use-compound-fops on
+# every write is a transaction of its own, with a post-op and an unlock
+TEST $CLI volume set $V0 cluster.eager-lock off
+TEST $CLI volume set $V0 performance.write-behind off
+TEST $CLI volume set $V0 cluster.self-heal-daemon off
+TEST $CLI volume start $V0
+
+TEST glusterfs --volfile-server=$H0 --volfile-id=$V0 $M0
+
+TEST dd if=/dev/urandom of=$B0/src bs=128k count=64
+TEST dd if=$B0/src of=$M0/file bs=128k
+TEST setfattr -n user.attr -v value $M0/file
+
+TEST cmp $B0/src $B0/${V0}0/file
+TEST cmp $B0/src $B0/${V0}1/file
+
+# both bricks are up to date, and the writes did not stay dirty
+EXPECT "000000000000000000000000" echo $(afr_get_changelog_xattr \
+        $B0/${V0}0/file trusted.afr.dirty | cut -c3-)
+EXPECT "000000000000000000000000" echo $(afr_get_changelog_xattr \
+        $B0/${V0}1/file trusted.afr.dirty | cut -c3-)
+EXPECT "000000000000000000000000" echo $(afr_get_changelog_xattr \
+        $B0/${V0}0/file trusted.afr.$V0-client-1 | cut -c3-)
+EXPECT "000000000000000000000000" echo $(afr_get_changelog_xattr \
+        $B0/${V0}1/file trusted.afr.$V0-client-0 | cut -c3-)
+
+# the unlocks went out with the post-ops
+EXPECT "0" active_inodelks $B0/${V0}0
+EXPECT "0" active_inodelks $B0/${V0}1
+TEST [ "$(compound_fops $V0-client-0)" -gt 0 ]
+TEST [ "$(compound_fops $V0-client-1)" -gt 0 ]
+EXPECT "0" compound_fops $V0-client-0 serial
+
+# with a brick down, the post-op on the other one records the pending write
+TEST kill_brick $V0 $H0 $B0/${V0}1
+TEST dd if=/dev/urandom of=$M0/file bs=128k count=1 conv=notrunc
+EXPECT "0" active_inodelks $B0/${V0}0
+EXPECT_NOT "00000000" afr_get_specific_changelog_xattr $B0/${V0}0/file \
+        trusted.afr.$V0-client-1 data
+
+TEST $CLI volume start $V0 force
+EXPECT_WITHIN 20 "1" afr_child_up_status $V0 1
+
+TEST umount $M0
+TEST $CLI volume stop $V0
+TEST $CLI volume delete $V0
+
+rm -f $B0/src
+
+cleanup;
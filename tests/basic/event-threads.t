@@ -0,0 +1,38 @@
+#!/bin/bash
+
+. $(dirname $0)/../include.rc
+. $(dirname $0)/../volume.rc
+
+cleanup;
+
+TEST glusterd
+TEST pidof glusterd
+
+TEST $CLI volume create $V0 replica 2 $H0:$B0/${V0}{1,2,3,4};
+TEST $CLI volume set $V0 server.event-threads 4;
+TEST $CLI volume set $V0 client.event-threads 4;
+TEST ! $CLI volume set $V0 client.event-threads 0;
+TEST ! $CLI volume set $V0 server.event-threads 33;
+TEST $CLI volume start $V0;
+
+TEST glusterfs -s $H0 --volfile-id $V0 $M0;
+
+for i in $(seq 1 8); do
+        dd if=/dev/zero of=$M0/file$i bs=128k count=64 2>/dev/null &
+done
+wait
+
+EXPECT "8" echo $(ls $M0 | wc -l)
+EXPECT "8388608" stat -c %s $M0/file8
+
+# Threads can be added and removed while I/O is going on.
+TEST $CLI volume set $V0 server.event-threads 2;
+TEST $CLI volume set $V0 client.event-threads 8;
+TEST dd if=/dev/zero of=$M0/file9 bs=128k count=64;
+TEST cat $M0/file{1..9} > /dev/null;
+
+TEST umount $M0
+TEST $CLI volume stop $V0;
+TEST $CLI volume delete $V0;
+
+cleanup;
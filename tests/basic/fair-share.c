@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2014 Red Hat, Inc. <http://www.redhat.com>
+ * This file is part of GlusterFS.
+ *
+ * This file is licensed to you under your choice of the GNU Lesser
+ * General Public License, version 3 or any later version (LGPLv3 or
+ * later), or the GNU General Public License, version 2 (GPLv2), in all
+ * cases as published by the Free Software Foundation.
+ */
+
+/*
+ * Queues requests of several clients in the fair-share scheduler of rpcsvc,
+ * with room for a single request in flight, and finishes the requests one
+ * at a time. The order in which the scheduler worker dispatches the queued
+ * requests has to give each client its turn, with as many requests as the
+ * weight of their class, and a request sent with a negative pid has to be
+ * weighed by the internal class without changing the weight of the other
+ * requests of its client.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "glusterfs.h"
+#include "globals.h"
+#include "xlator.h"
+#include "rpcsvc.h"
+#include "rpcsvc-sched.h"
+
+#define NCLIENTS 3
+
+static rpc_transport_t   trans[2 * NCLIENTS];
+
+static pthread_mutex_t   mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t    cond  = PTHREAD_COND_INITIALIZER;
+static char              order[64];
+static int               dispatched;
+static rpcsvc_request_t *running;
+
+/* remembers the client of the request, which stays in flight */
+static int
+record_actor (rpcsvc_request_t *req)
+{
+        pthread_mutex_lock (&mutex);
+        {
+                order[dispatched++] = '0' + (req->trans - trans) % NCLIENTS;
+                running = req;
+                pthread_cond_signal (&cond);
+        }
+        pthread_mutex_unlock (&mutex);
+
+        return 0;
+}
+
+static rpcsvc_actor_t actor = {
+        .procname = "RECORD",
+        .actor    = record_actor,
+};
+
+static int
+reconfigure (rpcsvc_t *svc, const char *classes)
+{
+        dict_t *options = NULL;
+        int     ret     = -1;
+
+        options = dict_new ();
+        if (!options)
+                return -1;
+
+        if (!dict_set_str (options, "rpc.fair-share", "on") &&
+            !dict_set_str (options, "rpc.fair-share-limit", "1") &&
+            !dict_set_str (options, "rpc.fair-share-classes",
+                           (char *)classes))
+                ret = rpcsvc_sched_reconfigure (svc, options);
+
+        dict_unref (options);
+
+        return ret;
+}
+
+static int
+submit (rpcsvc_t *svc, rpc_transport_t *t, int pid)
+{
+        rpcsvc_request_t *req = NULL;
+
+        req = calloc (1, sizeof (*req));
+        if (!req)
+                return -1;
+
+        req->svc = svc;
+        req->trans = t;
+        req->pid = pid;
+        INIT_LIST_HEAD (&req->sched_list);
+
+        return rpcsvc_sched_submit (req, &actor, NULL) ? 0 : -1;
+}
+
+/* finishes the request in flight, and waits for the next one, @count
+ * times */
+static void
+finish (int count)
+{
+        rpcsvc_request_t *req  = NULL;
+        int               next = 0;
+
+        while (count--) {
+                pthread_mutex_lock (&mutex);
+                {
+                        req = running;
+                        running = NULL;
+                        next = dispatched + 1;
+                }
+                pthread_mutex_unlock (&mutex);
+
+                rpcsvc_sched_done (req);
+                free (req);
+
+                pthread_mutex_lock (&mutex);
+                {
+                        while (dispatched < next)
+                                pthread_cond_wait (&cond, &mutex);
+                }
+                pthread_mutex_unlock (&mutex);
+        }
+}
+
+/* @t queues @n requests, the first @internal with a negative pid */
+static int
+queue (rpcsvc_t *svc, rpc_transport_t *t, int n, int internal)
+{
+        int i = 0;
+
+        for (i = 0; i < n; i++)
+                if (submit (svc, t, (i < internal) ? -1 : 1000))
+                        return -1;
+
+        return 0;
+}
+
+static void
+reset (void)
+{
+        pthread_mutex_lock (&mutex);
+        {
+                memset (order, 0, sizeof (order));
+                dispatched = 0;
+        }
+        pthread_mutex_unlock (&mutex);
+}
+
+#define CHECK(cond, msg) do {                                   \
+                if (!(cond)) {                                  \
+                        fprintf (stderr, "FAIL: %s (%s)\n",     \
+                                 msg, order);                   \
+                        return 1;                               \
+                }                                               \
+        } while (0)
+
+int
+main (int argc, char *argv[])
+{
+        glusterfs_ctx_t *ctx = NULL;
+        rpcsvc_t        *svc = NULL;
+        int              i   = 0;
+
+        ctx = glusterfs_ctx_new ();
+        if (!ctx || glusterfs_globals_init (ctx))
+                return 1;
+        THIS->ctx = ctx;
+
+        ctx->dict_pool = mem_pool_new (dict_t, 16);
+        ctx->dict_pair_pool = mem_pool_new (data_pair_t, 16);
+        ctx->dict_data_pool = mem_pool_new (data_t, 16);
+        if (!ctx->dict_pool || !ctx->dict_pair_pool || !ctx->dict_data_pool)
+                return 1;
+
+        svc = calloc (1, sizeof (*svc));
+        if (!svc)
+                return 1;
+        svc->mydata = THIS;
+
+        for (i = 0; i < 2 * NCLIENTS; i++) {
+                snprintf (trans[i].peerinfo.identifier,
+                          sizeof (trans[i].peerinfo.identifier),
+                          "10.0.%d.%d:%d", i / NCLIENTS, i % NCLIENTS + 1,
+                          1000 + i);
+                trans[i].peerinfo.sockaddr.ss_family = AF_INET;
+        }
+
+        /* same weights: the clients take turns */
+        CHECK (!reconfigure (svc, "*:1"), "enabling fair-share");
+        reset ();
+        CHECK (!submit (svc, &trans[0], 1000), "first request");
+        CHECK (!queue (svc, &trans[0], 3, 0) &&
+               !queue (svc, &trans[1], 3, 0) &&
+               !queue (svc, &trans[2], 3, 0), "queueing");
+        CHECK (dispatched == 1, "requests held back by the limit");
+        finish (9);
+        CHECK (!strcmp (order, "0012012012"), "round robin");
+
+        /* the second client gets two requests per turn */
+        CHECK (!reconfigure (svc, "10.0.0.2:2,*:1"), "weighted classes");
+        reset ();
+        CHECK (!queue (svc, &trans[0], 4, 0) &&
+               !queue (svc, &trans[1], 4, 0) &&
+               !queue (svc, &trans[2], 4, 0), "queueing");
+        finish (12);
+        CHECK (!strcmp (order, "011201120202"), "weighted round robin");
+
+        /* the first request of a client is internal and takes a turn of
+         * its own, the others are not held to the weight of the internal
+         * class; the requests the third client sends with a negative pid
+         * are */
+        CHECK (!reconfigure (svc, "internal:1,*:4"), "internal class");
+        reset ();
+        CHECK (!queue (svc, &trans[NCLIENTS], 5, 1) &&
+               !queue (svc, &trans[NCLIENTS + 1], 4, 0) &&
+               !queue (svc, &trans[NCLIENTS + 2], 2, 2), "queueing");
+        finish (11);
+        CHECK (!strcmp (order, "01111200002"), "classes per request");
+
+        /* the last request in flight */
+        rpcsvc_sched_done (running);
+        free (running);
+
+        return 0;
+}
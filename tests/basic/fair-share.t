@@ -0,0 +1,17 @@
+#!/bin/bash
+
+# Requests of several clients queued in the fair-share scheduler of rpcsvc
+# are dispatched in turns, by the weight of the class of each request.
+
+. $(dirname $0)/../include.rc
+
+cleanup;
+
+TOP=$(dirname $0)/../..
+
+TEST build_tester $(dirname $0)/fair-share.c $(libglusterfs_tester_flags) \
+        -I$TOP/rpc/rpc-lib/src -I$TOP/rpc/xdr/src -lgfrpc -lgfxdr
+TEST $(dirname $0)/fair-share
+rm -f $(dirname $0)/fair-share
+
+cleanup;
@@ -10,6 +10,7 @@
 
 #include <stdio.h>
 #include <unistd.h>
+#include <pthread.h>
 
 #include "glusterfs.h"
 #include "globals.h"
@@ -23,6 +24,76 @@ glusterfs_ctx_t   *ctx = NULL;
 #define TEST_FILENAME           "/tmp/logchecks.log"
 #define GF_LOG_CONTROL_FILE     "/etc/glusterfs/logger.conf"
 
+/* threads logging numbered messages through rings of the smallest size */
+#define RING_THREADS            4
+#define RING_MSGS               2000
+#define RING_SIZE               (4 * 1024)
+
+static void *
+ring_logger (void *data)
+{
+        long     id = (long) data;
+        int      i = 0;
+
+        THIS->ctx = ctx;
+
+        for (i = 0; i < RING_MSGS; i++)
+                gf_msg ("logchecks", GF_LOG_INFO, 0, logchecks_msg_20, id, i);
+
+        return NULL;
+}
+
+/* Every numbered message must be in the log file once, and the messages of
+   each thread in the order they were logged. */
+static int
+ring_check (void)
+{
+        FILE    *fp = NULL;
+        char     line[1024];
+        char    *p = NULL;
+        long     id = 0;
+        int      i = 0;
+        int      next[RING_THREADS] = {0, };
+        int      ret = -1;
+
+        fp = fopen (TEST_FILENAME, "r");
+        if (!fp) {
+                printf ("Error opening %s [%s]\n", TEST_FILENAME,
+                        strerror (errno));
+                return -1;
+        }
+
+        while (fgets (line, sizeof (line), fp)) {
+                p = strstr (line, "ring-check ");
+                if (!p || sscanf (p, "ring-check %ld %d", &id, &i) != 2)
+                        continue;
+                if (id < 0 || id >= RING_THREADS) {
+                        printf ("FAIL: unknown ring thread %ld\n", id);
+                        goto out;
+                }
+                if (i != next[id]) {
+                        printf ("FAIL: thread %ld message %d, expected %d\n",
+                                id, i, next[id]);
+                        goto out;
+                }
+                next[id]++;
+        }
+
+        for (id = 0; id < RING_THREADS; id++) {
+                if (next[id] != RING_MSGS) {
+                        printf ("FAIL: thread %ld logged %d messages of %d\n",
+                                id, next[id], RING_MSGS);
+                        goto out;
+                }
+        }
+
+        ret = 0;
+out:
+        fclose (fp);
+
+        return ret;
+}
+
 int
 go_log_vargs(gf_loglevel_t level, const char *fmt, ...)
 {
@@ -103,6 +174,8 @@ int
 main (int argc, char *argv[])
 {
         int                ret = -1;
+        pthread_t          threads[RING_THREADS];
+        long               id = 0;
 
         unlink (GF_LOG_CONTROL_FILE);
         creat (GF_LOG_CONTROL_FILE, O_RDONLY);
@@ -193,6 +266,45 @@ main (int argc, char *argv[])
         go_log ();
         gf_msg ("logchecks", GF_LOG_ALERT, 0, logchecks_msg_11);
 
+        /* Reset to run with the log writer thread */
+        gf_log_set_logger (gf_logger_glusterlog);
+        gf_log_set_logformat (gf_logformat_withmsgid);
+        gf_log_set_loglevel (GF_LOG_INFO);
+
+        /* TEST 10: Messages queued to the writer thread, repeats of
+         * logchecks_msg_6 are written once with a count */
+        gf_msg ("logchecks", GF_LOG_ALERT, 0, logchecks_msg_11);
+        gf_log_set_log_buf_size (32 * 1024);
+        go_log ();
+        for (ret = 0; ret < 10; ret++)
+                gf_msg ("logchecks", GF_LOG_CRITICAL, 0, logchecks_msg_6);
+        gf_log_flush ();
+        gf_log_set_log_buf_size (0);
+        gf_msg ("logchecks", GF_LOG_ALERT, 0, logchecks_msg_11);
+
+        /* TEST 11: Rings filling up faster than the writer drains them,
+         * nothing may be lost or reordered */
+        ret = gf_log_set_log_buf_size (RING_SIZE);
+        if (ret != 0) {
+                printf ("Error from gf_log_set_log_buf_size\n");
+                return -1;
+        }
+        for (id = 0; id < RING_THREADS; id++) {
+                if (pthread_create (&threads[id], NULL, ring_logger,
+                                    (void *) id) != 0) {
+                        printf ("Error creating a logging thread\n");
+                        return -1;
+                }
+        }
+        for (id = 0; id < RING_THREADS; id++)
+                pthread_join (threads[id], NULL);
+        gf_log_flush ();
+        gf_log_set_log_buf_size (0);
+
+        ret = ring_check ();
+        if (ret != 0)
+                return -1;
+
         // TODO: signal crash prints, but not yet feasible here
         // TODO: Graph printing
         // TODO: Multi threaded logging
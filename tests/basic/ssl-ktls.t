@@ -0,0 +1,69 @@
+#!/bin/bash
+
+# I/O over SSL connections, with the record layer in OpenSSL and with it
+# handed to the kernel (where the tls module is there to take it).
+
+. $(dirname $0)/../include.rc
+. $(dirname $0)/../volume.rc
+
+SSL_BASE=/etc/ssl
+SSL_KEY=$SSL_BASE/glusterfs.key
+SSL_CERT=$SSL_BASE/glusterfs.pem
+SSL_CA=$SSL_BASE/glusterfs.ca
+
+function io_check {
+        local f=$1
+
+        dd if=/dev/urandom of=$B0/$f bs=1M count=16 2>/dev/null || return 1
+        cp $B0/$f $M0/$f || return 1
+        # read back on a fresh mount, nothing cached
+        umount $M0 || return 1
+        glusterfs --volfile-server=$H0 --volfile-id=$V0 $M0 || return 1
+        cmp $B0/$f $M0/$f
+}
+
+function same_content {
+        cmp -s $1 $2 && echo "Y"
+}
+
+cleanup;
+rm -f $SSL_BASE/glusterfs.*
+modprobe tls 2>/dev/null
+
+TEST glusterd
+TEST pidof glusterd
+
+TEST openssl genrsa -out $SSL_KEY 2048
+TEST openssl req -new -x509 -key $SSL_KEY -subj /CN=Anyone -out $SSL_CERT
+ln $SSL_CERT $SSL_CA
+
+TEST $CLI volume create $V0 $H0:$B0/${V0}1
+TEST $CLI volume set $V0 server.ssl on
+TEST $CLI volume set $V0 client.ssl on
+TEST $CLI volume start $V0
+
+TEST glusterfs --volfile-server=$H0 --volfile-id=$V0 $M0
+TEST io_check file1
+TEST umount $M0
+TEST $CLI volume stop $V0
+
+TEST $CLI volume set $V0 server.ssl-ktls on
+TEST $CLI volume set $V0 client.ssl-ktls on
+TEST $CLI volume start $V0
+
+TEST glusterfs --volfile-server=$H0 --volfile-id=$V0 $M0
+TEST io_check file2
+# data written without kTLS reads back the same with it
+TEST cmp $B0/file1 $M0/file1
+
+# the client reconnects, and hands the new connection over again
+TEST kill_brick $V0 $H0 $B0/${V0}1
+TEST $CLI volume start $V0 force
+EXPECT_WITHIN 20 "Y" same_content $B0/file2 $M0/file2
+
+TEST umount $M0
+TEST $CLI volume stop $V0
+TEST $CLI volume delete $V0
+
+rm -f $SSL_BASE/glusterfs.* $B0/file1 $B0/file2
+cleanup;
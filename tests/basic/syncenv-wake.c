@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2014 Red Hat, Inc. <http://www.redhat.com>
+ * This file is part of GlusterFS.
+ *
+ * This file is licensed to you under your choice of the GNU Lesser
+ * General Public License, version 3 or any later version (LGPLv3 or
+ * later), or the GNU General Public License, version 2 (GPLv2), in all
+ * cases as published by the Free Software Foundation.
+ */
+
+/*
+ * A task woken by a task which goes on running (and blocking) must be
+ * picked up by an idle processor, not wait for the waker to yield.
+ *
+ * With two processors, "filler" keeps one of them busy while "waker" sets
+ * up "sleeper" on the runq of the other one. Once filler is done and its
+ * processor went to sleep, waker wakes sleeper and blocks for
+ * BLOCK_SECS. sleeper must run well before that.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include "glusterfs.h"
+#include "globals.h"
+#include "stack.h"
+#include "syncop.h"
+
+#define BLOCK_SECS 3
+
+static syncbarrier_t ready;
+static syncbarrier_t go;
+static double        woken_at;
+static double        ran_at;
+
+static double
+now (void)
+{
+        struct timeval tv = {0, };
+
+        gettimeofday (&tv, NULL);
+
+        return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static int
+filler (void *opaque)
+{
+        sleep (1);
+        return 0;
+}
+
+static int
+filler_done (int ret, call_frame_t *frame, void *opaque)
+{
+        return 0;
+}
+
+static int
+sleeper (void *opaque)
+{
+        syncbarrier_wake (&ready);
+        syncbarrier_wait (&go, 1);
+        ran_at = now ();
+        syncbarrier_wake (&ready);
+        return 0;
+}
+
+static int
+sleeper_done (int ret, call_frame_t *frame, void *opaque)
+{
+        return 0;
+}
+
+static int
+waker (void *opaque)
+{
+        struct syncenv *env = opaque;
+
+        /* lands on the runq of our processor, the other one is busy */
+        if (synctask_new (env, sleeper, sleeper_done, NULL, NULL))
+                return -1;
+        syncbarrier_wait (&ready, 1);
+
+        /* let the filler finish and its processor go to sleep */
+        sleep (2);
+
+        woken_at = now ();
+        syncbarrier_wake (&go);
+        sleep (BLOCK_SECS);
+
+        syncbarrier_wait (&ready, 1);
+        return 0;
+}
+
+int
+main (int argc, char *argv[])
+{
+        glusterfs_ctx_t *ctx = NULL;
+        struct syncenv  *env = NULL;
+        double           delay = 0;
+
+        ctx = glusterfs_ctx_new ();
+        if (!ctx || glusterfs_globals_init (ctx))
+                return 1;
+        THIS->ctx = ctx;
+
+        ctx->pool = calloc (1, sizeof (call_pool_t));
+        if (!ctx->pool)
+                return 1;
+        INIT_LIST_HEAD (&ctx->pool->all_frames);
+        LOCK_INIT (&ctx->pool->lock);
+        ctx->pool->frame_mem_pool = mem_pool_new (call_frame_t, 16);
+        ctx->pool->stack_mem_pool = mem_pool_new (call_stack_t, 16);
+        if (!ctx->pool->frame_mem_pool || !ctx->pool->stack_mem_pool)
+                return 1;
+
+        env = syncenv_new (0, 2, 2);
+        if (!env)
+                return 1;
+
+        syncbarrier_init (&ready);
+        syncbarrier_init (&go);
+
+        /* a task created outside the env goes to the processors in turn */
+        if (synctask_new (env, filler, filler_done, NULL, NULL))
+                return 1;
+        if (synctask_new (env, waker, NULL, NULL, env))
+                return 1;
+
+        delay = ran_at - woken_at;
+        printf ("woken task ran after %.3f seconds\n", delay);
+
+        return (delay >= 0 && delay < BLOCK_SECS - 1) ? 0 : 1;
+}
@@ -0,0 +1,13 @@
+#!/bin/bash
+
+. $(dirname $0)/../include.rc
+
+cleanup;
+
+# A task woken by a running synctask must not wait for it to yield while
+# another processor is idle.
+TEST build_tester $(dirname $0)/syncenv-wake.c $(libglusterfs_tester_flags)
+TEST $(dirname $0)/syncenv-wake
+
+rm -f $(dirname $0)/syncenv-wake
+cleanup;
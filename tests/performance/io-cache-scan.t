@@ -0,0 +1,74 @@
+#!/bin/bash
+
+TESTS_EXPECTED_IN_LOOP=20
+
+# A working set read more than once has to stay in io-cache while a scan
+# reads more than cache-size of other files once.
+
+. $(dirname $0)/../include.rc
+. $(dirname $0)/../volume.rc
+
+# pages faulted in, over all the shards of the io-cache table
+function ioc_misses {
+        local dump=$(generate_mount_statedump $V0)
+        sed -n '/io-cache.priv\]$/,/^\[/p' $dump | \
+                grep "^shard\[[0-9]*\].misses=" | cut -f2 -d'=' | \
+                awk '{ sum += $1 } END { print sum + 0 }'
+        cleanup_mount_statedump $V0
+}
+
+function read_files {
+        local f
+        for f in "$@"; do
+                dd if=$M0/$f of=/dev/null bs=128k 2>/dev/null || return 1
+        done
+}
+
+cleanup;
+
+TEST glusterd
+TEST pidof glusterd
+
+TEST $CLI volume create $V0 $H0:$B0/$V0
+# only io-cache caches, and every read is sent by the application
+TEST $CLI volume set $V0 performance.read-ahead off
+TEST $CLI volume set $V0 performance.quick-read off
+TEST $CLI volume set $V0 performance.open-behind off
+TEST $CLI volume set $V0 performance.cache-size 32MB
+TEST $CLI volume start $V0
+
+TEST glusterfs --direct-io-mode=yes -s $H0 --volfile-id $V0 $M0
+
+# 16MB working set, 64MB scanned once
+hot=""
+for i in {1..4}; do
+        TEST_IN_LOOP dd if=/dev/urandom of=$M0/hot$i bs=1M count=4
+        hot="$hot hot$i"
+done
+scan=""
+for i in {1..16}; do
+        TEST_IN_LOOP dd if=/dev/urandom of=$M0/scan$i bs=1M count=4
+        scan="$scan scan$i"
+done
+
+# a fresh mount, nothing is cached
+TEST umount $M0
+TEST glusterfs --direct-io-mode=yes -s $H0 --volfile-id $V0 $M0
+
+# reading the working set again from the start promotes it
+TEST read_files $hot
+TEST read_files $hot
+
+TEST read_files $scan
+
+# the working set is still cached, the scan did not fault it out
+before=$(ioc_misses)
+TEST read_files $hot
+after=$(ioc_misses)
+EXPECT "0" echo $((after - before))
+
+TEST umount $M0
+TEST $CLI volume stop $V0
+TEST $CLI volume delete $V0
+
+cleanup;
@@ -0,0 +1,63 @@
+#!/bin/bash
+
+# With cache-negative-entry, md-cache answers a repeated lookup of a missing
+# name itself, until a local create of the name, or a change of the
+# directory's times, makes the name worth asking the bricks about again.
+
+. $(dirname $0)/../include.rc
+. $(dirname $0)/../volume.rc
+
+# lookups which reached the brick since the last call
+function brick_lookups {
+        $CLI volume profile $V0 info incremental | grep -w LOOKUP | \
+                awk '{ sum += $(NF-1) } END { print sum + 0 }'
+}
+
+cleanup;
+
+TEST glusterd
+TEST pidof glusterd
+
+TEST $CLI volume create $V0 $H0:$B0/$V0
+TEST $CLI volume set $V0 performance.stat-prefetch on
+TEST $CLI volume set $V0 performance.cache-negative-entry on
+TEST $CLI volume set $V0 performance.md-cache-timeout 60
+TEST $CLI volume start $V0
+TEST $CLI volume profile $V0 start
+
+# the kernel keeps the directory but asks for every missing name
+TEST glusterfs --entry-timeout=600 --negative-timeout=0 \
+        -s $H0 --volfile-id $V0 $M0
+TEST glusterfs -s $H0 --volfile-id $V0 $M1
+
+TEST mkdir $M0/dir
+TEST stat $M0/dir
+
+# a repeated lookup of a missing name is served from the cache
+TEST ! stat $M0/dir/missing1
+TEST ! stat $M0/dir/missing2
+brick_lookups > /dev/null
+TEST ! stat $M0/dir/missing1
+TEST ! stat $M0/dir/missing1
+TEST ! stat $M0/dir/missing2
+EXPECT "0" brick_lookups
+
+# a local create drops the name, the other one stays cached
+TEST touch $M0/dir/missing1
+TEST stat $M0/dir/missing1
+brick_lookups > /dev/null
+TEST ! stat $M0/dir/missing2
+EXPECT "0" brick_lookups
+
+# another client changes the times of the directory, the first reply
+# carrying them drops what was cached for it
+TEST touch $M1/dir/missing2
+TEST ! stat $M0/dir/probe
+TEST stat $M0/dir/missing2
+
+TEST umount $M0
+TEST umount $M1
+TEST $CLI volume stop $V0
+TEST $CLI volume delete $V0
+
+cleanup;
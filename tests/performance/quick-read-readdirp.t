@@ -0,0 +1,78 @@
+#!/bin/bash
+
+# With quick-read-readdirp-prefetch, listing a directory brings the content
+# of its small files along with the entries. It is cached by quick-read and
+# counted against cache-size, and the brick puts no more than
+# POSIX_READDIRP_CONTENT_MAX (128KB) of it in one reply.
+
+. $(dirname $0)/../include.rc
+. $(dirname $0)/../volume.rc
+
+NSMALL=20
+SMALL_SIZE=4096
+NBIG=10
+BIG_SIZE=61440
+CONTENT_MAX=131072
+
+function qr_priv_value {
+        local key=$1
+        local dump=$(generate_mount_statedump $V0)
+        sed -n '/^\[xlator.performance.quick-read.priv\]/,/^\[/p' $dump | \
+                grep "^$key=" | cut -f2 -d'='
+        cleanup_mount_statedump $V0
+}
+
+# $2 files of $3 bytes in the directory $1
+function create_files {
+        local i
+        mkdir $1 || return 1
+        for i in $(seq 1 $2); do
+                dd if=/dev/urandom of=$1/file$i bs=$3 count=1 \
+                        2>/dev/null || return 1
+        done
+}
+
+# a fresh mount, on which nothing is cached yet
+function remount {
+        umount $M0 || return 1
+        glusterfs --use-readdirp=yes -s $H0 --volfile-id $V0 $M0
+}
+
+cleanup;
+
+TEST glusterd
+TEST pidof glusterd
+
+TEST $CLI volume create $V0 $H0:$B0/$V0
+TEST $CLI volume set $V0 performance.quick-read-readdirp-prefetch on
+# the entries of a listing are to reach quick-read as they come from posix
+TEST $CLI volume set $V0 performance.readdir-ahead off
+TEST $CLI volume set $V0 performance.stat-prefetch off
+TEST $CLI volume start $V0
+
+TEST glusterfs --use-readdirp=yes -s $H0 --volfile-id $V0 $M0
+
+TEST create_files $M0/small $NSMALL $SMALL_SIZE
+TEST create_files $M0/big $NBIG $BIG_SIZE
+
+# a listing caches the small files, and they count in the cache used
+TEST remount
+TEST ls $M0/small
+EXPECT "1" qr_priv_value readdirp_prefetch
+EXPECT "$NSMALL" qr_priv_value total_files_cached
+EXPECT "$((NSMALL * SMALL_SIZE))" qr_priv_value total_cache_used
+TEST cmp $M0/small/file1 $B0/$V0/small/file1
+
+# the files of a listing all fit in one reply, but their content does not
+TEST remount
+TEST ls $M0/big
+cached=$(qr_priv_value total_files_cached)
+TEST [ "$cached" -ge $((CONTENT_MAX / BIG_SIZE)) ]
+TEST [ "$cached" -lt $NBIG ]
+TEST [ "$(qr_priv_value total_cache_used)" -le $CONTENT_MAX ]
+
+TEST umount $M0
+TEST $CLI volume stop $V0
+TEST $CLI volume delete $V0
+
+cleanup;
@@ -0,0 +1,89 @@
+/*
+ * Reads <src> as <streams> interleaved sequential streams over a single fd
+ * and writes every block at the same offset of <copy>. Stream i covers the
+ * i-th of <streams> equal parts of the file, reads are done round robin.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#define BLOCK_SIZE (128 * 1024)
+
+int
+main (int argc, char *argv[])
+{
+        int          src     = -1;
+        int          copy    = -1;
+        int          streams = 0;
+        int          i       = 0;
+        int          active  = 0;
+        off_t        part    = 0;
+        off_t       *offset  = NULL;
+        off_t       *end     = NULL;
+        ssize_t      ret     = 0;
+        struct stat  stbuf   = {0, };
+        char         buf[BLOCK_SIZE];
+
+        if (argc != 4) {
+                fprintf (stderr, "Usage: %s <src> <copy> <streams>\n",
+                         argv[0]);
+                return 1;
+        }
+
+        streams = atoi (argv[3]);
+        if (streams <= 0)
+                return 1;
+
+        src = open (argv[1], O_RDONLY);
+        if (src < 0 || fstat (src, &stbuf)) {
+                perror (argv[1]);
+                return 1;
+        }
+
+        copy = open (argv[2], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (copy < 0) {
+                perror (argv[2]);
+                return 1;
+        }
+
+        offset = calloc (streams, sizeof (*offset));
+        end = calloc (streams, sizeof (*end));
+        if (!offset || !end)
+                return 1;
+
+        /* parts are whole blocks, the last one takes the rest */
+        part = (stbuf.st_size / streams) & ~((off_t) BLOCK_SIZE - 1);
+        for (i = 0; i < streams; i++) {
+                offset[i] = i * part;
+                end[i] = (i == streams - 1) ? stbuf.st_size : (i + 1) * part;
+        }
+
+        do {
+                active = 0;
+                for (i = 0; i < streams; i++) {
+                        if (offset[i] >= end[i])
+                                continue;
+                        active++;
+
+                        ret = pread (src, buf, BLOCK_SIZE, offset[i]);
+                        if (ret <= 0) {
+                                perror ("pread");
+                                return 1;
+                        }
+                        if (pwrite (copy, buf, ret, offset[i]) != ret) {
+                                perror ("pwrite");
+                                return 1;
+                        }
+                        offset[i] += ret;
+                }
+        } while (active);
+
+        close (src);
+        if (close (copy))
+                return 1;
+
+        return 0;
+}
@@ -0,0 +1,61 @@
+#!/bin/bash
+
+# Interleaved sequential streams on one fd must each keep their read-ahead
+# window: the data read back has to be intact and most reads have to be
+# served from pages read ahead.
+
+. $(dirname $0)/../include.rc
+. $(dirname $0)/../volume.rc
+
+function ra_priv_value {
+        local dump=$1
+        local key=$2
+        sed -n '/^\[xlator.performance.read-ahead.priv\]/,/^\[/p' $dump | \
+                grep "^$key=" | cut -f2 -d'=' | cut -f1 -d'.'
+}
+
+cleanup;
+
+TEST glusterd
+TEST pidof glusterd
+
+TEST $CLI volume create $V0 $H0:$B0/$V0
+# only read-ahead caches, and every read is sent by the application
+TEST $CLI volume set $V0 performance.io-cache off
+TEST $CLI volume set $V0 performance.quick-read off
+TEST $CLI volume set $V0 performance.open-behind off
+TEST $CLI volume set $V0 performance.read-ahead-stream-count 4
+TEST $CLI volume start $V0
+
+TEST glusterfs --direct-io-mode=yes -s $H0 --volfile-id $V0 $M0
+
+TEST build_tester $(dirname $0)/read-ahead-streams.c
+
+TEST dd if=/dev/urandom of=$B0/src bs=1M count=16
+TEST cp $B0/src $M0/file
+sum=$(md5sum $B0/src | cut -f1 -d' ')
+
+# a fresh mount, nothing is cached
+TEST umount $M0
+TEST glusterfs --direct-io-mode=yes -s $H0 --volfile-id $V0 $M0
+
+TEST $(dirname $0)/read-ahead-streams $M0/file $B0/copy 3
+EXPECT "$sum" echo $(md5sum $B0/copy | cut -f1 -d' ')
+
+dump=$(generate_mount_statedump $V0)
+TEST [ -f "$dump" ]
+EXPECT "4" ra_priv_value $dump stream_count
+hits=$(ra_priv_value $dump hits)
+misses=$(ra_priv_value $dump misses)
+hit_ratio=$(ra_priv_value $dump hit-ratio)
+TEST [ "$hits" -gt "$misses" ]
+TEST [ "$hit_ratio" -ge 50 ]
+cleanup_mount_statedump $V0
+
+rm -f $(dirname $0)/read-ahead-streams $B0/src $B0/copy
+
+TEST umount $M0
+TEST $CLI volume stop $V0
+TEST $CLI volume delete $V0
+
+cleanup;
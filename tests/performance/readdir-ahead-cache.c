@@ -0,0 +1,289 @@
+/*
+ * Copyright (c) 2014 Red Hat, Inc. <http://www.redhat.com>
+ * This file is part of GlusterFS.
+ *
+ * This file is licensed to you under your choice of the GNU Lesser
+ * General Public License, version 3 or any later version (LGPLv3 or
+ * later), or the GNU General Public License, version 2 (GPLv2), in all
+ * cases as published by the Free Software Foundation.
+ */
+
+/*
+ * Drives performance/readdir-ahead, with rda-cache on, over a "brick"
+ * answering opendir, stat and readdirp for a directory of NR_ENTRIES
+ * entries with unchanging times.
+ *
+ * The first fd of the directory is served from its preload and completes
+ * the cached listing, the second one is served from that listing. Both
+ * must fail a readdirp too small for the next entry with EINVAL rather
+ * than return no entry (end of directory), and the entries from the
+ * cached listing must come without attributes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+
+#include "glusterfs.h"
+#include "globals.h"
+#include "xlator.h"
+#include "stack.h"
+#include "call-stub.h"
+
+#define NR_ENTRIES 10
+
+static int          op_ret;
+static int          op_errno;
+static int          with_inode;
+static int          with_stat;
+
+static int32_t
+brick_opendir (call_frame_t *frame, xlator_t *this, loc_t *loc, fd_t *fd,
+               dict_t *xdata)
+{
+        STACK_UNWIND_STRICT (opendir, frame, 0, 0, fd, NULL);
+        return 0;
+}
+
+static int32_t
+brick_stat (call_frame_t *frame, xlator_t *this, loc_t *loc, dict_t *xdata)
+{
+        struct iatt buf = {0, };
+
+        buf.ia_type = IA_IFDIR;
+        buf.ia_mtime = buf.ia_ctime = 1000;
+        uuid_copy (buf.ia_gfid, loc->gfid);
+
+        STACK_UNWIND_STRICT (stat, frame, 0, 0, &buf, NULL);
+        return 0;
+}
+
+static int32_t
+brick_readdirp (call_frame_t *frame, xlator_t *this, fd_t *fd, size_t size,
+                off_t off, dict_t *xdata)
+{
+        gf_dirent_t  entries;
+        gf_dirent_t *entry = NULL;
+        char         name[32];
+        int          count = 0;
+        int          i = 0;
+
+        INIT_LIST_HEAD (&entries.list);
+
+        for (i = off; i < NR_ENTRIES; i++) {
+                snprintf (name, sizeof (name), "entry-%d", i);
+                entry = gf_dirent_for_name (name);
+                if (!entry)
+                        break;
+                entry->d_off = i + 1;
+                entry->d_ino = i + 1;
+                entry->d_type = DT_REG;
+                entry->d_stat.ia_type = IA_IFREG;
+                entry->d_stat.ia_size = 4096;
+                uuid_generate (entry->d_stat.ia_gfid);
+                entry->inode = inode_new (fd->inode->table);
+                list_add_tail (&entry->list, &entries.list);
+                count++;
+        }
+
+        STACK_UNWIND_STRICT (readdirp, frame, count, 0, &entries, NULL);
+        gf_dirent_free (&entries);
+        return 0;
+}
+
+static struct xlator_fops brick_fops = {
+        .opendir  = brick_opendir,
+        .stat     = brick_stat,
+        .readdirp = brick_readdirp,
+};
+
+static struct xlator_cbks brick_cbks;
+
+static int32_t
+opendir_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+             int32_t ret, int32_t err, fd_t *fd, dict_t *xdata)
+{
+        op_ret = ret;
+        op_errno = err;
+        return 0;
+}
+
+static int32_t
+readdirp_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+              int32_t ret, int32_t err, gf_dirent_t *entries, dict_t *xdata)
+{
+        gf_dirent_t *entry = NULL;
+
+        op_ret = ret;
+        op_errno = err;
+        with_inode = with_stat = 0;
+
+        if (ret > 0) {
+                list_for_each_entry (entry, &entries->list, list) {
+                        if (entry->inode)
+                                with_inode++;
+                        if (entry->d_stat.ia_size)
+                                with_stat++;
+                }
+        }
+
+        return 0;
+}
+
+static int
+do_opendir (xlator_t *rda, loc_t *loc, fd_t *fd)
+{
+        call_frame_t *frame = NULL;
+
+        frame = create_frame (rda, rda->ctx->pool);
+        if (!frame)
+                return -1;
+
+        /* the brick answers inline, it is all done on return */
+        STACK_WIND (frame, opendir_cbk, rda, rda->fops->opendir, loc, fd,
+                    NULL);
+        STACK_DESTROY (frame->root);
+
+        return op_ret;
+}
+
+static int
+do_readdirp (xlator_t *rda, fd_t *fd, size_t size, off_t off)
+{
+        call_frame_t *frame = NULL;
+
+        frame = create_frame (rda, rda->ctx->pool);
+        if (!frame)
+                return -1;
+
+        STACK_WIND (frame, readdirp_cbk, rda, rda->fops->readdirp, fd, size,
+                    off, NULL);
+        STACK_DESTROY (frame->root);
+
+        return op_ret;
+}
+
+#define CHECK(cond, msg) do {                                   \
+                if (!(cond)) {                                  \
+                        fprintf (stderr, "FAIL: %s\n", msg);    \
+                        return 1;                               \
+                }                                               \
+        } while (0)
+
+int
+main (int argc, char *argv[])
+{
+        glusterfs_ctx_t  *ctx   = NULL;
+        xlator_t         *rda   = NULL;
+        xlator_t         *brick = NULL;
+        xlator_list_t    *child = NULL;
+        xlator_list_t    *parent = NULL;
+        glusterfs_graph_t *graph = NULL;
+        inode_table_t    *table = NULL;
+        loc_t             loc   = {0, };
+        fd_t             *fd1   = NULL;
+        fd_t             *fd2   = NULL;
+
+        ctx = glusterfs_ctx_new ();
+        if (!ctx || glusterfs_globals_init (ctx))
+                return 1;
+        THIS->ctx = ctx;
+
+        ctx->pool = calloc (1, sizeof (call_pool_t));
+        if (!ctx->pool)
+                return 1;
+        INIT_LIST_HEAD (&ctx->pool->all_frames);
+        LOCK_INIT (&ctx->pool->lock);
+        ctx->pool->frame_mem_pool = mem_pool_new (call_frame_t, 16);
+        ctx->pool->stack_mem_pool = mem_pool_new (call_stack_t, 16);
+        ctx->stub_mem_pool = mem_pool_new (call_stub_t, 16);
+        ctx->dict_pool = mem_pool_new (dict_t, 16);
+        ctx->dict_pair_pool = mem_pool_new (data_pair_t, 16);
+        ctx->dict_data_pool = mem_pool_new (data_t, 16);
+        if (!ctx->pool->frame_mem_pool || !ctx->pool->stack_mem_pool ||
+            !ctx->stub_mem_pool || !ctx->dict_pool || !ctx->dict_pair_pool ||
+            !ctx->dict_data_pool)
+                return 1;
+
+        brick = calloc (1, sizeof (*brick));
+        rda = calloc (1, sizeof (*rda));
+        child = calloc (1, sizeof (*child));
+        parent = calloc (1, sizeof (*parent));
+        graph = calloc (1, sizeof (*graph));
+        if (!brick || !rda || !child || !parent || !graph)
+                return 1;
+        /* sizes the inode and fd contexts */
+        graph->xl_count = 2;
+
+        brick->name = "brick";
+        brick->type = "storage/fake";
+        brick->ctx = ctx;
+        brick->graph = graph;
+        brick->fops = &brick_fops;
+        brick->cbks = &brick_cbks;
+        parent->xlator = rda;
+        brick->parents = parent;
+
+        rda->name = "rda";
+        rda->ctx = ctx;
+        rda->graph = graph;
+        rda->options = dict_new ();
+        if (!rda->options || dict_set_str (rda->options, "rda-cache", "on"))
+                return 1;
+        CHECK (!xlator_set_type (rda, "performance/readdir-ahead"),
+               "loading performance/readdir-ahead");
+        child->xlator = brick;
+        rda->children = child;
+        CHECK (!xlator_init (rda), "init of readdir-ahead");
+
+        table = inode_table_new (0, rda);
+        if (!table)
+                return 1;
+
+        loc.path = gf_strdup ("/dir");
+        loc.parent = inode_ref (table->root);
+        loc.inode = inode_new (table);
+        if (!loc.path || !loc.inode)
+                return 1;
+        loc.name = loc.path + 1;
+        loc.inode->ia_type = IA_IFDIR;
+        uuid_generate (loc.gfid);
+        uuid_copy (loc.pargfid, table->root->gfid);
+
+        /* preloaded fd, which completes the cached listing */
+        fd1 = fd_create (loc.inode, 0);
+        CHECK (fd1 && !do_opendir (rda, &loc, fd1), "opendir 1");
+
+        do_readdirp (rda, fd1, 1, 0);
+        CHECK (op_ret == -1 && op_errno == EINVAL,
+               "preload: entry larger than the request is not EINVAL");
+
+        do_readdirp (rda, fd1, 4096, 0);
+        CHECK (op_ret == NR_ENTRIES && with_stat == NR_ENTRIES,
+               "preload: entries with their attributes");
+
+        do_readdirp (rda, fd1, 4096, NR_ENTRIES);
+        CHECK (op_ret == 0, "preload: end of directory");
+
+        /* fd served from the cached listing */
+        fd2 = fd_create (loc.inode, 0);
+        CHECK (fd2 && !do_opendir (rda, &loc, fd2), "opendir 2");
+
+        do_readdirp (rda, fd2, 1, 0);
+        CHECK (op_ret == -1 && op_errno == EINVAL,
+               "cache: entry larger than the request is not EINVAL");
+
+        do_readdirp (rda, fd2, 4096, 0);
+        CHECK (op_ret == NR_ENTRIES, "cache: all the entries");
+        CHECK (!with_inode && !with_stat,
+               "cache: entries served with (stale) attributes");
+
+        do_readdirp (rda, fd2, 4096, NR_ENTRIES);
+        CHECK (op_ret == 0, "cache: end of directory");
+
+        fd_unref (fd1);
+        fd_unref (fd2);
+        loc_wipe (&loc);
+
+        return 0;
+}
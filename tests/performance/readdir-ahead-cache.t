@@ -0,0 +1,50 @@
+#!/bin/bash
+
+# Directory listings cached by readdir-ahead must not hand out attributes:
+# they are not revalidated when the entries change. A readdirp too small
+# for the next entry must not look like the end of the directory.
+
+. $(dirname $0)/../include.rc
+
+cleanup;
+
+TEST build_tester $(dirname $0)/readdir-ahead-cache.c \
+        $(libglusterfs_tester_flags)
+TEST $(dirname $0)/readdir-ahead-cache
+rm -f $(dirname $0)/readdir-ahead-cache
+
+TEST glusterd
+TEST pidof glusterd
+
+TEST $CLI volume create $V0 $H0:$B0/$V0
+TEST $CLI volume set $V0 performance.readdir-ahead on
+TEST $CLI volume set $V0 performance.readdir-ahead-cache on
+TEST $CLI volume start $V0
+
+TEST glusterfs --attribute-timeout=0 --entry-timeout=0 --use-readdirp=yes \
+        -s $H0 --volfile-id $V0 $M0
+TEST glusterfs -s $H0 --volfile-id $V0 $M1
+
+TEST mkdir $M0/dir
+for i in {1..10}; do
+        echo > $M0/dir/file$i
+done
+
+# the first listing is cached, the second one is served from the cache
+TEST ls -l $M0/dir
+TEST ls -l $M0/dir
+
+# the times of dir do not change
+TEST dd if=/dev/zero of=$M1/dir/file1 bs=4096 count=1 conv=notrunc
+
+# let md-cache forget what it has for file1
+sleep 2
+TEST ls -l $M0/dir
+EXPECT "4096" stat -c %s $M0/dir/file1
+
+TEST umount $M0
+TEST umount $M1
+TEST $CLI volume stop $V0
+TEST $CLI volume delete $V0
+
+cleanup;
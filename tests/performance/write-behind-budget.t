@@ -0,0 +1,69 @@
+#!/bin/bash
+
+# Files written in parallel through write-behind with the smallest shared
+# buffer budget: the writes beyond the budget are throttled, the buffers
+# never grow past it, and the data comes out intact.
+
+. $(dirname $0)/../include.rc
+. $(dirname $0)/../volume.rc
+
+NFILES=8
+
+function wb_priv_value {
+        local dump=$1
+        local key=$2
+        sed -n '/^\[xlator.performance.write-behind.priv\]/,/^\[/p' $dump | \
+                grep "^$key=" | cut -f2 -d'='
+}
+
+# $1 against the sources, for all the files
+function same_files {
+        local i
+        for i in $(seq 1 $NFILES); do
+                cmp $B0/src$i $1/file$i || return 1
+        done
+}
+
+cleanup;
+
+TEST glusterd
+TEST pidof glusterd
+
+TEST $CLI volume create $V0 $H0:$B0/$V0
+TEST $CLI volume set $V0 performance.write-behind-global-cache-size 512KB
+TEST $CLI volume start $V0
+
+TEST glusterfs -s $H0 --volfile-id $V0 $M0
+
+for i in $(seq 1 $NFILES); do
+        dd if=/dev/urandom of=$B0/src$i bs=1M count=8 2>/dev/null
+done
+
+for i in $(seq 1 $NFILES); do
+        dd if=$B0/src$i of=$M0/file$i bs=128k 2>/dev/null &
+done
+wait
+
+dump=$(generate_mount_statedump $V0)
+TEST [ -f "$dump" ]
+EXPECT "524288" wb_priv_value $dump global_cache_size
+throttled=$(wb_priv_value $dump throttled)
+cache_peak=$(wb_priv_value $dump cache_peak)
+TEST [ "$throttled" -gt 0 ]
+TEST [ "$cache_peak" -gt 0 ]
+TEST [ "$cache_peak" -le 524288 ]
+cleanup_mount_statedump $V0
+
+# read back on a fresh mount, nothing cached
+TEST umount $M0
+TEST glusterfs -s $H0 --volfile-id $V0 $M0
+TEST same_files $M0
+TEST same_files $B0/$V0
+
+rm -f $B0/src*
+
+TEST umount $M0
+TEST $CLI volume stop $V0
+TEST $CLI volume delete $V0
+
+cleanup;
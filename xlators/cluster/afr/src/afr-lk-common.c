@@ -12,8 +12,11 @@
 #include "byte-order.h"
 #include "common-utils.h"
 
+#include "compound-fop.h"
+
 #include "afr.h"
 #include "afr-transaction.h"
+#include "afr-mem-types.h"
 
 #include <signal.h>
 
@@ -672,6 +675,36 @@ afr_unlock_inodelk_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
 
 }
 
+/* The unlock to send to @child for the inodelk of the transaction: the range
+ * of the transaction, the whole file for an eager lock, or NULL when the
+ * eager lock stays with the fd for a transaction which piggybacked on it.
+ */
+static struct gf_flock *
+afr_inodelk_unlock_flock (afr_local_t *local, afr_fd_ctx_t *fd_ctx, int child,
+                          struct gf_flock *flock, struct gf_flock *full_flock)
+{
+        int piggyback = 0;
+
+        if (!local->fd || !local->transaction.eager_lock[child])
+                return flock;
+
+        LOCK (&local->fd->lock);
+        {
+                if (fd_ctx->lock_piggyback[child]) {
+                        fd_ctx->lock_piggyback[child]--;
+                        piggyback = 1;
+                } else {
+                        fd_ctx->lock_acquired[child]--;
+                }
+        }
+        UNLOCK (&local->fd->lock);
+
+        if (piggyback)
+                return NULL;
+
+        return full_flock;
+}
+
 static int
 afr_unlock_inodelk (call_frame_t *frame, xlator_t *this)
 {
@@ -684,7 +717,6 @@ afr_unlock_inodelk (call_frame_t *frame, xlator_t *this)
         struct gf_flock *flock_use = NULL;
         int call_count = 0;
         int i = 0;
-        int piggyback = 0;
         afr_fd_ctx_t        *fd_ctx      = NULL;
 
 
@@ -719,25 +751,10 @@ afr_unlock_inodelk (call_frame_t *frame, xlator_t *this)
                         continue;
 
                 if (local->fd) {
-                        flock_use = &flock;
-                        if (!local->transaction.eager_lock[i]) {
-                                goto wind;
-                        }
-
-                        piggyback = 0;
-
-                        LOCK (&local->fd->lock);
-                        {
-                                if (fd_ctx->lock_piggyback[i]) {
-                                        fd_ctx->lock_piggyback[i]--;
-                                        piggyback = 1;
-                                } else {
-                                        fd_ctx->lock_acquired[i]--;
-                                }
-                        }
-                        UNLOCK (&local->fd->lock);
-
-                        if (piggyback) {
+                        flock_use = afr_inodelk_unlock_flock (local, fd_ctx, i,
+                                                              &flock,
+                                                              &full_flock);
+                        if (!flock_use) {
                                 afr_unlock_inodelk_cbk (frame, (void *) (long) i,
                                                         this, 1, 0, NULL);
                                 if (!--call_count)
@@ -745,8 +762,6 @@ afr_unlock_inodelk (call_frame_t *frame, xlator_t *this)
                                 continue;
                         }
 
-                        flock_use = &full_flock;
-                wind:
                         AFR_TRACE_INODELK_IN (frame, this,
                                               AFR_INODELK_TRANSACTION,
                                               AFR_UNLOCK_OP, flock_use, F_SETLK,
@@ -782,6 +797,247 @@ out:
         return 0;
 }
 
+/* A post-op and the unlock following it, sent to one child as a compound fop */
+typedef struct {
+        int              child;
+        compound_args_t *args;
+        int32_t          count;
+        gf_boolean_t     unlock;
+        struct gf_flock  flock;
+} afr_compound_unlock_t;
+
+static void
+afr_unlock_inodelk_child (call_frame_t *frame, xlator_t *this, int child,
+                          struct gf_flock *flock)
+{
+        afr_local_t         *local    = NULL;
+        afr_private_t       *priv     = NULL;
+        afr_internal_lock_t *int_lock = NULL;
+
+        local    = frame->local;
+        priv     = this->private;
+        int_lock = &local->internal_lock;
+
+        if (!flock) {
+                /* the eager lock stays with the fd */
+                afr_unlock_inodelk_cbk (frame, (void *) (long) child, this,
+                                        1, 0, NULL);
+                return;
+        }
+
+        AFR_TRACE_INODELK_IN (frame, this, AFR_INODELK_TRANSACTION,
+                              AFR_UNLOCK_OP, flock, F_SETLK, child);
+
+        if (local->fd)
+                STACK_WIND_COOKIE (frame, afr_unlock_inodelk_cbk,
+                                   (void *) (long) child,
+                                   priv->children[child],
+                                   priv->children[child]->fops->finodelk,
+                                   int_lock->domain, local->fd, F_SETLK,
+                                   flock, NULL);
+        else
+                STACK_WIND_COOKIE (frame, afr_unlock_inodelk_cbk,
+                                   (void *) (long) child,
+                                   priv->children[child],
+                                   priv->children[child]->fops->inodelk,
+                                   int_lock->domain, &local->loc, F_SETLK,
+                                   flock, NULL);
+}
+
+static int32_t
+afr_unlock_with_post_op_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                             int32_t op_ret, int32_t op_errno,
+                             compound_rsp_t *rsp, int32_t count,
+                             dict_t *xdata)
+{
+        afr_compound_unlock_t *cu     = cookie;
+        int                    child  = cu->child;
+        gf_boolean_t           unlock = cu->unlock;
+        struct gf_flock        flock  = cu->flock;
+
+        compound_args_destroy (cu->args, cu->count);
+        GF_FREE (cu);
+
+        if (count < 1 || rsp[0].op_ret < 0)
+                afr_transaction_fop_failed (frame, this, child);
+
+        if (unlock && count == 2) {
+                afr_unlock_inodelk_cbk (frame, (void *) (long) child, this,
+                                        rsp[1].op_ret, rsp[1].op_errno,
+                                        rsp[1].xdata);
+                return 0;
+        }
+
+        /* the post-op failed and the compound fop stopped there, or the
+         * eager lock stays with the fd */
+        afr_unlock_inodelk_child (frame, this, child, unlock ? &flock : NULL);
+
+        return 0;
+}
+
+static void
+afr_unlock_with_post_op_child (call_frame_t *frame, xlator_t *this, int child,
+                               dict_t *xattr, afr_fd_ctx_t *fd_ctx,
+                               struct gf_flock *flock,
+                               struct gf_flock *full_flock)
+{
+        afr_local_t           *local     = NULL;
+        afr_private_t         *priv      = NULL;
+        afr_internal_lock_t   *int_lock  = NULL;
+        afr_compound_unlock_t *cu        = NULL;
+        struct gf_flock       *flock_use = NULL;
+        int                    ret       = -1;
+
+        local    = frame->local;
+        priv     = this->private;
+        int_lock = &local->internal_lock;
+
+        cu = GF_CALLOC (1, sizeof (*cu), gf_afr_mt_compound_unlock_t);
+        if (cu)
+                cu->args = compound_args_new (2);
+        if (!cu || !cu->args)
+                goto err;
+
+        if (local->fd)
+                ret = compound_args_fxattrop (&cu->args[0], local->fd,
+                                              GF_XATTROP_ADD_ARRAY, xattr,
+                                              NULL);
+        else
+                ret = compound_args_xattrop (&cu->args[0], &local->loc,
+                                             GF_XATTROP_ADD_ARRAY, xattr,
+                                             NULL);
+        if (ret)
+                goto err;
+
+        cu->child = child;
+        cu->count = 1;
+
+        if (local->fd)
+                flock_use = afr_inodelk_unlock_flock (local, fd_ctx, child,
+                                                      flock, full_flock);
+        else
+                flock_use = flock;
+
+        if (flock_use) {
+                cu->unlock = _gf_true;
+                cu->flock = *flock_use;
+
+                if (local->fd)
+                        ret = compound_args_finodelk (&cu->args[1],
+                                                      int_lock->domain,
+                                                      local->fd, F_SETLK,
+                                                      flock_use, NULL);
+                else
+                        ret = compound_args_inodelk (&cu->args[1],
+                                                     int_lock->domain,
+                                                     &local->loc, F_SETLK,
+                                                     flock_use, NULL);
+                /* without its link, the unlock is sent after the reply */
+                if (!ret) {
+                        cu->count = 2;
+                        AFR_TRACE_INODELK_IN (frame, this,
+                                              AFR_INODELK_TRANSACTION,
+                                              AFR_UNLOCK_OP, flock_use,
+                                              F_SETLK, child);
+                }
+        }
+
+        STACK_WIND_COOKIE (frame, afr_unlock_with_post_op_cbk, cu,
+                           priv->children[child],
+                           priv->children[child]->fops->compound,
+                           cu->args, cu->count, NULL);
+        return;
+err:
+        if (cu)
+                compound_args_destroy (cu->args, 2);
+        GF_FREE (cu);
+
+        afr_transaction_fop_failed (frame, this, child);
+
+        if (local->fd)
+                flock_use = afr_inodelk_unlock_flock (local, fd_ctx, child,
+                                                      flock, full_flock);
+        else
+                flock_use = flock;
+        afr_unlock_inodelk_child (frame, this, child, flock_use);
+}
+
+/*
+ * Sends the post-op (xattr) and the unlock of a data or metadata transaction
+ * to each child as one compound fop, instead of an xattrop round trip
+ * followed by an unlock round trip. Returns -1 without sending anything if
+ * the transaction does not qualify; the caller then does the post-op and
+ * the unlock one after the other.
+ */
+int
+afr_unlock_with_post_op (call_frame_t *frame, xlator_t *this, dict_t *xattr)
+{
+        afr_local_t           *local      = NULL;
+        afr_private_t         *priv       = NULL;
+        afr_internal_lock_t   *int_lock   = NULL;
+        afr_inodelk_t         *inodelk    = NULL;
+        afr_fd_ctx_t          *fd_ctx     = NULL;
+        struct gf_flock        flock      = {0,};
+        struct gf_flock        full_flock = {0,};
+        int                    call_count = 0;
+        int                    i          = 0;
+
+        local    = frame->local;
+        priv     = this->private;
+        int_lock = &local->internal_lock;
+
+        if (!priv->use_compound_fops || local->transaction.resume_stub)
+                return -1;
+
+        if (local->transaction.type != AFR_DATA_TRANSACTION &&
+            local->transaction.type != AFR_METADATA_TRANSACTION)
+                return -1;
+
+        if (afr_lock_server_count (priv, local->transaction.type) == 0)
+                return -1;
+
+        inodelk = afr_get_inodelk (int_lock, int_lock->domain);
+
+        /* the post-op has to go to the children which are locked */
+        for (i = 0; i < priv->child_count; i++) {
+                if (!local->transaction.pre_op[i] !=
+                    !(inodelk->locked_nodes[i] & LOCKED_YES))
+                        return -1;
+        }
+
+        call_count = afr_locked_nodes_count (inodelk->locked_nodes,
+                                             priv->child_count);
+        if (!call_count)
+                return -1;
+
+        if (local->fd) {
+                fd_ctx = afr_fd_ctx_get (local->fd, this);
+                if (!fd_ctx)
+                        return -1;
+        }
+
+        flock.l_start = inodelk->flock.l_start;
+        flock.l_len   = inodelk->flock.l_len;
+        flock.l_type  = F_UNLCK;
+
+        full_flock.l_type = F_UNLCK;
+
+        int_lock->lk_call_count = call_count;
+        int_lock->lock_cbk = local->transaction.done;
+
+        for (i = 0; i < priv->child_count; i++) {
+                if ((inodelk->locked_nodes[i] & LOCKED_YES) != LOCKED_YES)
+                        continue;
+
+                afr_unlock_with_post_op_child (frame, this, i, xattr, fd_ctx,
+                                               &flock, &full_flock);
+                if (!--call_count)
+                        break;
+        }
+
+        return 0;
+}
+
 static int32_t
 afr_unlock_entrylk_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                         int32_t op_ret, int32_t op_errno, dict_t *xdata)
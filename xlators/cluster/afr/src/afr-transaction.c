@@ -495,7 +495,10 @@ afr_changelog_post_op_now (call_frame_t *frame, xlator_t *this)
 
 	}
 
-	afr_changelog_do (frame, this, xattr, afr_changelog_post_op_done);
+	/* with compound fops, the post-op carries the unlock along */
+	if (afr_unlock_with_post_op (frame, this, xattr))
+		afr_changelog_do (frame, this, xattr,
+				  afr_changelog_post_op_done);
 out:
 	if (xattr)
                 dict_unref (xattr);
@@ -190,6 +190,9 @@ reconfigure (xlator_t *this, dict_t *options)
         GF_OPTION_RECONF ("ensure-durability", priv->ensure_durability, options,
                           bool, out);
 
+        GF_OPTION_RECONF ("use-compound-fops", priv->use_compound_fops,
+                          options, bool, out);
+
 	GF_OPTION_RECONF ("self-heal-daemon", priv->shd.enabled, options,
 			  bool, out);
 
@@ -338,6 +341,8 @@ init (xlator_t *this)
 	GF_OPTION_INIT ("post-op-delay-secs", priv->post_op_delay_secs, uint32, out);
         GF_OPTION_INIT ("ensure-durability", priv->ensure_durability, bool,
                         out);
+        GF_OPTION_INIT ("use-compound-fops", priv->use_compound_fops, bool,
+                        out);
 
 	GF_OPTION_INIT ("self-heal-daemon", priv->shd.enabled, bool, out);
 
@@ -737,6 +742,13 @@ struct volume_options options[] = {
                          "written to the disk",
           .default_value = "on",
         },
+        { .key = {"use-compound-fops"},
+          .type = GF_OPTION_TYPE_BOOL,
+          .default_value = "off",
+          .description = "Send the post-op and the unlock of a data or "
+                         "metadata transaction to each brick as one compound "
+                         "fop, saving a round trip per write",
+        },
 	{ .key = {"afr-dirty-xattr"},
 	  .type = GF_OPTION_TYPE_STR,
 	  .default_value = AFR_DIRTY_DEFAULT,
@@ -114,6 +114,7 @@ typedef struct _afr_private {
         gf_boolean_t           did_discovery;
         uint64_t               sh_readdir_size;
         gf_boolean_t           ensure_durability;
+        gf_boolean_t           use_compound_fops;
         char                   *sh_domain;
 	char                   *afr_dirty;
 
@@ -779,6 +780,9 @@ afr_set_lock_number (call_frame_t *frame, xlator_t *this);
 int32_t
 afr_unlock (call_frame_t *frame, xlator_t *this);
 
+int
+afr_unlock_with_post_op (call_frame_t *frame, xlator_t *this, dict_t *xattr);
+
 int
 afr_nonblocking_entrylk (call_frame_t *frame, xlator_t *this);
 
@@ -4955,6 +4955,8 @@ stripe_readdirp (call_frame_t *frame, xlator_t *this,
         stripe_private_t *priv = NULL;
         xlator_list_t   *trav = NULL;
         int             op_errno = -1;
+        int             ret = -1;
+        int64_t         filesize = 0;
 
         VALIDATE_OR_GOTO (frame, err);
         VALIDATE_OR_GOTO (this, err);
@@ -4968,6 +4970,13 @@ stripe_readdirp (call_frame_t *frame, xlator_t *this,
                 goto err;
         }
 
+        /* quick-read friendly changes, as in stripe_lookup */
+        if (xdata && dict_get (xdata, GF_CONTENT_KEY)) {
+                ret = dict_get_int64 (xdata, GF_CONTENT_KEY, &filesize);
+                if (!ret && (filesize > priv->block_size))
+                        dict_del (xdata, GF_CONTENT_KEY);
+        }
+
         /* Initialization */
         local = mem_get0 (this->local_pool);
         if (!local) {
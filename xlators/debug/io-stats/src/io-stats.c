@@ -2673,6 +2673,9 @@ reconfigure (xlator_t *this, dict_t *options)
         int                 log_level = -1;
         int                 log_format = -1;
         int                 logger = -1;
+        uint64_t            log_buf_size = 0;
+        uint32_t            log_flush_timeout = 0;
+        gf_boolean_t        log_defer_format = _gf_false;
 
         if (!this || !this->private)
                 goto out;
@@ -2712,6 +2715,17 @@ reconfigure (xlator_t *this, dict_t *options)
                 gf_log_set_logformat (log_format);
         }
 
+        GF_OPTION_RECONF ("log-flush-timeout", log_flush_timeout, options,
+                          time, out);
+        gf_log_set_log_flush_timeout (log_flush_timeout);
+
+        GF_OPTION_RECONF ("log-defer-format", log_defer_format, options,
+                          bool, out);
+        gf_log_set_defer_format (log_defer_format);
+
+        GF_OPTION_RECONF ("log-buf-size", log_buf_size, options, size, out);
+        gf_log_set_log_buf_size (log_buf_size);
+
         ret = 0;
 out:
         gf_log (this->name, GF_LOG_DEBUG, "reconfigure returning %d", ret);
@@ -2750,6 +2764,9 @@ init (xlator_t *this)
         int                 sys_log_level = -1;
         char               *log_str = NULL;
         int                 log_level = -1;
+        uint64_t            log_buf_size = 0;
+        uint32_t            log_flush_timeout = 0;
+        gf_boolean_t        log_defer_format = _gf_false;
         int                 ret = -1;
 
         if (!this)
@@ -2817,6 +2834,14 @@ init (xlator_t *this)
                 gf_log_set_logformat (log_format);
         }
 
+        GF_OPTION_INIT ("log-flush-timeout", log_flush_timeout, time, out);
+        gf_log_set_log_flush_timeout (log_flush_timeout);
+
+        GF_OPTION_INIT ("log-defer-format", log_defer_format, bool, out);
+        gf_log_set_defer_format (log_defer_format);
+
+        GF_OPTION_INIT ("log-buf-size", log_buf_size, size, out);
+        gf_log_set_log_buf_size (log_buf_size);
 
         this->private = conf;
         ret = 0;
@@ -3094,6 +3119,32 @@ struct volume_options options[] = {
           .description = "Changes the log format for the bricks",
           .value = { GF_LOG_FORMAT_NO_MSG_ID, GF_LOG_FORMAT_WITH_MSG_ID}
         },
+        { .key  = {"log-buf-size"},
+          .type = GF_OPTION_TYPE_SIZET,
+          .min  = 0,
+          .max  = 16 * GF_UNIT_MB,
+          .default_value = "0",
+          .description = "Size of the per-thread buffer log messages are "
+                         "queued to. A separate thread writes them to the "
+                         "log file. 0 writes every message directly."
+        },
+        { .key  = {"log-flush-timeout"},
+          .type = GF_OPTION_TYPE_TIME,
+          .min  = 0,
+          .max  = 300,
+          .default_value = "5",
+          .description = "Repeats of a message logged within this many "
+                         "seconds of it are written once, followed by the "
+                         "number of times it was repeated. 0 writes every "
+                         "repeat. Only with log-buf-size set."
+        },
+        { .key  = {"log-defer-format"},
+          .type = GF_OPTION_TYPE_BOOL,
+          .default_value = "off",
+          .description = "Queue the arguments of log messages and format "
+                         "them in the log writer thread instead of the "
+                         "thread logging them."
+        },
         { .key  = {NULL} },
 
 };
@@ -554,6 +554,11 @@ struct volopt_map_entry glusterd_volopt_map[] = {
           .op_version = 3,
           .flags      = OPT_FLAG_CLIENT_OPT
         },
+        { .key        = "cluster.use-compound-fops",
+          .voltype    = "cluster/replicate",
+          .op_version = 4,
+          .flags      = OPT_FLAG_CLIENT_OPT
+        },
 
         /* Stripe xlator options */
         { .key         = "cluster.stripe-block-size",
@@ -632,6 +637,21 @@ struct volopt_map_entry glusterd_volopt_map[] = {
           .op_version = 4,
           .flags      = OPT_FLAG_CLIENT_OPT
         },
+        { .key         = "diagnostics.log-buf-size",
+          .voltype     = "debug/io-stats",
+          .option      = "log-buf-size",
+          .op_version  = 4
+        },
+        { .key         = "diagnostics.log-flush-timeout",
+          .voltype     = "debug/io-stats",
+          .option      = "log-flush-timeout",
+          .op_version  = 4
+        },
+        { .key         = "diagnostics.log-defer-format",
+          .voltype     = "debug/io-stats",
+          .option      = "log-defer-format",
+          .op_version  = 4
+        },
 
         /* IO-cache xlator options */
         { .key         = "performance.cache-max-file-size",
@@ -703,6 +723,12 @@ struct volopt_map_entry glusterd_volopt_map[] = {
           .op_version = 1,
           .flags      = OPT_FLAG_CLIENT_OPT
         },
+        { .key        = "performance.quick-read-readdirp-prefetch",
+          .voltype    = "performance/quick-read",
+          .option     = "readdirp-prefetch",
+          .op_version = 4,
+          .flags      = OPT_FLAG_CLIENT_OPT
+        },
         { .key        = "performance.flush-behind",
           .voltype    = "performance/write-behind",
           .option     = "flush-behind",
@@ -715,6 +741,18 @@ struct volopt_map_entry glusterd_volopt_map[] = {
           .op_version = 1,
           .flags      = OPT_FLAG_CLIENT_OPT
         },
+        { .key        = "performance.write-behind-max-window-size",
+          .voltype    = "performance/write-behind",
+          .option     = "max-window-size",
+          .op_version = 4,
+          .flags      = OPT_FLAG_CLIENT_OPT
+        },
+        { .key        = "performance.write-behind-global-cache-size",
+          .voltype    = "performance/write-behind",
+          .option     = "global-cache-size",
+          .op_version = 4,
+          .flags      = OPT_FLAG_CLIENT_OPT
+        },
         { .key        = "performance.strict-o-direct",
           .voltype    = "performance/write-behind",
           .option     = "strict-O_DIRECT",
@@ -745,12 +783,54 @@ struct volopt_map_entry glusterd_volopt_map[] = {
           .op_version = 1,
           .flags      = OPT_FLAG_CLIENT_OPT
         },
+        { .key        = "performance.read-ahead-stream-count",
+          .voltype    = "performance/read-ahead",
+          .option     = "stream-count",
+          .op_version = 4,
+          .flags      = OPT_FLAG_CLIENT_OPT
+        },
+        { .key        = "performance.read-ahead-file-window-limit",
+          .voltype    = "performance/read-ahead",
+          .option     = "file-window-limit",
+          .op_version = 4,
+          .flags      = OPT_FLAG_CLIENT_OPT
+        },
+        { .key        = "performance.read-ahead-window-limit",
+          .voltype    = "performance/read-ahead",
+          .option     = "window-limit",
+          .op_version = 4,
+          .flags      = OPT_FLAG_CLIENT_OPT
+        },
+        { .key        = "performance.readdir-ahead-cache",
+          .voltype    = "performance/readdir-ahead",
+          .option     = "rda-cache",
+          .op_version = 4,
+          .flags      = OPT_FLAG_CLIENT_OPT
+        },
+        { .key        = "performance.readdir-ahead-cache-limit",
+          .voltype    = "performance/readdir-ahead",
+          .option     = "rda-cache-limit",
+          .op_version = 4,
+          .flags      = OPT_FLAG_CLIENT_OPT
+        },
+        { .key        = "performance.readdir-ahead-cache-timeout",
+          .voltype    = "performance/readdir-ahead",
+          .option     = "rda-cache-timeout",
+          .op_version = 4,
+          .flags      = OPT_FLAG_CLIENT_OPT
+        },
         { .key        = "performance.md-cache-timeout",
           .voltype    = "performance/md-cache",
           .option     = "md-cache-timeout",
           .op_version = 2,
           .flags      = OPT_FLAG_CLIENT_OPT
         },
+        { .key        = "performance.cache-negative-entry",
+          .voltype    = "performance/md-cache",
+          .option     = "cache-negative-entry",
+          .op_version = 4,
+          .flags      = OPT_FLAG_CLIENT_OPT
+        },
 
  	/* Crypt xlator options */
 
@@ -815,12 +895,25 @@ struct volopt_map_entry glusterd_volopt_map[] = {
           .op_version = 2,
           .flags      = OPT_FLAG_CLIENT_OPT
         },
+        { .key        = "client.ssl-ktls",
+          .voltype    = "protocol/client",
+          .option     = "transport.socket.ssl-ktls",
+          .type       = NO_DOC,
+          .op_version = 4,
+          .flags      = OPT_FLAG_CLIENT_OPT
+        },
         { .key        = "network.remote-dio",
           .voltype    = "protocol/client",
           .option     = "filter-O_DIRECT",
           .op_version = 2,
           .flags      = OPT_FLAG_CLIENT_OPT
         },
+        { .key        = "client.event-threads",
+          .voltype    = "protocol/client",
+          .option     = "event-threads",
+          .op_version = 4,
+          .flags      = OPT_FLAG_CLIENT_OPT
+        },
 
         /* Server xlator options */
         { .key         = "network.tcp-window-size",
@@ -831,6 +924,26 @@ struct volopt_map_entry glusterd_volopt_map[] = {
           .voltype     = "protocol/server",
           .op_version  = 1
         },
+        { .key         = "network.inode-lru-limit-bytes",
+          .voltype     = "protocol/server",
+          .op_version  = 4
+        },
+        { .key         = "network.inode-rss-limit",
+          .voltype     = "protocol/server",
+          .op_version  = 4
+        },
+        { .key         = "server.iobuf-page-classes",
+          .voltype     = "protocol/server",
+          .op_version  = 4
+        },
+        { .key         = "server.iobuf-huge-pages",
+          .voltype     = "protocol/server",
+          .op_version  = 4
+        },
+        { .key         = "server.iobuf-numa",
+          .voltype     = "protocol/server",
+          .op_version  = 4
+        },
         { .key         = AUTH_ALLOW_MAP_KEY,
           .voltype     = "protocol/server",
           .option      = "!server-auth",
@@ -874,12 +987,37 @@ struct volopt_map_entry glusterd_volopt_map[] = {
           .option      = "statedump-path",
           .op_version  = 1
         },
+        { .key         = "server.event-threads",
+          .voltype     = "protocol/server",
+          .option      = "event-threads",
+          .op_version  = 4
+        },
+        { .key         = "server.zerocopy-threshold",
+          .voltype     = "protocol/server",
+          .option      = "transport.socket.zerocopy-threshold",
+          .op_version  = 4
+        },
         { .key         = "server.outstanding-rpc-limit",
           .voltype     = "protocol/server",
           .option      = "rpc.outstanding-rpc-limit",
           .type        = GLOBAL_DOC,
           .op_version  = 3
         },
+        { .key         = "server.fair-share",
+          .voltype     = "protocol/server",
+          .option      = "rpc.fair-share",
+          .op_version  = 4
+        },
+        { .key         = "server.fair-share-limit",
+          .voltype     = "protocol/server",
+          .option      = "rpc.fair-share-limit",
+          .op_version  = 4
+        },
+        { .key         = "server.fair-share-classes",
+          .voltype     = "protocol/server",
+          .option      = "rpc.fair-share-classes",
+          .op_version  = 4
+        },
         { .key         = "features.lock-heal",
           .voltype     = "protocol/server",
           .option      = "lk-heal",
@@ -898,6 +1036,12 @@ struct volopt_map_entry glusterd_volopt_map[] = {
           .type        = NO_DOC,
           .op_version  = 2
         },
+        { .key         = "server.ssl-ktls",
+          .voltype     = "protocol/server",
+          .option      = "transport.socket.ssl-ktls",
+          .type        = NO_DOC,
+          .op_version  = 4
+        },
 
         /* Performance xlators enable/disbable options */
         { .key         = "performance.write-behind",
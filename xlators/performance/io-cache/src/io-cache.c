@@ -41,38 +41,16 @@ ioc_hashfn (void *data, int len)
         return (offset >> ioc_log2_page_size);
 }
 
-static inline ioc_inode_t *
-ioc_inode_reupdate (ioc_inode_t *ioc_inode)
-{
-        ioc_table_t *table = NULL;
-
-        table = ioc_inode->table;
-
-        list_add_tail (&ioc_inode->inode_lru,
-                       &table->inode_lru[ioc_inode->weight]);
-
-        return ioc_inode;
-}
-
 static inline ioc_inode_t *
 ioc_get_inode (dict_t *dict, char *name)
 {
         ioc_inode_t *ioc_inode      = NULL;
         data_t      *ioc_inode_data = NULL;
-        ioc_table_t *table          = NULL;
 
         ioc_inode_data = dict_get (dict, name);
         if (ioc_inode_data) {
                 ioc_inode = data_to_ptr (ioc_inode_data);
-                table = ioc_inode->table;
-
-                ioc_table_lock (table);
-                {
-                        if (list_empty (&ioc_inode->inode_lru)) {
-                                ioc_inode = ioc_inode_reupdate (ioc_inode);
-                        }
-                }
-                ioc_table_unlock (table);
+                ioc_inode_touch (ioc_inode);
         }
 
         return ioc_inode;
@@ -131,13 +109,8 @@ ioc_inode_flush (ioc_inode_t *ioc_inode)
         }
         ioc_inode_unlock (ioc_inode);
 
-        if (destroy_size) {
-                ioc_table_lock (ioc_inode->table);
-                {
-                        ioc_inode->table->cache_used -= destroy_size;
-                }
-                ioc_table_unlock (ioc_inode->table);
-        }
+        if (destroy_size)
+                ioc_inode_account (ioc_inode, -destroy_size);
 
         return;
 }
@@ -213,7 +186,7 @@ ioc_lookup_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                         weight = ioc_get_priority (table, path);
 
                         ioc_inode = ioc_inode_update (table, inode,
-                                                      weight);
+                                                      stbuf->ia_gfid, weight);
 
                         __inode_ctx_put (inode, this,
                                          (uint64_t)(long)ioc_inode);
@@ -239,12 +212,7 @@ ioc_lookup_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                 ioc_inode_flush (ioc_inode);
         }
 
-        ioc_table_lock (ioc_inode->table);
-        {
-                list_move_tail (&ioc_inode->inode_lru,
-                                &table->inode_lru[ioc_inode->weight]);
-        }
-        ioc_table_unlock (ioc_inode->table);
+        ioc_inode_touch (ioc_inode);
 
 out:
         if (frame->local != NULL) {
@@ -375,13 +343,8 @@ ioc_cache_validate_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                 local_stbuf = NULL;
         }
 
-        if (destroy_size) {
-                ioc_table_lock (ioc_inode->table);
-                {
-                        ioc_inode->table->cache_used -= destroy_size;
-                }
-                ioc_table_unlock (ioc_inode->table);
-        }
+        if (destroy_size)
+                ioc_inode_account (ioc_inode, -destroy_size);
 
         if (op_ret < 0)
                 local_stbuf = NULL;
@@ -560,12 +523,7 @@ ioc_open_cbk (call_frame_t *frame, void *cookie, xlator_t *this, int32_t op_ret,
                         goto out;
                 }
 
-                ioc_table_lock (ioc_inode->table);
-                {
-                        list_move_tail (&ioc_inode->inode_lru,
-                                        &table->inode_lru[ioc_inode->weight]);
-                }
-                ioc_table_unlock (ioc_inode->table);
+                ioc_inode_touch (ioc_inode);
 
                 ioc_inode_lock (ioc_inode);
                 {
@@ -642,7 +600,8 @@ ioc_create_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                 /* assign weight */
                 weight = ioc_get_priority (table, path);
 
-                ioc_inode = ioc_inode_update (table, inode, weight);
+                ioc_inode = ioc_inode_update (table, inode, buf->ia_gfid,
+                                              weight);
 
                 ioc_inode_lock (ioc_inode);
                 {
@@ -726,7 +685,8 @@ ioc_mknod_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                 /* assign weight */
                 weight = ioc_get_priority (table, path);
 
-                ioc_inode = ioc_inode_update (table, inode, weight);
+                ioc_inode = ioc_inode_update (table, inode, buf->ia_gfid,
+                                              weight);
 
                 ioc_inode_lock (ioc_inode);
                 {
@@ -904,23 +864,6 @@ ioc_readv_disabled_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
 }
 
 
-int32_t
-ioc_need_prune (ioc_table_t *table)
-{
-        int64_t cache_difference = 0;
-
-        ioc_table_lock (table);
-        {
-                cache_difference = table->cache_used - table->cache_size;
-        }
-        ioc_table_unlock (table);
-
-        if (cache_difference > 0)
-                return 1;
-        else
-                return 0;
-}
-
 /*
  * ioc_dispatch_requests -
  *
@@ -949,6 +892,9 @@ ioc_dispatch_requests (call_frame_t *frame, ioc_inode_t *ioc_inode, fd_t *fd,
                                                 * if a page exists, do we need
                                                 * to validate it?
                                                 */
+        int8_t       sequential          = 0;
+        uint32_t     hits                = 0;
+        uint32_t     misses              = 0;
         local = frame->local;
         table = ioc_inode->table;
 
@@ -968,6 +914,13 @@ ioc_dispatch_requests (call_frame_t *frame, ioc_inode_t *ioc_inode, fd_t *fd,
 
         might_need_validate = ioc_inode_need_revalidate (ioc_inode);
 
+        ioc_inode_lock (ioc_inode);
+        {
+                sequential = (offset == ioc_inode->next_offset);
+                ioc_inode->next_offset = offset + size;
+        }
+        ioc_inode_unlock (ioc_inode);
+
         while (trav_offset < rounded_end) {
                 ioc_inode_lock (ioc_inode);
                 {
@@ -994,6 +947,9 @@ ioc_dispatch_requests (call_frame_t *frame, ioc_inode_t *ioc_inode, fd_t *fd,
                                         ioc_inode_unlock (ioc_inode);
                                         goto out;
                                 }
+                                misses++;
+                        } else {
+                                hits++;
                         }
 
                         __ioc_wait_on_page (trav, frame, local_offset,
@@ -1075,9 +1031,19 @@ ioc_dispatch_requests (call_frame_t *frame, ioc_inode_t *ioc_inode, fd_t *fd,
 out:
         ioc_frame_return (frame);
 
-        if (ioc_need_prune (ioc_inode->table)) {
-                ioc_prune (ioc_inode->table);
-        }
+        if (hits)
+                GF_ATOMIC_ADD (ioc_inode->shard->stats_lock,
+                               ioc_inode->shard->hits, hits);
+        if (misses)
+                GF_ATOMIC_ADD (ioc_inode->shard->stats_lock,
+                               ioc_inode->shard->misses, misses);
+
+        /* a sequential read hitting the page the previous read faulted in
+           is not a re-read, otherwise a scan would protect what it reads */
+        if (hits && !sequential && !ioc_inode->protected)
+                ioc_inode_promote (ioc_inode);
+
+        ioc_schedule_prune (table);
 
         return;
 }
@@ -1100,7 +1066,6 @@ ioc_readv (call_frame_t *frame, xlator_t *this, fd_t *fd,
         uint64_t     tmp_ioc_inode = 0;
         ioc_inode_t *ioc_inode     = NULL;
         ioc_local_t *local         = NULL;
-        uint32_t     weight        = 0;
         ioc_table_t *table         = NULL;
         int32_t      op_errno      = -1;
 
@@ -1175,14 +1140,7 @@ ioc_readv (call_frame_t *frame, xlator_t *this, fd_t *fd,
                 "NEW REQ (%p) offset = %"PRId64" && size = %"GF_PRI_SIZET"",
                 frame, offset, size);
 
-        weight = ioc_inode->weight;
-
-        ioc_table_lock (ioc_inode->table);
-        {
-                list_move_tail (&ioc_inode->inode_lru,
-                                &ioc_inode->table->inode_lru[weight]);
-        }
-        ioc_table_unlock (ioc_inode->table);
+        ioc_inode_touch (ioc_inode);
 
         ioc_dispatch_requests (frame, ioc_inode, fd, offset, size);
         return 0;
@@ -1706,12 +1664,15 @@ int32_t
 init (xlator_t *this)
 {
         ioc_table_t     *table             = NULL;
+        ioc_shard_t     *shard             = NULL;
         dict_t          *xl_options        = NULL;
         uint32_t         index             = 0;
         int32_t          ret               = -1;
+        int              i                 = 0;
         glusterfs_ctx_t *ctx               = NULL;
         data_t          *data              = 0;
         uint32_t         num_pages         = 0;
+        char             cond_inited       = 0;
 
         xl_options = this->options;
 
@@ -1777,15 +1738,27 @@ init (xlator_t *this)
                 goto out;
         }
 
-        table->inode_lru = GF_CALLOC (table->max_pri,
-                                      sizeof (struct list_head),
-                                      gf_ioc_mt_list_head);
-        if (table->inode_lru == NULL) {
-                goto out;
-        }
+        for (i = 0; i < IOC_SHARD_COUNT; i++) {
+                shard = &table->shards[i];
 
-        for (index = 0; index < (table->max_pri); index++)
-                INIT_LIST_HEAD (&table->inode_lru[index]);
+                shard->probation = GF_CALLOC (table->max_pri,
+                                              sizeof (struct list_head),
+                                              gf_ioc_mt_list_head);
+                shard->protected = GF_CALLOC (table->max_pri,
+                                              sizeof (struct list_head),
+                                              gf_ioc_mt_list_head);
+                if (!shard->probation || !shard->protected) {
+                        goto out;
+                }
+
+                for (index = 0; index < (table->max_pri); index++) {
+                        INIT_LIST_HEAD (&shard->probation[index]);
+                        INIT_LIST_HEAD (&shard->protected[index]);
+                }
+
+                pthread_mutex_init (&shard->shard_lock, NULL);
+                LOCK_INIT (&shard->stats_lock);
+        }
 
         this->local_pool = mem_pool_new (ioc_local_t, 64);
         if (!this->local_pool) {
@@ -1809,6 +1782,23 @@ init (xlator_t *this)
                 goto out;
         }
 
+        ret = pthread_cond_init (&table->prune_cond, NULL);
+        if (ret != 0) {
+                gf_log (this->name, GF_LOG_ERROR,
+                        "pthread_cond_init failed (%d)", ret);
+                ret = -1;
+                goto out;
+        }
+        cond_inited = 1;
+
+        ret = gf_thread_create (&table->pruner, NULL, ioc_pruner, table);
+        if (ret != 0) {
+                gf_log (this->name, GF_LOG_ERROR,
+                        "failed to create the pruner thread");
+                ret = -1;
+                goto out;
+        }
+
         ret = 0;
 
         ctx = this->ctx;
@@ -1817,8 +1807,16 @@ init (xlator_t *this)
 out:
         if (ret == -1) {
                 if (table != NULL) {
-                        GF_FREE (table->inode_lru);
+                        if (cond_inited)
+                                pthread_cond_destroy (&table->prune_cond);
+                        if (table->mem_pool)
+                                mem_pool_destroy (table->mem_pool);
+                        for (i = 0; i < IOC_SHARD_COUNT; i++) {
+                                GF_FREE (table->shards[i].probation);
+                                GF_FREE (table->shards[i].protected);
+                        }
                         GF_FREE (table);
+                        this->private = NULL;
                 }
         }
 
@@ -2001,12 +1999,67 @@ out:
         return ret;
 }
 
+static void
+ioc_shard_dump (ioc_table_t *table, int index)
+{
+        ioc_shard_t *shard                    = NULL;
+        ioc_inode_t *curr                     = NULL;
+        char         key[GF_DUMP_MAX_BUF_LEN] = {0, };
+        uint32_t     protected                = 0;
+        uint64_t     protected_used           = 0;
+        uint64_t     reads                    = 0;
+        int          i                        = 0;
+
+        shard = &table->shards[index];
+
+        /* the counters are updated without the shard lock */
+        snprintf (key, sizeof (key), "shard[%d].cache_used", index);
+        gf_proc_dump_write (key, "%"PRIu64, shard->cache_used);
+        snprintf (key, sizeof (key), "shard[%d].hits", index);
+        gf_proc_dump_write (key, "%"PRIu64, shard->hits);
+        snprintf (key, sizeof (key), "shard[%d].misses", index);
+        gf_proc_dump_write (key, "%"PRIu64, shard->misses);
+        reads = shard->hits + shard->misses;
+        snprintf (key, sizeof (key), "shard[%d].hit_ratio", index);
+        gf_proc_dump_write (key, "%.2f",
+                            reads ? shard->hits * 100.0 / reads : 0.0);
+        snprintf (key, sizeof (key), "shard[%d].promotions", index);
+        gf_proc_dump_write (key, "%"PRIu64, shard->promotions);
+        snprintf (key, sizeof (key), "shard[%d].demotions", index);
+        gf_proc_dump_write (key, "%"PRIu64, shard->demotions);
+        snprintf (key, sizeof (key), "shard[%d].pruned", index);
+        gf_proc_dump_write (key, "%"PRIu64, shard->pruned);
+
+        if (pthread_mutex_trylock (&shard->shard_lock))
+                return;
+        {
+                for (i = 0; i < table->max_pri; i++) {
+                        list_for_each_entry (curr, &shard->protected[i],
+                                             inode_lru) {
+                                protected++;
+                                protected_used += curr->cache_used;
+                        }
+                }
+
+                snprintf (key, sizeof (key), "shard[%d].inode_count", index);
+                gf_proc_dump_write (key, "%u", shard->inode_count);
+                snprintf (key, sizeof (key), "shard[%d].protected_inodes",
+                          index);
+                gf_proc_dump_write (key, "%u", protected);
+                snprintf (key, sizeof (key), "shard[%d].protected_used",
+                          index);
+                gf_proc_dump_write (key, "%"PRIu64, protected_used);
+        }
+        pthread_mutex_unlock (&shard->shard_lock);
+}
+
 int
 ioc_priv_dump (xlator_t *this)
 {
         ioc_table_t *priv                            = NULL;
         char         key_prefix[GF_DUMP_MAX_BUF_LEN] = {0, };
         int          ret                             = -1;
+        int          i                               = 0;
         gf_boolean_t add_section                     = _gf_false;
 
         if (!this || !this->private)
@@ -2024,13 +2077,20 @@ ioc_priv_dump (xlator_t *this)
         {
                 gf_proc_dump_write ("page_size", "%ld", priv->page_size);
                 gf_proc_dump_write ("cache_size", "%ld", priv->cache_size);
-                gf_proc_dump_write ("cache_used", "%ld", priv->cache_used);
+                gf_proc_dump_write ("cache_used", "%"PRIu64,
+                                    ioc_cache_used (priv));
                 gf_proc_dump_write ("inode_count", "%u", priv->inode_count);
                 gf_proc_dump_write ("cache_timeout", "%u", priv->cache_timeout);
                 gf_proc_dump_write ("min-file-size", "%u", priv->min_file_size);
                 gf_proc_dump_write ("max-file-size", "%u", priv->max_file_size);
+                gf_proc_dump_write ("prune_runs", "%u", priv->prune_runs);
+                gf_proc_dump_write ("prune_pending", "%d",
+                                    priv->prune_pending);
         }
         pthread_mutex_unlock (&priv->table_lock);
+
+        for (i = 0; i < IOC_SHARD_COUNT; i++)
+                ioc_shard_dump (priv, i);
 out:
         if (ret && priv) {
                 if (!add_section) {
@@ -2056,8 +2116,10 @@ void
 fini (xlator_t *this)
 {
         ioc_table_t         *table = NULL;
+        ioc_shard_t         *shard = NULL;
         struct ioc_priority *curr  = NULL, *tmp = NULL;
         int                  i     = 0;
+        int                  j     = 0;
 
         table = this->private;
 
@@ -2066,6 +2128,16 @@ fini (xlator_t *this)
 
         this->private = NULL;
 
+        ioc_table_lock (table);
+        {
+                table->prune_stop = 1;
+                pthread_cond_signal (&table->prune_cond);
+        }
+        ioc_table_unlock (table);
+
+        pthread_join (table->pruner, NULL);
+        pthread_cond_destroy (&table->prune_cond);
+
         if (table->mem_pool != NULL) {
                 mem_pool_destroy (table->mem_pool);
                 table->mem_pool = NULL;
@@ -2077,8 +2149,18 @@ fini (xlator_t *this)
                 GF_FREE (curr);
         }
 
-        for (i = 0; i < table->max_pri; i++) {
-                GF_ASSERT (list_empty (&table->inode_lru[i]));
+        for (i = 0; i < IOC_SHARD_COUNT; i++) {
+                shard = &table->shards[i];
+
+                for (j = 0; j < table->max_pri; j++) {
+                        GF_ASSERT (list_empty (&shard->probation[j]));
+                        GF_ASSERT (list_empty (&shard->protected[j]));
+                }
+
+                GF_FREE (shard->probation);
+                GF_FREE (shard->protected);
+                LOCK_DESTROY (&shard->stats_lock);
+                pthread_mutex_destroy (&shard->shard_lock);
         }
 
         GF_ASSERT (list_empty (&table->inodes));
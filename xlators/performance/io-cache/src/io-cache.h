@@ -34,10 +34,22 @@
 #define IOC_CACHE_SIZE   (32 * 1024 * 1024)
 #define IOC_PAGE_TABLE_BUCKET_COUNT 1
 
+/* the inodes are spread over the shards by gfid */
+#define IOC_SHARD_COUNT  16
+
+/* the pruner brings the cache down to 1/16th below cache-size at a time,
+   and the fop path prunes by itself only beyond 1/4th over cache-size */
+#define IOC_PRUNE_BATCH(table)  ((table)->cache_size / 16)
+#define IOC_PRUNE_LIMIT(table)  ((table)->cache_size + (table)->cache_size / 4)
+
+/* share of cache-size the protected inodes may hold, in percent */
+#define IOC_PROTECTED_PERCENT  75
+
 struct ioc_table;
 struct ioc_local;
 struct ioc_page;
 struct ioc_inode;
+struct ioc_shard;
 
 struct ioc_priority {
         struct list_head list;
@@ -142,7 +154,23 @@ struct ioc_inode {
                                             * list of inodes, maintained by
                                             * io-cache translator
                                             */
-        struct list_head       inode_lru;
+        struct list_head       inode_lru;   /*
+                                             * probation or protected list
+                                             * of the shard, under its lock
+                                             */
+        struct ioc_shard      *shard;
+        char                   protected;   /*
+                                             * re-read since its pages were
+                                             * cached, under the shard lock
+                                             */
+        uint64_t               cache_used;  /*
+                                             * bytes held by the pages of the
+                                             * inode, updated atomically
+                                             */
+        off_t                  next_offset; /*
+                                             * end of the last read, a read
+                                             * starting there is sequential
+                                             */
         struct ioc_waitq      *waitq;
         pthread_mutex_t        inode_lock;
         uint32_t               weight;      /*
@@ -152,15 +180,40 @@ struct ioc_inode {
         inode_t               *inode;
 };
 
+/*
+ * ioc_shard - a part of the inodes of the table, with its own lock
+ *
+ * Inodes enter the probation list of their priority when they are looked
+ * up, and move to the protected list when pages they already have in the
+ * cache are read again by a non-sequential read. The pruner empties the
+ * probation lists before the protected ones, so that a scan reading many
+ * files once does not push the files read repeatedly out of the cache.
+ */
+struct ioc_shard {
+        pthread_mutex_t   shard_lock;
+        struct list_head *probation;   /* per priority, lru first */
+        struct list_head *protected;   /* per priority, lru first */
+        uint32_t          inode_count;
+
+        /* updated atomically, stats_lock is for the compilers without
+           atomic builtins */
+        gf_lock_t         stats_lock;
+        uint64_t          cache_used;
+        uint64_t          hits;        /* pages read from the cache */
+        uint64_t          misses;      /* pages faulted in */
+        uint64_t          promotions;  /* inodes moved to protected */
+        uint64_t          demotions;   /* inodes moved back to probation */
+        uint64_t          pruned;      /* bytes pruned */
+};
+
 struct ioc_table {
         uint64_t         page_size;
         uint64_t         cache_size;
-        uint64_t         cache_used;
         uint64_t         min_file_size;
         uint64_t         max_file_size;
         struct list_head inodes; /* list of inodes cached */
         struct list_head active;
-        struct list_head *inode_lru;
+        struct ioc_shard shards[IOC_SHARD_COUNT];
         struct list_head priority_list;
         int32_t          readv_count;
         pthread_mutex_t  table_lock;
@@ -169,6 +222,13 @@ struct ioc_table {
         int32_t          cache_timeout;
         int32_t          max_pri;
         struct mem_pool  *mem_pool;
+
+        /* the pruner thread, woken up through prune_cond under table_lock */
+        pthread_t        pruner;
+        pthread_cond_t   prune_cond;
+        char             prune_pending;
+        char             prune_stop;
+        uint32_t         prune_runs;
 };
 
 typedef struct ioc_table ioc_table_t;
@@ -177,6 +237,7 @@ typedef struct ioc_page ioc_page_t;
 typedef struct ioc_inode ioc_inode_t;
 typedef struct ioc_waitq ioc_waitq_t;
 typedef struct ioc_fill ioc_fill_t;
+typedef struct ioc_shard ioc_shard_t;
 
 void *
 str_to_ptr (char *string);
@@ -254,6 +315,18 @@ ioc_frame_fill (ioc_page_t *page, call_frame_t *frame, off_t offset,
         } while (0)
 
 
+#define ioc_shard_lock(shard)                                   \
+        do {                                                    \
+                pthread_mutex_lock (&(shard)->shard_lock);      \
+        } while (0)
+
+
+#define ioc_shard_unlock(shard)                                 \
+        do {                                                    \
+                pthread_mutex_unlock (&(shard)->shard_lock);    \
+        } while (0)
+
+
 #define ioc_local_lock(local)                                           \
         do {                                                            \
                 gf_log (local->inode->table->xl->name, GF_LOG_TRACE,    \
@@ -305,7 +378,20 @@ void
 ioc_inode_destroy (ioc_inode_t *ioc_inode);
 
 ioc_inode_t *
-ioc_inode_update (ioc_table_t *table, inode_t *inode, uint32_t weight);
+ioc_inode_update (ioc_table_t *table, inode_t *inode, uuid_t gfid,
+                  uint32_t weight);
+
+void
+ioc_inode_touch (ioc_inode_t *ioc_inode);
+
+void
+ioc_inode_promote (ioc_inode_t *ioc_inode);
+
+void
+ioc_inode_account (ioc_inode_t *ioc_inode, int64_t size);
+
+uint64_t
+ioc_cache_used (ioc_table_t *table);
 
 int64_t
 __ioc_page_destroy (ioc_page_t *page);
@@ -326,7 +412,10 @@ ioc_cache_still_valid (ioc_inode_t *ioc_inode, struct iatt *stbuf);
 int32_t
 ioc_prune (ioc_table_t *table);
 
-int32_t
-ioc_need_prune (ioc_table_t *table);
+void
+ioc_schedule_prune (ioc_table_t *table);
+
+void *
+ioc_pruner (void *data);
 
 #endif /* __IO_CACHE_H */
@@ -161,6 +161,25 @@ out:
 }
 
 
+/*
+ * ioc_inode_lru - the list of the shard the inode belongs to
+ *
+ * @ioc_inode:
+ *
+ * assumes the shard lock is held
+ */
+static struct list_head *
+__ioc_inode_lru (ioc_inode_t *ioc_inode)
+{
+        ioc_shard_t *shard = ioc_inode->shard;
+
+        if (ioc_inode->protected)
+                return &shard->protected[ioc_inode->weight];
+
+        return &shard->probation[ioc_inode->weight];
+}
+
+
 /*
  * ioc_inode_update - create a new ioc_inode_t structure and add it to
  *                    the table table. fill in the fields which are derived
@@ -168,13 +187,16 @@ out:
  *
  * @table: io-table structure
  * @inode: inode structure
+ * @gfid: gfid of the inode, picks its shard
  *
  * not for external reference
  */
 ioc_inode_t *
-ioc_inode_update (ioc_table_t *table, inode_t *inode, uint32_t weight)
+ioc_inode_update (ioc_table_t *table, inode_t *inode, uuid_t gfid,
+                  uint32_t weight)
 {
         ioc_inode_t     *ioc_inode   = NULL;
+        ioc_shard_t     *shard       = NULL;
 
         GF_VALIDATE_OR_GOTO ("io-cache", table, out);
 
@@ -183,8 +205,12 @@ ioc_inode_update (ioc_table_t *table, inode_t *inode, uint32_t weight)
                 goto out;
         }
 
+        shard = &table->shards[SuperFastHash ((char *)gfid, sizeof (uuid_t))
+                               % IOC_SHARD_COUNT];
+
         ioc_inode->inode = inode;
         ioc_inode->table = table;
+        ioc_inode->shard = shard;
         INIT_LIST_HEAD (&ioc_inode->cache.page_lru);
         pthread_mutex_init (&ioc_inode->inode_lock, NULL);
         ioc_inode->weight = weight;
@@ -193,19 +219,113 @@ ioc_inode_update (ioc_table_t *table, inode_t *inode, uint32_t weight)
         {
                 table->inode_count++;
                 list_add (&ioc_inode->inode_list, &table->inodes);
-                list_add_tail (&ioc_inode->inode_lru,
-                               &table->inode_lru[weight]);
         }
         ioc_table_unlock (table);
 
+        ioc_shard_lock (shard);
+        {
+                shard->inode_count++;
+                list_add_tail (&ioc_inode->inode_lru,
+                               &shard->probation[weight]);
+        }
+        ioc_shard_unlock (shard);
+
         gf_log (table->xl->name, GF_LOG_TRACE,
-                "adding to inode_lru[%d]", weight);
+                "adding to inode_lru[%d] of shard %d", weight,
+                (int)(shard - table->shards));
 
 out:
         return ioc_inode;
 }
 
 
+/*
+ * ioc_inode_touch - make the inode the most recently used of its list
+ *
+ * @ioc_inode:
+ *
+ */
+void
+ioc_inode_touch (ioc_inode_t *ioc_inode)
+{
+        ioc_shard_t *shard = ioc_inode->shard;
+
+        ioc_shard_lock (shard);
+        {
+                list_move_tail (&ioc_inode->inode_lru,
+                                __ioc_inode_lru (ioc_inode));
+        }
+        ioc_shard_unlock (shard);
+}
+
+
+/*
+ * ioc_inode_promote - move the inode to the protected list, its cached pages
+ *                     were read again
+ *
+ * @ioc_inode:
+ *
+ */
+void
+ioc_inode_promote (ioc_inode_t *ioc_inode)
+{
+        ioc_shard_t *shard    = ioc_inode->shard;
+        char         promoted = 0;
+
+        ioc_shard_lock (shard);
+        {
+                /* not if pruned meanwhile, it has to be read again */
+                if (!ioc_inode->protected &&
+                    !list_empty (&ioc_inode->inode_lru)) {
+                        ioc_inode->protected = 1;
+                        list_move_tail (&ioc_inode->inode_lru,
+                                        __ioc_inode_lru (ioc_inode));
+                        promoted = 1;
+                }
+        }
+        ioc_shard_unlock (shard);
+
+        if (promoted)
+                GF_ATOMIC_ADD (shard->stats_lock, shard->promotions, 1);
+}
+
+
+/*
+ * ioc_inode_account - account pages added to or removed from the inode
+ *
+ * @ioc_inode:
+ * @size: bytes added, negative if removed
+ *
+ */
+void
+ioc_inode_account (ioc_inode_t *ioc_inode, int64_t size)
+{
+        ioc_shard_t *shard = ioc_inode->shard;
+
+        GF_ATOMIC_ADD (shard->stats_lock, ioc_inode->cache_used, size);
+        GF_ATOMIC_ADD (shard->stats_lock, shard->cache_used, size);
+}
+
+
+/*
+ * ioc_cache_used - bytes held by the pages of all inodes
+ *
+ * @table:
+ *
+ */
+uint64_t
+ioc_cache_used (ioc_table_t *table)
+{
+        uint64_t cache_used = 0;
+        int      i          = 0;
+
+        for (i = 0; i < IOC_SHARD_COUNT; i++)
+                cache_used += table->shards[i].cache_used;
+
+        return cache_used;
+}
+
+
 /*
  * ioc_inode_destroy - destroy an ioc_inode_t object.
  *
@@ -217,19 +337,27 @@ void
 ioc_inode_destroy (ioc_inode_t *ioc_inode)
 {
         ioc_table_t *table = NULL;
+        ioc_shard_t *shard = NULL;
 
         GF_VALIDATE_OR_GOTO ("io-cache", ioc_inode, out);
 
         table = ioc_inode->table;
+        shard = ioc_inode->shard;
 
         ioc_table_lock (table);
         {
                 table->inode_count--;
                 list_del (&ioc_inode->inode_list);
-                list_del (&ioc_inode->inode_lru);
         }
         ioc_table_unlock (table);
 
+        ioc_shard_lock (shard);
+        {
+                shard->inode_count--;
+                list_del (&ioc_inode->inode_lru);
+        }
+        ioc_shard_unlock (shard);
+
         ioc_inode_flush (ioc_inode);
         rbthash_table_destroy (ioc_inode->cache.page_table);
 
@@ -160,23 +160,28 @@ __ioc_inode_prune (ioc_inode_t *curr, uint64_t *size_pruned,
         ioc_page_t  *page  = NULL, *next = NULL;
         int32_t      ret   = 0;
         ioc_table_t *table = NULL;
+        ioc_shard_t *shard = NULL;
 
         if (curr == NULL) {
                 goto out;
         }
 
         table = curr->table;
+        shard = curr->shard;
 
         list_for_each_entry_safe (page, next, &curr->cache.page_lru, page_lru) {
                 *size_pruned += page->size;
                 ret = __ioc_page_destroy (page);
 
-                if (ret != -1)
-                        table->cache_used -= ret;
+                if (ret != -1) {
+                        ioc_inode_account (curr, -ret);
+                        GF_ATOMIC_ADD (shard->stats_lock, shard->pruned,
+                                       ret);
+                }
 
                 gf_log (table->xl->name, GF_LOG_TRACE,
-                        "index = %d && table->cache_used = %"PRIu64" && table->"
-                        "cache_size = %"PRIu64, index, table->cache_used,
+                        "index = %d && shard->cache_used = %"PRIu64" && table->"
+                        "cache_size = %"PRIu64, index, shard->cache_used,
                         table->cache_size);
 
                 if ((*size_pruned) >= size_to_prune)
@@ -184,60 +189,304 @@ __ioc_inode_prune (ioc_inode_t *curr, uint64_t *size_pruned,
         }
 
         if (ioc_empty (&curr->cache)) {
+                /* out of the cache, it has to earn protection again */
                 list_del_init (&curr->inode_lru);
+                curr->protected = 0;
         }
 
 out:
         return 0;
 }
+
+
+/*
+ * __ioc_shard_protected - bytes held by the protected inodes of the shard
+ *
+ * @table:
+ * @shard: locked
+ *
+ */
+static uint64_t
+__ioc_shard_protected (ioc_table_t *table, ioc_shard_t *shard)
+{
+        ioc_inode_t *curr           = NULL;
+        uint64_t     protected_used = 0;
+        int32_t      index          = 0;
+
+        for (index = 0; index < table->max_pri; index++) {
+                list_for_each_entry (curr, &shard->protected[index],
+                                     inode_lru) {
+                        protected_used += curr->cache_used;
+                }
+        }
+
+        return protected_used;
+}
+
+
+/*
+ * __ioc_shard_demote - move the least recently used protected inodes of the
+ *                      shard back to probation
+ *
+ * @table:
+ * @shard: locked
+ * @size: bytes of pages to demote
+ *
+ */
+static void
+__ioc_shard_demote (ioc_table_t *table, ioc_shard_t *shard, uint64_t size)
+{
+        ioc_inode_t *curr    = NULL, *next = NULL;
+        uint64_t     demoted = 0;
+        uint32_t     count   = 0;
+        int32_t      index   = 0;
+
+        for (index = 0; index < table->max_pri; index++) {
+                list_for_each_entry_safe (curr, next,
+                                          &shard->protected[index],
+                                          inode_lru) {
+                        if (demoted >= size)
+                                goto out;
+
+                        demoted += curr->cache_used;
+                        curr->protected = 0;
+                        list_move_tail (&curr->inode_lru,
+                                        &shard->probation[index]);
+                        count++;
+                }
+        }
+
+out:
+        if (count)
+                GF_ATOMIC_ADD (shard->stats_lock, shard->demotions, count);
+}
+
+
+/*
+ * ioc_demote - keep the protected inodes within IOC_PROTECTED_PERCENT of
+ *              cache-size, so that newly read inodes stay cached long enough
+ *              to be read again
+ *
+ * @table:
+ *
+ * the excess is demoted from the shards in proportion to what their
+ * protected inodes hold
+ */
+static void
+ioc_demote (ioc_table_t *table)
+{
+        ioc_shard_t *shard                     = NULL;
+        uint64_t     protected[IOC_SHARD_COUNT] = {0, };
+        uint64_t     protected_total           = 0;
+        uint64_t     limit                     = 0;
+        uint64_t     excess                    = 0;
+        int          i                         = 0;
+
+        for (i = 0; i < IOC_SHARD_COUNT; i++) {
+                shard = &table->shards[i];
+
+                ioc_shard_lock (shard);
+                {
+                        protected[i] = __ioc_shard_protected (table, shard);
+                }
+                ioc_shard_unlock (shard);
+
+                protected_total += protected[i];
+        }
+
+        limit = table->cache_size * IOC_PROTECTED_PERCENT / 100;
+        if (protected_total <= limit)
+                return;
+
+        excess = protected_total - limit;
+
+        for (i = 0; i < IOC_SHARD_COUNT; i++) {
+                if (!protected[i])
+                        continue;
+
+                shard = &table->shards[i];
+
+                ioc_shard_lock (shard);
+                {
+                        __ioc_shard_demote (table, shard,
+                                            (double)excess * protected[i]
+                                            / protected_total);
+                }
+                ioc_shard_unlock (shard);
+        }
+}
+
+
+/*
+ * __ioc_lru_prune - prune the inodes of a list of a shard, least recently
+ *                   used first
+ *
+ * @lru: probation or protected list, its shard locked
+ * @size_to_prune:
+ * @index: priority of the list
+ *
+ * returns the size pruned
+ */
+static uint64_t
+__ioc_lru_prune (struct list_head *lru, uint64_t size_to_prune,
+                 uint32_t index)
+{
+        ioc_inode_t *curr        = NULL, *next = NULL;
+        uint64_t     size_pruned = 0;
+
+        list_for_each_entry_safe (curr, next, lru, inode_lru) {
+                /* prune page-by-page for this inode, till we reach the
+                 * equilibrium */
+                ioc_inode_lock (curr);
+                {
+                        __ioc_inode_prune (curr, &size_pruned, size_to_prune,
+                                           index);
+                }
+                ioc_inode_unlock (curr);
+
+                if (size_pruned >= size_to_prune)
+                        break;
+        }
+
+        return size_pruned;
+}
+
+
 /*
  * ioc_prune - prune the cache. we have a limit to the number of pages we
  *             can have in-memory.
  *
  * @table: ioc_table_t of this translator
  *
+ * Brings the cache IOC_PRUNE_BATCH below cache-size. Priorities are pruned
+ * lowest first; within a priority the probation inodes go before the
+ * protected ones, least recently used first. Each pass takes an equal share
+ * from every shard, starting from a different shard every time.
  */
 int32_t
 ioc_prune (ioc_table_t *table)
 {
-        ioc_inode_t *curr          = NULL, *next_ioc_inode = NULL;
-        int32_t      index         = 0;
-        uint64_t     size_to_prune = 0;
-        uint64_t     size_pruned   = 0;
+        ioc_shard_t      *shard         = NULL;
+        struct list_head *lru           = NULL;
+        int32_t           index         = 0;
+        int32_t           protected     = 0;
+        uint32_t          start         = 0;
+        uint32_t          i             = 0;
+        uint64_t          cache_used    = 0;
+        uint64_t          size_to_prune = 0;
+        uint64_t          size_pruned   = 0;
+        uint64_t          quota         = 0;
+        uint64_t          shard_pruned  = 0;
+        uint64_t          pass_pruned   = 0;
 
         GF_VALIDATE_OR_GOTO ("io-cache", table, out);
 
-        ioc_table_lock (table);
-        {
-                size_to_prune = table->cache_used - table->cache_size;
-                /* take out the least recently used inode */
-                for (index=0; index < table->max_pri; index++) {
-                        list_for_each_entry_safe (curr, next_ioc_inode,
-                                                  &table->inode_lru[index],
-                                                  inode_lru) {
-                                /* prune page-by-page for this inode, till
-                                 * we reach the equilibrium */
-                                ioc_inode_lock (curr);
-                                {
-                                        __ioc_inode_prune (curr, &size_pruned,
-                                                           size_to_prune,
-                                                           index);
+        cache_used = ioc_cache_used (table);
+        if (cache_used <= table->cache_size)
+                goto out;
+
+        size_to_prune = cache_used - table->cache_size
+                + IOC_PRUNE_BATCH (table);
+        quota = max (size_to_prune / IOC_SHARD_COUNT, table->page_size);
+        start = table->prune_runs++;
+
+        ioc_demote (table);
+
+        for (index = 0; index < table->max_pri; index++) {
+                for (protected = 0; protected < 2; protected++) {
+                        do {
+                                pass_pruned = 0;
+
+                                for (i = 0; i < IOC_SHARD_COUNT; i++) {
+                                        shard = &table->shards[(start + i)
+                                                               % IOC_SHARD_COUNT];
+                                        lru = protected ?
+                                                &shard->protected[index] :
+                                                &shard->probation[index];
+
+                                        ioc_shard_lock (shard);
+                                        {
+                                                shard_pruned = __ioc_lru_prune
+                                                        (lru, quota, index);
+                                        }
+                                        ioc_shard_unlock (shard);
+
+                                        pass_pruned += shard_pruned;
+                                        size_pruned += shard_pruned;
+                                        if (size_pruned >= size_to_prune)
+                                                goto out;
                                 }
-                                ioc_inode_unlock (curr);
+                        } while (pass_pruned);
+                }
+        }
+
+out:
+        return 0;
+}
 
-                                if (size_pruned >= size_to_prune)
-                                        break;
-                        } /* list_for_each_entry_safe (curr...) */
 
-                        if (size_pruned >= size_to_prune)
-                                break;
-                } /* for(index=0;...) */
+/*
+ * ioc_schedule_prune - have the pruner thread prune the cache if it is over
+ *                      cache-size
+ *
+ * @table:
+ *
+ * The fop prunes by itself if the pruner does not keep up.
+ */
+void
+ioc_schedule_prune (ioc_table_t *table)
+{
+        uint64_t cache_used = 0;
+
+        cache_used = ioc_cache_used (table);
+        if (cache_used <= table->cache_size)
+                return;
+
+        if (cache_used > IOC_PRUNE_LIMIT (table)) {
+                ioc_prune (table);
+                return;
+        }
 
-        } /* ioc_inode_table locked region end */
+        if (table->prune_pending)
+                return;
+
+        ioc_table_lock (table);
+        {
+                table->prune_pending = 1;
+                pthread_cond_signal (&table->prune_cond);
+        }
         ioc_table_unlock (table);
+}
 
-out:
-        return 0;
+
+void *
+ioc_pruner (void *data)
+{
+        ioc_table_t *table = NULL;
+        char         stop  = 0;
+
+        table = data;
+        THIS = table->xl;
+
+        for (;;) {
+                ioc_table_lock (table);
+                {
+                        while (!table->prune_pending && !table->prune_stop)
+                                pthread_cond_wait (&table->prune_cond,
+                                                   &table->table_lock);
+
+                        stop = table->prune_stop;
+                        table->prune_pending = 0;
+                }
+                ioc_table_unlock (table);
+
+                if (stop)
+                        break;
+
+                ioc_prune (table);
+        }
+
+        return NULL;
 }
 
 /*
@@ -533,25 +782,13 @@ unlock:
 
         ioc_waitq_return (waitq);
 
-        if (iobref_page_size) {
-                ioc_table_lock (table);
-                {
-                        table->cache_used += iobref_page_size;
-                }
-                ioc_table_unlock (table);
-        }
+        if (iobref_page_size)
+                ioc_inode_account (ioc_inode, iobref_page_size);
 
-        if (destroy_size) {
-                ioc_table_lock (table);
-                {
-                        table->cache_used -= destroy_size;
-                }
-                ioc_table_unlock (table);
-        }
+        if (destroy_size)
+                ioc_inode_account (ioc_inode, -destroy_size);
 
-        if (ioc_need_prune (ioc_inode->table)) {
-                ioc_prune (ioc_inode->table);
-        }
+        ioc_schedule_prune (table);
 
         gf_log (frame->this->name, GF_LOG_TRACE, "fault frame %p returned",
                 frame);
@@ -986,7 +1223,7 @@ __ioc_page_error (ioc_page_t *page, int32_t op_ret, int32_t op_errno)
         ioc_waitq_t  *waitq = NULL, *trav = NULL;
         call_frame_t *frame = NULL;
         int64_t       ret   = 0;
-        ioc_table_t  *table = NULL;
+        ioc_inode_t  *inode = NULL;
         ioc_local_t  *local = NULL;
 
         GF_VALIDATE_OR_GOTO ("io-cache", page, out);
@@ -1012,11 +1249,11 @@ __ioc_page_error (ioc_page_t *page, int32_t op_ret, int32_t op_errno)
                 ioc_local_unlock (local);
         }
 
-        table = page->inode->table;
+        inode = page->inode;
         ret = __ioc_page_destroy (page);
 
         if (ret != -1) {
-                table->cache_used -= ret;
+                ioc_inode_account (inode, -ret);
         }
 
 out:
@@ -29,11 +29,16 @@
 */
 
 
+/* names of a directory remembered not to exist */
+#define MDC_NEGATIVE_MAX 256
+
+
 struct mdc_conf {
 	int  timeout;
 	gf_boolean_t cache_posix_acl;
 	gf_boolean_t cache_selinux;
 	gf_boolean_t force_readdirp;
+	gf_boolean_t cache_negative_entry;
 };
 
 
@@ -124,10 +129,27 @@ struct md_cache {
         char         *linkname;
 	time_t        ia_time;
 	time_t        xa_time;
+
+	/* lookups of these names in the directory failed with ENOENT.
+	   They hold as long as the times of the directory are the ones
+	   below, what md_mtime and md_ctime must match to serve them */
+	struct list_head negative;
+	int           negative_count;
+	uint32_t      neg_mtime;
+	uint32_t      neg_mtime_nsec;
+	uint32_t      neg_ctime;
+	uint32_t      neg_ctime_nsec;
+
         gf_lock_t     lock;
 };
 
 
+struct mdc_negative {
+	struct list_head  list;
+	char              name[];
+};
+
+
 struct mdc_local {
         loc_t   loc;
         loc_t   loc2;
@@ -241,6 +263,21 @@ mdc_local_wipe (xlator_t *this, mdc_local_t *local)
 }
 
 
+static void
+__mdc_negative_purge (struct md_cache *mdc)
+{
+	struct mdc_negative *neg = NULL;
+	struct mdc_negative *tmp = NULL;
+
+	list_for_each_entry_safe (neg, tmp, &mdc->negative, list) {
+		list_del (&neg->list);
+		GF_FREE (neg);
+	}
+
+	mdc->negative_count = 0;
+}
+
+
 int
 mdc_inode_wipe (xlator_t *this, inode_t *inode)
 {
@@ -254,6 +291,8 @@ mdc_inode_wipe (xlator_t *this, inode_t *inode)
 
         mdc = (void *) (long) mdc_int;
 
+        __mdc_negative_purge (mdc);
+
         if (mdc->xattr)
                 dict_unref (mdc->xattr);
 
@@ -287,6 +326,7 @@ mdc_inode_prep (xlator_t *this, inode_t *inode)
                 }
 
                 LOCK_INIT (&mdc->lock);
+                INIT_LIST_HEAD (&mdc->negative);
 
                 ret = __mdc_inode_ctx_set (this, inode, mdc);
                 if (ret) {
@@ -459,6 +499,199 @@ out:
         return ret;
 }
 
+static gf_boolean_t
+__mdc_negative_matches (struct md_cache *mdc, uint32_t mtime,
+			uint32_t mtime_nsec, uint32_t ctime,
+			uint32_t ctime_nsec)
+{
+	return (mdc->neg_mtime == mtime && mdc->neg_mtime_nsec == mtime_nsec &&
+		mdc->neg_ctime == ctime && mdc->neg_ctime_nsec == ctime_nsec);
+}
+
+
+static void
+__mdc_negative_stamp (struct md_cache *mdc, struct iatt *iatt)
+{
+	mdc->neg_mtime      = iatt->ia_mtime;
+	mdc->neg_mtime_nsec = iatt->ia_mtime_nsec;
+	mdc->neg_ctime      = iatt->ia_ctime;
+	mdc->neg_ctime_nsec = iatt->ia_ctime_nsec;
+}
+
+
+static struct mdc_negative *
+__mdc_negative_find (struct md_cache *mdc, const char *name)
+{
+	struct mdc_negative *neg = NULL;
+
+	list_for_each_entry (neg, &mdc->negative, list) {
+		if (strcmp (neg->name, name) == 0)
+			return neg;
+	}
+
+	return NULL;
+}
+
+
+/* remembers that @name does not exist in @parent, whose attributes were
+   @postparent at the time */
+int
+mdc_negative_add (xlator_t *this, inode_t *parent, const char *name,
+		  struct iatt *postparent)
+{
+	int                  ret = -1;
+	struct md_cache     *mdc = NULL;
+	struct mdc_negative *neg = NULL;
+
+	if (!postparent || !postparent->ia_ctime)
+		goto out;
+
+	mdc = mdc_inode_prep (this, parent);
+	if (!mdc)
+		goto out;
+
+	LOCK (&mdc->lock);
+	{
+		/* a reply older than what a later fop in the directory
+		   told us, the name may exist by now */
+		if ((mdc->md_ctime > postparent->ia_ctime) ||
+		    ((mdc->md_ctime == postparent->ia_ctime) &&
+		     (mdc->md_ctime_nsec > postparent->ia_ctime_nsec)))
+			goto unlock;
+
+		if (!__mdc_negative_matches (mdc, postparent->ia_mtime,
+					     postparent->ia_mtime_nsec,
+					     postparent->ia_ctime,
+					     postparent->ia_ctime_nsec)) {
+			__mdc_negative_purge (mdc);
+			__mdc_negative_stamp (mdc, postparent);
+		}
+
+		if (__mdc_negative_find (mdc, name))
+			goto done;
+
+		if (mdc->negative_count >= MDC_NEGATIVE_MAX) {
+			neg = list_entry (mdc->negative.next,
+					  struct mdc_negative, list);
+			list_del (&neg->list);
+			GF_FREE (neg);
+			mdc->negative_count--;
+		}
+
+		neg = GF_CALLOC (1, sizeof (*neg) + strlen (name) + 1,
+				 gf_mdc_mt_mdc_negative_t);
+		if (!neg)
+			goto unlock;
+
+		strcpy (neg->name, name);
+		list_add_tail (&neg->list, &mdc->negative);
+		mdc->negative_count++;
+done:
+		ret = 0;
+	}
+unlock:
+	UNLOCK (&mdc->lock);
+out:
+	return ret;
+}
+
+
+/* an entry fop on @name in @parent, @preparent and @postparent are the
+   attributes of @parent around it if it succeeded. The other names
+   still do not exist if nothing else changed the directory meanwhile */
+int
+mdc_negative_update (xlator_t *this, inode_t *parent, const char *name,
+		     struct iatt *preparent, struct iatt *postparent)
+{
+	struct md_cache     *mdc = NULL;
+	struct mdc_negative *neg = NULL;
+
+	if (!parent || mdc_inode_ctx_get (this, parent, &mdc) != 0)
+		return 0;
+
+	LOCK (&mdc->lock);
+	{
+		if (list_empty (&mdc->negative))
+			goto unlock;
+
+		if (name) {
+			neg = __mdc_negative_find (mdc, name);
+			if (neg) {
+				list_del (&neg->list);
+				GF_FREE (neg);
+				mdc->negative_count--;
+			}
+		}
+
+		if (!preparent || !postparent)
+			goto unlock;
+
+		if (__mdc_negative_matches (mdc, preparent->ia_mtime,
+					    preparent->ia_mtime_nsec,
+					    preparent->ia_ctime,
+					    preparent->ia_ctime_nsec))
+			__mdc_negative_stamp (mdc, postparent);
+		else
+			__mdc_negative_purge (mdc);
+	}
+unlock:
+	UNLOCK (&mdc->lock);
+
+	return 0;
+}
+
+
+/* a lookup of a name known not to exist, as long as the cached attributes
+   of the parent are valid and say the directory did not change since */
+static gf_boolean_t
+mdc_negative_lookup (xlator_t *this, loc_t *loc, struct iatt *postparent)
+{
+	struct mdc_conf     *conf  = NULL;
+	struct md_cache     *mdc   = NULL;
+	struct mdc_negative *neg   = NULL;
+	gf_boolean_t         found = _gf_false;
+
+	conf = this->private;
+
+	if (!conf->cache_negative_entry || !loc->parent || !loc->name)
+		goto out;
+
+	/* the inode table knows the name, or it is looked up by gfid */
+	if (!uuid_is_null (loc->inode->gfid) || !uuid_is_null (loc->gfid))
+		goto out;
+
+	if (mdc_inode_iatt_get (this, loc->parent, postparent) != 0)
+		goto out;
+
+	if (mdc_inode_ctx_get (this, loc->parent, &mdc) != 0)
+		goto out;
+
+	LOCK (&mdc->lock);
+	{
+		if (list_empty (&mdc->negative))
+			goto unlock;
+
+		if (!__mdc_negative_matches (mdc, mdc->md_mtime,
+					     mdc->md_mtime_nsec, mdc->md_ctime,
+					     mdc->md_ctime_nsec)) {
+			__mdc_negative_purge (mdc);
+			goto unlock;
+		}
+
+		neg = __mdc_negative_find (mdc, loc->name);
+		if (!neg)
+			goto unlock;
+
+		list_move_tail (&neg->list, &mdc->negative);
+		found = _gf_true;
+	}
+unlock:
+	UNLOCK (&mdc->lock);
+out:
+	return found;
+}
+
+
 struct updatedict {
 	dict_t *dict;
 	int ret;
@@ -754,6 +987,26 @@ mdc_xattr_satisfied (xlator_t *this, dict_t *req, dict_t *rsp)
 }
 
 
+static void
+mdc_lookup_negative_cbk (xlator_t *this, mdc_local_t *local,
+                         struct iatt *postparent)
+{
+        struct mdc_conf *conf = NULL;
+
+        conf = this->private;
+
+        if (!conf->cache_negative_entry)
+                return;
+
+        if (!local->loc.parent || !local->loc.name)
+                return;
+
+        if (mdc_negative_add (this, local->loc.parent, local->loc.name,
+                              postparent) == 0)
+                mdc_inode_iatt_set (this, local->loc.parent, postparent);
+}
+
+
 int
 mdc_lookup_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                 int32_t op_ret,	int32_t op_errno, inode_t *inode,
@@ -763,11 +1016,14 @@ mdc_lookup_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
 
         local = frame->local;
 
-        if (op_ret != 0)
+        if (!local)
                 goto out;
 
-        if (!local)
+        if (op_ret != 0) {
+                if (op_errno == ENOENT)
+                        mdc_lookup_negative_cbk (this, local, postparent);
                 goto out;
+        }
 
         if (local->loc.parent) {
                 mdc_inode_iatt_set (this, local->loc.parent, postparent);
@@ -809,6 +1065,12 @@ mdc_lookup (call_frame_t *frame, xlator_t *this, loc_t *loc,
 
         loc_copy (&local->loc, loc);
 
+        if (mdc_negative_lookup (this, loc, &postparent)) {
+                MDC_STACK_UNWIND (lookup, frame, -1, ENOENT, NULL, NULL,
+                                  NULL, &postparent);
+                return 0;
+        }
+
         ret = mdc_inode_iatt_get (this, loc->inode, &stbuf);
         if (ret != 0)
                 goto uncached;
@@ -1044,11 +1306,17 @@ mdc_mknod_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
 
         local = frame->local;
 
-        if (op_ret != 0)
+        if (!local)
                 goto out;
 
-        if (!local)
+        if (op_ret != 0) {
+                mdc_negative_update (this, local->loc.parent,
+                                     local->loc.name, NULL, NULL);
                 goto out;
+        }
+
+        mdc_negative_update (this, local->loc.parent, local->loc.name,
+                             preparent, postparent);
 
         if (local->loc.parent) {
                 mdc_inode_iatt_set (this, local->loc.parent, postparent);
@@ -1093,11 +1361,17 @@ mdc_mkdir_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
 
         local = frame->local;
 
-        if (op_ret != 0)
+        if (!local)
                 goto out;
 
-        if (!local)
+        if (op_ret != 0) {
+                mdc_negative_update (this, local->loc.parent,
+                                     local->loc.name, NULL, NULL);
                 goto out;
+        }
+
+        mdc_negative_update (this, local->loc.parent, local->loc.name,
+                             preparent, postparent);
 
         if (local->loc.parent) {
                 mdc_inode_iatt_set (this, local->loc.parent, postparent);
@@ -1147,6 +1421,9 @@ mdc_unlink_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         if (!local)
                 goto out;
 
+        mdc_negative_update (this, local->loc.parent, NULL, preparent,
+                             postparent);
+
         if (local->loc.parent) {
                 mdc_inode_iatt_set (this, local->loc.parent, postparent);
         }
@@ -1194,6 +1471,9 @@ mdc_rmdir_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         if (!local)
                 goto out;
 
+        mdc_negative_update (this, local->loc.parent, NULL, preparent,
+                             postparent);
+
         if (local->loc.parent) {
                 mdc_inode_iatt_set (this, local->loc.parent, postparent);
         }
@@ -1232,11 +1512,17 @@ mdc_symlink_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
 
         local = frame->local;
 
-        if (op_ret != 0)
+        if (!local)
                 goto out;
 
-        if (!local)
+        if (op_ret != 0) {
+                mdc_negative_update (this, local->loc.parent,
+                                     local->loc.name, NULL, NULL);
                 goto out;
+        }
+
+        mdc_negative_update (this, local->loc.parent, local->loc.name,
+                             preparent, postparent);
 
         if (local->loc.parent) {
                 mdc_inode_iatt_set (this, local->loc.parent, postparent);
@@ -1282,11 +1568,19 @@ mdc_rename_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
 
         local = frame->local;
 
-        if (op_ret != 0)
+        if (!local)
                 goto out;
 
-        if (!local)
+        if (op_ret != 0) {
+                mdc_negative_update (this, local->loc2.parent,
+                                     local->loc2.name, NULL, NULL);
                 goto out;
+        }
+
+        mdc_negative_update (this, local->loc.parent, NULL, preoldparent,
+                             postoldparent);
+        mdc_negative_update (this, local->loc2.parent, local->loc2.name,
+                             prenewparent, postnewparent);
 
         if (local->loc.parent) {
                 mdc_inode_iatt_set (this, local->loc.parent, postoldparent);
@@ -1338,11 +1632,17 @@ mdc_link_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
 
         local = frame->local;
 
-        if (op_ret != 0)
+        if (!local)
                 goto out;
 
-        if (!local)
+        if (op_ret != 0) {
+                mdc_negative_update (this, local->loc2.parent,
+                                     local->loc2.name, NULL, NULL);
                 goto out;
+        }
+
+        mdc_negative_update (this, local->loc2.parent, local->loc2.name,
+                             preparent, postparent);
 
         if (local->loc.inode) {
                 mdc_inode_iatt_set (this, local->loc.inode, buf);
@@ -1386,11 +1686,17 @@ mdc_create_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
 
         local = frame->local;
 
-        if (op_ret != 0)
+        if (!local)
                 goto out;
 
-        if (!local)
+        if (op_ret != 0) {
+                mdc_negative_update (this, local->loc.parent,
+                                     local->loc.name, NULL, NULL);
                 goto out;
+        }
+
+        mdc_negative_update (this, local->loc.parent, local->loc.name,
+                             preparent, postparent);
 
         if (local->loc.parent) {
                 mdc_inode_iatt_set (this, local->loc.parent, postparent);
@@ -2192,6 +2498,9 @@ reconfigure (xlator_t *this, dict_t *options)
 
 	GF_OPTION_RECONF("force-readdirp", conf->force_readdirp, options, bool, out);
 
+	GF_OPTION_RECONF ("cache-negative-entry", conf->cache_negative_entry,
+			  options, bool, out);
+
 out:
 	return 0;
 }
@@ -2226,6 +2535,9 @@ init (xlator_t *this)
 	mdc_key_load_set (mdc_keys, "system.posix_acl_", conf->cache_posix_acl);
 
 	GF_OPTION_INIT("force-readdirp", conf->force_readdirp, bool, out);
+
+	GF_OPTION_INIT ("cache-negative-entry", conf->cache_negative_entry,
+			bool, out);
 out:
 	this->private = conf;
 
@@ -2299,5 +2611,14 @@ struct volume_options options[] = {
 	  .description = "Convert all readdir requests to readdirplus to "
 			 "collect stat info on each entry.",
 	},
+	{ .key = {"cache-negative-entry"},
+	  .type = GF_OPTION_TYPE_BOOL,
+	  .default_value = "false",
+	  .description = "Answer lookups of names found not to exist in a "
+			 "directory locally, as long as the cached attributes "
+			 "of the directory say it did not change since. "
+			 "Names created by other clients may be missed for "
+			 "up to md-cache-timeout seconds.",
+	},
     { .key = {NULL} },
 };
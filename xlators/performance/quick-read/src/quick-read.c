@@ -280,6 +280,27 @@ qr_content_extract (dict_t *xdata)
 }
 
 
+/* To be called with priv->table.lock held */
+void
+__qr_content_update (qr_inode_table_t *table, qr_inode_t *qr_inode,
+		     void *data, struct iatt *buf)
+{
+	__qr_inode_prune (table, qr_inode);
+
+	qr_inode->data = data;
+	qr_inode->size = buf->ia_size;
+
+	qr_inode->ia_mtime = buf->ia_mtime;
+	qr_inode->ia_mtime_nsec = buf->ia_mtime_nsec;
+
+	qr_inode->buf = *buf;
+
+	gettimeofday (&qr_inode->last_refresh, NULL);
+
+	__qr_inode_register (table, qr_inode);
+}
+
+
 void
 qr_content_update (xlator_t *this, qr_inode_t *qr_inode, void *data,
 		   struct iatt *buf)
@@ -292,19 +313,7 @@ qr_content_update (xlator_t *this, qr_inode_t *qr_inode, void *data,
 
 	LOCK (&table->lock);
 	{
-		__qr_inode_prune (table, qr_inode);
-
-		qr_inode->data = data;
-		qr_inode->size = buf->ia_size;
-
-		qr_inode->ia_mtime = buf->ia_mtime;
-		qr_inode->ia_mtime_nsec = buf->ia_mtime_nsec;
-
-		qr_inode->buf = *buf;
-
-		gettimeofday (&qr_inode->last_refresh, NULL);
-
-		__qr_inode_register (table, qr_inode);
+		__qr_content_update (table, qr_inode, data, buf);
 	}
 	UNLOCK (&table->lock);
 
@@ -487,12 +496,66 @@ wind:
 }
 
 
+/* content of a small file which came along with a readdirp entry */
+void *
+qr_content_prefetched (xlator_t *this, gf_dirent_t *entry)
+{
+	data_t            *data = NULL;
+
+	if (!entry->dict)
+		return NULL;
+
+	data = dict_get (entry->dict, GF_CONTENT_KEY);
+	if (!data || data->len != entry->d_stat.ia_size)
+		return NULL;
+
+	return qr_content_extract (entry->dict);
+}
+
+
+/*
+ * as qr_content_update(), but the prefetched content is taken only if it
+ * fits in what is left of cache-size. checked and inserted under the same
+ * lock, and without a prune, so that prefetching a directory never pushes
+ * out content which was actually read.
+ */
+gf_boolean_t
+qr_content_update_prefetched (xlator_t *this, qr_inode_t *qr_inode,
+			      void *data, struct iatt *buf)
+{
+        qr_private_t      *priv = NULL;
+        qr_inode_table_t  *table = NULL;
+	qr_conf_t         *conf = NULL;
+	size_t             cached = 0;
+	gf_boolean_t       fits = _gf_false;
+
+        priv = this->private;
+        table = &priv->table;
+	conf = &priv->conf;
+
+	LOCK (&table->lock);
+	{
+		/* what is cached for the inode already gets replaced */
+		if (!list_empty (&qr_inode->lru))
+			cached = qr_inode->size;
+		fits = (table->cache_used - cached + buf->ia_size
+			<= conf->cache_size);
+		if (fits)
+			__qr_content_update (table, qr_inode, data, buf);
+	}
+	UNLOCK (&table->lock);
+
+	return fits;
+}
+
+
 int
 qr_readdirp_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
 		 int op_ret, int op_errno, gf_dirent_t *entries, dict_t *xdata)
 {
         gf_dirent_t *entry      = NULL;
 	qr_inode_t  *qr_inode   = NULL;
+	void        *content    = NULL;
 
 	if (op_ret <= 0)
 		goto unwind;
@@ -501,6 +564,25 @@ qr_readdirp_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                 if (!entry->inode)
 			continue;
 
+		content = qr_content_prefetched (this, entry);
+		if (content) {
+			qr_inode = qr_inode_ctx_get_or_new (this,
+							    entry->inode);
+			if (!qr_inode) {
+				/* no harm done */
+				GF_FREE (content);
+				continue;
+			}
+			if (qr_content_update_prefetched (this, qr_inode,
+							  content,
+							  &entry->d_stat))
+				continue;
+			/* no room left, check what may be cached */
+			GF_FREE (content);
+			qr_content_refresh (this, qr_inode, &entry->d_stat);
+			continue;
+		}
+
 		qr_inode = qr_inode_ctx_get (this, entry->inode);
 		if (!qr_inode)
 			/* no harm */
@@ -519,9 +601,38 @@ int
 qr_readdirp (call_frame_t *frame, xlator_t *this, fd_t *fd,
 	     size_t size, off_t offset, dict_t *xdata)
 {
+        qr_private_t     *priv           = NULL;
+        qr_conf_t        *conf           = NULL;
+	int               ret            = 0;
+	dict_t           *new_xdata      = NULL;
+
+        priv = this->private;
+        conf = &priv->conf;
+
+	if (!conf->readdirp_prefetch || !conf->max_file_size)
+		goto wind;
+
+	/* ask for the content of the small files in the directory, the
+	   same way qr_lookup does for a single file */
+	if (!xdata)
+		xdata = new_xdata = dict_new ();
+
+	if (!xdata)
+		goto wind;
+
+	ret = dict_set (xdata, GF_CONTENT_KEY,
+			data_from_uint64 (conf->max_file_size));
+	if (ret)
+		gf_log (this->name, GF_LOG_WARNING,
+			"cannot set key in request dict (readdirp)");
+wind:
 	STACK_WIND (frame, qr_readdirp_cbk,
 		    FIRST_CHILD (this), FIRST_CHILD (this)->fops->readdirp,
 		    fd, size, offset, xdata);
+
+	if (new_xdata)
+		dict_unref (new_xdata);
+
 	return 0;
 }
 
@@ -756,6 +867,8 @@ qr_priv_dump (xlator_t *this)
 
         gf_proc_dump_write ("max_file_size", "%d", conf->max_file_size);
         gf_proc_dump_write ("cache_timeout", "%d", conf->cache_timeout);
+        gf_proc_dump_write ("readdirp_prefetch", "%d",
+                            conf->readdirp_prefetch);
 
         if (!table) {
                 goto out;
@@ -854,6 +967,9 @@ reconfigure (xlator_t *this, dict_t *options)
         GF_OPTION_RECONF ("cache-timeout", conf->cache_timeout, options, int32,
                           out);
 
+        GF_OPTION_RECONF ("readdirp-prefetch", conf->readdirp_prefetch,
+                          options, bool, out);
+
         GF_OPTION_RECONF ("cache-size", cache_size_new, options, size, out);
         if (!check_cache_size_ok (this, cache_size_new)) {
                 ret = -1;
@@ -1005,6 +1121,9 @@ init (xlator_t *this)
                 goto out;
         }
 
+        GF_OPTION_INIT ("readdirp-prefetch", conf->readdirp_prefetch, bool,
+                        out);
+
         INIT_LIST_HEAD (&conf->priority_list);
         conf->max_pri = 1;
         if (dict_get (this->options, "priority")) {
@@ -1144,5 +1263,13 @@ struct volume_options options[] = {
           .max  = 1 * GF_UNIT_KB * 1000,
           .default_value = "64KB",
         },
+        { .key  = {"readdirp-prefetch"},
+          .type = GF_OPTION_TYPE_BOOL,
+          .default_value = "off",
+          .description = "Ask for the content of the files of up to "
+                         "max-file-size along with the entries of readdirp, "
+                         "to cache a whole directory of small files in one "
+                         "go. The content counts against cache-size."
+        },
         { .key  = {NULL} }
 };
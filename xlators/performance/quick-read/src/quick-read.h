@@ -59,6 +59,7 @@ struct qr_conf {
         uint64_t         max_file_size;
         int32_t          cache_timeout;
         uint64_t         cache_size;
+        gf_boolean_t     readdirp_prefetch;
         int              max_pri;
         struct list_head priority_list;
 };
@@ -70,6 +70,9 @@ ra_page_create (ra_file_t *file, off_t offset)
                 page->prev->next = newpage;
                 page->prev = newpage;
 
+                file->cached += file->page_size;
+                RA_CACHED_ADD (file->conf, file->page_size);
+
                 page = newpage;
         }
 
@@ -520,11 +523,22 @@ out:
 void
 ra_page_purge (ra_page_t *page)
 {
+        ra_file_t *file = NULL;
+
         GF_VALIDATE_OR_GOTO ("read-ahead", page, out);
 
+        file = page->file;
+
         page->prev->next = page->next;
         page->next->prev = page->prev;
 
+        /* read ahead, but never asked for */
+        if (page->dirty)
+                file->stats.wasted++;
+
+        file->cached -= file->page_size;
+        RA_CACHED_SUB (file->conf, file->page_size);
+
         if (page->iobref) {
                 iobref_unref (page->iobref);
         }
@@ -587,18 +601,23 @@ ra_file_destroy (ra_file_t *file)
 
         conf = file->conf;
 
+        trav = file->pages.next;
+        while (trav != &file->pages) {
+                ra_page_error (trav, -1, EINVAL);
+                trav = file->pages.next;
+        }
+
         ra_conf_lock (conf);
         {
                 file->prev->next = file->next;
                 file->next->prev = file->prev;
-        }
-        ra_conf_unlock (conf);
 
-        trav = file->pages.next;
-        while (trav != &file->pages) {
-                ra_page_error (trav, -1, EINVAL);
-                trav = file->pages.next;
+                conf->stats.hits       += file->stats.hits;
+                conf->stats.misses     += file->stats.misses;
+                conf->stats.prefetched += file->stats.prefetched;
+                conf->stats.wasted     += file->stats.wasted;
         }
+        ra_conf_unlock (conf);
 
         pthread_mutex_destroy (&file->file_lock);
         GF_FREE (file);
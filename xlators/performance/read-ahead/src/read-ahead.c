@@ -30,7 +30,7 @@
 #include <sys/time.h>
 
 static void
-read_ahead (call_frame_t *frame, ra_file_t *file);
+read_ahead (call_frame_t *frame, ra_file_t *file, off_t offset, size_t size);
 
 
 int
@@ -62,7 +62,6 @@ ra_open_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         if ((fd->flags & O_DIRECT) || ((fd->flags & O_ACCMODE) == O_WRONLY))
                 file->disabled = 1;
 
-        file->offset = (unsigned long long) 0;
         file->conf = conf;
         file->pages.next = &file->pages;
         file->pages.prev = &file->pages;
@@ -81,10 +80,13 @@ ra_open_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         file->fd = fd;
         file->page_count = conf->page_count;
         file->page_size = conf->page_size;
+        file->stream_count = conf->stream_count;
         pthread_mutex_init (&file->file_lock, NULL);
 
+        /* expect a sequential read from the start of the file */
         if (!file->disabled) {
-                file->page_count = 1;
+                file->streams[0].window = file->page_size;
+                file->streams[0].last_use = ++file->tick;
         }
 
         ret = fd_ctx_set (fd, this, (uint64_t)(long)file);
@@ -137,7 +139,6 @@ ra_create_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         if ((fd->flags & O_DIRECT) || ((fd->flags & O_ACCMODE) == O_WRONLY))
                 file->disabled = 1;
 
-        file->offset = (unsigned long long) 0;
         //file->size = fd->inode->buf.ia_size;
         file->conf = conf;
         file->pages.next = &file->pages;
@@ -157,6 +158,7 @@ ra_create_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         file->fd = fd;
         file->page_count = conf->page_count;
         file->page_size = conf->page_size;
+        file->stream_count = conf->stream_count;
         pthread_mutex_init (&file->file_lock, NULL);
 
         ret = fd_ctx_set (fd, this, (uint64_t)(long)file);
@@ -265,60 +267,49 @@ out:
 }
 
 
+/* read ahead the pages of [offset, offset + size), as long as the pages
+   cached for the file and for all files stay within their limits */
 void
-read_ahead (call_frame_t *frame, ra_file_t *file)
+read_ahead (call_frame_t *frame, ra_file_t *file, off_t offset, size_t size)
 {
-        off_t      ra_offset   = 0;
-        size_t     ra_size     = 0;
-        off_t      trav_offset = 0;
-        ra_page_t *trav        = NULL;
-        off_t      cap         = 0;
-        char       fault       = 0;
+        ra_conf_t  *conf        = NULL;
+        ra_page_t  *trav        = NULL;
+        off_t       trav_offset = 0;
+        off_t       cap         = 0;
+        char        fault       = 0;
 
         GF_VALIDATE_OR_GOTO ("read-ahead", frame, out);
         GF_VALIDATE_OR_GOTO (frame->this->name, file, out);
 
-        if (!file->page_count) {
+        if (!size) {
                 goto out;
         }
 
-        ra_size   = file->page_size * file->page_count;
-        ra_offset = floor (file->offset, file->page_size);
-        cap       = file->size ? file->size : file->offset + ra_size;
+        conf        = file->conf;
+        trav_offset = floor (offset, file->page_size);
+        cap         = file->size ? min (file->size, offset + size)
+                                 : offset + size;
 
-        while (ra_offset < min (file->offset + ra_size, cap)) {
-
-                ra_file_lock (file);
-                {
-                        trav = ra_page_get (file, ra_offset);
-                }
-                ra_file_unlock (file);
-
-                if (!trav)
-                        break;
-
-                ra_offset += file->page_size;
-        }
-
-        if (trav) {
-                /* comfortable enough */
-                goto out;
-        }
-
-        trav_offset = ra_offset;
-
-        cap  = file->size ? file->size : ra_offset + ra_size;
-
-        while (trav_offset < min(ra_offset + ra_size, cap)) {
+        while (trav_offset < cap) {
                 fault = 0;
                 ra_file_lock (file);
                 {
                         trav = ra_page_get (file, trav_offset);
                         if (!trav) {
+                                if ((file->cached + file->page_size
+                                     > conf->file_window_limit) ||
+                                    (conf->cached + file->page_size
+                                     > conf->window_limit)) {
+                                        ra_file_unlock (file);
+                                        break;
+                                }
+
                                 fault = 1;
                                 trav = ra_page_create (file, trav_offset);
-                                if (trav)
+                                if (trav) {
                                         trav->dirty = 1;
+                                        file->stats.prefetched++;
+                                }
                         }
                 }
                 ra_file_unlock (file);
@@ -395,6 +386,11 @@ dispatch_requests (call_frame_t *frame, ra_file_t *file)
                         }
                         trav->dirty = 0;
 
+                        if (fault)
+                                file->stats.misses++;
+                        else
+                                file->stats.hits++;
+
                         if (trav->ready) {
                                 gf_log (frame->this->name, GF_LOG_TRACE,
                                         "HIT at offset=%"PRId64".",
@@ -459,23 +455,100 @@ ra_readv_disabled_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
 }
 
 
+/*
+ * __ra_stream_get - find the stream a read belongs to, and move it past the
+ *                   read
+ *
+ * A read continues a stream when it starts within the read-ahead window of
+ * the stream. The window doubles when the read starts exactly where the
+ * previous one ended, and is halved when the read skipped part of it. A read
+ * continuing no stream takes over the least recently used one, whose
+ * read-ahead pages are dropped.
+ *
+ * @param file        - the file, locked
+ * @param offset      - offset of the read
+ * @param size        - size of the read
+ * @param flush_start - set to the start of the pages no longer needed
+ * @param flush_end   - set to the end of the pages no longer needed
+ * @return the stream
+ */
+static struct ra_stream *
+__ra_stream_get (ra_file_t *file, off_t offset, size_t size,
+                 off_t *flush_start, off_t *flush_end)
+{
+        struct ra_stream *stream = NULL;
+        struct ra_stream *lru    = NULL;
+        size_t            limit  = 0;
+        uint32_t          i      = 0;
+
+        limit = file->page_size * file->page_count;
+        file->tick++;
+
+        for (i = 0; i < file->stream_count; i++) {
+                stream = &file->streams[i];
+
+                if (stream->last_use && offset >= stream->offset &&
+                    offset <= stream->offset + (off_t)stream->window)
+                        break;
+
+                if (!lru || stream->last_use < lru->last_use)
+                        lru = stream;
+
+                stream = NULL;
+        }
+
+        if (stream) {
+                if (offset == stream->offset) {
+                        if (stream->window)
+                                stream->window *= 2;
+                        else
+                                stream->window = roof (size, file->page_size);
+                        stream->window = min (stream->window, limit);
+                } else {
+                        /* the pages skipped were read ahead in vain */
+                        stream->window = floor (stream->window / 2,
+                                                file->page_size);
+                }
+
+                *flush_start = stream->consumed;
+                *flush_end   = floor (offset, file->page_size);
+        } else {
+                stream = lru;
+
+                *flush_start = stream->consumed;
+                *flush_end   = stream->last_use ?
+                        roof (stream->offset + stream->window,
+                              file->page_size) : 0;
+
+                stream->window = 0;
+        }
+
+        stream->consumed = floor (offset, file->page_size);
+        stream->offset   = offset + size;
+        stream->last_use = file->tick;
+
+        return stream;
+}
+
+
 int
 ra_readv (call_frame_t *frame, xlator_t *this, fd_t *fd, size_t size,
           off_t offset, uint32_t flags, dict_t *xdata)
 {
-        ra_file_t   *file            = NULL;
-        ra_local_t  *local           = NULL;
-        ra_conf_t   *conf            = NULL;
-        int          op_errno        = EINVAL;
-        char         expected_offset = 1;
-        uint64_t     tmp_file        = 0;
+        ra_file_t        *file        = NULL;
+        ra_local_t       *local       = NULL;
+        struct ra_stream *stream      = NULL;
+        int               op_errno    = EINVAL;
+        uint64_t          tmp_file    = 0;
+        off_t             flush_start = 0;
+        off_t             flush_end   = 0;
+        off_t             ra_offset   = 0;
+        size_t            ra_size     = 0;
 
         GF_ASSERT (frame);
         GF_VALIDATE_OR_GOTO (frame->this->name, this, unwind);
         GF_VALIDATE_OR_GOTO (frame->this->name, fd, unwind);
 
-        conf = this->private;
-
         gf_log (this->name, GF_LOG_TRACE,
                 "NEW REQ at offset=%"PRId64" for size=%"GF_PRI_SIZET"",
                 offset, size);
@@ -487,28 +560,19 @@ ra_readv (call_frame_t *frame, xlator_t *this, fd_t *fd, size_t size,
                 goto disabled;
         }
 
-        if (file->offset != offset) {
-                gf_log (this->name, GF_LOG_TRACE,
-                        "unexpected offset (%"PRId64" != %"PRId64") resetting",
-                        file->offset, offset);
-
-                expected_offset = file->expected = file->page_count = 0;
-        } else {
-                gf_log (this->name, GF_LOG_TRACE,
-                        "expected offset (%"PRId64") when page_count=%d",
-                        offset, file->page_count);
-
-                if (file->expected < (file->page_size * conf->page_count)) {
-                        file->expected += size;
-                        file->page_count = min ((file->expected
-                                                 / file->page_size),
-                                                conf->page_count);
-                }
+        ra_file_lock (file);
+        {
+                stream = __ra_stream_get (file, offset, size, &flush_start,
+                                          &flush_end);
+                ra_offset = stream->offset;
+                ra_size   = stream->window;
         }
+        ra_file_unlock (file);
 
-        if (!expected_offset) {
-                flush_region (frame, file, 0, file->pages.prev->offset + 1, 0);
-        }
+        gf_log (this->name, GF_LOG_TRACE,
+                "stream %d: read-ahead window %"GF_PRI_SIZET" at "
+                "offset=%"PRId64, (int)(stream - file->streams), ra_size,
+                ra_offset);
 
         local = mem_get0 (this->local_pool);
         if (!local) {
@@ -530,14 +594,14 @@ ra_readv (call_frame_t *frame, xlator_t *this, fd_t *fd, size_t size,
 
         dispatch_requests (frame, file);
 
-        flush_region (frame, file, 0, floor (offset, file->page_size), 0);
+        if (flush_end > flush_start)
+                flush_region (frame, file, flush_start,
+                              flush_end - flush_start, 0);
 
-        read_ahead (frame, file);
+        read_ahead (frame, file, ra_offset, ra_size);
 
         ra_frame_return (frame);
 
-        file->offset = offset + size;
-
         return 0;
 
 unwind:
@@ -665,6 +729,7 @@ ra_writev (call_frame_t *frame, xlator_t *this, fd_t *fd, struct iovec *vector,
         ra_file_t *file    = NULL;
         uint64_t  tmp_file = 0;
         int32_t   op_errno = EINVAL;
+        uint32_t  i        = 0;
 
         GF_ASSERT (frame);
         GF_VALIDATE_OR_GOTO (frame->this->name, this, unwind);
@@ -675,8 +740,13 @@ ra_writev (call_frame_t *frame, xlator_t *this, fd_t *fd, struct iovec *vector,
         if (file) {
                 flush_region (frame, file, 0, file->pages.prev->offset+1, 1);
                 frame->local = file;
-                /* reset the read-ahead counters too */
-                file->expected = file->page_count = 0;
+                /* reset the read-ahead windows too */
+                ra_file_lock (file);
+                {
+                        for (i = 0; i < file->stream_count; i++)
+                                file->streams[i].window = 0;
+                }
+                ra_file_unlock (file);
         }
 
         STACK_WIND (frame, ra_writev_cbk,
@@ -798,6 +868,25 @@ out:
         return;
 }
 
+/* hit and waste ratios, in percent */
+static void
+ra_stats_dump (struct ra_stats *stats)
+{
+        uint64_t reads = 0;
+
+        gf_proc_dump_write ("hits", "%"PRIu64, stats->hits);
+        gf_proc_dump_write ("misses", "%"PRIu64, stats->misses);
+        gf_proc_dump_write ("prefetched", "%"PRIu64, stats->prefetched);
+        gf_proc_dump_write ("wasted", "%"PRIu64, stats->wasted);
+
+        reads = stats->hits + stats->misses;
+        gf_proc_dump_write ("hit-ratio", "%.2f",
+                            reads ? stats->hits * 100.0 / reads : 0.0);
+        gf_proc_dump_write ("waste-ratio", "%.2f",
+                            stats->prefetched ?
+                            stats->wasted * 100.0 / stats->prefetched : 0.0);
+}
+
 int32_t
 ra_fdctx_dump (xlator_t *this, fd_t *fd)
 {
@@ -842,8 +931,21 @@ ra_fdctx_dump (xlator_t *this, fd_t *fd)
 
         gf_proc_dump_write ("page-count", "%u", file->page_count);
 
-        gf_proc_dump_write ("next-expected-offset-for-sequential-reads",
-                            "%"PRId64, file->offset);
+        gf_proc_dump_write ("cached", "%"PRIu64, file->cached);
+
+        for (i = 0; i < file->stream_count; i++) {
+                if (!file->streams[i].last_use)
+                        continue;
+                sprintf (key, "stream[%d].next-expected-offset", i);
+                gf_proc_dump_write (key, "%"PRId64, file->streams[i].offset);
+                sprintf (key, "stream[%d].window", i);
+                gf_proc_dump_write (key, "%"GF_PRI_SIZET,
+                                    file->streams[i].window);
+        }
+
+        ra_stats_dump (&file->stats);
+
+        i = 0;
 
         for (page = file->pages.next; page != &file->pages;
              page = page->next) {
@@ -1047,6 +1149,8 @@ int
 ra_priv_dump (xlator_t *this)
 {
         ra_conf_t       *conf                           = NULL;
+        ra_file_t       *file                           = NULL;
+        struct ra_stats  stats                          = {0, };
         int             ret                             = -1;
         char            key_prefix[GF_DUMP_MAX_BUF_LEN] = {0, };
         gf_boolean_t    add_section                     = _gf_false;
@@ -1073,8 +1177,26 @@ ra_priv_dump (xlator_t *this)
         {
                 gf_proc_dump_write ("page_size", "%d", conf->page_size);
                 gf_proc_dump_write ("page_count", "%d", conf->page_count);
+                gf_proc_dump_write ("stream_count", "%u", conf->stream_count);
+                gf_proc_dump_write ("file_window_limit", "%"PRIu64,
+                                    conf->file_window_limit);
+                gf_proc_dump_write ("window_limit", "%"PRIu64,
+                                    conf->window_limit);
+                gf_proc_dump_write ("cached", "%"PRIu64, conf->cached);
                 gf_proc_dump_write ("force_atime_update", "%d",
                                     conf->force_atime_update);
+
+                /* the counters of open files are read unlocked, they are
+                   only approximate */
+                stats = conf->stats;
+                for (file = conf->files.next; file != &conf->files;
+                     file = file->next) {
+                        stats.hits       += file->stats.hits;
+                        stats.misses     += file->stats.misses;
+                        stats.prefetched += file->stats.prefetched;
+                        stats.wasted     += file->stats.wasted;
+                }
+                ra_stats_dump (&stats);
         }
         pthread_mutex_unlock (&conf->conf_lock);
 
@@ -1124,6 +1246,15 @@ reconfigure (xlator_t *this, dict_t *options)
 
         GF_OPTION_RECONF ("page-count", conf->page_count, options, uint32, out);
 
+        GF_OPTION_RECONF ("stream-count", conf->stream_count, options, uint32,
+                          out);
+
+        GF_OPTION_RECONF ("file-window-limit", conf->file_window_limit,
+                          options, size, out);
+
+        GF_OPTION_RECONF ("window-limit", conf->window_limit, options, size,
+                          out);
+
 	GF_OPTION_RECONF ("page-size", conf->page_size, options, size, out);
 
         ret = 0;
@@ -1162,12 +1293,20 @@ init (xlator_t *this)
 
         GF_OPTION_INIT ("page-count", conf->page_count, uint32, out);
 
+        GF_OPTION_INIT ("stream-count", conf->stream_count, uint32, out);
+
+        GF_OPTION_INIT ("file-window-limit", conf->file_window_limit, size,
+                        out);
+
+        GF_OPTION_INIT ("window-limit", conf->window_limit, size, out);
+
         GF_OPTION_INIT ("force-atime-update", conf->force_atime_update, bool, out);
 
         conf->files.next = &conf->files;
         conf->files.prev = &conf->files;
 
         pthread_mutex_init (&conf->conf_lock, NULL);
+        LOCK_INIT (&conf->cached_lock);
 
         this->local_pool = mem_pool_new (ra_local_t, 64);
         if (!this->local_pool) {
@@ -1207,6 +1346,7 @@ fini (xlator_t *this)
                    && (conf->files.prev == &conf->files));
 
         pthread_mutex_destroy (&conf->conf_lock);
+        LOCK_DESTROY (&conf->cached_lock);
         GF_FREE (conf);
 
 out:
@@ -1246,7 +1386,34 @@ struct volume_options options[] = {
           .min  = 1,
           .max  = 16,
           .default_value = "4",
-          .description = "Number of pages that will be pre-fetched"
+          .description = "Maximum number of pages that will be pre-fetched "
+                         "for a sequential stream of reads. The read-ahead "
+                         "window of a stream starts small and doubles as "
+                         "long as its reads stay sequential"
+        },
+        { .key  = {"stream-count"},
+          .type = GF_OPTION_TYPE_INT,
+          .min  = 1,
+          .max  = RA_MAX_STREAMS,
+          .default_value = "4",
+          .description = "Number of concurrent sequential streams of reads "
+                         "detected on a file descriptor"
+        },
+        { .key  = {"file-window-limit"},
+          .type = GF_OPTION_TYPE_SIZET,
+          .min  = 4096,
+          .max  = 1 * GF_UNIT_GB,
+          .default_value = "8MB",
+          .description = "Maximum size of the pages cached for a file "
+                         "descriptor. No more pages are read ahead beyond it"
+        },
+        { .key  = {"window-limit"},
+          .type = GF_OPTION_TYPE_SIZET,
+          .min  = 4096,
+          .max  = 32 * GF_UNIT_GB,
+          .default_value = "256MB",
+          .description = "Maximum size of the pages cached for all file "
+                         "descriptors. No more pages are read ahead beyond it"
         },
 	{ .key = {"page-size"},
 	  .type = GF_OPTION_TYPE_SIZET,
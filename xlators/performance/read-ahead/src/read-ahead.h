@@ -30,6 +30,9 @@ struct ra_page;
 struct ra_file;
 struct ra_waitq;
 
+/* upper bound of the stream-count option */
+#define RA_MAX_STREAMS 16
+
 
 struct ra_waitq {
         struct ra_waitq *next;
@@ -80,27 +83,58 @@ struct ra_page {
 };
 
 
+/* a sequential stream of reads on an fd */
+struct ra_stream {
+        off_t              offset;   /* where the next read is expected */
+        off_t              consumed; /* pages below this have been read */
+        size_t             window;   /* bytes to read ahead of offset */
+        uint64_t           last_use; /* 0 if the slot is unused */
+};
+
+
+/* counted in pages */
+struct ra_stats {
+        uint64_t           hits;       /* user reads found in the cache */
+        uint64_t           misses;     /* user reads which had to wait */
+        uint64_t           prefetched; /* read ahead */
+        uint64_t           wasted;     /* read ahead, dropped unread */
+};
+
+
 struct ra_file {
         struct ra_file    *next;
         struct ra_file    *prev;
         struct ra_conf    *conf;
         fd_t              *fd;
         int                disabled;
-        size_t             expected;
         struct ra_page     pages;
-        off_t              offset;
         size_t             size;
         int32_t            refcount;
         pthread_mutex_t    file_lock;
         struct iatt        stbuf;
         uint64_t           page_size;
         uint32_t           page_count;
+        struct ra_stream   streams[RA_MAX_STREAMS];
+        uint32_t           stream_count;
+        uint64_t           tick;
+        /* bytes held by the pages of the file */
+        uint64_t           cached;
+        struct ra_stats    stats;
 };
 
 
 struct ra_conf {
         uint64_t          page_size;
         uint32_t          page_count;
+        uint32_t          stream_count;
+        uint64_t          file_window_limit;
+        uint64_t          window_limit;
+        /* bytes held by the pages of all files, cached_lock is for the
+           compilers without atomic builtins */
+        uint64_t          cached;
+        gf_lock_t         cached_lock;
+        /* stats of the files already released */
+        struct ra_stats   stats;
         void             *cache_block;
         struct ra_file    files;
         gf_boolean_t      force_atime_update;
@@ -189,4 +223,10 @@ ra_local_unlock (ra_local_t *local)
         pthread_mutex_unlock (&local->local_lock);
 }
 
+/* conf->cached is updated with the file lock held */
+#define RA_CACHED_ADD(conf,n) ((void) GF_ATOMIC_ADD ((conf)->cached_lock, \
+                                                     (conf)->cached, n))
+#define RA_CACHED_SUB(conf,n) ((void) GF_ATOMIC_SUB ((conf)->cached_lock, \
+                                                     (conf)->cached, n))
+
 #endif /* __READ_AHEAD_H */
@@ -18,6 +18,7 @@ enum gf_rda_mem_types_ {
         gf_rda_mt_rda_local   = gf_common_mt_end + 1,
 	gf_rda_mt_rda_fd_ctx,
 	gf_rda_mt_rda_priv,
+	gf_rda_mt_rda_inode_ctx,
         gf_rda_mt_end
 };
 
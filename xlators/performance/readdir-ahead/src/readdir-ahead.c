@@ -21,6 +21,18 @@
  * The translator is currently designed to handle the simple, sequential case
  * only. If a non-sequential directory read occurs, readdir-ahead disables
  * preloads on the directory.
+ *
+ * With rda-cache enabled, a preload that completes a listing from offset 0 is
+ * also kept with the directory inode. Later opendirs of the directory serve
+ * readdirp at any offset from that listing, without a preload, as long as a
+ * stat of the directory issued along with opendir still finds the times it
+ * had when it was listed. Entry fops on the directory through this client
+ * drop the listing, and listings are evicted least recently used first when
+ * the memory budget (rda-cache-limit) is used up.
+ *
+ * The times of the directory do not change with the data or attributes of
+ * its entries, so only the names are cached: entries served from the cache
+ * carry no attributes (nor inode), and the layers above look them up.
  */
 
 #ifndef _CONFIG_H
@@ -57,6 +69,7 @@ rda_fd_ctx *get_rda_fd_ctx(fd_t *fd, xlator_t *this)
 
 		LOCK_INIT(&ctx->lock);
 		INIT_LIST_HEAD(&ctx->entries.list);
+		INIT_LIST_HEAD(&ctx->fill.list);
 		ctx->state = RDA_FD_NEW;
 		/* ctx offset values initialized to 0 */
 
@@ -84,6 +97,262 @@ rda_reset_ctx(struct rda_fd_ctx *ctx)
 	ctx->cur_size = 0;
 	ctx->next_offset = 0;
 	gf_dirent_free(&ctx->entries);
+	gf_dirent_free(&ctx->fill);
+	ctx->fill_size = 0;
+}
+
+/*
+ * Get (or create) the inode context holding the cached listing of a
+ * directory.
+ */
+static struct rda_inode_ctx *
+get_rda_inode_ctx(inode_t *inode, xlator_t *this)
+{
+	uint64_t val;
+	struct rda_inode_ctx *ictx = NULL;
+
+	LOCK(&inode->lock);
+
+	if (__inode_ctx_get(inode, this, &val) < 0) {
+		ictx = GF_CALLOC(1, sizeof(struct rda_inode_ctx),
+				 gf_rda_mt_rda_inode_ctx);
+		if (!ictx)
+			goto out;
+
+		LOCK_INIT(&ictx->lock);
+		INIT_LIST_HEAD(&ictx->lru);
+		INIT_LIST_HEAD(&ictx->entries.list);
+
+		if (__inode_ctx_put(inode, this, (uint64_t) ictx) < 0) {
+			GF_FREE(ictx);
+			ictx = NULL;
+			goto out;
+		}
+	} else {
+		ictx = (struct rda_inode_ctx *) val;
+	}
+out:
+	UNLOCK(&inode->lock);
+	return ictx;
+}
+
+/*
+ * Drop the cached listing of a directory. priv and ictx must be locked.
+ */
+static void
+__rda_inode_purge(struct rda_priv *priv, struct rda_inode_ctx *ictx)
+{
+	gf_dirent_free(&ictx->entries);
+	priv->cache_size -= ictx->size;
+	ictx->size = 0;
+	ictx->valid = _gf_false;
+	ictx->gen++;
+	list_del_init(&ictx->lru);
+}
+
+static void
+rda_inode_invalidate(xlator_t *this, inode_t *inode)
+{
+	uint64_t val;
+	struct rda_inode_ctx *ictx;
+	struct rda_priv *priv = this->private;
+
+	if (!inode || inode_ctx_get(inode, this, &val) < 0)
+		return;
+
+	ictx = (struct rda_inode_ctx *) val;
+
+	LOCK(&priv->lock);
+	LOCK(&ictx->lock);
+	__rda_inode_purge(priv, ictx);
+	UNLOCK(&ictx->lock);
+	UNLOCK(&priv->lock);
+}
+
+static gf_boolean_t
+rda_same_times(struct iatt *a, struct iatt *b)
+{
+	return (a->ia_mtime == b->ia_mtime &&
+		a->ia_mtime_nsec == b->ia_mtime_nsec &&
+		a->ia_ctime == b->ia_ctime &&
+		a->ia_ctime_nsec == b->ia_ctime_nsec);
+}
+
+/*
+ * Name-only copy of a dirent for the directory cache, adding the memory it
+ * holds to @size. The attributes, xattrs and inode are left out: they may
+ * change without the times of the directory changing.
+ */
+static gf_dirent_t *
+rda_dirent_copy(gf_dirent_t *dirent, uint64_t *size)
+{
+	gf_dirent_t *copy;
+
+	copy = gf_dirent_for_name(dirent->d_name);
+	if (!copy)
+		return NULL;
+
+	copy->d_ino = dirent->d_ino;
+	copy->d_off = dirent->d_off;
+	copy->d_type = dirent->d_type;
+
+	if (size)
+		*size += gf_dirent_size(dirent->d_name);
+
+	return copy;
+}
+
+/*
+ * Check the cached listing against the directory attributes found at
+ * opendir, and decide whether the fd is served from it or its preload
+ * builds a new one.
+ */
+static void
+rda_inode_validate(xlator_t *this, fd_t *fd, struct rda_fd_ctx *ctx,
+		   struct iatt *stbuf)
+{
+	struct rda_inode_ctx *ictx;
+	struct rda_priv *priv = this->private;
+	time_t now = time(NULL);
+
+	ictx = get_rda_inode_ctx(fd->inode, this);
+	if (!ictx)
+		return;
+
+	LOCK(&priv->lock);
+	LOCK(&ictx->lock);
+
+	if (ictx->valid && (!rda_same_times(&ictx->stbuf, stbuf) ||
+	    now >= ictx->cached_at + priv->rda_cache_timeout))
+		__rda_inode_purge(priv, ictx);
+
+	ctx->ictx = ictx;
+	ctx->gen = ictx->gen;
+	ctx->stbuf = *stbuf;
+
+	if (ictx->valid) {
+		ctx->state |= RDA_FD_CACHED;
+		list_move_tail(&ictx->lru, &priv->lru);
+	} else {
+		ctx->state |= RDA_FD_COLLECT;
+	}
+
+	UNLOCK(&ictx->lock);
+	UNLOCK(&priv->lock);
+}
+
+/*
+ * The preload of the fd completed the listing: keep it, unless the directory
+ * changed since the fd was opened or it does not fit in the budget. ctx must
+ * be locked.
+ */
+static void
+__rda_inode_publish(xlator_t *this, struct rda_fd_ctx *ctx)
+{
+	struct rda_inode_ctx *ictx = ctx->ictx;
+	struct rda_inode_ctx *victim, *tmp;
+	struct rda_priv *priv = this->private;
+
+	ctx->state &= ~RDA_FD_COLLECT;
+
+	LOCK(&priv->lock);
+	LOCK(&ictx->lock);
+
+	if (ictx->gen != ctx->gen || ctx->fill_size > priv->rda_cache_limit)
+		goto unlock;
+
+	list_for_each_entry_safe(victim, tmp, &priv->lru, lru) {
+		if (priv->cache_size + ctx->fill_size <= priv->rda_cache_limit)
+			break;
+		if (victim == ictx)
+			continue;
+
+		LOCK(&victim->lock);
+		__rda_inode_purge(priv, victim);
+		UNLOCK(&victim->lock);
+	}
+
+	if (priv->cache_size + ctx->fill_size > priv->rda_cache_limit)
+		goto unlock;
+
+	list_splice_init(&ctx->fill.list, &ictx->entries.list);
+	ictx->size = ctx->fill_size;
+	ictx->stbuf = ctx->stbuf;
+	ictx->cached_at = time(NULL);
+	ictx->valid = _gf_true;
+	ictx->gen++;
+	list_move_tail(&ictx->lru, &priv->lru);
+	priv->cache_size += ictx->size;
+
+unlock:
+	UNLOCK(&ictx->lock);
+	UNLOCK(&priv->lock);
+
+	gf_dirent_free(&ctx->fill);
+	ctx->fill_size = 0;
+}
+
+/*
+ * Serve a request from the cached listing of the directory. Returns -1 if the
+ * listing changed since the fd was opened or does not have the offset, and
+ * -EINVAL if the next entry does not fit in @request_size.
+ */
+static int
+rda_serve_cached(xlator_t *this, struct rda_fd_ctx *ctx, gf_dirent_t *entries,
+		 size_t request_size, off_t off)
+{
+	struct rda_inode_ctx *ictx = ctx->ictx;
+	gf_dirent_t *dirent, *copy;
+	size_t size = 0;
+	int count = 0;
+
+	LOCK(&ictx->lock);
+
+	if (!ictx->valid || ictx->gen != ctx->gen) {
+		count = -1;
+		goto unlock;
+	}
+
+	if (!off) {
+		dirent = list_entry(ictx->entries.list.next, gf_dirent_t, list);
+	} else if (ctx->cursor && ctx->cursor->d_off == off) {
+		dirent = list_entry(ctx->cursor->list.next, gf_dirent_t, list);
+	} else {
+		count = -1;
+		list_for_each_entry(dirent, &ictx->entries.list, list) {
+			if (dirent->d_off == off) {
+				count = 0;
+				break;
+			}
+		}
+		if (count < 0)
+			goto unlock;
+		dirent = list_entry(dirent->list.next, gf_dirent_t, list);
+	}
+
+	for (; &dirent->list != &ictx->entries.list;
+	     dirent = list_entry(dirent->list.next, gf_dirent_t, list)) {
+		size += gf_dirent_size(dirent->d_name);
+		if (size > request_size) {
+			/* not the end of the directory */
+			if (!count)
+				count = -EINVAL;
+			break;
+		}
+
+		copy = rda_dirent_copy(dirent, NULL);
+		if (!copy)
+			break;
+
+		list_add_tail(&copy->list, &entries->list);
+		ctx->cursor = dirent;
+		count++;
+	}
+
+unlock:
+	UNLOCK(&ictx->lock);
+
+	return count;
 }
 
 /*
@@ -104,7 +373,8 @@ rda_can_serve_readdirp(struct rda_fd_ctx *ctx, size_t request_size)
 
 /*
  * Serve a request from the fd dentry list based on the size of the request
- * buffer. ctx must be locked.
+ * buffer. Returns -EINVAL if the next entry does not fit in the buffer. ctx
+ * must be locked.
  */
 static int32_t
 __rda_serve_readdirp(xlator_t *this, gf_dirent_t *entries, size_t request_size,
@@ -117,8 +387,12 @@ __rda_serve_readdirp(xlator_t *this, gf_dirent_t *entries, size_t request_size,
 
 	list_for_each_entry_safe(dirent, tmp, &ctx->entries.list, list) {
 		dirent_size = gf_dirent_size(dirent->d_name);
-		if (size + dirent_size > request_size)
+		if (size + dirent_size > request_size) {
+			/* not the end of the directory */
+			if (!count)
+				count = -EINVAL;
 			break;
+		}
 
 		size += dirent_size;
 		list_del_init(&dirent->list);
@@ -148,7 +422,10 @@ rda_readdirp_stub(call_frame_t *frame, xlator_t *this, fd_t *fd, size_t size,
 	INIT_LIST_HEAD(&entries.list);
 	ret = __rda_serve_readdirp(this, &entries, size, ctx);
 
-	if (!ret && (ctx->state & RDA_FD_ERROR)) {
+	if (ret < 0) {
+		op_errno = -ret;
+		ret = -1;
+	} else if (!ret && (ctx->state & RDA_FD_ERROR)) {
 		ret = -1;
 		op_errno = ctx->op_errno;
 		ctx->state &= ~RDA_FD_ERROR;
@@ -172,7 +449,9 @@ rda_readdirp(call_frame_t *frame, xlator_t *this, fd_t *fd, size_t size,
 {
 	struct rda_fd_ctx *ctx;
 	call_stub_t *stub;
+	gf_dirent_t entries;
 	int fill = 0;
+	int ret;
 
 	ctx = get_rda_fd_ctx(fd, this);
 	if (!ctx)
@@ -181,6 +460,30 @@ rda_readdirp(call_frame_t *frame, xlator_t *this, fd_t *fd, size_t size,
 	if (ctx->state & RDA_FD_BYPASS)
 		goto bypass;
 
+	if (ctx->state & RDA_FD_CACHED) {
+		INIT_LIST_HEAD(&entries.list);
+
+		LOCK(&ctx->lock);
+		ret = rda_serve_cached(this, ctx, &entries, size, off);
+		if (ret == -1) {
+			ctx->state &= ~RDA_FD_CACHED;
+			ctx->state |= RDA_FD_BYPASS;
+		}
+		UNLOCK(&ctx->lock);
+
+		if (ret == -1)
+			goto bypass;
+
+		if (ret < 0)
+			STACK_UNWIND_STRICT(readdirp, frame, -1, -ret, &entries,
+					    xdata);
+		else
+			STACK_UNWIND_STRICT(readdirp, frame, ret, 0, &entries,
+					    xdata);
+		gf_dirent_free(&entries);
+		return 0;
+	}
+
 	LOCK(&ctx->lock);
 
 	/* recheck now that we have the lock */
@@ -241,6 +544,27 @@ err:
 	return 0;
 }
 
+/*
+ * Copy an entry of the preload for the directory cache, or give up on
+ * caching the listing if it grows past the budget. ctx must be locked.
+ */
+static void
+rda_fill_collect(xlator_t *this, struct rda_fd_ctx *ctx, gf_dirent_t *dirent)
+{
+	gf_dirent_t *copy;
+	struct rda_priv *priv = this->private;
+
+	copy = rda_dirent_copy(dirent, &ctx->fill_size);
+	if (copy)
+		list_add_tail(&copy->list, &ctx->fill.list);
+
+	if (!copy || ctx->fill_size > priv->rda_cache_limit) {
+		ctx->state &= ~RDA_FD_COLLECT;
+		gf_dirent_free(&ctx->fill);
+		ctx->fill_size = 0;
+	}
+}
+
 static int32_t
 rda_fill_fd_cbk(call_frame_t *frame, void *cookie, xlator_t *this,
 		 int32_t op_ret, int32_t op_errno, gf_dirent_t *entries,
@@ -266,6 +590,9 @@ rda_fill_fd_cbk(call_frame_t *frame, void *cookie, xlator_t *this,
 
 	if (entries) {
 		list_for_each_entry_safe(dirent, tmp, &entries->list, list) {
+			if (ctx->state & RDA_FD_COLLECT)
+				rda_fill_collect(this, ctx, dirent);
+
 			list_del_init(&dirent->list);
 			/* must preserve entry order */
 			list_add_tail(&dirent->list, &ctx->entries.list);
@@ -282,6 +609,9 @@ rda_fill_fd_cbk(call_frame_t *frame, void *cookie, xlator_t *this,
 		/* we've hit eod */
 		ctx->state &= ~RDA_FD_RUNNING;
 		ctx->state |= RDA_FD_EOD;
+
+		if (ctx->state & RDA_FD_COLLECT)
+			__rda_inode_publish(this, ctx);
 	} else if (op_ret == -1) {
 		/* kill the preload and pend the error */
 		ctx->state &= ~RDA_FD_RUNNING;
@@ -399,12 +729,209 @@ rda_opendir_cbk(call_frame_t *frame, void *cookie, xlator_t *this,
 	return 0;
 }
 
+/*
+ * Both the opendir and the stat of the directory returned.
+ */
+static void
+rda_opendir_done(call_frame_t *frame, xlator_t *this)
+{
+	struct rda_local *local = frame->local;
+	struct rda_fd_ctx *ctx;
+	fd_t *fd = local->fd;
+	dict_t *xdata = local->xdata;
+	int32_t op_ret = local->op_ret;
+	int32_t op_errno = local->op_errno;
+
+	frame->local = NULL;
+
+	if (!op_ret) {
+		ctx = get_rda_fd_ctx(fd, this);
+		if (ctx && local->stat_ok)
+			rda_inode_validate(this, fd, ctx, &local->stbuf);
+
+		if (!ctx || !(ctx->state & RDA_FD_CACHED))
+			rda_fill_fd(frame, this, fd);
+	}
+
+	mem_put(local);
+
+	STACK_UNWIND_STRICT(opendir, frame, op_ret, op_errno, fd, xdata);
+
+	if (xdata)
+		dict_unref(xdata);
+}
+
+static int32_t
+rda_opendir_cached_cbk(call_frame_t *frame, void *cookie, xlator_t *this,
+		       int32_t op_ret, int32_t op_errno, fd_t *fd,
+		       dict_t *xdata)
+{
+	struct rda_local *local = frame->local;
+	int call_count;
+
+	LOCK(&frame->lock);
+	{
+		local->op_ret = op_ret;
+		local->op_errno = op_errno;
+		if (xdata)
+			local->xdata = dict_ref(xdata);
+		call_count = --local->call_count;
+	}
+	UNLOCK(&frame->lock);
+
+	if (!call_count)
+		rda_opendir_done(frame, this);
+
+	return 0;
+}
+
+static int32_t
+rda_opendir_stat_cbk(call_frame_t *frame, void *cookie, xlator_t *this,
+		     int32_t op_ret, int32_t op_errno, struct iatt *buf,
+		     dict_t *xdata)
+{
+	struct rda_local *local = frame->local;
+	int call_count;
+
+	LOCK(&frame->lock);
+	{
+		if (!op_ret && buf) {
+			local->stbuf = *buf;
+			local->stat_ok = _gf_true;
+		}
+		call_count = --local->call_count;
+	}
+	UNLOCK(&frame->lock);
+
+	if (!call_count)
+		rda_opendir_done(frame, this);
+
+	return 0;
+}
+
 static int32_t
 rda_opendir(call_frame_t *frame, xlator_t *this, loc_t *loc, fd_t *fd,
 		dict_t *xdata)
 {
-	STACK_WIND(frame, rda_opendir_cbk, FIRST_CHILD(this),
+	struct rda_local *local = NULL;
+	struct rda_priv *priv = this->private;
+
+	if (priv->rda_cache)
+		local = mem_get0(this->local_pool);
+
+	if (!local) {
+		STACK_WIND(frame, rda_opendir_cbk, FIRST_CHILD(this),
+			   FIRST_CHILD(this)->fops->opendir, loc, fd, xdata);
+		return 0;
+	}
+
+	/*
+	 * Fetch the times of the directory along with the opendir, to tell
+	 * whether its cached listing still holds.
+	 */
+	local->fd = fd;
+	local->call_count = 2;
+	frame->local = local;
+
+	STACK_WIND(frame, rda_opendir_cached_cbk, FIRST_CHILD(this),
 		   FIRST_CHILD(this)->fops->opendir, loc, fd, xdata);
+	STACK_WIND(frame, rda_opendir_stat_cbk, FIRST_CHILD(this),
+		   FIRST_CHILD(this)->fops->stat, loc, NULL);
+	return 0;
+}
+
+/*
+ * Entry fops drop the cached listing of the parent directories.
+ */
+static int32_t
+rda_create(call_frame_t *frame, xlator_t *this, loc_t *loc, int32_t flags,
+	   mode_t mode, mode_t umask, fd_t *fd, dict_t *xdata)
+{
+	rda_inode_invalidate(this, loc->parent);
+
+	STACK_WIND(frame, default_create_cbk, FIRST_CHILD(this),
+		   FIRST_CHILD(this)->fops->create, loc, flags, mode, umask,
+		   fd, xdata);
+	return 0;
+}
+
+static int32_t
+rda_mknod(call_frame_t *frame, xlator_t *this, loc_t *loc, mode_t mode,
+	  dev_t rdev, mode_t umask, dict_t *xdata)
+{
+	rda_inode_invalidate(this, loc->parent);
+
+	STACK_WIND(frame, default_mknod_cbk, FIRST_CHILD(this),
+		   FIRST_CHILD(this)->fops->mknod, loc, mode, rdev, umask,
+		   xdata);
+	return 0;
+}
+
+static int32_t
+rda_mkdir(call_frame_t *frame, xlator_t *this, loc_t *loc, mode_t mode,
+	  mode_t umask, dict_t *xdata)
+{
+	rda_inode_invalidate(this, loc->parent);
+
+	STACK_WIND(frame, default_mkdir_cbk, FIRST_CHILD(this),
+		   FIRST_CHILD(this)->fops->mkdir, loc, mode, umask, xdata);
+	return 0;
+}
+
+static int32_t
+rda_symlink(call_frame_t *frame, xlator_t *this, const char *linkname,
+	    loc_t *loc, mode_t umask, dict_t *xdata)
+{
+	rda_inode_invalidate(this, loc->parent);
+
+	STACK_WIND(frame, default_symlink_cbk, FIRST_CHILD(this),
+		   FIRST_CHILD(this)->fops->symlink, linkname, loc, umask,
+		   xdata);
+	return 0;
+}
+
+static int32_t
+rda_link(call_frame_t *frame, xlator_t *this, loc_t *oldloc, loc_t *newloc,
+	 dict_t *xdata)
+{
+	rda_inode_invalidate(this, newloc->parent);
+
+	STACK_WIND(frame, default_link_cbk, FIRST_CHILD(this),
+		   FIRST_CHILD(this)->fops->link, oldloc, newloc, xdata);
+	return 0;
+}
+
+static int32_t
+rda_rename(call_frame_t *frame, xlator_t *this, loc_t *oldloc, loc_t *newloc,
+	   dict_t *xdata)
+{
+	rda_inode_invalidate(this, oldloc->parent);
+	rda_inode_invalidate(this, newloc->parent);
+
+	STACK_WIND(frame, default_rename_cbk, FIRST_CHILD(this),
+		   FIRST_CHILD(this)->fops->rename, oldloc, newloc, xdata);
+	return 0;
+}
+
+static int32_t
+rda_unlink(call_frame_t *frame, xlator_t *this, loc_t *loc, int xflags,
+	   dict_t *xdata)
+{
+	rda_inode_invalidate(this, loc->parent);
+
+	STACK_WIND(frame, default_unlink_cbk, FIRST_CHILD(this),
+		   FIRST_CHILD(this)->fops->unlink, loc, xflags, xdata);
+	return 0;
+}
+
+static int32_t
+rda_rmdir(call_frame_t *frame, xlator_t *this, loc_t *loc, int flags,
+	  dict_t *xdata)
+{
+	rda_inode_invalidate(this, loc->parent);
+
+	STACK_WIND(frame, default_rmdir_cbk, FIRST_CHILD(this),
+		   FIRST_CHILD(this)->fops->rmdir, loc, flags, xdata);
 	return 0;
 }
 
@@ -434,6 +961,31 @@ rda_releasedir(xlator_t *this, fd_t *fd)
 	return 0;
 }
 
+static int32_t
+rda_forget(xlator_t *this, inode_t *inode)
+{
+	uint64_t val;
+	struct rda_inode_ctx *ictx;
+	struct rda_priv *priv = this->private;
+
+	if (inode_ctx_del(inode, this, &val) < 0)
+		return 0;
+
+	ictx = (struct rda_inode_ctx *) val;
+	if (!ictx)
+		return 0;
+
+	LOCK(&priv->lock);
+	LOCK(&ictx->lock);
+	__rda_inode_purge(priv, ictx);
+	UNLOCK(&ictx->lock);
+	UNLOCK(&priv->lock);
+
+	LOCK_DESTROY(&ictx->lock);
+	GF_FREE(ictx);
+	return 0;
+}
+
 int32_t
 mem_acct_init(xlator_t *this)
 {
@@ -463,6 +1015,11 @@ reconfigure(xlator_t *this, dict_t *options)
 			 err);
 	GF_OPTION_RECONF("rda-high-wmark", priv->rda_high_wmark, options, size,
 			 err);
+	GF_OPTION_RECONF("rda-cache", priv->rda_cache, options, bool, err);
+	GF_OPTION_RECONF("rda-cache-limit", priv->rda_cache_limit, options,
+			 size, err);
+	GF_OPTION_RECONF("rda-cache-timeout", priv->rda_cache_timeout, options,
+			 int32, err);
 
 	return 0;
 err:
@@ -500,6 +1057,13 @@ init(xlator_t *this)
 	GF_OPTION_INIT("rda-request-size", priv->rda_req_size, uint32, err);
 	GF_OPTION_INIT("rda-low-wmark", priv->rda_low_wmark, size, err);
 	GF_OPTION_INIT("rda-high-wmark", priv->rda_high_wmark, size, err);
+	GF_OPTION_INIT("rda-cache", priv->rda_cache, bool, err);
+	GF_OPTION_INIT("rda-cache-limit", priv->rda_cache_limit, size, err);
+	GF_OPTION_INIT("rda-cache-timeout", priv->rda_cache_timeout, int32,
+		       err);
+
+	LOCK_INIT(&priv->lock);
+	INIT_LIST_HEAD(&priv->lru);
 
 	return 0;
 
@@ -516,8 +1080,14 @@ err:
 void
 fini(xlator_t *this)
 {
+	struct rda_priv *priv = NULL;
+
         GF_VALIDATE_OR_GOTO ("readdir-ahead", this, out);
 
+	priv = this->private;
+	if (priv)
+		LOCK_DESTROY(&priv->lock);
+
 	GF_FREE(this->private);
 
 out:
@@ -527,10 +1097,19 @@ out:
 struct xlator_fops fops = {
 	.opendir	= rda_opendir,
 	.readdirp	= rda_readdirp,
+	.create		= rda_create,
+	.mknod		= rda_mknod,
+	.mkdir		= rda_mkdir,
+	.symlink	= rda_symlink,
+	.link		= rda_link,
+	.rename		= rda_rename,
+	.unlink		= rda_unlink,
+	.rmdir		= rda_rmdir,
 };
 
 struct xlator_cbks cbks = {
 	.releasedir	= rda_releasedir,
+	.forget		= rda_forget,
 };
 
 struct volume_options options[] = {
@@ -555,6 +1134,28 @@ struct volume_options options[] = {
 	  .default_value = "131072",
 	  .description = "the value over which we unplug",
 	},
+	{ .key = {"rda-cache"},
+	  .type = GF_OPTION_TYPE_BOOL,
+	  .default_value = "off",
+	  .description = "keep the names in the listings of directories and "
+			 "serve later opendirs from them while the "
+			 "directories do not change",
+	},
+	{ .key = {"rda-cache-limit"},
+	  .type = GF_OPTION_TYPE_SIZET,
+	  .min = 0,
+	  .max = 1 * GF_UNIT_GB,
+	  .default_value = "10MB",
+	  .description = "memory held by the cached listings of all "
+			 "directories",
+	},
+	{ .key = {"rda-cache-timeout"},
+	  .type = GF_OPTION_TYPE_INT,
+	  .min = 1,
+	  .max = 3600,
+	  .default_value = "10",
+	  .description = "seconds a cached listing is served for",
+	},
         { .key = {NULL} },
 };
 
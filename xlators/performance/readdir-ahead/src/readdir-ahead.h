@@ -18,6 +18,24 @@
 #define RDA_FD_ERROR	(1 << 3)
 #define RDA_FD_BYPASS	(1 << 4)
 #define RDA_FD_PLUGGED	(1 << 5)
+#define RDA_FD_CACHED	(1 << 6)	/* served from the directory cache */
+#define RDA_FD_COLLECT	(1 << 7)	/* preload fills the directory cache */
+
+/*
+ * Listing of a directory, shared by its fds. It is complete and in the
+ * order of the bricks, and holds as long as the directory has the times
+ * of @stbuf.
+ */
+struct rda_inode_ctx {
+	struct list_head lru;	/* rda_priv:lru while entries are cached */
+	gf_lock_t lock;
+	gf_dirent_t entries;
+	uint64_t size;		/* memory held by the entries */
+	uint64_t gen;		/* bumped whenever the listing changes */
+	gf_boolean_t valid;
+	struct iatt stbuf;	/* of the directory, when it was listed */
+	time_t cached_at;
+};
 
 struct rda_fd_ctx {
 	off_t cur_offset;	/* current head of the ctx */
@@ -29,18 +47,42 @@ struct rda_fd_ctx {
 	call_frame_t *fill_frame;
 	call_stub_t *stub;
 	int op_errno;
+
+	/* directory cache */
+	struct rda_inode_ctx *ictx;
+	uint64_t gen;		/* of ictx, when opened */
+	struct iatt stbuf;	/* of the directory, when opened */
+	gf_dirent_t *cursor;	/* last entry served from ictx */
+	gf_dirent_t fill;	/* copy of the preload, for ictx */
+	uint64_t fill_size;
 };
 
 struct rda_local {
 	struct rda_fd_ctx *ctx;
 	fd_t *fd;
 	off_t offset;
+
+	/* opendir, along with a stat of the directory */
+	int call_count;
+	int32_t op_ret;
+	int32_t op_errno;
+	dict_t *xdata;
+	struct iatt stbuf;
+	gf_boolean_t stat_ok;
 };
 
 struct rda_priv {
 	uint32_t rda_req_size;
 	uint64_t rda_low_wmark;
 	uint64_t rda_high_wmark;
+
+	gf_boolean_t rda_cache;
+	uint64_t rda_cache_limit;
+	int32_t rda_cache_timeout;
+
+	gf_lock_t lock;
+	struct list_head lru;	/* of rda_inode_ctx, least recent first */
+	uint64_t cache_size;
 };
 
 #endif /* __READDIR_AHEAD_H */
@@ -30,13 +30,15 @@
 #define MAX_VECTOR_COUNT          8
 #define WB_AGGREGATE_SIZE         131072 /* 128 KB */
 #define WB_WINDOW_SIZE            1048576 /* 1MB */
+#define WB_RATE_INTERVAL          100000 /* usecs between write rate samples */
 
 typedef struct list_head list_head_t;
 struct wb_conf;
 struct wb_inode;
 
 typedef struct wb_inode {
-        ssize_t      window_conf;
+        ssize_t      window_conf; /* adapted to the write rate, between
+                                     cache-size and max-window-size */
         ssize_t      window_current;
 	ssize_t      transit; /* size of data stack_wound, and yet
 				 to be fulfilled (wb_fulfill_cbk).
@@ -109,6 +111,15 @@ typedef struct wb_inode {
 				liability generation higher than itself)
 			     */
 	size_t       size; /* Size of the file to catch write after EOF. */
+
+        /* write rate as acknowledged by the server, sampled every
+           WB_RATE_INTERVAL, and time taken by a write. The window is the
+           bandwidth-delay product of the two. */
+        uint64_t        rate;     /* bytes per second */
+        uint64_t        latency;  /* usecs */
+        uint64_t        acked;    /* bytes since @sampled */
+        struct timeval  sampled;
+
         gf_lock_t    lock;
         xlator_t    *this;
 } wb_inode_t;
@@ -132,8 +143,13 @@ typedef struct wb_request {
 					   */
         size_t                total_size;  /* valid only in @head in wb_fulfill().
 					      This is the size with which we perform
-					      STACK_WIND to server and therefore the
-					      amount by which we shrink the window.
+					      STACK_WIND to server.
+					   */
+	size_t                charged;     /* what the window (and the budget)
+					      was grown by for this request,
+					      given back when it is fulfilled.
+					      A request fulfilled before it was
+					      unwound is never charged.
 					   */
 
 	int                   op_ret;
@@ -146,6 +162,8 @@ typedef struct wb_request {
 	struct iobref        *iobref;
 	uint64_t              gen;  /* inode liability state at the time of
 				       request arrival */
+        struct timeval        wound; /* valid only in @head in wb_fulfill(),
+                                        when it was sent to the server */
 
 	fd_t                 *fd;
 	struct {
@@ -157,6 +175,7 @@ typedef struct wb_request {
 		int           lied:1;        /* sin committed */
 		int           fulfilled:1;   /* got server acknowledgement */
 		int           go:1;          /* enough aggregating, good to go */
+		int           throttled:1;   /* held back for the budget */
 	} ordering;
 } wb_request_t;
 
@@ -164,10 +183,18 @@ typedef struct wb_request {
 typedef struct wb_conf {
         uint64_t         aggregate_size;
         uint64_t         window_size;
+        uint64_t         window_max;
         gf_boolean_t     flush_behind;
         gf_boolean_t     trickling_writes;
 	gf_boolean_t     strict_write_ordering;
 	gf_boolean_t     strict_O_DIRECT;
+
+        /* budget shared by the windows of all inodes */
+        gf_lock_t        lock;
+        uint64_t         cache_limit;
+        int64_t          cache_used;   /* sum of the window_current */
+        int64_t          cache_peak;
+        uint64_t         throttled;    /* writes not lied for the budget */
 } wb_conf_t;
 
 
@@ -175,6 +202,72 @@ void
 wb_process_queue (wb_inode_t *wb_inode);
 
 
+/* charges the window of the inode, and the budget shared by all inodes */
+static void
+__wb_inode_window_add (wb_inode_t *wb_inode, ssize_t size)
+{
+        wb_conf_t *conf = NULL;
+
+        conf = wb_inode->this->private;
+
+        wb_inode->window_current += size;
+
+        LOCK (&conf->lock);
+        {
+                conf->cache_used += size;
+                if (conf->cache_used > conf->cache_peak)
+                        conf->cache_peak = conf->cache_used;
+        }
+        UNLOCK (&conf->lock);
+}
+
+
+/* as __wb_inode_window_add(), unless the budget has no room left for size;
+ * checked and charged at once, so that inodes racing for the last of the
+ * budget do not overrun it together */
+static gf_boolean_t
+__wb_inode_window_try_add (wb_inode_t *wb_inode, size_t size)
+{
+        wb_conf_t    *conf    = NULL;
+        gf_boolean_t  charged = _gf_false;
+
+        conf = wb_inode->this->private;
+
+        LOCK (&conf->lock);
+        {
+                if (conf->cache_used + (int64_t)size
+                    <= (int64_t)conf->cache_limit) {
+                        conf->cache_used += size;
+                        if (conf->cache_used > conf->cache_peak)
+                                conf->cache_peak = conf->cache_used;
+                        charged = _gf_true;
+                }
+        }
+        UNLOCK (&conf->lock);
+
+        if (charged)
+                wb_inode->window_current += size;
+
+        return charged;
+}
+
+
+static gf_boolean_t
+wb_budget_exhausted (wb_conf_t *conf, size_t size)
+{
+        gf_boolean_t exhausted = _gf_false;
+
+        LOCK (&conf->lock);
+        {
+                exhausted = (conf->cache_used + (int64_t)size
+                             > (int64_t)conf->cache_limit);
+        }
+        UNLOCK (&conf->lock);
+
+        return exhausted;
+}
+
+
 wb_inode_t *
 __wb_inode_ctx_get (xlator_t *this, inode_t *inode)
 {
@@ -371,7 +464,8 @@ __wb_request_unref (wb_request_t *req)
 		if (list_empty (&wb_inode->all)) {
 			wb_inode->gen = 0;
 			/* in case of accounting errors? */
-			wb_inode->window_current = 0;
+			__wb_inode_window_add (wb_inode,
+					       -wb_inode->window_current);
 		}
 
 		list_del_init (&req->winds);
@@ -668,7 +762,10 @@ __wb_fulfill_request (wb_request_t *req)
 	wb_inode = req->wb_inode;
 
 	req->ordering.fulfilled = 1;
-	wb_inode->window_current -= req->total_size;
+	if (req->charged) {
+		__wb_inode_window_add (wb_inode, -(ssize_t)req->charged);
+		req->charged = 0;
+	}
 	wb_inode->transit -= req->total_size;
 
 	if (!req->ordering.lied) {
@@ -681,6 +778,61 @@ __wb_fulfill_request (wb_request_t *req)
 }
 
 
+/* adapts the window of the inode to the bandwidth-delay product of its
+   writes: twice what the server acknowledges during the time a write takes */
+static void
+__wb_inode_sample (wb_inode_t *wb_inode, wb_request_t *head)
+{
+        wb_conf_t      *conf    = NULL;
+        struct timeval  now     = {0, };
+        uint64_t        latency = 0;
+        uint64_t        elapsed = 0;
+        uint64_t        rate    = 0;
+        uint64_t        window  = 0;
+
+        if (!timerisset (&head->wound))
+                return;
+
+        conf = wb_inode->this->private;
+
+        gettimeofday (&now, NULL);
+
+        latency = (now.tv_sec - head->wound.tv_sec) * 1000000
+                + (now.tv_usec - head->wound.tv_usec);
+        if (wb_inode->latency)
+                wb_inode->latency = (3 * wb_inode->latency + latency) / 4;
+        else
+                wb_inode->latency = latency;
+
+        if (!timerisset (&wb_inode->sampled)) {
+                wb_inode->sampled = head->wound;
+                wb_inode->acked = 0;
+        }
+
+        wb_inode->acked += head->total_size;
+
+        elapsed = (now.tv_sec - wb_inode->sampled.tv_sec) * 1000000
+                + (now.tv_usec - wb_inode->sampled.tv_usec);
+        if (elapsed < WB_RATE_INTERVAL)
+                return;
+
+        rate = wb_inode->acked * 1000000 / elapsed;
+        if (wb_inode->rate)
+                wb_inode->rate = (wb_inode->rate + rate) / 2;
+        else
+                wb_inode->rate = rate;
+
+        wb_inode->acked = 0;
+        wb_inode->sampled = now;
+
+        window = 2 * wb_inode->rate * wb_inode->latency / 1000000;
+        window = max (window, conf->window_size);
+        window = min (window, max (conf->window_max, conf->window_size));
+
+        wb_inode->window_conf = window;
+}
+
+
 void
 wb_head_done (wb_request_t *head)
 {
@@ -692,6 +844,8 @@ wb_head_done (wb_request_t *head)
 
 	LOCK (&wb_inode->lock);
 	{
+		__wb_inode_sample (wb_inode, head);
+
 		list_for_each_entry_safe (req, tmp, &head->winds, winds) {
 			__wb_fulfill_request (req);
 		}
@@ -815,6 +969,8 @@ wb_fulfill_head (wb_inode_t *wb_inode, wb_request_t *head)
 	}
 	UNLOCK (&wb_inode->lock);
 
+	gettimeofday (&head->wound, NULL);
+
 	STACK_WIND (frame, wb_fulfill_cbk, FIRST_CHILD (frame->this),
 		    FIRST_CHILD (frame->this)->fops->writev,
 		    head->fd, vector, count,
@@ -933,19 +1089,40 @@ wb_do_unwinds (wb_inode_t *wb_inode, list_head_t *lies)
 void
 __wb_pick_unwinds (wb_inode_t *wb_inode, list_head_t *lies)
 {
-        wb_request_t *req = NULL;
-        wb_request_t *tmp = NULL;
+        wb_request_t *req  = NULL;
+        wb_request_t *tmp  = NULL;
+        wb_conf_t    *conf = NULL;
+
+        conf = wb_inode->this->private;
 
 	list_for_each_entry_safe (req, tmp, &wb_inode->temptation, lie) {
 		if (!req->ordering.fulfilled &&
 		    wb_inode->window_current > wb_inode->window_conf)
 			continue;
 
+		/* back-pressure: the write is unwound once the server
+		   acknowledged it, __wb_preprocess_winds() does not hold it
+		   back meanwhile. Then nothing is cached for it any more,
+		   and it is not charged. */
+		if (!req->ordering.fulfilled) {
+			if (!__wb_inode_window_try_add (wb_inode,
+							req->orig_size)) {
+				if (!req->ordering.throttled) {
+					req->ordering.throttled = 1;
+					LOCK (&conf->lock);
+					{
+						conf->throttled++;
+					}
+					UNLOCK (&conf->lock);
+				}
+				continue;
+			}
+			req->charged += req->orig_size;
+		}
+
 		list_del_init (&req->lie);
 		list_move_tail (&req->unwinds, lies);
 
-		wb_inode->window_current += req->orig_size;
-
 		if (!req->ordering.fulfilled) {
 			/* burden increased */
 			list_add_tail (&req->lie, &wb_inode->liability);
@@ -1103,9 +1280,12 @@ __wb_preprocess_winds (wb_inode_t *wb_inode)
 			continue;
 
 		/* collapsed request is as good as wound
-		   (from its p.o.v)
+		   (from its p.o.v), its data stays charged until the
+		   holder is fulfilled
 		*/
 		list_del_init (&req->todo);
+		holder->charged += req->charged;
+		req->charged = 0;
 		__wb_fulfill_request (req);
 
                /* Only the last @holder in queue which
@@ -1125,6 +1305,11 @@ __wb_preprocess_winds (wb_inode_t *wb_inode)
 	if (conf->trickling_writes && !wb_inode->transit && holder)
 		holder->ordering.go = 1;
 
+	/* nor if no write can be lied about for now, the writer waits for
+	   the acknowledgement of this one */
+	if (holder && wb_budget_exhausted (conf, holder->orig_size))
+		holder->ordering.go = 1;
+
         return;
 }
 
@@ -1975,6 +2160,20 @@ wb_priv_dump (xlator_t *this)
         gf_proc_dump_write ("window_size", "%d", conf->window_size);
         gf_proc_dump_write ("flush_behind", "%d", conf->flush_behind);
         gf_proc_dump_write ("trickling_writes", "%d", conf->trickling_writes);
+        gf_proc_dump_write ("max_window_size", "%"PRIu64, conf->window_max);
+        gf_proc_dump_write ("global_cache_size", "%"PRIu64,
+                            conf->cache_limit);
+
+        LOCK (&conf->lock);
+        {
+                gf_proc_dump_write ("cache_used", "%"PRId64,
+                                    conf->cache_used);
+                gf_proc_dump_write ("cache_peak", "%"PRId64,
+                                    conf->cache_peak);
+                gf_proc_dump_write ("throttled", "%"PRIu64,
+                                    conf->throttled);
+        }
+        UNLOCK (&conf->lock);
 
         ret = 0;
 out:
@@ -2066,6 +2265,11 @@ wb_inode_dump (xlator_t *this, inode_t *inode)
         gf_proc_dump_write ("window_current", "%"GF_PRI_SIZET,
                             wb_inode->window_current);
 
+        gf_proc_dump_write ("write_rate", "%"PRIu64, wb_inode->rate);
+
+        gf_proc_dump_write ("write_latency_usec", "%"PRIu64,
+                            wb_inode->latency);
+
 
         ret = TRY_LOCK (&wb_inode->lock);
         if (!ret)
@@ -2118,6 +2322,12 @@ reconfigure (xlator_t *this, dict_t *options)
 
         GF_OPTION_RECONF ("cache-size", conf->window_size, options, size, out);
 
+        GF_OPTION_RECONF ("max-window-size", conf->window_max, options, size,
+                          out);
+
+        GF_OPTION_RECONF ("global-cache-size", conf->cache_limit, options,
+                          size, out);
+
         GF_OPTION_RECONF ("flush-behind", conf->flush_behind, options, bool,
                           out);
 
@@ -2181,6 +2391,12 @@ init (xlator_t *this)
                 goto out;
         }
 
+        /* the window of an inode grows up to max-window-size with its
+           write rate, windows of all inodes share global-cache-size */
+        GF_OPTION_INIT ("max-window-size", conf->window_max, size, out);
+
+        GF_OPTION_INIT ("global-cache-size", conf->cache_limit, size, out);
+
         /* configure 'option flush-behind <on/off>' */
         GF_OPTION_INIT ("flush-behind", conf->flush_behind, bool, out);
 
@@ -2191,6 +2407,8 @@ init (xlator_t *this)
         GF_OPTION_INIT ("strict-write-ordering", conf->strict_write_ordering,
 			bool, out);
 
+        LOCK_INIT (&conf->lock);
+
         this->private = conf;
         ret = 0;
 
@@ -2215,6 +2433,7 @@ fini (xlator_t *this)
         }
 
         this->private = NULL;
+        LOCK_DESTROY (&conf->lock);
         GF_FREE (conf);
 
 out:
@@ -2266,6 +2485,24 @@ struct volume_options options[] = {
           .description = "Size of the write-behind buffer for a single file "
                          "(inode)."
         },
+        { .key  = {"max-window-size"},
+          .type = GF_OPTION_TYPE_SIZET,
+          .min  = 512 * GF_UNIT_KB,
+          .max  = 1 * GF_UNIT_GB,
+          .default_value = "16MB",
+          .description = "Size up to which the write-behind buffer of a file "
+                         "grows with the rate the file is written at. It is "
+                         "never less than cache-size."
+        },
+        { .key  = {"global-cache-size"},
+          .type = GF_OPTION_TYPE_SIZET,
+          .min  = 512 * GF_UNIT_KB,
+          .max  = 32 * GF_UNIT_GB,
+          .default_value = "64MB",
+          .description = "Size of the write-behind buffers of all the files "
+                         "together. Once used up, writes are acknowledged "
+                         "only after the server acknowledged them."
+        },
         { .key = {"trickling-writes"},
           .type = GF_OPTION_TYPE_BOOL,
           .default_value = "on",
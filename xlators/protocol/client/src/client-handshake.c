@@ -1345,6 +1345,7 @@ client_setvolume_cbk (struct rpc_req *req, struct iovec *iov, int count, void *m
         int32_t               op_errno      = 0;
         gf_boolean_t          auth_fail     = _gf_false;
         uint32_t              lk_ver        = 0;
+        int32_t               compound_fops = 0;
 
         frame = myframe;
         this  = frame->this;
@@ -1434,6 +1435,13 @@ client_setvolume_cbk (struct rpc_req *req, struct iovec *iov, int count, void *m
 
         gf_log (this->name, GF_LOG_DEBUG, "clnt-lk-version = %d, "
                 "server-lk-version = %d", client_get_lk_ver (conf), lk_ver);
+
+        /* Bricks which do not understand GFS3_OP_COMPOUND leave this out,
+         * compound fops are then executed one link at a time.
+         */
+        ret = dict_get_int32 (reply, "compound-fops", &compound_fops);
+        conf->compound_fops = (ret == 0 && compound_fops);
+
         /* TODO: currently setpeer path is broken */
         /*
         if (process_uuid && req->conn &&
@@ -1618,6 +1626,14 @@ client_setvolume (xlator_t *this, struct rpc_clnt *rpc)
                         client_get_lk_ver (conf));
         }
 
+        /* Replies can carry xdata with well-known keys sent as ids */
+        ret = dict_set_uint32 (options, "compact-xdata",
+                               dict_compact_key_count ());
+        if (ret < 0) {
+                gf_log (this->name, GF_LOG_WARNING,
+                        "failed to set 'compact-xdata' in handshake msg");
+        }
+
         ret = dict_serialized_length (options);
         if (ret < 0) {
                 gf_log (this->name, GF_LOG_ERROR,
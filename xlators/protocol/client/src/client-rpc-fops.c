@@ -17,6 +17,7 @@
 #include "glusterfs3-xdr.h"
 #include "glusterfs3.h"
 #include "compat-errno.h"
+#include "compound-fop.h"
 
 int32_t client3_getspec (call_frame_t *frame, xlator_t *this, void *data);
 void client_start_ping (void *data);
@@ -2103,6 +2104,129 @@ out:
         return 0;
 }
 
+static void
+client_compound_link_rsp (xlator_t *this, gfs3_compound_link_rsp *link,
+                          compound_rsp_t *rsp)
+{
+        gf_common_rsp     *common  = NULL;
+        gfs3_xattrop_rsp  *xattrop = NULL;
+        gfs3_write_rsp    *write   = NULL;
+        char              *xdata   = NULL;
+        u_int              len     = 0;
+        int                ret     = 0;
+
+        switch (link->op) {
+        case GFS3_COMPOUND_XATTROP:
+        case GFS3_COMPOUND_FXATTROP:
+                /* gfs3_fxattrop_rsp has the same layout */
+                xattrop = &link->gfs3_compound_link_rsp_u.xattrop_rsp;
+                rsp->op_ret = xattrop->op_ret;
+                rsp->op_errno = gf_error_to_errno (xattrop->op_errno);
+                if (rsp->op_ret != -1) {
+                        GF_PROTOCOL_DICT_UNSERIALIZE (this, rsp->xattr,
+                                                      (xattrop->dict.dict_val),
+                                                      (xattrop->dict.dict_len),
+                                                      rsp->op_ret,
+                                                      rsp->op_errno, out);
+                }
+                xdata = xattrop->xdata.xdata_val;
+                len = xattrop->xdata.xdata_len;
+                break;
+        case GFS3_COMPOUND_WRITE:
+                write = &link->gfs3_compound_link_rsp_u.write_rsp;
+                rsp->op_ret = write->op_ret;
+                rsp->op_errno = gf_error_to_errno (write->op_errno);
+                if (rsp->op_ret != -1) {
+                        gf_stat_to_iatt (&write->prestat, &rsp->prebuf);
+                        gf_stat_to_iatt (&write->poststat, &rsp->postbuf);
+                }
+                xdata = write->xdata.xdata_val;
+                len = write->xdata.xdata_len;
+                break;
+        default:
+                /* every other link replies with a gf_common_rsp */
+                common = &link->gfs3_compound_link_rsp_u.inodelk_rsp;
+                rsp->op_ret = common->op_ret;
+                rsp->op_errno = gf_error_to_errno (common->op_errno);
+                xdata = common->xdata.xdata_val;
+                len = common->xdata.xdata_len;
+                break;
+        }
+
+        GF_PROTOCOL_DICT_UNSERIALIZE (this, rsp->xdata, xdata, len, ret,
+                                      rsp->op_errno, out);
+out:
+        return;
+}
+
+int
+client3_3_compound_cbk (struct rpc_req *req, struct iovec *iov, int count,
+                        void *myframe)
+{
+        call_frame_t      *frame  = NULL;
+        gfs3_compound_rsp  rsp    = {0,};
+        compound_rsp_t    *links  = NULL;
+        int32_t            nlinks = 0;
+        int                ret    = 0;
+        int                i      = 0;
+        xlator_t          *this   = NULL;
+        dict_t            *xdata  = NULL;
+
+        this = THIS;
+
+        frame = myframe;
+
+        if (-1 == req->rpc_status) {
+                rsp.op_ret   = -1;
+                rsp.op_errno = ENOTCONN;
+                goto out;
+        }
+        ret = xdr_to_generic (*iov, &rsp, (xdrproc_t)xdr_gfs3_compound_rsp);
+        if (ret < 0) {
+                gf_log (this->name, GF_LOG_ERROR, "XDR decoding failed");
+                rsp.op_ret   = -1;
+                rsp.op_errno = EINVAL;
+                goto out;
+        }
+
+        if (rsp.links.links_len) {
+                links = compound_rsp_new (rsp.links.links_len);
+                if (!links) {
+                        rsp.op_ret   = -1;
+                        rsp.op_errno = ENOMEM;
+                        goto out;
+                }
+                nlinks = rsp.links.links_len;
+        }
+
+        for (i = 0; i < nlinks; i++)
+                client_compound_link_rsp (this, &rsp.links.links_val[i],
+                                          &links[i]);
+
+        GF_PROTOCOL_DICT_UNSERIALIZE (this, xdata, (rsp.xdata.xdata_val),
+                                      (rsp.xdata.xdata_len), ret,
+                                      rsp.op_errno, out);
+
+out:
+        if (rsp.op_ret == -1) {
+                gf_log (this->name, GF_LOG_WARNING,
+                        "remote operation failed: %s",
+                        strerror (gf_error_to_errno (rsp.op_errno)));
+        }
+        CLIENT_STACK_UNWIND (compound, frame, rsp.op_ret,
+                             gf_error_to_errno (rsp.op_errno), links, nlinks,
+                             xdata);
+
+        xdr_free ((xdrproc_t)xdr_gfs3_compound_rsp, (char *)&rsp);
+
+        compound_rsp_destroy (links, nlinks);
+
+        if (xdata)
+                dict_unref (xdata);
+
+        return 0;
+}
+
 int
 client3_3_setattr_cbk (struct rpc_req *req, struct iovec *iov, int count,
                        void *myframe)
@@ -6093,6 +6217,380 @@ unwind:
         return 0;
 }
 
+static int
+client_compound_gfid (loc_t *loc, fd_t *fd, char *gfid)
+{
+        if (fd)
+                memcpy (gfid, fd->inode->gfid, 16);
+        else if (loc->inode && !uuid_is_null (loc->inode->gfid))
+                memcpy (gfid, loc->inode->gfid, 16);
+        else
+                memcpy (gfid, loc->gfid, 16);
+
+        return uuid_is_null (*((uuid_t *)gfid)) ? -1 : 0;
+}
+
+/* Fills in the request of a link. Returns -1 when the link can not be sent
+ * as part of a compound request, for instance when its fd has not been
+ * opened on the brick yet; the caller then falls back to the regular fops.
+ */
+static int
+client_compound_link_req (xlator_t *this, compound_args_t *link,
+                          gfs3_compound_link_req *req)
+{
+        gfs3_inodelk_req    *inodelk   = NULL;
+        gfs3_finodelk_req   *finodelk  = NULL;
+        gfs3_entrylk_req    *entrylk   = NULL;
+        gfs3_fentrylk_req   *fentrylk  = NULL;
+        gfs3_xattrop_req    *xattrop   = NULL;
+        gfs3_fxattrop_req   *fxattrop  = NULL;
+        gfs3_setxattr_req   *setxattr  = NULL;
+        gfs3_fsetxattr_req  *fsetxattr = NULL;
+        gfs3_write_req      *write     = NULL;
+        int64_t              remote_fd = -1;
+        int32_t              gf_cmd    = 0;
+        int32_t              gf_type   = 0;
+        int                  op_errno  = 0;
+
+        if (link->fd) {
+                if (client_get_remote_fd (this, link->fd, DEFAULT_REMOTE_FD,
+                                          &remote_fd) < 0 || remote_fd == -1)
+                        goto out;
+        }
+
+        if (link->fop == GF_FOP_INODELK || link->fop == GF_FOP_FINODELK) {
+                if (client_cmd_to_gf_cmd (link->cmd, &gf_cmd))
+                        goto out;
+
+                switch (link->flock.l_type) {
+                case F_RDLCK:
+                        gf_type = GF_LK_F_RDLCK;
+                        break;
+                case F_WRLCK:
+                        gf_type = GF_LK_F_WRLCK;
+                        break;
+                case F_UNLCK:
+                        gf_type = GF_LK_F_UNLCK;
+                        break;
+                }
+        }
+
+        switch (link->fop) {
+        case GF_FOP_INODELK:
+                req->op = GFS3_COMPOUND_INODELK;
+                inodelk = &req->gfs3_compound_link_req_u.inodelk_req;
+                if (client_compound_gfid (&link->loc, NULL, inodelk->gfid))
+                        goto out;
+                inodelk->volume = link->volume;
+                inodelk->cmd = gf_cmd;
+                inodelk->type = gf_type;
+                gf_proto_flock_from_flock (&inodelk->flock, &link->flock);
+                GF_PROTOCOL_DICT_SERIALIZE (this, link->xdata,
+                                            (&inodelk->xdata.xdata_val),
+                                            inodelk->xdata.xdata_len,
+                                            op_errno, out);
+                break;
+        case GF_FOP_FINODELK:
+                req->op = GFS3_COMPOUND_FINODELK;
+                finodelk = &req->gfs3_compound_link_req_u.finodelk_req;
+                client_compound_gfid (NULL, link->fd, finodelk->gfid);
+                finodelk->fd = remote_fd;
+                finodelk->volume = link->volume;
+                finodelk->cmd = gf_cmd;
+                finodelk->type = gf_type;
+                gf_proto_flock_from_flock (&finodelk->flock, &link->flock);
+                GF_PROTOCOL_DICT_SERIALIZE (this, link->xdata,
+                                            (&finodelk->xdata.xdata_val),
+                                            finodelk->xdata.xdata_len,
+                                            op_errno, out);
+                break;
+        case GF_FOP_ENTRYLK:
+                req->op = GFS3_COMPOUND_ENTRYLK;
+                entrylk = &req->gfs3_compound_link_req_u.entrylk_req;
+                if (client_compound_gfid (&link->loc, NULL, entrylk->gfid))
+                        goto out;
+                entrylk->volume = link->volume;
+                entrylk->cmd = link->entrylk_cmd;
+                entrylk->type = link->entrylk_type;
+                entrylk->name = "";
+                if (link->name) {
+                        entrylk->name = link->name;
+                        entrylk->namelen = 1;
+                }
+                GF_PROTOCOL_DICT_SERIALIZE (this, link->xdata,
+                                            (&entrylk->xdata.xdata_val),
+                                            entrylk->xdata.xdata_len,
+                                            op_errno, out);
+                break;
+        case GF_FOP_FENTRYLK:
+                req->op = GFS3_COMPOUND_FENTRYLK;
+                fentrylk = &req->gfs3_compound_link_req_u.fentrylk_req;
+                client_compound_gfid (NULL, link->fd, fentrylk->gfid);
+                fentrylk->fd = remote_fd;
+                fentrylk->volume = link->volume;
+                fentrylk->cmd = link->entrylk_cmd;
+                fentrylk->type = link->entrylk_type;
+                fentrylk->name = "";
+                if (link->name) {
+                        fentrylk->name = link->name;
+                        fentrylk->namelen = 1;
+                }
+                GF_PROTOCOL_DICT_SERIALIZE (this, link->xdata,
+                                            (&fentrylk->xdata.xdata_val),
+                                            fentrylk->xdata.xdata_len,
+                                            op_errno, out);
+                break;
+        case GF_FOP_XATTROP:
+                req->op = GFS3_COMPOUND_XATTROP;
+                xattrop = &req->gfs3_compound_link_req_u.xattrop_req;
+                if (client_compound_gfid (&link->loc, NULL, xattrop->gfid))
+                        goto out;
+                xattrop->flags = link->optype;
+                GF_PROTOCOL_DICT_SERIALIZE (this, link->xattr,
+                                            (&xattrop->dict.dict_val),
+                                            xattrop->dict.dict_len,
+                                            op_errno, out);
+                GF_PROTOCOL_DICT_SERIALIZE (this, link->xdata,
+                                            (&xattrop->xdata.xdata_val),
+                                            xattrop->xdata.xdata_len,
+                                            op_errno, out);
+                break;
+        case GF_FOP_FXATTROP:
+                req->op = GFS3_COMPOUND_FXATTROP;
+                fxattrop = &req->gfs3_compound_link_req_u.fxattrop_req;
+                client_compound_gfid (NULL, link->fd, fxattrop->gfid);
+                fxattrop->fd = remote_fd;
+                fxattrop->flags = link->optype;
+                GF_PROTOCOL_DICT_SERIALIZE (this, link->xattr,
+                                            (&fxattrop->dict.dict_val),
+                                            fxattrop->dict.dict_len,
+                                            op_errno, out);
+                GF_PROTOCOL_DICT_SERIALIZE (this, link->xdata,
+                                            (&fxattrop->xdata.xdata_val),
+                                            fxattrop->xdata.xdata_len,
+                                            op_errno, out);
+                break;
+        case GF_FOP_SETXATTR:
+                req->op = GFS3_COMPOUND_SETXATTR;
+                setxattr = &req->gfs3_compound_link_req_u.setxattr_req;
+                if (client_compound_gfid (&link->loc, NULL, setxattr->gfid))
+                        goto out;
+                setxattr->flags = link->flags;
+                GF_PROTOCOL_DICT_SERIALIZE (this, link->xattr,
+                                            (&setxattr->dict.dict_val),
+                                            setxattr->dict.dict_len,
+                                            op_errno, out);
+                GF_PROTOCOL_DICT_SERIALIZE (this, link->xdata,
+                                            (&setxattr->xdata.xdata_val),
+                                            setxattr->xdata.xdata_len,
+                                            op_errno, out);
+                break;
+        case GF_FOP_FSETXATTR:
+                req->op = GFS3_COMPOUND_FSETXATTR;
+                fsetxattr = &req->gfs3_compound_link_req_u.fsetxattr_req;
+                client_compound_gfid (NULL, link->fd, fsetxattr->gfid);
+                fsetxattr->fd = remote_fd;
+                fsetxattr->flags = link->flags;
+                GF_PROTOCOL_DICT_SERIALIZE (this, link->xattr,
+                                            (&fsetxattr->dict.dict_val),
+                                            fsetxattr->dict.dict_len,
+                                            op_errno, out);
+                GF_PROTOCOL_DICT_SERIALIZE (this, link->xdata,
+                                            (&fsetxattr->xdata.xdata_val),
+                                            fsetxattr->xdata.xdata_len,
+                                            op_errno, out);
+                break;
+        case GF_FOP_WRITE:
+                req->op = GFS3_COMPOUND_WRITE;
+                write = &req->gfs3_compound_link_req_u.write_req;
+                client_compound_gfid (NULL, link->fd, write->gfid);
+                write->fd = remote_fd;
+                write->offset = link->offset;
+                write->size = iov_length (link->vector, link->count);
+                write->flag = link->flags;
+                GF_PROTOCOL_DICT_SERIALIZE (this, link->xdata,
+                                            (&write->xdata.xdata_val),
+                                            write->xdata.xdata_len,
+                                            op_errno, out);
+                break;
+        default:
+                goto out;
+        }
+
+        return 0;
+out:
+        return -1;
+}
+
+static void
+client_compound_req_cleanup (gfs3_compound_req *req)
+{
+        gfs3_compound_link_req *link      = NULL;
+        gfs3_inodelk_req       *inodelk   = NULL;
+        gfs3_finodelk_req      *finodelk  = NULL;
+        gfs3_entrylk_req       *entrylk   = NULL;
+        gfs3_fentrylk_req      *fentrylk  = NULL;
+        gfs3_xattrop_req       *xattrop   = NULL;
+        gfs3_fxattrop_req      *fxattrop  = NULL;
+        gfs3_setxattr_req      *setxattr  = NULL;
+        gfs3_fsetxattr_req     *fsetxattr = NULL;
+        gfs3_write_req         *write     = NULL;
+        int                     i         = 0;
+
+        for (i = 0; i < req->links.links_len; i++) {
+                link = &req->links.links_val[i];
+                switch (link->op) {
+                case GFS3_COMPOUND_INODELK:
+                        inodelk = &link->gfs3_compound_link_req_u.inodelk_req;
+                        GF_FREE (inodelk->xdata.xdata_val);
+                        break;
+                case GFS3_COMPOUND_FINODELK:
+                        finodelk = &link->gfs3_compound_link_req_u.finodelk_req;
+                        GF_FREE (finodelk->xdata.xdata_val);
+                        break;
+                case GFS3_COMPOUND_ENTRYLK:
+                        entrylk = &link->gfs3_compound_link_req_u.entrylk_req;
+                        GF_FREE (entrylk->xdata.xdata_val);
+                        break;
+                case GFS3_COMPOUND_FENTRYLK:
+                        fentrylk = &link->gfs3_compound_link_req_u.fentrylk_req;
+                        GF_FREE (fentrylk->xdata.xdata_val);
+                        break;
+                case GFS3_COMPOUND_XATTROP:
+                        xattrop = &link->gfs3_compound_link_req_u.xattrop_req;
+                        GF_FREE (xattrop->dict.dict_val);
+                        GF_FREE (xattrop->xdata.xdata_val);
+                        break;
+                case GFS3_COMPOUND_FXATTROP:
+                        fxattrop = &link->gfs3_compound_link_req_u.fxattrop_req;
+                        GF_FREE (fxattrop->dict.dict_val);
+                        GF_FREE (fxattrop->xdata.xdata_val);
+                        break;
+                case GFS3_COMPOUND_SETXATTR:
+                        setxattr = &link->gfs3_compound_link_req_u.setxattr_req;
+                        GF_FREE (setxattr->dict.dict_val);
+                        GF_FREE (setxattr->xdata.xdata_val);
+                        break;
+                case GFS3_COMPOUND_FSETXATTR:
+                        fsetxattr =
+                                &link->gfs3_compound_link_req_u.fsetxattr_req;
+                        GF_FREE (fsetxattr->dict.dict_val);
+                        GF_FREE (fsetxattr->xdata.xdata_val);
+                        break;
+                case GFS3_COMPOUND_WRITE:
+                        write = &link->gfs3_compound_link_req_u.write_req;
+                        GF_FREE (write->xdata.xdata_val);
+                        break;
+                }
+        }
+
+        GF_FREE (req->links.links_val);
+        GF_FREE (req->xdata.xdata_val);
+}
+
+int32_t
+client3_3_compound (call_frame_t *frame, xlator_t *this, void *data)
+{
+        clnt_args_t       *args    = NULL;
+        clnt_conf_t       *conf    = NULL;
+        compound_args_t   *link    = NULL;
+        gfs3_compound_req  req     = {{0,},};
+        struct iovec      *vector  = NULL;
+        struct iobref     *iobref  = NULL;
+        int                count   = 0;
+        int                op_errno = ENOMEM;
+        int                ret     = 0;
+        int                i       = 0;
+
+        if (!frame || !this || !data)
+                goto unwind;
+
+        args = data;
+        conf = this->private;
+
+        req.links.links_val = GF_CALLOC (args->count,
+                                         sizeof (gfs3_compound_link_req),
+                                         gf_client_mt_compound_req_t);
+        if (!req.links.links_val)
+                goto unwind;
+
+        iobref = iobref_new ();
+        if (!iobref)
+                goto unwind;
+
+        for (i = 0; i < args->count; i++) {
+                link = &args->compound[i];
+                if (client_compound_link_req (this, link,
+                                              &req.links.links_val[i]))
+                        goto serial;
+                req.links.links_len++;
+
+                if (link->fop != GF_FOP_WRITE)
+                        continue;
+
+                /* the payloads of all writes follow the request, in
+                 * the order of the links */
+                count += link->count;
+                if (link->iobref)
+                        iobref_merge (iobref, link->iobref);
+        }
+
+        if (count) {
+                vector = GF_CALLOC (count, sizeof (struct iovec),
+                                    gf_client_mt_compound_req_t);
+                if (!vector)
+                        goto unwind;
+
+                count = 0;
+                for (i = 0; i < args->count; i++) {
+                        link = &args->compound[i];
+                        if (link->fop != GF_FOP_WRITE)
+                                continue;
+                        memcpy (&vector[count], link->vector,
+                                link->count * sizeof (struct iovec));
+                        count += link->count;
+                }
+        }
+
+        GF_PROTOCOL_DICT_SERIALIZE (this, args->xdata, (&req.xdata.xdata_val),
+                                    req.xdata.xdata_len, op_errno, unwind);
+
+        GF_ATOMIC_ADD (conf->compound_lock, conf->compound_sent, 1);
+
+        ret = client_submit_vec_request (this, &req, frame, conf->fops,
+                                         GFS3_OP_COMPOUND,
+                                         client3_3_compound_cbk,
+                                         vector, count, iobref,
+                                         (xdrproc_t)xdr_gfs3_compound_req);
+        if (ret) {
+                gf_log (this->name, GF_LOG_WARNING, "failed to send the fop");
+        }
+
+        client_compound_req_cleanup (&req);
+        GF_FREE (vector);
+        iobref_unref (iobref);
+
+        return 0;
+
+serial:
+        /* some link needs the regular fop path (an fd to reopen, an
+         * anonymous fd), send the links one by one */
+        client_compound_req_cleanup (&req);
+        iobref_unref (iobref);
+
+        GF_ATOMIC_ADD (conf->compound_lock, conf->compound_serial, 1);
+        return compound_fop_serial (frame, this, args->compound, args->count,
+                                    args->xdata);
+unwind:
+        CLIENT_STACK_UNWIND (compound, frame, -1, op_errno, NULL, 0, NULL);
+        client_compound_req_cleanup (&req);
+        GF_FREE (vector);
+        if (iobref)
+                iobref_unref (iobref);
+
+        return 0;
+}
+
 /* Table Specific to FOPS */
 
 
@@ -6141,6 +6639,7 @@ rpc_clnt_procedure_t clnt3_3_fop_actors[GF_FOP_MAXVALUE] = {
 	[GF_FOP_FALLOCATE]   = { "FALLOCATE",	client3_3_fallocate },
 	[GF_FOP_DISCARD]     = { "DISCARD",	client3_3_discard },
         [GF_FOP_ZEROFILL]    = { "ZEROFILL",    client3_3_zerofill},
+        [GF_FOP_COMPOUND]    = { "COMPOUND",    client3_3_compound},
         [GF_FOP_RELEASE]     = { "RELEASE",     client3_3_release },
         [GF_FOP_RELEASEDIR]  = { "RELEASEDIR",  client3_3_releasedir },
         [GF_FOP_GETSPEC]     = { "GETSPEC",     client3_getspec },
@@ -6196,6 +6695,7 @@ char *clnt3_3_fop_names[GFS3_OP_MAXVALUE] = {
 	[GFS3_OP_FALLOCATE]   = "FALLOCATE",
 	[GFS3_OP_DISCARD]     = "DISCARD",
         [GFS3_OP_ZEROFILL]    = "ZEROFILL",
+        [GFS3_OP_COMPOUND]    = "COMPOUND",
 
 };
 
@@ -20,8 +20,10 @@
 #include "glusterfs.h"
 #include "statedump.h"
 #include "compat-errno.h"
+#include "event.h"
 
 #include "glusterfs3.h"
+#include "compound-fop.h"
 
 extern rpc_clnt_prog_t clnt_handshake_prog;
 extern rpc_clnt_prog_t clnt_dump_prog;
@@ -2067,6 +2069,48 @@ out:
 }
 
 
+int32_t
+client_compound (call_frame_t *frame, xlator_t *this, compound_args_t *args,
+                 int32_t count, dict_t *xdata)
+{
+        int          ret              = -1;
+        clnt_conf_t *conf             = NULL;
+        rpc_clnt_procedure_t *proc    = NULL;
+        clnt_args_t  clnt_args        = {0,};
+
+        conf = this->private;
+        if (!conf || !conf->fops)
+                goto out;
+
+        /* the brick does not know GFS3_OP_COMPOUND, send the links one by
+         * one through the regular fops of this xlator */
+        if (!conf->compound_fops) {
+                GF_ATOMIC_ADD (conf->compound_lock, conf->compound_serial, 1);
+                return compound_fop_serial (frame, this, args, count, xdata);
+        }
+
+        clnt_args.compound = args;
+        clnt_args.count = count;
+        clnt_args.xdata = xdata;
+
+        proc = &conf->fops->proctable[GF_FOP_COMPOUND];
+        if (!proc) {
+                gf_log (this->name, GF_LOG_ERROR,
+                        "rpc procedure not found for %s",
+                        gf_fop_list[GF_FOP_COMPOUND]);
+                goto out;
+        }
+        if (proc->fn)
+                ret = proc->fn (frame, this, &clnt_args);
+out:
+        if (ret)
+                STACK_UNWIND_STRICT (compound, frame, -1, ENOTCONN, NULL, 0,
+                                     NULL);
+
+        return 0;
+}
+
+
 int32_t
 client_getspec (call_frame_t *frame, xlator_t *this, const char *key,
                 int32_t flags)
@@ -2515,6 +2559,13 @@ reconfigure (xlator_t *this, dict_t *options)
         GF_OPTION_RECONF ("filter-O_DIRECT", conf->filter_o_direct,
                           options, bool, out);
 
+        GF_OPTION_RECONF ("event-threads", conf->event_threads,
+                          options, int32, out);
+        ret = event_reconfigure_threads (this->ctx->event_pool,
+                                         conf->event_threads);
+        if (ret)
+                goto out;
+
         ret = client_init_grace_timer (this, options, conf);
         if (ret)
                 goto out;
@@ -2549,6 +2600,7 @@ init (xlator_t *this)
                 goto out;
 
         pthread_mutex_init (&conf->lock, NULL);
+        LOCK_INIT (&conf->compound_lock);
         INIT_LIST_HEAD (&conf->saved_fds);
 
         /* Initialize parameters for lock self healing*/
@@ -2564,6 +2616,12 @@ init (xlator_t *this)
 
         conf->last_sent_event = -1; /* To start with we don't have any events */
 
+        GF_OPTION_INIT ("event-threads", conf->event_threads, int32, out);
+        ret = event_reconfigure_threads (this->ctx->event_pool,
+                                         conf->event_threads);
+        if (ret)
+                goto out;
+
         this->private = conf;
 
         /* If it returns -1, then its a failure, if it returns +1 we need
@@ -2617,6 +2675,7 @@ fini (xlator_t *this)
                 /* TODO: */
 
                 pthread_mutex_destroy (&conf->lock);
+                LOCK_DESTROY (&conf->compound_lock);
 
                 GF_FREE (conf);
         }
@@ -2706,12 +2765,22 @@ client_priv_dump (xlator_t *this)
 
         gf_proc_dump_write("connecting", "%d", conf->connecting);
 
+        gf_proc_dump_write("compound_fops", "%"PRIu64, conf->compound_sent);
+        gf_proc_dump_write("compound_fops_serial", "%"PRIu64,
+                           conf->compound_serial);
+
         if (conf->rpc) {
                 gf_proc_dump_write("total_bytes_read", "%"PRIu64,
                                    conf->rpc->conn.trans->total_bytes_read);
 
                 gf_proc_dump_write("total_bytes_written", "%"PRIu64,
                                    conf->rpc->conn.trans->total_bytes_write);
+
+                gf_proc_dump_write("total_write_calls", "%"PRIu64,
+                                   conf->rpc->conn.trans->total_write_calls);
+
+                gf_proc_dump_write("total_write_msgs", "%"PRIu64,
+                                   conf->rpc->conn.trans->total_write_msgs);
         }
         pthread_mutex_unlock(&conf->lock);
 
@@ -2787,6 +2856,7 @@ struct xlator_fops fops = {
 	.fallocate   = client_fallocate,
 	.discard     = client_discard,
         .zerofill    = client_zerofill,
+        .compound    = client_compound,
         .getspec     = client_getspec,
 };
 
@@ -2870,5 +2940,15 @@ struct volume_options options[] = {
           "still continue to cache the file. This works similar to NFS's "
           "behavior of O_DIRECT",
         },
+        { .key   = {"event-threads"},
+          .type  = GF_OPTION_TYPE_INT,
+          .min   = 1,
+          .max   = 32,
+          .default_value = "1",
+          .description = "Specifies the number of event threads to execute "
+                         "in parallel. Larger values would help process "
+                         "responses faster, depending on available processing "
+                         "power. Range 1-32 threads."
+        },
         { .key   = {NULL} },
 };
@@ -120,11 +120,18 @@ typedef struct clnt_conf {
 						*/
         gf_boolean_t           filter_o_direct; /* if set, filter O_DIRECT from
                                                    the flags list of open() */
+        int32_t                event_threads; /* number of epoll threads
+                                                 requested for this process */
         /* set volume is the op which results in creating/re-using
          * the conn-id and is called once per connection, this remembers
          * how manytimes set_volume is called
          */
         uint64_t               setvol_count;
+        gf_boolean_t           compound_fops; /* brick executes
+                                                 GFS3_OP_COMPOUND */
+        gf_lock_t              compound_lock;
+        uint64_t               compound_sent;   /* as GFS3_OP_COMPOUND */
+        uint64_t               compound_serial; /* link by link */
 } clnt_conf_t;
 
 typedef struct _client_fd_ctx {
@@ -204,6 +211,7 @@ typedef struct client_args {
 
         mode_t              umask;
         dict_t             *xdata;
+        compound_args_t    *compound;
 } clnt_args_t;
 
 typedef ssize_t (*gfs_serialize_t) (struct iovec outmsg, void *args);
@@ -350,6 +350,7 @@ server_setvolume (rpcsvc_request_t *req)
         int32_t              fop_version   = 0;
         int32_t              mgmt_version  = 0;
         uint32_t             lk_version    = 0;
+        uint32_t             xdata_keys    = 0;
         char                *buf           = NULL;
         gf_boolean_t        cancelled      = _gf_false;
 
@@ -445,6 +446,14 @@ server_setvolume (rpcsvc_request_t *req)
                                                   INTERNAL_LOCKS | POSIX_LOCKS);
         }
 
+        /* Older clients do not announce compact xdata support, keep sending
+         * them the regular format.
+         */
+        ret = dict_get_uint32 (params, "compact-xdata", &xdata_keys);
+        if (ret < 0)
+                xdata_keys = 0;
+        serv_ctx->xdata_keys = min (xdata_keys, dict_compact_key_count ());
+
         if (req->trans->xl_private != client)
                 req->trans->xl_private = client;
 
@@ -624,6 +633,11 @@ server_setvolume (rpcsvc_request_t *req)
                 client->bound_xl->itable =
                         inode_table_new (conf->inode_lru_limit,
                                          client->bound_xl);
+                if (conf->inode_lru_limit_bytes || conf->inode_rss_limit)
+                        inode_table_set_lru_limit (client->bound_xl->itable,
+                                                   conf->inode_lru_limit,
+                                                   conf->inode_lru_limit_bytes,
+                                                   conf->inode_rss_limit);
         }
 
         ret = dict_set_str (reply, "process-uuid",
@@ -637,6 +651,16 @@ server_setvolume (rpcsvc_request_t *req)
                 gf_log (this->name, GF_LOG_WARNING,
                         "failed to set 'clnt-lk-version'");
 
+        ret = dict_set_uint32 (reply, "compact-xdata", serv_ctx->xdata_keys);
+        if (ret)
+                gf_log (this->name, GF_LOG_DEBUG,
+                        "failed to set 'compact-xdata'");
+
+        ret = dict_set_int32 (reply, "compound-fops", 1);
+        if (ret)
+                gf_log (this->name, GF_LOG_DEBUG,
+                        "failed to set 'compound-fops'");
+
         ret = dict_set_uint64 (reply, "transport-ptr",
                                ((uint64_t) (long) req->trans));
         if (ret)
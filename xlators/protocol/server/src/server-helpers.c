@@ -15,6 +15,7 @@
 
 #include "server.h"
 #include "server-helpers.h"
+#include "compat-errno.h"
 
 #include <fnmatch.h>
 
@@ -717,74 +718,63 @@ out:
 }
 
 
-int
-serialize_rsp_direntp (gf_dirent_t *entries, gfs3_readdirp_rsp *rsp)
+/**
+ * server_encode_readdirp_rsp - encode a readdirp reply into an iobuf
+ *
+ * The entries are encoded straight into the iobuf, which is sized for them
+ * up front. If they can not be encoded, an ENOMEM failure is encoded
+ * instead.
+ *
+ * @param req        - the request to reply to
+ * @param rsp        - the reply, without entries
+ * @param entries    - the entries, or NULL
+ * @param xdata_keys - compact dict format of the client
+ * @param outmsg     - on success, the encoded reply within the iobuf
+ * @return the iobuf, NULL on failure
+ */
+struct iobuf *
+server_encode_readdirp_rsp (rpcsvc_request_t *req, gfs3_readdirp_rsp *rsp,
+                            gf_dirent_t *entries, uint32_t xdata_keys,
+                            struct iovec *outmsg)
 {
-        gf_dirent_t         *entry = NULL;
-        gfs3_dirplist       *trav  = NULL;
-        gfs3_dirplist       *prev  = NULL;
-        int                  ret   = -1;
+        struct iobuf *iob = NULL;
+        ssize_t       len = 0;
 
-        GF_VALIDATE_OR_GOTO ("server", entries, out);
+        GF_VALIDATE_OR_GOTO ("server", req, out);
         GF_VALIDATE_OR_GOTO ("server", rsp, out);
 
-        list_for_each_entry (entry, &entries->list, list) {
-                trav = GF_CALLOC (1, sizeof (*trav), gf_server_mt_dirent_rsp_t);
-                if (!trav)
-                        goto out;
-
-                trav->d_ino  = entry->d_ino;
-                trav->d_off  = entry->d_off;
-                trav->d_len  = entry->d_len;
-                trav->d_type = entry->d_type;
-                trav->name   = entry->d_name;
-
-                gf_stat_from_iatt (&trav->stat, &entry->d_stat);
-
-                /* if 'dict' is present, pack it */
-                if (entry->dict) {
-                        trav->dict.dict_len = dict_serialized_length (entry->dict);
-                        if (trav->dict.dict_len < 0) {
-                                gf_log (THIS->name, GF_LOG_ERROR,
-                                        "failed to get serialized length "
-                                        "of reply dict");
-                                errno = EINVAL;
-                                trav->dict.dict_len = 0;
-                                goto out;
-                        }
-
-                        trav->dict.dict_val = GF_CALLOC (1, trav->dict.dict_len,
-                                                         gf_server_mt_rsp_buf_t);
-                        if (!trav->dict.dict_val) {
-                                errno = ENOMEM;
-                                trav->dict.dict_len = 0;
-                                goto out;
-                        }
-
-                        ret = dict_serialize (entry->dict, trav->dict.dict_val);
-                        if (ret < 0) {
-                                gf_log (THIS->name, GF_LOG_ERROR,
-                                        "failed to serialize reply dict");
-                                errno = -ret;
-                                trav->dict.dict_len = 0;
-                                goto out;
-                        }
-                }
+        len = gfs3_readdirp_rsp_length (rsp, entries, xdata_keys);
+        if (len < 0)
+                goto enomem;
 
-                if (prev)
-                        prev->nextentry = trav;
-                else
-                        rsp->reply = trav;
+        iob = iobuf_get2 (req->svc->ctx->iobuf_pool, len);
+        if (!iob) {
+                gf_log (THIS->name, GF_LOG_ERROR, "Failed to get iobuf");
+                goto out;
+        }
 
-                prev = trav;
-                trav = NULL;
+        iobuf_to_iovec (iob, outmsg);
+        len = gfs3_encode_readdirp_rsp (*outmsg, rsp, entries, xdata_keys);
+        if (len < 0) {
+                iobuf_unref (iob);
+                iob = NULL;
+                goto enomem;
         }
+        outmsg->iov_len = len;
 
-        ret = 0;
 out:
-        GF_FREE (trav);
+        return iob;
 
-        return ret;
+enomem:
+        if (!entries)
+                return NULL;
+
+        gf_log (THIS->name, GF_LOG_ERROR, "failed to encode readdirp reply");
+        rsp->op_ret = -1;
+        rsp->op_errno = gf_errno_to_error (ENOMEM);
+
+        return server_encode_readdirp_rsp (req, rsp, NULL, xdata_keys,
+                                           outmsg);
 }
 
 
@@ -840,25 +830,6 @@ readdir_rsp_cleanup (gfs3_readdir_rsp *rsp)
 }
 
 
-int
-readdirp_rsp_cleanup (gfs3_readdirp_rsp *rsp)
-{
-        gfs3_dirplist *prev = NULL;
-        gfs3_dirplist *trav = NULL;
-
-        trav = rsp->reply;
-        prev = trav;
-        while (trav) {
-                trav = trav->nextentry;
-                GF_FREE (prev->dict.dict_val);
-                GF_FREE (prev);
-                prev = trav;
-        }
-
-        return 0;
-}
-
-
 int
 gf_server_check_getxattr_cmd (call_frame_t *frame, const char *key)
 {
@@ -992,6 +963,23 @@ out:
         return ctx;
 }
 
+
+uint32_t
+server_xdata_keys (call_frame_t *frame)
+{
+        client_t     *client   = frame->root->client;
+        server_ctx_t *serv_ctx = NULL;
+
+        if (!client)
+                return 0;
+
+        serv_ctx = server_ctx_get (client, client->this);
+        if (!serv_ctx)
+                return 0;
+
+        return serv_ctx->xdata_keys;
+}
+
 int
 auth_set_username_passwd (dict_t *input_params, dict_t *config_params,
                           client_t *client)
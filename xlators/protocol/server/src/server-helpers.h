@@ -54,13 +54,17 @@ int
 server_build_config (xlator_t *this, server_conf_t *conf);
 
 int serialize_rsp_dirent (gf_dirent_t *entries, gfs3_readdir_rsp *rsp);
-int serialize_rsp_direntp (gf_dirent_t *entries, gfs3_readdirp_rsp *rsp);
-int readdirp_rsp_cleanup (gfs3_readdirp_rsp *rsp);
+struct iobuf *server_encode_readdirp_rsp (rpcsvc_request_t *req,
+                                          gfs3_readdirp_rsp *rsp,
+                                          gf_dirent_t *entries,
+                                          uint32_t xdata_keys,
+                                          struct iovec *outmsg);
 int readdir_rsp_cleanup (gfs3_readdir_rsp *rsp);
 int auth_set_username_passwd (dict_t *input_params, dict_t *config_params,
                               struct _client_t *client);
 
 server_ctx_t *server_ctx_get (client_t *client, xlator_t *xlator);
+uint32_t server_xdata_keys (call_frame_t *frame);
 
 int32_t gf_barrier_start (xlator_t *this);
 int32_t gf_barrier_stop (xlator_t *this);
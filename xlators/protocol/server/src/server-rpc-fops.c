@@ -39,8 +39,8 @@ server_statfs_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         gfs3_statfs_rsp      rsp    = {0,};
         rpcsvc_request_t    *req    = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, xdata, &rsp.xdata.xdata_val,
+                               rsp.xdata.xdata_len, op_errno, out);
 
         if (op_ret < 0) {
                 gf_log (this->name, GF_LOG_WARNING, "%"PRId64": STATFS (%s)",
@@ -96,8 +96,8 @@ server_lookup_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
 
         gf_stat_from_iatt (&rsp.postparent, postparent);
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, xdata, &rsp.xdata.xdata_val,
+                               rsp.xdata.xdata_len, op_errno, out);
 
         if (op_ret) {
                 if (state->is_revalidate && op_errno == ENOENT) {
@@ -174,8 +174,8 @@ server_lk_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         rpcsvc_request_t    *req   = NULL;
         server_state_t      *state = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, xdata, &rsp.xdata.xdata_val,
+                               rsp.xdata.xdata_len, op_errno, out);
 
         if (op_ret) {
                 if ((op_errno != ENOSYS) && (op_errno != EAGAIN)) {
@@ -230,8 +230,8 @@ server_inodelk_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         server_state_t   *state     = NULL;
         rpcsvc_request_t *req       = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, xdata, &rsp.xdata.xdata_val,
+                               rsp.xdata.xdata_len, op_errno, out);
 
         state = CALL_STATE (frame);
 
@@ -269,8 +269,8 @@ server_finodelk_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         server_state_t   *state     = NULL;
         rpcsvc_request_t *req       = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, xdata, &rsp.xdata.xdata_val,
+                               rsp.xdata.xdata_len, op_errno, out);
 
         state = CALL_STATE (frame);
 
@@ -307,8 +307,8 @@ server_entrylk_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         server_state_t   *state     = NULL;
         rpcsvc_request_t *req       = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, xdata, &rsp.xdata.xdata_val,
+                               rsp.xdata.xdata_len, op_errno, out);
 
         state = CALL_STATE (frame);
 
@@ -345,8 +345,8 @@ server_fentrylk_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         server_state_t   *state     = NULL;
         rpcsvc_request_t *req       = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, xdata, &rsp.xdata.xdata_val,
+                               rsp.xdata.xdata_len, op_errno, out);
 
         state = CALL_STATE (frame);
 
@@ -383,8 +383,8 @@ server_access_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         rpcsvc_request_t    *req   = NULL;
         server_state_t      *state = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, xdata, &rsp.xdata.xdata_val,
+                               rsp.xdata.xdata_len, op_errno, out);
 
         if (op_ret) {
                 state = CALL_STATE (frame);
@@ -419,8 +419,8 @@ server_rmdir_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         inode_t             *parent = NULL;
         rpcsvc_request_t    *req    = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, xdata, &rsp.xdata.xdata_val,
+                               rsp.xdata.xdata_len, op_errno, out);
 
         state = CALL_STATE (frame);
 
@@ -472,8 +472,8 @@ server_mkdir_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         inode_t             *link_inode = NULL;
         rpcsvc_request_t    *req        = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, xdata, &rsp.xdata.xdata_val,
+                               rsp.xdata.xdata_len, op_errno, out);
 
         state = CALL_STATE (frame);
 
@@ -519,8 +519,8 @@ server_mknod_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         inode_t             *link_inode = NULL;
         rpcsvc_request_t    *req        = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, xdata, &rsp.xdata.xdata_val,
+                               rsp.xdata.xdata_len, op_errno, out);
 
         state = CALL_STATE (frame);
 
@@ -563,8 +563,8 @@ server_fsyncdir_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         server_state_t      *state = NULL;
         rpcsvc_request_t    *req   = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, xdata, &rsp.xdata.xdata_val,
+                               rsp.xdata.xdata_len, op_errno, out);
 
         if (op_ret < 0) {
                 state = CALL_STATE (frame);
@@ -599,8 +599,8 @@ server_readdir_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         rpcsvc_request_t    *req   = NULL;
         int                  ret   = 0;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, xdata, &rsp.xdata.xdata_val,
+                               rsp.xdata.xdata_len, op_errno, out);
 
         if (op_ret < 0) {
                 state = CALL_STATE (frame);
@@ -647,8 +647,8 @@ server_opendir_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         gfs3_opendir_rsp     rsp      = {0,};
         uint64_t             fd_no    = 0;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, xdata, &rsp.xdata.xdata_val,
+                               rsp.xdata.xdata_len, op_errno, out);
 
         if (op_ret < 0) {
                 state = CALL_STATE (frame);
@@ -692,8 +692,8 @@ server_removexattr_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         rpcsvc_request_t    *req   = NULL;
         server_state_t      *state = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, xdata, &rsp.xdata.xdata_val,
+                               rsp.xdata.xdata_len, op_errno, out);
 
         if (op_ret == -1) {
                 state = CALL_STATE (frame);
@@ -726,8 +726,8 @@ server_fremovexattr_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         rpcsvc_request_t    *req   = NULL;
         server_state_t      *state = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, xdata, &rsp.xdata.xdata_val,
+                               rsp.xdata.xdata_len, op_errno, out);
 
         if (op_ret == -1) {
                 state = CALL_STATE (frame);
@@ -761,8 +761,8 @@ server_getxattr_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         rpcsvc_request_t    *req   = NULL;
         server_state_t      *state = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, xdata, &rsp.xdata.xdata_val,
+                               rsp.xdata.xdata_len, op_errno, out);
 
         if (op_ret == -1) {
                 state = CALL_STATE (frame);
@@ -777,8 +777,8 @@ server_getxattr_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                 goto out;
         }
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, dict, &rsp.dict.dict_val,
-                                    rsp.dict.dict_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, dict, &rsp.dict.dict_val,
+                               rsp.dict.dict_len, op_errno, out);
 
 out:
         rsp.op_ret        = op_ret;
@@ -805,8 +805,8 @@ server_fgetxattr_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         server_state_t      *state = NULL;
         rpcsvc_request_t    *req   = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, xdata, &rsp.xdata.xdata_val,
+                               rsp.xdata.xdata_len, op_errno, out);
 
         if (op_ret == -1) {
                 state = CALL_STATE (frame);
@@ -821,8 +821,8 @@ server_fgetxattr_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                 goto out;
         }
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, dict, &rsp.dict.dict_val,
-                                    rsp.dict.dict_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, dict, &rsp.dict.dict_val,
+                               rsp.dict.dict_len, op_errno, out);
 
 out:
 
@@ -866,8 +866,8 @@ server_setxattr_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         rpcsvc_request_t *req = NULL;
         server_state_t      *state = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, xdata, &rsp.xdata.xdata_val,
+                               rsp.xdata.xdata_len, op_errno, out);
 
         if (op_ret == -1) {
                 state = CALL_STATE (frame);
@@ -922,8 +922,8 @@ server_fsetxattr_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         rpcsvc_request_t *req = NULL;
         server_state_t      *state = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, xdata, &rsp.xdata.xdata_val,
+                               rsp.xdata.xdata_len, op_errno, out);
 
         if (op_ret == -1) {
                 state = CALL_STATE (frame);
@@ -966,8 +966,8 @@ server_rename_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         char         oldpar_str[50]     = {0,};
         char         newpar_str[50]     = {0,};
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, xdata, &rsp.xdata.xdata_val,
+                               rsp.xdata.xdata_len, op_errno, out);
 
         state = CALL_STATE (frame);
 
@@ -1046,8 +1046,8 @@ server_unlink_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         inode_t             *parent = NULL;
         rpcsvc_request_t    *req    = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, xdata, &rsp.xdata.xdata_val,
+                               rsp.xdata.xdata_len, op_errno, out);
 
         state = CALL_STATE (frame);
 
@@ -1102,8 +1102,8 @@ server_symlink_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         inode_t             *link_inode = NULL;
         rpcsvc_request_t    *req        = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, xdata, &rsp.xdata.xdata_val,
+                               rsp.xdata.xdata_len, op_errno, out);
 
         state = CALL_STATE (frame);
 
@@ -1152,8 +1152,8 @@ server_link_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         char              gfid_str[50]   = {0,};
         char              newpar_str[50] = {0,};
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, xdata, &rsp.xdata.xdata_val,
+                               rsp.xdata.xdata_len, op_errno, out);
 
         state = CALL_STATE (frame);
 
@@ -1199,8 +1199,8 @@ server_truncate_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         server_state_t      *state = NULL;
         rpcsvc_request_t    *req   = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, xdata, &rsp.xdata.xdata_val,
+                               rsp.xdata.xdata_len, op_errno, out);
 
         if (op_ret) {
                 state = CALL_STATE (frame);
@@ -1236,8 +1236,8 @@ server_fstat_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         server_state_t      *state = NULL;
         rpcsvc_request_t    *req   = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, xdata, &rsp.xdata.xdata_val,
+                               rsp.xdata.xdata_len, op_errno, out);
 
         if (op_ret) {
                 state = CALL_STATE (frame);
@@ -1272,8 +1272,8 @@ server_ftruncate_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         server_state_t      *state = NULL;
         rpcsvc_request_t    *req   = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, xdata, &rsp.xdata.xdata_val,
+                               rsp.xdata.xdata_len, op_errno, out);
 
         if (op_ret) {
                 state = CALL_STATE (frame);
@@ -1308,8 +1308,8 @@ server_flush_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         server_state_t      *state = NULL;
         rpcsvc_request_t    *req   = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, xdata, &rsp.xdata.xdata_val,
+                               rsp.xdata.xdata_len, op_errno, out);
 
         if (op_ret < 0) {
                 state = CALL_STATE (frame);
@@ -1343,8 +1343,8 @@ server_fsync_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         server_state_t      *state = NULL;
         rpcsvc_request_t    *req   = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, xdata, &rsp.xdata.xdata_val,
+                               rsp.xdata.xdata_len, op_errno, out);
 
         if (op_ret < 0) {
                 state = CALL_STATE (frame);
@@ -1380,8 +1380,8 @@ server_writev_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         server_state_t      *state = NULL;
         rpcsvc_request_t    *req   = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, xdata, &rsp.xdata.xdata_val,
+                               rsp.xdata.xdata_len, op_errno, out);
 
         if (op_ret < 0) {
                 state = CALL_STATE (frame);
@@ -1429,8 +1429,8 @@ server_readv_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                                        "testing-xdata-value");
         }
 #endif
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, xdata, &rsp.xdata.xdata_val,
+                               rsp.xdata.xdata_len, op_errno, out);
 
         if (op_ret < 0) {
                 state = CALL_STATE (frame);
@@ -1467,8 +1467,8 @@ server_rchecksum_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         rpcsvc_request_t    *req   = NULL;
         server_state_t      *state = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, xdata, &rsp.xdata.xdata_val,
+                               rsp.xdata.xdata_len, op_errno, out);
 
         if (op_ret < 0) {
                 state = CALL_STATE (frame);
@@ -1508,8 +1508,8 @@ server_open_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         uint64_t             fd_no    = 0;
         gfs3_open_rsp        rsp      = {0,};
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, xdata, &rsp.xdata.xdata_val,
+                               rsp.xdata.xdata_len, op_errno, out);
 
         if (op_ret < 0) {
                 state = CALL_STATE (frame);
@@ -1559,8 +1559,8 @@ server_create_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         uint64_t             fd_no      = 0;
         gfs3_create_rsp      rsp        = {0,};
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, xdata, &rsp.xdata.xdata_val,
+                               rsp.xdata.xdata_len, op_errno, out);
 
         state = CALL_STATE (frame);
 
@@ -1643,8 +1643,8 @@ server_readlink_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         server_state_t      *state = NULL;
         rpcsvc_request_t    *req   = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, xdata, &rsp.xdata.xdata_val,
+                               rsp.xdata.xdata_len, op_errno, out);
 
         if (op_ret < 0) {
                 state = CALL_STATE (frame);
@@ -1684,8 +1684,8 @@ server_stat_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         server_state_t      *state = NULL;
         rpcsvc_request_t    *req   = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, xdata, &rsp.xdata.xdata_val,
+                               rsp.xdata.xdata_len, op_errno, out);
 
         if (op_ret) {
                 state  = CALL_STATE (frame);
@@ -1723,8 +1723,8 @@ server_setattr_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         server_state_t      *state = NULL;
         rpcsvc_request_t    *req   = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, xdata, &rsp.xdata.xdata_val,
+                               rsp.xdata.xdata_len, op_errno, out);
 
         if (op_ret) {
                 state = CALL_STATE (frame);
@@ -1761,8 +1761,8 @@ server_fsetattr_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         server_state_t      *state = NULL;
         rpcsvc_request_t    *req   = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, xdata, &rsp.xdata.xdata_val,
+                               rsp.xdata.xdata_len, op_errno, out);
 
         if (op_ret) {
                 state  = CALL_STATE (frame);
@@ -1800,8 +1800,8 @@ server_xattrop_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         server_state_t      *state = NULL;
         rpcsvc_request_t    *req   = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, xdata, &rsp.xdata.xdata_val,
+                               rsp.xdata.xdata_len, op_errno, out);
 
         if (op_ret < 0) {
                 state = CALL_STATE (frame);
@@ -1813,8 +1813,8 @@ server_xattrop_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                 goto out;
         }
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, dict, &rsp.dict.dict_val,
-                                    rsp.dict.dict_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, dict, &rsp.dict.dict_val,
+                               rsp.dict.dict_len, op_errno, out);
 
 out:
         rsp.op_ret        = op_ret;
@@ -1841,8 +1841,8 @@ server_fxattrop_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         server_state_t      *state = NULL;
         rpcsvc_request_t    *req   = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, xdata, &rsp.xdata.xdata_val,
+                               rsp.xdata.xdata_len, op_errno, out);
 
         if (op_ret < 0) {
                 state = CALL_STATE (frame);
@@ -1854,8 +1854,8 @@ server_fxattrop_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                 goto out;
         }
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, dict, &rsp.dict.dict_val,
-                                    rsp.dict.dict_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, dict, &rsp.dict.dict_val,
+                               rsp.dict.dict_len, op_errno, out);
 
 out:
         rsp.op_ret        = op_ret;
@@ -1878,13 +1878,14 @@ server_readdirp_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                      int32_t op_ret, int32_t op_errno, gf_dirent_t *entries,
                      dict_t *xdata)
 {
-        gfs3_readdirp_rsp    rsp   = {0,};
-        server_state_t      *state = NULL;
-        rpcsvc_request_t    *req   = NULL;
-        int                  ret   = 0;
+        gfs3_readdirp_rsp    rsp    = {0,};
+        server_state_t      *state  = NULL;
+        rpcsvc_request_t    *req    = NULL;
+        struct iobuf        *iob    = NULL;
+        struct iovec         outmsg = {0,};
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, xdata, &rsp.xdata.xdata_val,
+                               rsp.xdata.xdata_len, op_errno, out);
 
         if (op_ret < 0) {
                 state = CALL_STATE (frame);
@@ -1896,16 +1897,6 @@ server_readdirp_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                 goto out;
         }
 
-        /* (op_ret == 0) is valid, and means EOF */
-        if (op_ret) {
-                ret = serialize_rsp_direntp (entries, &rsp);
-                if (ret == -1) {
-                        op_ret   = -1;
-                        op_errno = ENOMEM;
-                        goto out;
-                }
-        }
-
         /* TODO: need more clear thoughts before calling this function. */
         /* gf_link_inodes_from_dirent (this, state->fd->inode, entries); */
 
@@ -1914,12 +1905,15 @@ out:
         rsp.op_errno  = gf_errno_to_error (op_errno);
 
         req = frame->local;
-        server_submit_reply (frame, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gfs3_readdirp_rsp);
 
-        GF_FREE (rsp.xdata.xdata_val);
+        /* (op_ret == 0) is valid, and means EOF. The entries are encoded
+         * straight into the reply buffer. */
+        iob = server_encode_readdirp_rsp (req, &rsp,
+                                          (op_ret > 0) ? entries : NULL,
+                                          server_xdata_keys (frame), &outmsg);
+        server_submit_encoded_reply (frame, req, iob, &outmsg, NULL, 0, NULL);
 
-        readdirp_rsp_cleanup (&rsp);
+        GF_FREE (rsp.xdata.xdata_val);
 
         return 0;
 }
@@ -1933,8 +1927,8 @@ server_fallocate_cbk(call_frame_t *frame, void *cookie, xlator_t *this,
         server_state_t    *state = NULL;
         rpcsvc_request_t  *req   = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, xdata, &rsp.xdata.xdata_val,
+                               rsp.xdata.xdata_len, op_errno, out);
 
         if (op_ret) {
                 state  = CALL_STATE (frame);
@@ -1971,8 +1965,8 @@ server_discard_cbk(call_frame_t *frame, void *cookie, xlator_t *this,
         server_state_t    *state = NULL;
         rpcsvc_request_t  *req   = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, xdata, &rsp.xdata.xdata_val,
+                               rsp.xdata.xdata_len, op_errno, out);
 
         if (op_ret) {
                 state  = CALL_STATE (frame);
@@ -2012,8 +2006,8 @@ server_zerofill_cbk(call_frame_t *frame, void *cookie, xlator_t *this,
         req = frame->local;
         state  = CALL_STATE (frame);
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, (&rsp.xdata.xdata_val),
-                                    rsp.xdata.xdata_len, op_errno, out);
+        SERVER_DICT_SERIALIZE (frame, this, xdata, (&rsp.xdata.xdata_val),
+                               rsp.xdata.xdata_len, op_errno, out);
 
         if (op_ret) {
                 gf_log (this->name, GF_LOG_INFO,
@@ -6122,6 +6116,645 @@ out:
 }
 
 
+/* Compound fops: the links of a GFS3_OP_COMPOUND request are executed one
+ * after the other, each on a frame and state of its own so that the regular
+ * resolver can be used. The reply goes out on the frame of the compound
+ * request once the last link returned or a link failed.
+ */
+typedef struct {
+        call_frame_t            *frame;
+        rpcsvc_request_t        *req;
+        gfs3_compound_req        args;
+        gfs3_compound_link_rsp  *links;
+        struct iovec             payload[MAX_IOVEC];
+        int                      payload_count;
+        int                      payload_idx;
+        size_t                   payload_off;
+        int                      done;
+} server_compound_t;
+
+static void server_compound_next (server_compound_t *cs);
+
+static void
+server_compound_destroy (server_compound_t *cs)
+{
+        gfs3_compound_link_rsp *link    = NULL;
+        gf_common_rsp          *common  = NULL;
+        gfs3_xattrop_rsp       *xattrop = NULL;
+        gfs3_write_rsp         *write   = NULL;
+        int                     i       = 0;
+
+        for (i = 0; i < cs->done; i++) {
+                link = &cs->links[i];
+                switch (link->op) {
+                case GFS3_COMPOUND_XATTROP:
+                case GFS3_COMPOUND_FXATTROP:
+                        xattrop = &link->gfs3_compound_link_rsp_u.xattrop_rsp;
+                        GF_FREE (xattrop->dict.dict_val);
+                        GF_FREE (xattrop->xdata.xdata_val);
+                        break;
+                case GFS3_COMPOUND_WRITE:
+                        write = &link->gfs3_compound_link_rsp_u.write_rsp;
+                        GF_FREE (write->xdata.xdata_val);
+                        break;
+                default:
+                        common = &link->gfs3_compound_link_rsp_u.inodelk_rsp;
+                        GF_FREE (common->xdata.xdata_val);
+                        break;
+                }
+        }
+
+        GF_FREE (cs->links);
+        xdr_free ((xdrproc_t)xdr_gfs3_compound_req, (char *)&cs->args);
+        GF_FREE (cs);
+}
+
+static void
+server_compound_reply (server_compound_t *cs, int32_t op_ret,
+                       int32_t op_errno)
+{
+        gfs3_compound_rsp rsp = {0,};
+
+        rsp.op_ret = op_ret;
+        rsp.op_errno = gf_errno_to_error (op_errno);
+        rsp.links.links_len = cs->done;
+        rsp.links.links_val = cs->links;
+
+        server_submit_reply (cs->frame, cs->req, &rsp, NULL, 0, NULL,
+                             (xdrproc_t)xdr_gfs3_compound_rsp);
+
+        server_compound_destroy (cs);
+}
+
+/* Records the reply of the current link, releases its frame and moves on to
+ * the next link, or replies to the client after the last or a failed one.
+ */
+static int
+server_compound_link_done (call_frame_t *frame, xlator_t *this,
+                           int32_t op_ret, int32_t op_errno,
+                           struct iatt *prebuf, struct iatt *postbuf,
+                           dict_t *dict, dict_t *xdata)
+{
+        server_compound_t      *cs        = NULL;
+        server_state_t         *state     = NULL;
+        gfs3_compound_link_rsp *link      = NULL;
+        gf_common_rsp          *common    = NULL;
+        gfs3_xattrop_rsp       *xattrop   = NULL;
+        gfs3_write_rsp         *write     = NULL;
+        int                    *rsp_ret   = NULL;
+        int                    *rsp_errno = NULL;
+
+        cs = frame->local;
+        state = CALL_STATE (frame);
+
+        link = &cs->links[cs->done];
+        link->op = cs->args.links.links_val[cs->done].op;
+
+        switch (link->op) {
+        case GFS3_COMPOUND_XATTROP:
+        case GFS3_COMPOUND_FXATTROP:
+                /* gfs3_fxattrop_rsp has the same layout */
+                xattrop = &link->gfs3_compound_link_rsp_u.xattrop_rsp;
+                rsp_ret = &xattrop->op_ret;
+                rsp_errno = &xattrop->op_errno;
+                SERVER_DICT_SERIALIZE (frame, this, xdata,
+                                       &xattrop->xdata.xdata_val,
+                                       xattrop->xdata.xdata_len, op_errno,
+                                       nomem);
+                if (op_ret < 0)
+                        break;
+                SERVER_DICT_SERIALIZE (frame, this, dict,
+                                       &xattrop->dict.dict_val,
+                                       xattrop->dict.dict_len, op_errno,
+                                       nomem);
+                break;
+        case GFS3_COMPOUND_WRITE:
+                write = &link->gfs3_compound_link_rsp_u.write_rsp;
+                rsp_ret = &write->op_ret;
+                rsp_errno = &write->op_errno;
+                SERVER_DICT_SERIALIZE (frame, this, xdata,
+                                       &write->xdata.xdata_val,
+                                       write->xdata.xdata_len, op_errno,
+                                       nomem);
+                if (op_ret < 0)
+                        break;
+                gf_stat_from_iatt (&write->prestat, prebuf);
+                gf_stat_from_iatt (&write->poststat, postbuf);
+                break;
+        default:
+                /* every other link replies with a gf_common_rsp */
+                common = &link->gfs3_compound_link_rsp_u.inodelk_rsp;
+                rsp_ret = &common->op_ret;
+                rsp_errno = &common->op_errno;
+                SERVER_DICT_SERIALIZE (frame, this, xdata,
+                                       &common->xdata.xdata_val,
+                                       common->xdata.xdata_len, op_errno,
+                                       nomem);
+                break;
+        }
+        goto out;
+
+nomem:
+        /* the reply of the link could not be encoded */
+        op_ret = -1;
+        op_errno = ENOMEM;
+out:
+        if (op_ret < 0) {
+                gf_log (this->name, GF_LOG_INFO,
+                        "%"PRId64": COMPOUND %s (%s) ==> (%s)",
+                        frame->root->unique, gf_fop_list[frame->root->op],
+                        uuid_utoa (state->resolve.gfid), strerror (op_errno));
+        }
+
+        *rsp_ret = op_ret;
+        *rsp_errno = gf_errno_to_error (op_errno);
+        cs->done++;
+
+        frame->local = NULL;
+        free_state (state);
+        gf_client_unref (frame->root->client);
+        STACK_DESTROY (frame->root);
+
+        if (op_ret < 0)
+                server_compound_reply (cs, -1, op_errno);
+        else if (cs->done == cs->args.links.links_len)
+                server_compound_reply (cs, 0, 0);
+        else
+                server_compound_next (cs);
+
+        return 0;
+}
+
+static int
+server_compound_common_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                            int32_t op_ret, int32_t op_errno, dict_t *xdata)
+{
+        return server_compound_link_done (frame, this, op_ret, op_errno,
+                                          NULL, NULL, NULL, xdata);
+}
+
+static int
+server_compound_xattrop_cbk (call_frame_t *frame, void *cookie,
+                             xlator_t *this, int32_t op_ret, int32_t op_errno,
+                             dict_t *dict, dict_t *xdata)
+{
+        return server_compound_link_done (frame, this, op_ret, op_errno,
+                                          NULL, NULL, dict, xdata);
+}
+
+static int
+server_compound_writev_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                            int32_t op_ret, int32_t op_errno,
+                            struct iatt *prebuf, struct iatt *postbuf,
+                            dict_t *xdata)
+{
+        return server_compound_link_done (frame, this, op_ret, op_errno,
+                                          prebuf, postbuf, NULL, xdata);
+}
+
+static int
+server_compound_resume (call_frame_t *frame, xlator_t *bound_xl)
+{
+        GF_UNUSED int   ret   = -1;
+        server_state_t *state = NULL;
+
+        state = CALL_STATE (frame);
+
+        if (state->resolve.op_ret != 0)
+                goto err;
+
+        switch (frame->root->op) {
+        case GF_FOP_INODELK:
+        case GF_FOP_FINODELK:
+        case GF_FOP_ENTRYLK:
+        case GF_FOP_FENTRYLK:
+                if (!state->xdata)
+                        state->xdata = dict_new ();
+
+                if (state->xdata)
+                        ret = dict_set_str (state->xdata, "connection-id",
+                                            frame->root->client->client_uid);
+                break;
+        default:
+                break;
+        }
+
+        switch (frame->root->op) {
+        case GF_FOP_INODELK:
+                STACK_WIND (frame, server_compound_common_cbk, bound_xl,
+                            bound_xl->fops->inodelk, state->volume,
+                            &state->loc, state->cmd, &state->flock,
+                            state->xdata);
+                break;
+        case GF_FOP_FINODELK:
+                STACK_WIND (frame, server_compound_common_cbk, bound_xl,
+                            bound_xl->fops->finodelk, state->volume,
+                            state->fd, state->cmd, &state->flock,
+                            state->xdata);
+                break;
+        case GF_FOP_ENTRYLK:
+                STACK_WIND (frame, server_compound_common_cbk, bound_xl,
+                            bound_xl->fops->entrylk, state->volume,
+                            &state->loc, state->name, state->cmd,
+                            state->type, state->xdata);
+                break;
+        case GF_FOP_FENTRYLK:
+                STACK_WIND (frame, server_compound_common_cbk, bound_xl,
+                            bound_xl->fops->fentrylk, state->volume,
+                            state->fd, state->name, state->cmd,
+                            state->type, state->xdata);
+                break;
+        case GF_FOP_XATTROP:
+                STACK_WIND (frame, server_compound_xattrop_cbk, bound_xl,
+                            bound_xl->fops->xattrop, &state->loc,
+                            state->flags, state->dict, state->xdata);
+                break;
+        case GF_FOP_FXATTROP:
+                STACK_WIND (frame, server_compound_xattrop_cbk, bound_xl,
+                            bound_xl->fops->fxattrop, state->fd,
+                            state->flags, state->dict, state->xdata);
+                break;
+        case GF_FOP_SETXATTR:
+                STACK_WIND (frame, server_compound_common_cbk, bound_xl,
+                            bound_xl->fops->setxattr, &state->loc,
+                            state->dict, state->flags, state->xdata);
+                break;
+        case GF_FOP_FSETXATTR:
+                STACK_WIND (frame, server_compound_common_cbk, bound_xl,
+                            bound_xl->fops->fsetxattr, state->fd,
+                            state->dict, state->flags, state->xdata);
+                break;
+        case GF_FOP_WRITE:
+                STACK_WIND (frame, server_compound_writev_cbk, bound_xl,
+                            bound_xl->fops->writev, state->fd,
+                            state->payload_vector, state->payload_count,
+                            state->offset, state->flags, state->iobref,
+                            state->xdata);
+                break;
+        default:
+                server_compound_link_done (frame, frame->this, -1, ENOTSUP,
+                                           NULL, NULL, NULL, NULL);
+                break;
+        }
+
+        return 0;
+err:
+        server_compound_link_done (frame, frame->this, state->resolve.op_ret,
+                                   state->resolve.op_errno, NULL, NULL, NULL,
+                                   NULL);
+        return 0;
+}
+
+static void
+server_compound_lk (server_state_t *state, unsigned int cmd,
+                    unsigned int type, struct gf_proto_flock *flock)
+{
+        switch (cmd) {
+        case GF_LK_GETLK:
+                state->cmd = F_GETLK;
+                break;
+        case GF_LK_SETLK:
+                state->cmd = F_SETLK;
+                break;
+        case GF_LK_SETLKW:
+                state->cmd = F_SETLKW;
+                break;
+        }
+
+        state->type = type;
+        gf_proto_flock_to_flock (flock, &state->flock);
+
+        switch (state->type) {
+        case GF_LK_F_RDLCK:
+                state->flock.l_type = F_RDLCK;
+                break;
+        case GF_LK_F_WRLCK:
+                state->flock.l_type = F_WRLCK;
+                break;
+        case GF_LK_F_UNLCK:
+                state->flock.l_type = F_UNLCK;
+                break;
+        }
+}
+
+/* Hands the next size bytes of the write payloads to the state of a link */
+static int
+server_compound_payload (server_compound_t *cs, server_state_t *state,
+                         size_t size)
+{
+        struct iovec *iov = NULL;
+        size_t        len = 0;
+
+        state->size = size;
+        while (size && cs->payload_idx < cs->payload_count) {
+                if (state->payload_count == MAX_IOVEC)
+                        return -1;
+
+                iov = &cs->payload[cs->payload_idx];
+                len = min (size, iov->iov_len - cs->payload_off);
+
+                state->payload_vector[state->payload_count].iov_base =
+                        iov->iov_base + cs->payload_off;
+                state->payload_vector[state->payload_count].iov_len = len;
+                state->payload_count++;
+
+                size -= len;
+                cs->payload_off += len;
+                if (cs->payload_off == iov->iov_len) {
+                        cs->payload_idx++;
+                        cs->payload_off = 0;
+                }
+        }
+
+        return size ? -1 : 0;
+}
+
+static int
+server_compound_link_state (server_compound_t *cs, call_frame_t *frame,
+                            gfs3_compound_link_req *link)
+{
+        server_state_t     *state     = NULL;
+        xlator_t           *bound_xl  = NULL;
+        gfs3_inodelk_req   *inodelk   = NULL;
+        gfs3_finodelk_req  *finodelk  = NULL;
+        gfs3_entrylk_req   *entrylk   = NULL;
+        gfs3_fentrylk_req  *fentrylk  = NULL;
+        gfs3_xattrop_req   *xattrop   = NULL;
+        gfs3_fxattrop_req  *fxattrop  = NULL;
+        gfs3_setxattr_req  *setxattr  = NULL;
+        gfs3_fsetxattr_req *fsetxattr = NULL;
+        gfs3_write_req     *write     = NULL;
+        int                 ret       = 0;
+        int                 op_errno  = 0;
+
+        state = CALL_STATE (frame);
+        bound_xl = frame->root->client->bound_xl;
+
+        switch (link->op) {
+        case GFS3_COMPOUND_INODELK:
+                inodelk = &link->gfs3_compound_link_req_u.inodelk_req;
+                frame->root->op = GF_FOP_INODELK;
+                state->resolve.type = RESOLVE_EXACT;
+                memcpy (state->resolve.gfid, inodelk->gfid, 16);
+                state->volume = gf_strdup (inodelk->volume);
+                server_compound_lk (state, inodelk->cmd, inodelk->type,
+                                    &inodelk->flock);
+                GF_PROTOCOL_DICT_UNSERIALIZE (bound_xl, state->xdata,
+                                              inodelk->xdata.xdata_val,
+                                              inodelk->xdata.xdata_len, ret,
+                                              op_errno, out);
+                break;
+        case GFS3_COMPOUND_FINODELK:
+                finodelk = &link->gfs3_compound_link_req_u.finodelk_req;
+                frame->root->op = GF_FOP_FINODELK;
+                state->resolve.type = RESOLVE_EXACT;
+                state->resolve.fd_no = finodelk->fd;
+                memcpy (state->resolve.gfid, finodelk->gfid, 16);
+                state->volume = gf_strdup (finodelk->volume);
+                server_compound_lk (state, finodelk->cmd, finodelk->type,
+                                    &finodelk->flock);
+                GF_PROTOCOL_DICT_UNSERIALIZE (bound_xl, state->xdata,
+                                              finodelk->xdata.xdata_val,
+                                              finodelk->xdata.xdata_len, ret,
+                                              op_errno, out);
+                break;
+        case GFS3_COMPOUND_ENTRYLK:
+                entrylk = &link->gfs3_compound_link_req_u.entrylk_req;
+                frame->root->op = GF_FOP_ENTRYLK;
+                state->resolve.type = RESOLVE_EXACT;
+                memcpy (state->resolve.gfid, entrylk->gfid, 16);
+                if (entrylk->namelen)
+                        state->name = gf_strdup (entrylk->name);
+                state->volume = gf_strdup (entrylk->volume);
+                state->cmd = entrylk->cmd;
+                state->type = entrylk->type;
+                GF_PROTOCOL_DICT_UNSERIALIZE (bound_xl, state->xdata,
+                                              entrylk->xdata.xdata_val,
+                                              entrylk->xdata.xdata_len, ret,
+                                              op_errno, out);
+                break;
+        case GFS3_COMPOUND_FENTRYLK:
+                fentrylk = &link->gfs3_compound_link_req_u.fentrylk_req;
+                frame->root->op = GF_FOP_FENTRYLK;
+                state->resolve.type = RESOLVE_EXACT;
+                state->resolve.fd_no = fentrylk->fd;
+                memcpy (state->resolve.gfid, fentrylk->gfid, 16);
+                if (fentrylk->namelen)
+                        state->name = gf_strdup (fentrylk->name);
+                state->volume = gf_strdup (fentrylk->volume);
+                state->cmd = fentrylk->cmd;
+                state->type = fentrylk->type;
+                GF_PROTOCOL_DICT_UNSERIALIZE (bound_xl, state->xdata,
+                                              fentrylk->xdata.xdata_val,
+                                              fentrylk->xdata.xdata_len, ret,
+                                              op_errno, out);
+                break;
+        case GFS3_COMPOUND_XATTROP:
+                xattrop = &link->gfs3_compound_link_req_u.xattrop_req;
+                frame->root->op = GF_FOP_XATTROP;
+                state->resolve.type = RESOLVE_MUST;
+                state->flags = xattrop->flags;
+                memcpy (state->resolve.gfid, xattrop->gfid, 16);
+                GF_PROTOCOL_DICT_UNSERIALIZE (bound_xl, state->dict,
+                                              xattrop->dict.dict_val,
+                                              xattrop->dict.dict_len, ret,
+                                              op_errno, out);
+                GF_PROTOCOL_DICT_UNSERIALIZE (bound_xl, state->xdata,
+                                              xattrop->xdata.xdata_val,
+                                              xattrop->xdata.xdata_len, ret,
+                                              op_errno, out);
+                break;
+        case GFS3_COMPOUND_FXATTROP:
+                fxattrop = &link->gfs3_compound_link_req_u.fxattrop_req;
+                frame->root->op = GF_FOP_FXATTROP;
+                state->resolve.type = RESOLVE_MUST;
+                state->resolve.fd_no = fxattrop->fd;
+                state->flags = fxattrop->flags;
+                memcpy (state->resolve.gfid, fxattrop->gfid, 16);
+                GF_PROTOCOL_DICT_UNSERIALIZE (bound_xl, state->dict,
+                                              fxattrop->dict.dict_val,
+                                              fxattrop->dict.dict_len, ret,
+                                              op_errno, out);
+                GF_PROTOCOL_DICT_UNSERIALIZE (bound_xl, state->xdata,
+                                              fxattrop->xdata.xdata_val,
+                                              fxattrop->xdata.xdata_len, ret,
+                                              op_errno, out);
+                break;
+        case GFS3_COMPOUND_SETXATTR:
+                setxattr = &link->gfs3_compound_link_req_u.setxattr_req;
+                frame->root->op = GF_FOP_SETXATTR;
+                state->resolve.type = RESOLVE_MUST;
+                state->flags = setxattr->flags;
+                memcpy (state->resolve.gfid, setxattr->gfid, 16);
+                GF_PROTOCOL_DICT_UNSERIALIZE (bound_xl, state->dict,
+                                              setxattr->dict.dict_val,
+                                              setxattr->dict.dict_len, ret,
+                                              op_errno, out);
+                /* There can be some commands hidden in key */
+                gf_server_check_setxattr_cmd (frame, state->dict);
+                GF_PROTOCOL_DICT_UNSERIALIZE (bound_xl, state->xdata,
+                                              setxattr->xdata.xdata_val,
+                                              setxattr->xdata.xdata_len, ret,
+                                              op_errno, out);
+                break;
+        case GFS3_COMPOUND_FSETXATTR:
+                fsetxattr = &link->gfs3_compound_link_req_u.fsetxattr_req;
+                frame->root->op = GF_FOP_FSETXATTR;
+                state->resolve.type = RESOLVE_MUST;
+                state->resolve.fd_no = fsetxattr->fd;
+                state->flags = fsetxattr->flags;
+                memcpy (state->resolve.gfid, fsetxattr->gfid, 16);
+                GF_PROTOCOL_DICT_UNSERIALIZE (bound_xl, state->dict,
+                                              fsetxattr->dict.dict_val,
+                                              fsetxattr->dict.dict_len, ret,
+                                              op_errno, out);
+                GF_PROTOCOL_DICT_UNSERIALIZE (bound_xl, state->xdata,
+                                              fsetxattr->xdata.xdata_val,
+                                              fsetxattr->xdata.xdata_len, ret,
+                                              op_errno, out);
+                break;
+        case GFS3_COMPOUND_WRITE:
+                write = &link->gfs3_compound_link_req_u.write_req;
+                frame->root->op = GF_FOP_WRITE;
+                state->resolve.type = RESOLVE_MUST;
+                state->resolve.fd_no = write->fd;
+                state->offset = write->offset;
+                state->flags = write->flag;
+                state->iobref = iobref_ref (cs->req->iobref);
+                memcpy (state->resolve.gfid, write->gfid, 16);
+                if (server_compound_payload (cs, state, write->size)) {
+                        op_errno = EINVAL;
+                        goto out;
+                }
+                GF_PROTOCOL_DICT_UNSERIALIZE (bound_xl, state->xdata,
+                                              write->xdata.xdata_val,
+                                              write->xdata.xdata_len, ret,
+                                              op_errno, out);
+                break;
+        default:
+                op_errno = ENOTSUP;
+                goto out;
+        }
+
+        return 0;
+out:
+        return -op_errno;
+}
+
+static void
+server_compound_next (server_compound_t *cs)
+{
+        call_frame_t *frame = NULL;
+        int           ret   = 0;
+
+        frame = get_frame_from_request (cs->req);
+        if (!frame) {
+                /* reply with the links done so far */
+                server_compound_reply (cs, -1, ENOMEM);
+                return;
+        }
+        frame->local = cs;
+
+        ret = server_compound_link_state (cs, frame,
+                                          &cs->args.links.links_val[cs->done]);
+        if (ret) {
+                server_compound_link_done (frame, frame->this, -1, -ret,
+                                           NULL, NULL, NULL, NULL);
+                return;
+        }
+
+        resolve_and_resume (frame, server_compound_resume);
+}
+
+int
+server3_3_compound (rpcsvc_request_t *req)
+{
+        server_compound_t   *cs       = NULL;
+        call_frame_t        *frame    = NULL;
+        ssize_t              len      = 0;
+        int                  i        = 0;
+        int                  ret      = -1;
+
+        if (!req)
+                return ret;
+
+        cs = GF_CALLOC (1, sizeof (*cs), gf_server_mt_compound_t);
+        if (!cs) {
+                SERVER_REQ_SET_ERROR (req, ret);
+                goto out;
+        }
+
+        len = xdr_to_generic (req->msg[0], &cs->args,
+                              (xdrproc_t)xdr_gfs3_compound_req);
+        if (len < 0) {
+                //failed to decode msg;
+                SERVER_REQ_SET_ERROR (req, ret);
+                goto out;
+        }
+
+        frame = get_frame_from_request (req);
+        if (!frame) {
+                // something wrong, mostly insufficient memory
+                SERVER_REQ_SET_ERROR (req, ret);
+                goto out;
+        }
+        frame->root->op = GF_FOP_COMPOUND;
+
+        if (!frame->root->client->bound_xl) {
+                /* auth failure, request on subvolume without setvolume */
+                SERVER_REQ_SET_ERROR (req, ret);
+                goto out;
+        }
+
+        cs->frame = frame;
+        cs->req = req;
+
+        if (cs->args.links.links_len) {
+                cs->links = GF_CALLOC (cs->args.links.links_len,
+                                       sizeof (gfs3_compound_link_rsp),
+                                       gf_server_mt_compound_t);
+                if (!cs->links) {
+                        SERVER_REQ_SET_ERROR (req, ret);
+                        goto out;
+                }
+        }
+
+        /* the payloads of all writes follow the request, in the order of
+         * the links */
+        if (len < req->msg[0].iov_len) {
+                cs->payload[0].iov_base = (req->msg[0].iov_base + len);
+                cs->payload[0].iov_len = req->msg[0].iov_len - len;
+                cs->payload_count = 1;
+        }
+
+        for (i = 1; i < req->count; i++)
+                cs->payload[cs->payload_count++] = req->msg[i];
+
+        ret = 0;
+        if (cs->args.links.links_len)
+                server_compound_next (cs);
+        else
+                server_compound_reply (cs, 0, 0);
+
+        return ret;
+out:
+        if (frame) {
+                free_state (CALL_STATE (frame));
+                gf_client_unref (frame->root->client);
+                STACK_DESTROY (frame->root);
+        }
+
+        if (cs) {
+                GF_FREE (cs->links);
+                xdr_free ((xdrproc_t)xdr_gfs3_compound_req,
+                          (char *)&cs->args);
+                GF_FREE (cs);
+        }
+
+        return ret;
+}
+
+
 rpcsvc_actor_t glusterfs3_3_fop_actors[] = {
         [GFS3_OP_NULL]         = {"NULL",         GFS3_OP_NULL,         server_null,            NULL, 0, DRC_NA},
         [GFS3_OP_STAT]         = {"STAT",         GFS3_OP_STAT,         server3_3_stat,         NULL, 0, DRC_NA},
@@ -6149,13 +6782,13 @@ rpcsvc_actor_t glusterfs3_3_fop_actors[] = {
         [GFS3_OP_CREATE]       = {"CREATE",       GFS3_OP_CREATE,       server3_3_create,       NULL, 0, DRC_NA},
         [GFS3_OP_FTRUNCATE]    = {"FTRUNCATE",    GFS3_OP_FTRUNCATE,    server3_3_ftruncate,    NULL, 0, DRC_NA},
         [GFS3_OP_FSTAT]        = {"FSTAT",        GFS3_OP_FSTAT,        server3_3_fstat,        NULL, 0, DRC_NA},
-        [GFS3_OP_LK]           = {"LK",           GFS3_OP_LK,           server3_3_lk,           NULL, 0, DRC_NA},
+        [GFS3_OP_LK]           = {"LK",           GFS3_OP_LK,           server3_3_lk,           NULL, 0, DRC_NA, _gf_true},
         [GFS3_OP_LOOKUP]       = {"LOOKUP",       GFS3_OP_LOOKUP,       server3_3_lookup,       NULL, 0, DRC_NA},
         [GFS3_OP_READDIR]      = {"READDIR",      GFS3_OP_READDIR,      server3_3_readdir,      NULL, 0, DRC_NA},
-        [GFS3_OP_INODELK]      = {"INODELK",      GFS3_OP_INODELK,      server3_3_inodelk,      NULL, 0, DRC_NA},
-        [GFS3_OP_FINODELK]     = {"FINODELK",     GFS3_OP_FINODELK,     server3_3_finodelk,     NULL, 0, DRC_NA},
-        [GFS3_OP_ENTRYLK]      = {"ENTRYLK",      GFS3_OP_ENTRYLK,      server3_3_entrylk,      NULL, 0, DRC_NA},
-        [GFS3_OP_FENTRYLK]     = {"FENTRYLK",     GFS3_OP_FENTRYLK,     server3_3_fentrylk,     NULL, 0, DRC_NA},
+        [GFS3_OP_INODELK]      = {"INODELK",      GFS3_OP_INODELK,      server3_3_inodelk,      NULL, 0, DRC_NA, _gf_true},
+        [GFS3_OP_FINODELK]     = {"FINODELK",     GFS3_OP_FINODELK,     server3_3_finodelk,     NULL, 0, DRC_NA, _gf_true},
+        [GFS3_OP_ENTRYLK]      = {"ENTRYLK",      GFS3_OP_ENTRYLK,      server3_3_entrylk,      NULL, 0, DRC_NA, _gf_true},
+        [GFS3_OP_FENTRYLK]     = {"FENTRYLK",     GFS3_OP_FENTRYLK,     server3_3_fentrylk,     NULL, 0, DRC_NA, _gf_true},
         [GFS3_OP_XATTROP]      = {"XATTROP",      GFS3_OP_XATTROP,      server3_3_xattrop,      NULL, 0, DRC_NA},
         [GFS3_OP_FXATTROP]     = {"FXATTROP",     GFS3_OP_FXATTROP,     server3_3_fxattrop,     NULL, 0, DRC_NA},
         [GFS3_OP_FGETXATTR]    = {"FGETXATTR",    GFS3_OP_FGETXATTR,    server3_3_fgetxattr,    NULL, 0, DRC_NA},
@@ -6170,6 +6803,7 @@ rpcsvc_actor_t glusterfs3_3_fop_actors[] = {
         [GFS3_OP_FALLOCATE]    = {"FALLOCATE",    GFS3_OP_FALLOCATE,    server3_3_fallocate,    NULL, 0, DRC_NA},
         [GFS3_OP_DISCARD]      = {"DISCARD",      GFS3_OP_DISCARD,      server3_3_discard,      NULL, 0, DRC_NA},
         [GFS3_OP_ZEROFILL]    =  {"ZEROFILL",     GFS3_OP_ZEROFILL,     server3_3_zerofill,     NULL, 0, DRC_NA},
+        [GFS3_OP_COMPOUND]    =  {"COMPOUND",     GFS3_OP_COMPOUND,     server3_3_compound,     NULL, 0, DRC_NA, _gf_true},
 };
 
 
@@ -25,6 +25,8 @@
 #include "statedump.h"
 #include "defaults.h"
 #include "authenticate.h"
+#include "event.h"
+#include "rpcsvc-sched.h"
 
 void
 grace_time_handler (void *data)
@@ -130,14 +132,28 @@ ret:
         return iob;
 }
 
+/**
+ * server_submit_encoded_reply - submit a reply which is already encoded
+ *
+ * Takes over the iobuf and, like server_submit_reply, the frame.
+ *
+ * @param frame        - the frame of the fop, or NULL
+ * @param req          - the request to reply to
+ * @param iob          - the iobuf holding the encoded reply, NULL if
+ *                       encoding failed
+ * @param rsp          - the encoded reply within iob
+ * @param payload      - payload to send after the reply
+ * @param payloadcount - number of payload vectors
+ * @param iobref       - iobref holding the payload buffers, or NULL
+ * @return 0 on success, -1 on failure
+ */
 int
-server_submit_reply (call_frame_t *frame, rpcsvc_request_t *req, void *arg,
-                     struct iovec *payload, int payloadcount,
-                     struct iobref *iobref, xdrproc_t xdrproc)
+server_submit_encoded_reply (call_frame_t *frame, rpcsvc_request_t *req,
+                             struct iobuf *iob, struct iovec *rsp,
+                             struct iovec *payload, int payloadcount,
+                             struct iobref *iobref)
 {
-        struct iobuf           *iob        = NULL;
         int                     ret        = -1;
-        struct iovec            rsp        = {0,};
         server_state_t         *state      = NULL;
         char                    new_iobref = 0;
         client_t               *client     = NULL;
@@ -159,21 +175,19 @@ server_submit_reply (call_frame_t *frame, rpcsvc_request_t *req, void *arg,
         if (client)
                 lk_heal = ((server_conf_t *) client->this->private)->lk_heal;
 
+        if (!iob)
+                goto ret;
+
         if (!iobref) {
                 iobref = iobref_new ();
                 if (!iobref) {
+                        iobuf_unref (iob);
                         goto ret;
                 }
 
                 new_iobref = 1;
         }
 
-        iob = gfs_serialize_reply (req, arg, &rsp, xdrproc);
-        if (!iob) {
-                gf_log ("", GF_LOG_ERROR, "Failed to serialize reply");
-                goto ret;
-        }
-
         iobref_add (iobref, iob);
 
         if (conf)
@@ -184,7 +198,7 @@ server_submit_reply (call_frame_t *frame, rpcsvc_request_t *req, void *arg,
                 {
                         if (is_fop_barriered (barrier->fops, req->procnum) &&
                             (barrier_add_to_queue (barrier))) {
-                                stub = gf_barrier_payload (req, &rsp, frame,
+                                stub = gf_barrier_payload (req, rsp, frame,
                                                            payload,
                                                            payloadcount, iobref,
                                                            iob, new_iobref);
@@ -203,7 +217,7 @@ server_submit_reply (call_frame_t *frame, rpcsvc_request_t *req, void *arg,
                         goto out;
         }
         /* Then, submit the message for transmission. */
-        ret = rpcsvc_submit_generic (req, &rsp, 1, payload, payloadcount,
+        ret = rpcsvc_submit_generic (req, rsp, 1, payload, payloadcount,
                                      iobref);
 
         /* TODO: this is demo purpose only */
@@ -248,6 +262,25 @@ out:
 }
 
 
+int
+server_submit_reply (call_frame_t *frame, rpcsvc_request_t *req, void *arg,
+                     struct iovec *payload, int payloadcount,
+                     struct iobref *iobref, xdrproc_t xdrproc)
+{
+        struct iobuf           *iob        = NULL;
+        struct iovec            rsp        = {0,};
+
+        if (req) {
+                iob = gfs_serialize_reply (req, arg, &rsp, xdrproc);
+                if (!iob)
+                        gf_log ("", GF_LOG_ERROR, "Failed to serialize reply");
+        }
+
+        return server_submit_encoded_reply (frame, req, iob, &rsp, payload,
+                                            payloadcount, iobref);
+}
+
+
 int
 server_priv_to_dict (xlator_t *this, dict_t *dict)
 {
@@ -315,6 +348,8 @@ server_priv (xlator_t *this)
         char              key[GF_DUMP_MAX_BUF_LEN] = {0,};
         uint64_t          total_read = 0;
         uint64_t          total_write = 0;
+        uint64_t          total_write_calls = 0;
+        uint64_t          total_write_msgs = 0;
         int32_t           ret  = -1;
 
         GF_VALIDATE_OR_GOTO ("server", this, out);
@@ -333,6 +368,8 @@ server_priv (xlator_t *this)
                 list_for_each_entry (xprt, &conf->xprt_list, list) {
                         total_read  += xprt->total_bytes_read;
                         total_write += xprt->total_bytes_write;
+                        total_write_calls += xprt->total_write_calls;
+                        total_write_msgs  += xprt->total_write_msgs;
                 }
         }
         pthread_mutex_unlock (&conf->mutex);
@@ -343,6 +380,15 @@ server_priv (xlator_t *this)
         gf_proc_dump_build_key(key, "server", "total-bytes-write");
         gf_proc_dump_write(key, "%"PRIu64, total_write);
 
+        gf_proc_dump_build_key(key, "server", "total-write-calls");
+        gf_proc_dump_write(key, "%"PRIu64, total_write_calls);
+
+        gf_proc_dump_build_key(key, "server", "total-write-msgs");
+        gf_proc_dump_write(key, "%"PRIu64, total_write_msgs);
+
+        if (conf->rpc)
+                rpcsvc_sched_priv (conf->rpc);
+
         ret = 0;
 out:
         if (ret)
@@ -697,6 +743,38 @@ out:
         return ret;
 }
 
+
+/* The iobuf pool is shared by the whole brick process */
+static int
+server_init_iobuf_pool (xlator_t *this, dict_t *options)
+{
+        int32_t                ret        = -1;
+        char                  *classes    = NULL;
+        char                  *huge_str   = NULL;
+        gf_boolean_t           numa       = _gf_false;
+        gf_iobuf_huge_pages_t  huge_pages = GF_IOBUF_HUGE_PAGES_OFF;
+
+        GF_OPTION_RECONF ("iobuf-page-classes", classes, options, str, out);
+        GF_OPTION_RECONF ("iobuf-huge-pages", huge_str, options, str, out);
+        GF_OPTION_RECONF ("iobuf-numa", numa, options, bool, out);
+
+        ret = iobuf_huge_pages_from_str (huge_str, &huge_pages);
+        if (ret) {
+                gf_log (this->name, GF_LOG_ERROR, "invalid value %s for "
+                        "iobuf-huge-pages", huge_str);
+                goto out;
+        }
+
+        ret = iobuf_pool_set_arena_policy (this->ctx->iobuf_pool, huge_pages,
+                                           numa);
+        if (ret)
+                goto out;
+
+        ret = iobuf_pool_set_page_classes (this->ctx->iobuf_pool, classes);
+out:
+        return ret;
+}
+
 int
 reconfigure (xlator_t *this, dict_t *options)
 {
@@ -709,6 +787,7 @@ reconfigure (xlator_t *this, dict_t *options)
         data_t                   *data;
         int                       ret = 0;
         char                     *statedump_path = NULL;
+        xlator_list_t            *trav = NULL;
         conf = this->private;
 
         if (!conf) {
@@ -784,6 +863,13 @@ reconfigure (xlator_t *this, dict_t *options)
                 goto out;
         }
 
+        ret = rpcsvc_sched_reconfigure (rpc_conf, options);
+        if (ret < 0) {
+                gf_log (this->name, GF_LOG_ERROR,
+                        "Failed to reconfigure fair-share scheduling");
+                goto out;
+        }
+
         list_for_each_entry (listeners, &(rpc_conf->listeners), list) {
                 if (listeners->trans != NULL) {
                         if (listeners->trans->reconfigure )
@@ -794,6 +880,32 @@ reconfigure (xlator_t *this, dict_t *options)
                 }
         }
         ret = server_init_grace_timer (this, options, conf);
+        if (ret)
+                goto out;
+
+        GF_OPTION_RECONF ("event-threads", conf->event_threads,
+                          options, int32, out);
+        ret = event_reconfigure_threads (this->ctx->event_pool,
+                                         conf->event_threads);
+        if (ret)
+                goto out;
+
+        ret = server_init_iobuf_pool (this, options);
+        if (ret)
+                goto out;
+
+        GF_OPTION_RECONF ("inode-lru-limit-bytes", conf->inode_lru_limit_bytes,
+                          options, size, out);
+        GF_OPTION_RECONF ("inode-rss-limit", conf->inode_rss_limit,
+                          options, size, out);
+
+        for (trav = this->children; trav; trav = trav->next) {
+                if (trav->xlator->itable)
+                        inode_table_set_lru_limit (trav->xlator->itable,
+                                                   conf->inode_lru_limit,
+                                                   conf->inode_lru_limit_bytes,
+                                                   conf->inode_rss_limit);
+        }
 
 out:
         gf_log ("", GF_LOG_DEBUG, "returning %d", ret);
@@ -863,6 +975,20 @@ init (xlator_t *this)
         if (ret)
                 conf->conf_dir = CONFDIR;
 
+        GF_OPTION_INIT ("event-threads", conf->event_threads, int32, out);
+        ret = event_reconfigure_threads (this->ctx->event_pool,
+                                         conf->event_threads);
+        if (ret)
+                goto out;
+
+        ret = server_init_iobuf_pool (this, this->options);
+        if (ret)
+                goto out;
+
+        GF_OPTION_INIT ("inode-lru-limit-bytes", conf->inode_lru_limit_bytes,
+                        size, out);
+        GF_OPTION_INIT ("inode-rss-limit", conf->inode_rss_limit, size, out);
+
         /*ret = dict_get_str (this->options, "statedump-path", &statedump_path);
         if (!ret) {
                 gf_path_strip_trailing_slashes (statedump_path);
@@ -913,6 +1039,13 @@ init (xlator_t *this)
                 goto out;
         }
 
+        ret = rpcsvc_sched_reconfigure (conf->rpc, this->options);
+        if (ret < 0) {
+                gf_log (this->name, GF_LOG_ERROR,
+                        "Failed to configure fair-share scheduling");
+                goto out;
+        }
+
         ret = rpcsvc_create_listeners (conf->rpc, this->options,
                                        this->name);
         if (ret < 1) {
@@ -1139,6 +1272,29 @@ struct volume_options options[] = {
         { .key   = {"transport.*"},
           .type  = GF_OPTION_TYPE_ANY,
         },
+        { .key   = {"rpc.fair-share"},
+          .type  = GF_OPTION_TYPE_BOOL,
+          .default_value = "off",
+          .description = "Queue requests per client once rpc.fair-share-limit "
+          "requests are in progress, and serve the queues in turns weighted "
+          "by the client class."
+        },
+        { .key   = {"rpc.fair-share-limit"},
+          .type  = GF_OPTION_TYPE_INT,
+          .min   = 1,
+          .max   = 65536,
+          .default_value = "64",
+          .description = "Number of requests in progress before fair-share "
+          "scheduling starts to queue them."
+        },
+        { .key   = {"rpc.fair-share-classes"},
+          .type  = GF_OPTION_TYPE_STR,
+          .default_value = RPCSVC_SCHED_DEFAULT_CLASSES,
+          .description = "Comma separated list of <address-pattern>:<weight> "
+          "client classes, the first matching one applies. The pattern "
+          "\"" RPCSVC_SCHED_INTERNAL_CLASS "\" matches gluster's own "
+          "daemons (rebalance, geo-replication ...)."
+        },
         { .key   = {"rpc*"},
           .type  = GF_OPTION_TYPE_ANY,
         },
@@ -1150,6 +1306,21 @@ struct volume_options options[] = {
           .description = "Specifies the maximum megabytes of memory to be "
           "used in the inode cache."
         },
+        { .key   = {"inode-lru-limit-bytes"},
+          .type  = GF_OPTION_TYPE_SIZET,
+          .min   = 0,
+          .default_value = "0",
+          .description = "Upper bound on the estimated memory held by unused "
+          "inodes in the inode cache. 0 means only inode-lru-limit applies."
+        },
+        { .key   = {"inode-rss-limit"},
+          .type  = GF_OPTION_TYPE_SIZET,
+          .min   = 0,
+          .default_value = "0",
+          .description = "When the resident size of the brick process goes "
+          "above this value, the inode cache is shrunk until it comes back "
+          "down. 0 disables the check."
+        },
         { .key   = {"verify-volfile-checksum"},
           .type  = GF_OPTION_TYPE_BOOL
         },
@@ -1244,5 +1415,37 @@ struct volume_options options[] = {
          .type = GF_OPTION_TYPE_STR,
          .description = "Allow a comma seperated fop lists",
         },
+        { .key   = {"event-threads"},
+          .type  = GF_OPTION_TYPE_INT,
+          .min   = 1,
+          .max   = 32,
+          .default_value = "1",
+          .description = "Specifies the number of event threads to execute "
+                         "in parallel. Larger values would help process "
+                         "responses faster, depending on available processing "
+                         "power. Range 1-32 threads."
+        },
+        { .key   = {"iobuf-page-classes"},
+          .type  = GF_OPTION_TYPE_STR,
+          .default_value = GF_IOBUF_DEFAULT_PAGE_CLASSES,
+          .description = "Comma separated list of <page-size>:<page-count> "
+                         "iobuf size classes, sorted on page size. Each "
+                         "arena of a class holds <page-count> buffers."
+        },
+        { .key   = {"iobuf-huge-pages"},
+          .type  = GF_OPTION_TYPE_STR,
+          .value = {"off", "transparent", "explicit"},
+          .default_value = "off",
+          .description = "Back iobuf arenas of at least one huge page with "
+                         "transparent huge pages, or with reserved huge "
+                         "pages (falling back to transparent ones when "
+                         "none are left)."
+        },
+        { .key   = {"iobuf-numa"},
+          .type  = GF_OPTION_TYPE_BOOL,
+          .default_value = "off",
+          .description = "Allocate iobuf arenas per NUMA node and serve "
+                         "buffers from the node of the calling thread."
+        },
         { .key   = {NULL} },
 };
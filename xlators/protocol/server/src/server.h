@@ -75,6 +75,8 @@ struct server_conf {
         rpcsvc_t               *rpc;
         struct rpcsvc_config    rpc_conf;
         int                     inode_lru_limit;
+        uint64_t                inode_lru_limit_bytes;
+        uint64_t                inode_rss_limit;
         gf_boolean_t            verify_volfile;
         gf_boolean_t            trace;
         gf_boolean_t            lk_heal; /* If true means lock self
@@ -87,6 +89,8 @@ struct server_conf {
         gf_barrier_t           *barrier;
         struct list_head        xprt_list;
         pthread_t               barrier_th;
+        int32_t                 event_threads; /* number of epoll threads
+                                                  requested for the brick */
 };
 typedef struct server_conf server_conf_t;
 
@@ -182,14 +186,29 @@ typedef struct _server_ctx {
         fdtable_t           *fdtable;
         struct _gf_timer    *grace_timer;
         uint32_t             lk_version;
+        uint32_t             xdata_keys; /* compact xdata, 0 if unsupported */
 } server_ctx_t;
 
+/* Reply dicts are sent in the compact format to clients which asked for it
+ * at setvolume.
+ */
+#define SERVER_DICT_SERIALIZE(frame,this,from_dict,to,len,ope,labl)     \
+        GF_PROTOCOL_DICT_SERIALIZE_COMPACT (this, from_dict,            \
+                                            server_xdata_keys (frame),  \
+                                            to, len, ope, labl)
+
 
 int
 server_submit_reply (call_frame_t *frame, rpcsvc_request_t *req, void *arg,
                      struct iovec *payload, int payloadcount,
                      struct iobref *iobref, xdrproc_t xdrproc);
 
+int
+server_submit_encoded_reply (call_frame_t *frame, rpcsvc_request_t *req,
+                             struct iobuf *iob, struct iovec *rsp,
+                             struct iovec *payload, int payloadcount,
+                             struct iobref *iobref);
+
 int gf_server_check_setxattr_cmd (call_frame_t *frame, dict_t *dict);
 int gf_server_check_getxattr_cmd (call_frame_t *frame, const char *name);
 
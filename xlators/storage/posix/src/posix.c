@@ -2443,6 +2443,7 @@ __posix_writev (int fd, struct iovec *vector, int count, off_t startoff,
         int32_t         op_ret = 0;
         int             idx = 0;
         int             max_buf_size = 0;
+        int             aligned = 1;
         int             retval = 0;
         char            *buf = NULL;
         char            *alloc_buf = NULL;
@@ -2455,8 +2456,15 @@ __posix_writev (int fd, struct iovec *vector, int count, off_t startoff,
         for (idx = 0; idx < count; idx++) {
                 if (max_buf_size < vector[idx].iov_len)
                         max_buf_size = vector[idx].iov_len;
+                aligned &= !((unsigned long) vector[idx].iov_base
+                             & (ALIGN_SIZE - 1));
+                aligned &= !(vector[idx].iov_len & (ALIGN_SIZE - 1));
         }
 
+        /* payloads received by the socket transport are page aligned */
+        if (aligned)
+                return __posix_pwritev (fd, vector, count, startoff);
+
         alloc_buf = _page_aligned_alloc (max_buf_size, &buf);
         if (!alloc_buf) {
                 op_ret = -errno;
@@ -4766,11 +4774,22 @@ posix_readdirp_fill (xlator_t *this, fd_t *fd, gf_dirent_t *entries, dict_t *dic
 	char            *hpath    = NULL;
 	int              len      = 0;
         struct iatt      stbuf    = {0, };
+        dict_t          *xattr_req = NULL;
+        dict_t          *nocontent = NULL;
+        gf_boolean_t     content_req = _gf_false;
+        uint64_t         content_left = 0;
 	uuid_t           gfid;
 
 	if (list_empty(&entries->list))
 		return 0;
 
+        /* quick-read asking for the content of small files along with the
+           entries, up to POSIX_READDIRP_CONTENT_MAX of it in the reply */
+        if (dict && dict_get (dict, GF_CONTENT_KEY)) {
+                content_req = _gf_true;
+                content_left = POSIX_READDIRP_CONTENT_MAX;
+        }
+
         itable = fd->inode->table;
 
 	len = posix_handle_path (this, fd->inode->gfid, NULL, NULL, 0);
@@ -4799,11 +4818,30 @@ posix_readdirp_fill (xlator_t *this, fd_t *fd, gf_dirent_t *entries, dict_t *dic
 		entry->inode = inode;
 
                 if (dict) {
+                        xattr_req = dict;
+                        if (content_req && IA_ISREG (stbuf.ia_type) &&
+                            stbuf.ia_size > content_left) {
+                                if (!nocontent) {
+                                        nocontent = dict_copy_with_ref (dict,
+                                                                        NULL);
+                                        if (nocontent)
+                                                dict_del (nocontent,
+                                                          GF_CONTENT_KEY);
+                                }
+                                if (nocontent)
+                                        xattr_req = nocontent;
+                        }
+
                         entry->dict =
                                 posix_entry_xattr_fill (this, entry->inode,
                                                         fd, entry->d_name,
-                                                        dict, &stbuf);
+                                                        xattr_req, &stbuf);
                         dict_ref (entry->dict);
+
+                        if (content_req &&
+                            dict_get (entry->dict, GF_CONTENT_KEY))
+                                content_left -= min (content_left,
+                                                     stbuf.ia_size);
                 }
 
                 entry->d_stat = stbuf;
@@ -4812,6 +4850,9 @@ posix_readdirp_fill (xlator_t *this, fd_t *fd, gf_dirent_t *entries, dict_t *dic
 		inode = NULL;
         }
 
+        if (nocontent)
+                dict_unref (nocontent);
+
 	return 0;
 }
 
@@ -53,6 +53,9 @@
 #define VECTOR_SIZE 64 * 1024 /* vector size 64KB*/
 #define MAX_NO_VECT 1024
 
+/* file content (GF_CONTENT_KEY) put in the entries of one readdirp reply */
+#define POSIX_READDIRP_CONTENT_MAX (128 * GF_UNIT_KB)
+
 #define POSIX_GFID_HANDLE_SIZE(base_path_len) (base_path_len + SLEN("/") \
                                                + SLEN(GF_HIDDEN_PATH) + SLEN("/") \
                                                + SLEN("00/")            \